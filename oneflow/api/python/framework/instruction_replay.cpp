@@ -33,4 +33,16 @@ ONEFLOW_API_PYBIND11_MODULE("debug", m) {
 
 }  // namespace debug
 
+ONEFLOW_API_PYBIND11_MODULE("", m) {
+  py::class_<InstructionCapture, std::shared_ptr<InstructionCapture>>(m, "InstructionCapture")
+      .def(py::init<>())
+      .def("begin_capture",
+           [](InstructionCapture* capture) { return capture->BeginCapture().GetOrThrow(); })
+      .def("end_capture",
+           [](InstructionCapture* capture) { return capture->EndCapture().GetOrThrow(); })
+      .def("replay", [](InstructionCapture* capture) { return capture->Replay().GetOrThrow(); })
+      .def_property_readonly("valid", &InstructionCapture::valid)
+      .def_property_readonly("instruction_num", &InstructionCapture::instruction_num);
+}
+
 }  // namespace oneflow
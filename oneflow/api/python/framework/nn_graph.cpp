@@ -34,6 +34,7 @@ ONEFLOW_API_PYBIND11_MODULE("nn.graph.", m) {
   py::class_<NNGraph, std::shared_ptr<NNGraph>>(m, "CNNGraph")
       .def(py::init<const std::string&>())
       .def_property_readonly("name", &NNGraph::job_name)
+      .def_property_readonly("plan_cache_hit", &NNGraph::plan_cache_hit)
       .def(
           "register_input_op_names_and_tensors",
           [](NNGraph& graph, const std::vector<std::string>& input_op_names,
@@ -0,0 +1,54 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <pybind11/pybind11.h>
+#include "oneflow/api/python/of_api_registry.h"
+#include "oneflow/core/common/global.h"
+#include "oneflow/core/common/throw.h"
+#include "oneflow/core/vm/virtual_machine.h"
+
+namespace oneflow {
+namespace vm {
+
+namespace py = pybind11;
+
+ONEFLOW_API_PYBIND11_MODULE("vm", m) {
+  py::class_<SchedulerStats>(m, "SchedulerStats")
+      .def_readonly("wakeup_cnt", &SchedulerStats::wakeup_cnt)
+      .def_readonly("schedule_cnt", &SchedulerStats::schedule_cnt)
+      .def_readonly("spin_us", &SchedulerStats::spin_us)
+      .def_readonly("flying_instruction_cnt", &SchedulerStats::flying_instruction_cnt)
+      .def_readonly("max_flying_instruction_cnt", &SchedulerStats::max_flying_instruction_cnt);
+
+  m.def("GetSchedulerStats", []() -> SchedulerStats {
+    const auto* virtual_machine = Global<VirtualMachine>::Get();
+    CHECK_NOTNULL_OR_THROW(virtual_machine);
+    return virtual_machine->scheduler_stats();
+  });
+
+  m.def("GetSchedulerPolicy", []() -> std::string {
+    const auto* virtual_machine = Global<VirtualMachine>::Get();
+    CHECK_NOTNULL_OR_THROW(virtual_machine);
+    switch (virtual_machine->scheduler_policy()) {
+      case SchedulerPolicy::kLatency: return "latency";
+      case SchedulerPolicy::kBalanced: return "balanced";
+      case SchedulerPolicy::kEfficiency: return "efficiency";
+    }
+    return "";
+  });
+}
+
+}  // namespace vm
+}  // namespace oneflow
@@ -37,6 +37,7 @@ void CommNet::DeleteActorReadId(void* actor_read_id) {
 void CommNet::Read(void* actor_read_id, int64_t src_machine_id, void* src_token, void* dst_token) {
   auto actor_read_ctx = static_cast<ActorReadContext*>(actor_read_id);
   ReadContext* read_ctx = new ReadContext;
+  read_ctx->comm_net = this;
   read_ctx->actor_read_ctx = actor_read_ctx;
   auto do_read = [this, read_ctx, src_machine_id, src_token, dst_token]() {
     DoRead(read_ctx, src_machine_id, src_token, dst_token);
@@ -61,7 +62,7 @@ void CommNet::ReadDone(void* read_id) {
     item = actor_read_ctx->waiting_list.front();
     actor_read_ctx->waiting_list.pop_front();
     CHECK(item.callback);
-    ready_cbs_.Send(item.callback);
+    read_ctx->comm_net->ready_cbs_.Send(item.callback);
     if (item.is_read) { break; }
   }
   delete read_ctx;
@@ -63,6 +63,8 @@ class CommNet {
   void AddWorkToStream(void* actor_read_id, const std::function<void()>& cb, bool is_read);
   struct ActorReadContext;
   struct ReadContext {
+    // the comm net the read was issued to, ReadDone may be reported by the one it delegates to
+    CommNet* comm_net;
     ActorReadContext* actor_read_ctx;
   };
   struct ActorReadContext {
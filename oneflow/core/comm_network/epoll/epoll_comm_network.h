@@ -37,6 +37,8 @@ class EpollCommNet final : public CommNetIf<SocketMemDesc> {
   SocketMemDesc* NewMemDesc(void* ptr, size_t byte_size) override;
 
   friend class Global<EpollCommNet>;
+  // ShmCommNet hands the reads from peers on other hosts over to EpollCommNet
+  friend class ShmCommNet;
   EpollCommNet();
   void InitSockets();
   SocketHelper* GetSocketHelper(int64_t machine_id);
@@ -28,8 +28,18 @@ SocketReadHelper::~SocketReadHelper() {
   // do nothing
 }
 
+namespace {
+
+constexpr size_t kSocketReadBufferSize = 64 * 1024;
+static_assert(kSocketReadBufferSize >= sizeof(SocketMsg), "");
+
+}  // namespace
+
 SocketReadHelper::SocketReadHelper(int sockfd) {
   sockfd_ = sockfd;
+  read_buf_.resize(kSocketReadBufferSize);
+  read_buf_begin_ = 0;
+  read_buf_end_ = 0;
   SwitchToMsgHeadReadHandle();
 }
 
@@ -37,8 +47,8 @@ void SocketReadHelper::NotifyMeSocketReadable() { ReadUntilSocketNotReadable();
 
 void SocketReadHelper::SwitchToMsgHeadReadHandle() {
   cur_read_handle_ = &SocketReadHelper::MsgHeadReadHandle;
-  read_ptr_ = reinterpret_cast<char*>(&cur_msg_);
-  read_size_ = sizeof(cur_msg_);
+  read_ptr_ = nullptr;
+  read_size_ = 0;
 }
 
 void SocketReadHelper::ReadUntilSocketNotReadable() {
@@ -46,23 +56,52 @@ void SocketReadHelper::ReadUntilSocketNotReadable() {
 }
 
 bool SocketReadHelper::MsgHeadReadHandle() {
-  return DoCurRead(&SocketReadHelper::SetStatusWhenMsgHeadDone);
+  // dispatch all the buffered heads before reading the socket again
+  while (read_buf_end_ - read_buf_begin_ >= sizeof(SocketMsg)) {
+    std::memcpy(&cur_msg_, read_buf_.data() + read_buf_begin_, sizeof(SocketMsg));
+    read_buf_begin_ += sizeof(SocketMsg);
+    SetStatusWhenMsgHeadDone();
+    if (cur_read_handle_ != &SocketReadHelper::MsgHeadReadHandle) { return true; }
+  }
+  if (read_buf_begin_ > 0) {
+    std::memmove(read_buf_.data(), read_buf_.data() + read_buf_begin_,
+                 read_buf_end_ - read_buf_begin_);
+    read_buf_end_ -= read_buf_begin_;
+    read_buf_begin_ = 0;
+  }
+  size_t n = 0;
+  if (!DoCurRead(read_buf_.data() + read_buf_end_, read_buf_.size() - read_buf_end_, &n)) {
+    return false;
+  }
+  read_buf_end_ += n;
+  return true;
 }
 
 bool SocketReadHelper::MsgBodyReadHandle() {
-  return DoCurRead(&SocketReadHelper::SetStatusWhenMsgBodyDone);
+  size_t n = 0;
+  if (read_size_ == 0) {
+    // empty body
+  } else if (read_buf_end_ > read_buf_begin_) {
+    // the beginning of the body came in with its head
+    n = std::min(read_size_, read_buf_end_ - read_buf_begin_);
+    std::memcpy(read_ptr_, read_buf_.data() + read_buf_begin_, n);
+    read_buf_begin_ += n;
+  } else {
+    // large bodies bypass the buffer
+    if (!DoCurRead(read_ptr_, read_size_, &n)) { return false; }
+  }
+  read_ptr_ += n;
+  read_size_ -= n;
+  if (read_size_ == 0) { SetStatusWhenMsgBodyDone(); }
+  return true;
 }
 
-bool SocketReadHelper::DoCurRead(void (SocketReadHelper::*set_cur_read_done)()) {
-  ssize_t n = read(sockfd_, read_ptr_, read_size_);
+bool SocketReadHelper::DoCurRead(char* ptr, size_t size, size_t* read_size) {
+  ssize_t n = read(sockfd_, ptr, size);
   const int val = 1;
   PCHECK(setsockopt(sockfd_, IPPROTO_TCP, TCP_QUICKACK, (char*)&val, sizeof(int)) == 0);
-  if (n == read_size_) {
-    (this->*set_cur_read_done)();
-    return true;
-  } else if (n >= 0) {
-    read_ptr_ += n;
-    read_size_ -= n;
+  if (n >= 0) {
+    *read_size = n;
     return true;
   } else {
     CHECK_EQ(n, -1);
@@ -39,7 +39,7 @@ class SocketReadHelper final {
   bool MsgHeadReadHandle();
   bool MsgBodyReadHandle();
 
-  bool DoCurRead(void (SocketReadHelper::*set_cur_read_done)());
+  bool DoCurRead(char* ptr, size_t size, size_t* read_size);
   void SetStatusWhenMsgHeadDone();
   void SetStatusWhenMsgBodyDone();
 
@@ -53,6 +53,11 @@ class SocketReadHelper final {
   bool (SocketReadHelper::*cur_read_handle_)();
   char* read_ptr_;
   size_t read_size_;
+
+  // Bytes read from the socket but not consumed yet, one read usually brings in many heads.
+  std::vector<char> read_buf_;
+  size_t read_buf_begin_;
+  size_t read_buf_end_;
 };
 
 }  // namespace oneflow
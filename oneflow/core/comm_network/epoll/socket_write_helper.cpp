@@ -18,6 +18,7 @@ limitations under the License.
 #include "oneflow/core/comm_network/epoll/socket_write_helper.h"
 #include "oneflow/core/comm_network/epoll/socket_memory_desc.h"
 
+#include <limits.h>
 #include <sys/eventfd.h>
 
 namespace oneflow {
@@ -38,11 +39,12 @@ SocketWriteHelper::SocketWriteHelper(int sockfd, IOEventPoller* poller) {
   PCHECK(queue_not_empty_fd_ != -1);
   poller->AddFdWithOnlyReadHandler(queue_not_empty_fd_,
                                    std::bind(&SocketWriteHelper::ProcessQueueNotEmptyEvent, this));
+  // 1 writes the messages one by one
+  max_write_batch_msg_num_ =
+      std::max<int64_t>(ParseIntegerFromEnv("ONEFLOW_COMM_NET_SOCKET_MAX_WRITE_BATCH", 64), 1);
   cur_msg_queue_ = new std::queue<SocketMsg>;
   pending_msg_queue_ = new std::queue<SocketMsg>;
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
-  write_ptr_ = nullptr;
-  write_size_ = 0;
+  write_iov_idx_ = 0;
 }
 
 void SocketWriteHelper::AsyncWrite(const SocketMsg& msg) {
@@ -67,10 +69,16 @@ void SocketWriteHelper::ProcessQueueNotEmptyEvent() {
 }
 
 void SocketWriteHelper::WriteUntilMsgQueueEmptyOrSocketNotWriteable() {
-  while ((this->*cur_write_handle_)()) {}
+  while (true) {
+    if (write_iov_idx_ == write_iovs_.size() && !InitWriteBatch()) { return; }
+    if (!DoCurWrite()) { return; }
+  }
 }
 
-bool SocketWriteHelper::InitMsgWriteHandle() {
+bool SocketWriteHelper::InitWriteBatch() {
+  write_batch_msgs_.clear();
+  write_iovs_.clear();
+  write_iov_idx_ = 0;
   if (cur_msg_queue_->empty()) {
     {
       std::unique_lock<std::mutex> lck(pending_msg_queue_mtx_);
@@ -78,30 +86,40 @@ bool SocketWriteHelper::InitMsgWriteHandle() {
     }
     if (cur_msg_queue_->empty()) { return false; }
   }
-  cur_msg_ = cur_msg_queue_->front();
-  cur_msg_queue_->pop();
-  write_ptr_ = reinterpret_cast<const char*>(&cur_msg_);
-  write_size_ = sizeof(cur_msg_);
-  cur_write_handle_ = &SocketWriteHelper::MsgHeadWriteHandle;
+  while (!cur_msg_queue_->empty() && write_batch_msgs_.size() < max_write_batch_msg_num_) {
+    AppendMsgToWriteBatch(cur_msg_queue_->front());
+    cur_msg_queue_->pop();
+  }
   return true;
 }
 
-bool SocketWriteHelper::MsgHeadWriteHandle() {
-  return DoCurWrite(&SocketWriteHelper::SetStatusWhenMsgHeadDone);
-}
-
-bool SocketWriteHelper::MsgBodyWriteHandle() {
-  return DoCurWrite(&SocketWriteHelper::SetStatusWhenMsgBodyDone);
+void SocketWriteHelper::AppendMsgToWriteBatch(const SocketMsg& msg) {
+  write_batch_msgs_.push_back(msg);
+  write_iovs_.push_back({&write_batch_msgs_.back(), sizeof(SocketMsg)});
+  if (msg.msg_type == SocketMsgType::kRequestRead) {
+    // the payload follows its head directly, the reader switches to the body after the head
+    auto src_mem_desc = static_cast<const SocketMemDesc*>(msg.request_read_msg.src_token);
+    if (src_mem_desc->byte_size > 0) {
+      write_iovs_.push_back({src_mem_desc->mem_ptr, src_mem_desc->byte_size});
+    }
+  }
 }
 
-bool SocketWriteHelper::DoCurWrite(void (SocketWriteHelper::*set_cur_write_done)()) {
-  ssize_t n = write(sockfd_, write_ptr_, write_size_);
-  if (n == write_size_) {
-    (this->*set_cur_write_done)();
-    return true;
-  } else if (n >= 0) {
-    write_ptr_ += n;
-    write_size_ -= n;
+bool SocketWriteHelper::DoCurWrite() {
+  const int iov_cnt = std::min<size_t>(write_iovs_.size() - write_iov_idx_, IOV_MAX);
+  ssize_t n = writev(sockfd_, write_iovs_.data() + write_iov_idx_, iov_cnt);
+  if (n >= 0) {
+    while (n > 0) {
+      struct iovec* iov = &write_iovs_.at(write_iov_idx_);
+      if (static_cast<size_t>(n) >= iov->iov_len) {
+        n -= iov->iov_len;
+        write_iov_idx_ += 1;
+      } else {
+        iov->iov_base = static_cast<char*>(iov->iov_base) + n;
+        iov->iov_len -= n;
+        n = 0;
+      }
+    }
     return true;
   } else {
     CHECK_EQ(n, -1);
@@ -110,40 +128,6 @@ bool SocketWriteHelper::DoCurWrite(void (SocketWriteHelper::*set_cur_write_done)
   }
 }
 
-void SocketWriteHelper::SetStatusWhenMsgHeadDone() {
-  switch (cur_msg_.msg_type) {
-#define MAKE_ENTRY(x, y) \
-  case SocketMsgType::k##x: return SetStatusWhen##x##MsgHeadDone();
-    OF_PP_FOR_EACH_TUPLE(MAKE_ENTRY, SOCKET_MSG_TYPE_SEQ);
-#undef MAKE_ENTRY
-    default: UNIMPLEMENTED();
-  }
-}
-
-void SocketWriteHelper::SetStatusWhenMsgBodyDone() {
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
-}
-
-void SocketWriteHelper::SetStatusWhenRequestWriteMsgHeadDone() {
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
-}
-
-void SocketWriteHelper::SetStatusWhenRequestReadMsgHeadDone() {
-  const void* src_token = cur_msg_.request_read_msg.src_token;
-  auto src_mem_desc = static_cast<const SocketMemDesc*>(src_token);
-  write_ptr_ = reinterpret_cast<const char*>(src_mem_desc->mem_ptr);
-  write_size_ = src_mem_desc->byte_size;
-  cur_write_handle_ = &SocketWriteHelper::MsgBodyWriteHandle;
-}
-
-void SocketWriteHelper::SetStatusWhenActorMsgHeadDone() {
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
-}
-
-void SocketWriteHelper::SetStatusWhenTransportMsgHeadDone() {
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
-}
-
 }  // namespace oneflow
 
 #endif  // __linux__
@@ -21,6 +21,8 @@ limitations under the License.
 
 #ifdef OF_PLATFORM_POSIX
 
+#include <sys/uio.h>
+
 namespace oneflow {
 
 class SocketWriteHelper final {
@@ -40,30 +42,24 @@ class SocketWriteHelper final {
   void ProcessQueueNotEmptyEvent();
 
   void WriteUntilMsgQueueEmptyOrSocketNotWriteable();
-  bool InitMsgWriteHandle();
-  bool MsgHeadWriteHandle();
-  bool MsgBodyWriteHandle();
-
-  bool DoCurWrite(void (SocketWriteHelper::*set_cur_write_done)());
-  void SetStatusWhenMsgHeadDone();
-  void SetStatusWhenMsgBodyDone();
-
-#define MAKE_ENTRY(x, y) void SetStatusWhen##x##MsgHeadDone();
-  OF_PP_FOR_EACH_TUPLE(MAKE_ENTRY, SOCKET_MSG_TYPE_SEQ);
-#undef MAKE_ENTRY
+  bool InitWriteBatch();
+  void AppendMsgToWriteBatch(const SocketMsg& msg);
+  bool DoCurWrite();
 
   int sockfd_;
   int queue_not_empty_fd_;
+  size_t max_write_batch_msg_num_;
 
   std::queue<SocketMsg>* cur_msg_queue_;
 
   std::mutex pending_msg_queue_mtx_;
   std::queue<SocketMsg>* pending_msg_queue_;
 
-  SocketMsg cur_msg_;
-  bool (SocketWriteHelper::*cur_write_handle_)();
-  const char* write_ptr_;
-  size_t write_size_;
+  // Messages of the batch being written, the heads are gathered from here so it must keep the
+  // addresses of its elements stable while growing.
+  std::deque<SocketMsg> write_batch_msgs_;
+  std::vector<struct iovec> write_iovs_;
+  size_t write_iov_idx_;
 };
 
 }  // namespace oneflow
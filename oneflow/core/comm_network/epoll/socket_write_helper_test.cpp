@@ -0,0 +1,115 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifdef __linux__
+
+#include "oneflow/core/comm_network/epoll/socket_write_helper.h"
+#include "oneflow/core/comm_network/epoll/socket_memory_desc.h"
+#include <gtest/gtest.h>
+#include <cstdlib>
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+void ReadFully(int fd, char* dst, size_t size) {
+  // small reads keep the send buffer of the writer full, so most writev calls are partial
+  constexpr size_t kMaxReadSize = 1000;
+  while (size > 0) {
+    const ssize_t n = read(fd, dst, std::min(size, kMaxReadSize));
+    PCHECK(n > 0);
+    dst += n;
+    size -= n;
+  }
+}
+
+// Writes request-write heads, which stand alone, and request-read heads, which are followed by
+// their payload, through a socket with a tiny send buffer and checks the byte stream on the other
+// end: every head and payload arrives intact and in the order it was written.
+void TestSocketWriteHelper(const std::string& max_write_batch) {
+  setenv("ONEFLOW_COMM_NET_SOCKET_MAX_WRITE_BATCH", max_write_batch.c_str(), 1);
+  int fds[2];
+  PCHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  const int send_fd = fds[0];
+  const int recv_fd = fds[1];
+  const int buf_size = 4096;
+  PCHECK(setsockopt(send_fd, SOL_SOCKET, SO_SNDBUF, &buf_size, sizeof(buf_size)) == 0);
+  PCHECK(setsockopt(recv_fd, SOL_SOCKET, SO_RCVBUF, &buf_size, sizeof(buf_size)) == 0);
+
+  constexpr int64_t kMsgNum = 3000;
+  const std::vector<size_t> body_sizes{0, 1, 3, 4095, 4097, 70001};
+  std::vector<SocketMsg> msgs(kMsgNum);
+  std::vector<std::vector<char>> bodies(kMsgNum);
+  std::vector<SocketMemDesc> mem_descs(kMsgNum);
+  for (int64_t i = 0; i < kMsgNum; ++i) {
+    SocketMsg* msg = &msgs[i];
+    std::memset(msg, 0, sizeof(SocketMsg));
+    if (i % 7 == 3) {
+      std::vector<char>* body = &bodies[i];
+      body->resize(body_sizes[(i / 7) % body_sizes.size()]);
+      for (size_t j = 0; j < body->size(); ++j) { (*body)[j] = static_cast<char>(j * 31 + i); }
+      mem_descs[i] = {body->data(), body->size()};
+      msg->msg_type = SocketMsgType::kRequestRead;
+      msg->request_read_msg.src_token = &mem_descs[i];
+      msg->request_read_msg.read_id = reinterpret_cast<void*>(i);
+    } else {
+      msg->msg_type = SocketMsgType::kRequestWrite;
+      msg->request_write_msg.dst_machine_id = i;
+      msg->request_write_msg.read_id = reinterpret_cast<void*>(i);
+    }
+  }
+
+  IOEventPoller poller;
+  SocketWriteHelper writer(send_fd, &poller);
+  poller.AddFd(
+      send_fd, []() {}, [&writer]() { writer.NotifyMeSocketWriteable(); });
+  poller.Start();
+  for (const SocketMsg& msg : msgs) { writer.AsyncWrite(msg); }
+
+  SocketMsg head;
+  std::vector<char> body;
+  for (int64_t i = 0; i < kMsgNum; ++i) {
+    ReadFully(recv_fd, reinterpret_cast<char*>(&head), sizeof(SocketMsg));
+    ASSERT_EQ(std::memcmp(&head, &msgs[i], sizeof(SocketMsg)), 0) << "message " << i;
+    if (head.msg_type == SocketMsgType::kRequestRead) {
+      body.resize(bodies[i].size());
+      ReadFully(recv_fd, body.data(), body.size());
+      ASSERT_TRUE(body == bodies[i]) << "message " << i;
+    }
+  }
+  // nothing follows the last message
+  char extra = 0;
+  ASSERT_EQ(recv(recv_fd, &extra, 1, MSG_DONTWAIT), -1);
+  ASSERT_TRUE(errno == EAGAIN || errno == EWOULDBLOCK);
+
+  poller.Stop();
+  // the poller closes send_fd
+  PCHECK(close(recv_fd) == 0);
+  unsetenv("ONEFLOW_COMM_NET_SOCKET_MAX_WRITE_BATCH");
+}
+
+}  // namespace
+
+TEST(SocketWriteHelper, partial_batched_writes) { TestSocketWriteHelper("64"); }
+
+TEST(SocketWriteHelper, partial_single_writes) { TestSocketWriteHelper("1"); }
+
+}  // namespace test
+
+}  // namespace oneflow
+
+#endif  // __linux__
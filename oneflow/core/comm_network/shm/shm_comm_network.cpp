@@ -0,0 +1,206 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifdef __linux__
+
+#include "oneflow/core/comm_network/shm/shm_comm_network.h"
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <unistd.h>
+#include <cerrno>
+#include "oneflow/core/comm_network/epoll/epoll_comm_network.h"
+#include "oneflow/core/comm_network/shm/shm_segment.h"
+#include "oneflow/core/common/futex.h"
+#include "oneflow/core/comm_network/shm/shm_comm_network.pb.h"
+#include "oneflow/core/control/ctrl_client.h"
+#include "oneflow/core/control/global_process_ctx.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/lazy/actor/actor_message_bus.h"
+
+namespace oneflow {
+
+namespace {
+
+constexpr int64_t kMaxSpinRound = 1 << 14;
+constexpr int64_t kFutexWaitTimeoutMs = 100;
+
+std::string GenInfoKey(int64_t machine_id) {
+  return "ShmCommNetInfo/" + std::to_string(machine_id);
+}
+
+}  // namespace
+
+ShmCommNet::~ShmCommNet() {
+  // no peer sends anything after this barrier
+  OF_ENV_BARRIER();
+  poll_exit_flag_.store(true, std::memory_order_release);
+  segment_->header()->doorbell.fetch_add(1, std::memory_order_release);
+  FutexWakeOne(&segment_->header()->doorbell);
+  poll_thread_.join();
+  for (auto& peer : local_rank2peer_) {
+    if (peer) { delete peer->segment; }
+  }
+  delete segment_;
+}
+
+void ShmCommNet::SendActorMsg(int64_t dst_machine_id, const ActorMsg& msg) {
+  if (!IsShmPeer(dst_machine_id)) {
+    Global<EpollCommNet>::Get()->SendActorMsg(dst_machine_id, msg);
+    return;
+  }
+  ActorMsg new_msg = msg;
+  if (msg.IsDataRegstMsgToConsumer()) {
+    CHECK_EQ(msg.user_data_size(), 0);
+    auto* mem_desc = static_cast<SocketMemDesc*>(msg.regst()->comm_net_token());
+    CHECK(mem_desc != nullptr);
+    ShmCommNetRMADesc rma_desc{};
+    rma_desc.mem_ptr = reinterpret_cast<uint64_t>(mem_desc->mem_ptr);
+    rma_desc.mem_size = mem_desc->byte_size;
+    rma_desc.token = reinterpret_cast<uint64_t>(mem_desc);
+    static_assert(sizeof(ShmCommNetRMADesc) <= kActorMsgUserDataMaxSize, "");
+    new_msg.AddUserData(sizeof(ShmCommNetRMADesc), &rma_desc);
+  }
+  ShmPeer* peer = local_rank2peer_.at(GlobalProcessCtx::LocalRank(dst_machine_id)).get();
+  std::lock_guard<std::mutex> lock(peer->send_mutex);
+  peer->segment->Push(GlobalProcessCtx::LocalRank(GlobalProcessCtx::Rank()), new_msg);
+}
+
+void ShmCommNet::RecvActorMsg(const ActorMsg& msg) {
+  ActorMsg new_msg = msg;
+  if (msg.IsDataRegstMsgToConsumer()) {
+    std::lock_guard<std::mutex> lock(remote_regst2rma_desc_mutex_);
+    auto& desc = remote_regst2rma_desc_[std::make_pair(msg.src_actor_id(),
+                                                       reinterpret_cast<uint64_t>(msg.regst()))];
+    if (!desc) { desc.reset(new ShmCommNetRMADesc); }
+    CHECK_EQ(msg.user_data_size(), sizeof(ShmCommNetRMADesc));
+    std::memcpy(desc.get(), msg.user_data(), sizeof(ShmCommNetRMADesc));
+    new_msg.set_comm_net_token(desc.get());
+  }
+  deliver_(new_msg);
+}
+
+SocketMemDesc* ShmCommNet::NewMemDesc(void* ptr, size_t byte_size) {
+  SocketMemDesc* mem_desc = new SocketMemDesc;
+  mem_desc->mem_ptr = ptr;
+  mem_desc->byte_size = byte_size;
+  return mem_desc;
+}
+
+ShmCommNet::ShmCommNet()
+    : ShmCommNet([](const ActorMsg& msg) {
+        Global<ActorMsgBus>::Get()->SendMsgWithoutCommNet(msg);
+      }) {}
+
+ShmCommNet::ShmCommNet(const std::function<void(const ActorMsg&)>& Deliver)
+    : CommNetIf(), deliver_(Deliver), poll_exit_flag_(false) {
+  const int64_t this_machine_id = GlobalProcessCtx::Rank();
+  const int64_t local_rank_num = GlobalProcessCtx::NumOfProcessPerNode();
+  ring_capacity_ = ParseIntegerFromEnv("ONEFLOW_COMM_NET_SHM_RING_CAPACITY", 4096);
+  CHECK_GT(ring_capacity_, 0);
+  const bool cma_enabled = ParseBooleanFromEnv("ONEFLOW_COMM_NET_SHM_CMA_ENABLE", false);
+  if (cma_enabled) {
+    // Under yama ptrace_scope 1 only a ptracer may process_vm_readv this process. The peer pids
+    // are not known yet, so this admits every process of the user.
+    PCHECK(prctl(PR_SET_PTRACER, PR_SET_PTRACER_ANY, 0, 0, 0) == 0 || errno == EINVAL);
+  }
+  {
+    const std::string segment_name = "/oneflow_comm_net_" + std::to_string(getpid()) + "_"
+                                     + std::to_string(this_machine_id);
+    segment_ = new ShmSegment(segment_name, local_rank_num, ring_capacity_);
+    ShmCommNetInfo info;
+    info.set_pid(getpid());
+    info.set_segment_name(segment_name);
+    info.set_probe_addr(cma_enabled ? reinterpret_cast<uint64_t>(&segment_->header()->magic) : 0);
+    Global<CtrlClient>::Get()->PushKV(GenInfoKey(this_machine_id), info);
+  }
+  local_rank2peer_.resize(local_rank_num);
+  for (int64_t peer_id : peer_machine_id()) {
+    if (!IsShmPeer(peer_id)) { continue; }
+    ShmCommNetInfo info;
+    Global<CtrlClient>::Get()->PullKV(GenInfoKey(peer_id), &info);
+    auto peer = std::make_unique<ShmPeer>();
+    peer->pid = info.pid();
+    peer->segment = new ShmSegment(info.segment_name(), 0, 0);
+    peer->cross_memory_attach_enabled = cma_enabled && info.probe_addr() != 0
+                                        && ProbeCrossMemoryAttach(peer->pid, info.probe_addr());
+    LOG(INFO) << "CommNet:Shm connected to peer " << peer_id << ", reads go through "
+              << (peer->cross_memory_attach_enabled ? "cross memory attach" : "epoll");
+    local_rank2peer_.at(GlobalProcessCtx::LocalRank(peer_id)) = std::move(peer);
+  }
+  OF_ENV_BARRIER();
+  // every peer has mapped the segment, the name is not needed anymore
+  PCHECK(shm_unlink(segment_->name.c_str()) == 0);
+  Global<CtrlClient>::Get()->ClearKV(GenInfoKey(this_machine_id));
+  poll_thread_ = std::thread(&ShmCommNet::PollSegment, this);
+  OF_ENV_BARRIER();
+}
+
+bool ShmCommNet::IsShmPeer(int64_t machine_id) const {
+  return machine_id != GlobalProcessCtx::Rank()
+         && GlobalProcessCtx::NodeId(machine_id) == GlobalProcessCtx::ThisNodeId();
+}
+
+void ShmCommNet::DoRead(void* read_id, int64_t src_machine_id, void* src_token, void* dst_token) {
+  if (!IsShmPeer(src_machine_id)) {
+    Global<EpollCommNet>::Get()->DoRead(read_id, src_machine_id, src_token, dst_token);
+    return;
+  }
+  const auto* rma_desc = static_cast<const ShmCommNetRMADesc*>(src_token);
+  const auto* dst_mem_desc = static_cast<const SocketMemDesc*>(dst_token);
+  const ShmPeer* peer = local_rank2peer_.at(GlobalProcessCtx::LocalRank(src_machine_id)).get();
+  if (peer->cross_memory_attach_enabled) {
+    CHECK_EQ(rma_desc->mem_size, dst_mem_desc->byte_size);
+    PCHECK(ReadFromProcess(peer->pid, rma_desc->mem_ptr, dst_mem_desc->mem_ptr,
+                           dst_mem_desc->byte_size))
+        << "Fail to read from process " << peer->pid;
+    ReadDone(read_id);
+  } else {
+    Global<EpollCommNet>::Get()->DoRead(read_id, src_machine_id,
+                                        reinterpret_cast<void*>(rma_desc->token), dst_token);
+  }
+}
+
+void ShmCommNet::PollSegment() {
+  ShmSegmentHeader* header = segment_->header();
+  const int64_t ring_num = header->ring_num;
+  int64_t idle_round = 0;
+  while (!poll_exit_flag_.load(std::memory_order_acquire)) {
+    bool has_msg = false;
+    FOR_RANGE(int64_t, ring_id, 0, ring_num) {
+      if (segment_->Drain(ring_id, [this](const ActorMsg& msg) { RecvActorMsg(msg); }) > 0) {
+        has_msg = true;
+      }
+    }
+    if (has_msg) {
+      idle_round = 0;
+      continue;
+    }
+    if (++idle_round < kMaxSpinRound) { continue; }
+    // nothing came in for a while, sleep until a sender rings the doorbell
+    const uint32_t doorbell = header->doorbell.load(std::memory_order_acquire);
+    header->receiver_sleeping.store(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (segment_->AllRingsEmpty() && !poll_exit_flag_.load(std::memory_order_acquire)) {
+      FutexWait(&header->doorbell, doorbell, kFutexWaitTimeoutMs);
+    }
+    header->receiver_sleeping.store(0, std::memory_order_relaxed);
+    idle_round = 0;
+  }
+}
+
+}  // namespace oneflow
+
+#endif  // __linux__
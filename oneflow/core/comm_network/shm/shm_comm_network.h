@@ -0,0 +1,84 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMM_NETWORK_SHM_SHM_COMM_NETWORK_H_
+#define ONEFLOW_CORE_COMM_NETWORK_SHM_SHM_COMM_NETWORK_H_
+
+#ifdef __linux__
+
+#include "oneflow/core/comm_network/comm_network.h"
+#include "oneflow/core/comm_network/epoll/socket_memory_desc.h"
+
+namespace oneflow {
+
+struct ShmCommNetRMADesc {
+  uint64_t mem_ptr;
+  uint64_t mem_size;
+  // the SocketMemDesc of the region in the producer, used when the read goes through epoll
+  uint64_t token;
+};
+
+struct ShmSegment;
+
+// CommNet for processes on the same host. Actor messages go through lock-free single-producer
+// single-consumer rings in POSIX shared memory, one ring per sender in the segment owned by the
+// receiver. Reads copy the registered region straight out of the producer with cross memory attach
+// (process_vm_readv) when both processes opt in with ONEFLOW_COMM_NET_SHM_CMA_ENABLE, which lets
+// any process of the user ptrace them. Peers on other hosts and all other reads are delegated to
+// Global<EpollCommNet>. Memory tokens are SocketMemDesc, so they stay valid for EpollCommNet as
+// well.
+class ShmCommNet final : public CommNetIf<SocketMemDesc> {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ShmCommNet);
+  ~ShmCommNet();
+
+  void SendActorMsg(int64_t dst_machine_id, const ActorMsg& msg) override;
+
+ private:
+  friend class Global<ShmCommNet>;
+  ShmCommNet();
+  // hands the received actor messages to Deliver instead of Global<ActorMsgBus>
+  explicit ShmCommNet(const std::function<void(const ActorMsg&)>& Deliver);
+
+  struct ShmPeer {
+    int64_t pid;
+    bool cross_memory_attach_enabled;
+    ShmSegment* segment;
+    // the ring this process writes into, it has a single producer only under the lock
+    std::mutex send_mutex;
+  };
+
+  SocketMemDesc* NewMemDesc(void* ptr, size_t byte_size) override;
+  void DoRead(void* read_id, int64_t src_machine_id, void* src_token, void* dst_token) override;
+  void RecvActorMsg(const ActorMsg& msg);
+  void PollSegment();
+  bool IsShmPeer(int64_t machine_id) const;
+
+  std::function<void(const ActorMsg&)> deliver_;
+  int64_t ring_capacity_;
+  ShmSegment* segment_;
+  std::vector<std::unique_ptr<ShmPeer>> local_rank2peer_;
+  std::atomic<bool> poll_exit_flag_;
+  std::thread poll_thread_;
+  HashMap<std::pair<int64_t, uint64_t>, std::shared_ptr<ShmCommNetRMADesc>>
+      remote_regst2rma_desc_;
+  std::mutex remote_regst2rma_desc_mutex_;
+};
+
+}  // namespace oneflow
+
+#endif  // __linux__
+
+#endif  // ONEFLOW_CORE_COMM_NETWORK_SHM_SHM_COMM_NETWORK_H_
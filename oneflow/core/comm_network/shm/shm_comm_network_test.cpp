@@ -0,0 +1,247 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifdef __linux__
+
+#include "oneflow/core/comm_network/shm/shm_comm_network.h"
+#include <dirent.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include <fstream>
+#include <future>
+#include <sstream>
+#include "oneflow/core/comm_network/epoll/epoll_comm_network.h"
+#include "oneflow/core/common/channel.h"
+#include "oneflow/core/control/ctrl_client.h"
+#include "oneflow/core/control/global_process_ctx.h"
+#include "oneflow/core/job/env_desc.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/resource_desc.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+constexpr int64_t kRankNum = 2;
+
+// A CtrlClient for ranks forked from the test process. Every value is a file in a directory they
+// share, and barriers are numbered, since all ranks pass the same barriers in the same order.
+class FileCtrlClient final : public CtrlClient {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(FileCtrlClient);
+  FileCtrlClient(const std::string& dir, int64_t rank) : dir_(dir), rank_(rank), barrier_cnt_(0) {}
+  ~FileCtrlClient() override = default;
+
+  void Barrier(const std::string& barrier_name) override { Barrier(barrier_name, kRankNum); }
+  void Barrier(const std::string& barrier_name, int32_t barrier_num) override {
+    const std::string prefix = "barrier_" + std::to_string(barrier_cnt_++) + "_";
+    PushKV(prefix + std::to_string(rank_), "");
+    FOR_RANGE(int32_t, rank, 0, barrier_num) {
+      PullKV(prefix + std::to_string(rank), [](const std::string&) {});
+    }
+  }
+
+  TryLockResult TryLock(const std::string& name) override { UNIMPLEMENTED(); }
+  void NotifyDone(const std::string& name) override { UNIMPLEMENTED(); }
+  void WaitUntilDone(const std::string& name) override { UNIMPLEMENTED(); }
+
+  void PushKV(const std::string& k, std::function<void(std::string*)> VSetter) override {
+    std::string v;
+    VSetter(&v);
+    PushKV(k, v);
+  }
+  void PushKV(const std::string& k, const std::string& v) override {
+    // readers never see a partially written value
+    const std::string tmp_path = Path(k) + ".tmp";
+    std::ofstream(tmp_path, std::ios::binary) << v;
+    PCHECK(rename(tmp_path.c_str(), Path(k).c_str()) == 0);
+  }
+  void PushKV(const std::string& k, const PbMessage& msg) override {
+    PushKV(k, msg.SerializeAsString());
+  }
+  void PushMasterKV(const std::string& k, const PbMessage& msg) override { UNIMPLEMENTED(); }
+
+  void ClearKV(const std::string& k) override { PCHECK(unlink(Path(k).c_str()) == 0); }
+  void ClearMasterKV(const std::string& k) override { UNIMPLEMENTED(); }
+
+  void PullKV(const std::string& k, std::function<void(const std::string&)> VGetter) override {
+    while (access(Path(k).c_str(), F_OK) != 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::ostringstream v;
+    v << std::ifstream(Path(k), std::ios::binary).rdbuf();
+    VGetter(v.str());
+  }
+  void PullKV(const std::string& k, std::string* v) override {
+    PullKV(k, [v](const std::string& value) { *v = value; });
+  }
+  void PullKV(const std::string& k, PbMessage* msg) override {
+    PullKV(k, [msg](const std::string& value) { CHECK(msg->ParseFromString(value)); });
+  }
+  void PullMasterKV(const std::string& k, PbMessage* msg) override { UNIMPLEMENTED(); }
+
+  void Clear() override { UNIMPLEMENTED(); }
+  int32_t IncreaseCount(const std::string& k, int32_t v) override { UNIMPLEMENTED(); }
+  void EraseCount(const std::string& k) override { UNIMPLEMENTED(); }
+
+ private:
+  std::string Path(const std::string& k) const {
+    std::string name = k;
+    std::replace(name.begin(), name.end(), '/', '_');
+    return dir_ + "/" + name;
+  }
+
+  std::string dir_;
+  int64_t rank_;
+  int64_t barrier_cnt_;
+};
+
+constexpr int64_t kMsgNum = 10000;
+constexpr size_t kRegionSize = 1 << 20;
+
+char RegionByte(int64_t rank, size_t i) { return static_cast<char>(i * 7 + rank * 13); }
+
+// Brings up EpollCommNet and ShmCommNet as rank of kRankNum ranks on one node, then sends kMsgNum
+// actor messages to the other rank and reads its registered region, while it does the same.
+void RunRank(int64_t rank, const std::string& dir) {
+  setenv("LOCAL_RANK", std::to_string(rank).c_str(), 1);
+  // a small ring makes the senders wait for the receiver
+  setenv("ONEFLOW_COMM_NET_SHM_RING_CAPACITY", "16", 1);
+  EnvProto env_proto;
+  Global<ProcessCtx>::New();
+  Global<ProcessCtx>::Get()->set_rank(rank);
+  Global<ProcessCtx>::Get()->set_node_size(1);
+  FOR_RANGE(int64_t, i, 0, kRankNum) {
+    auto* machine = env_proto.add_machine();
+    machine->set_id(i);
+    machine->set_addr("127.0.0.1");
+    auto* addr = Global<ProcessCtx>::Get()->add_ctrl_addr();
+    addr->set_host("127.0.0.1");
+    addr->set_port(0);
+  }
+  Global<EnvDesc>::New(env_proto);
+  Resource resource;
+  resource.set_machine_num(kRankNum);
+  resource.set_cpu_device_num(1);
+  resource.set_comm_net_worker_num(1);
+  Global<ResourceDesc, ForSession>::New(resource, GlobalProcessCtx::NumOfProcessPerNode());
+  Global<CtrlClient>::SetAllocated(new FileCtrlClient(dir, rank));
+  Global<EpollCommNet>::New();
+  Channel<ActorMsg> received;
+  Global<ShmCommNet>::New([&received](const ActorMsg& msg) { received.Send(msg); });
+  ShmCommNet* comm_net = Global<ShmCommNet>::Get();
+  const int64_t peer = 1 - rank;
+
+  std::vector<char> region(kRegionSize);
+  FOR_RANGE(size_t, i, 0, kRegionSize) { region[i] = RegionByte(rank, i); }
+  void* region_token = comm_net->RegisterMemory(region.data(), kRegionSize);
+  ShmCommNetRMADesc rma_desc{};
+  rma_desc.mem_ptr = reinterpret_cast<uint64_t>(region.data());
+  rma_desc.mem_size = kRegionSize;
+  rma_desc.token = reinterpret_cast<uint64_t>(region_token);
+  Global<CtrlClient>::Get()->PushKV(
+      "region_" + std::to_string(rank),
+      std::string(reinterpret_cast<const char*>(&rma_desc), sizeof(rma_desc)));
+
+  std::thread sender([&]() {
+    FOR_RANGE(int64_t, i, 0, kMsgNum) {
+      comm_net->SendActorMsg(peer, ActorMsg::BuildCommandMsg(i, ActorCmd::kStart));
+    }
+  });
+  FOR_RANGE(int64_t, i, 0, kMsgNum) {
+    ActorMsg msg;
+    ASSERT_EQ(received.Receive(&msg), kChannelStatusSuccess);
+    ASSERT_EQ(msg.msg_type(), ActorMsgType::kCmdMsg);
+    ASSERT_EQ(msg.actor_cmd(), ActorCmd::kStart);
+    ASSERT_EQ(msg.dst_actor_id(), i);
+  }
+  sender.join();
+
+  std::string peer_rma_desc_str;
+  Global<CtrlClient>::Get()->PullKV("region_" + std::to_string(peer), &peer_rma_desc_str);
+  ASSERT_EQ(peer_rma_desc_str.size(), sizeof(ShmCommNetRMADesc));
+  ShmCommNetRMADesc peer_rma_desc{};
+  std::memcpy(&peer_rma_desc, peer_rma_desc_str.data(), sizeof(ShmCommNetRMADesc));
+  std::vector<char> dst(kRegionSize);
+  void* dst_token = comm_net->RegisterMemory(dst.data(), kRegionSize);
+  void* read_id = comm_net->NewActorReadId();
+  std::promise<void> read_done;
+  comm_net->Read(read_id, peer, &peer_rma_desc, dst_token);
+  comm_net->AddReadCallBack(read_id, [&read_done]() { read_done.set_value(); });
+  read_done.get_future().wait();
+  comm_net->DeleteActorReadId(read_id);
+  FOR_RANGE(size_t, i, 0, kRegionSize) { ASSERT_EQ(dst[i], RegionByte(peer, i)) << i; }
+
+  // the peer may still be reading the region
+  OF_ENV_BARRIER();
+  Global<CtrlClient>::Get()->ClearKV("region_" + std::to_string(rank));
+  comm_net->UnRegisterMemory(dst_token);
+  comm_net->UnRegisterMemory(region_token);
+  Global<ShmCommNet>::Delete();
+  received.Close();
+  Global<EpollCommNet>::Delete();
+  Global<CtrlClient>::Delete();
+  Global<ResourceDesc, ForSession>::Delete();
+  Global<EnvDesc>::Delete();
+  Global<ProcessCtx>::Delete();
+}
+
+void TestTwoLocalRanks(bool cma_enabled) {
+  char dir_template[] = "/tmp/oneflow_shm_comm_net_test_XXXXXX";
+  ASSERT_NE(mkdtemp(dir_template), nullptr);
+  const std::string dir = dir_template;
+  setenv("ONEFLOW_COMM_NET_SHM_CMA_ENABLE", cma_enabled ? "1" : "0", 1);
+  std::vector<pid_t> pids;
+  FOR_RANGE(int64_t, rank, 0, kRankNum) {
+    const pid_t pid = fork();
+    ASSERT_NE(pid, -1);
+    if (pid == 0) {
+      // a rank waiting for a peer that failed would hang forever
+      alarm(120);
+      RunRank(rank, dir);
+      _exit(testing::Test::HasFailure() ? 1 : 0);
+    }
+    pids.push_back(pid);
+  }
+  unsetenv("ONEFLOW_COMM_NET_SHM_CMA_ENABLE");
+  for (pid_t pid : pids) {
+    int status = 0;
+    ASSERT_EQ(waitpid(pid, &status, 0), pid);
+    EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0) << "status " << status;
+  }
+  DIR* d = opendir(dir.c_str());
+  ASSERT_NE(d, nullptr);
+  while (dirent* entry = readdir(d)) {
+    const std::string name = entry->d_name;
+    if (name != "." && name != "..") { unlink((dir + "/" + name).c_str()); }
+  }
+  closedir(d);
+  ASSERT_EQ(rmdir(dir.c_str()), 0);
+}
+
+}  // namespace
+
+TEST(ShmCommNet, two_local_ranks_with_cross_memory_attach) { TestTwoLocalRanks(true); }
+
+TEST(ShmCommNet, two_local_ranks_with_epoll_reads) { TestTwoLocalRanks(false); }
+
+}  // namespace test
+
+}  // namespace oneflow
+
+#endif  // __linux__
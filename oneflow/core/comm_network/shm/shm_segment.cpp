@@ -0,0 +1,139 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifdef __linux__
+
+#include "oneflow/core/comm_network/shm/shm_segment.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "oneflow/core/common/futex.h"
+
+namespace oneflow {
+
+namespace {
+
+size_t RoundUpToCacheLine(size_t size) { return (size + 63) / 64 * 64; }
+
+size_t RingByteSize(int64_t ring_capacity) {
+  return sizeof(ShmRingHeader) + RoundUpToCacheLine(ring_capacity * sizeof(ActorMsg));
+}
+
+size_t SegmentByteSize(int64_t ring_num, int64_t ring_capacity) {
+  return RoundUpToCacheLine(sizeof(ShmSegmentHeader)) + ring_num * RingByteSize(ring_capacity);
+}
+
+}  // namespace
+
+ShmSegment::ShmSegment(const std::string& name, int64_t ring_num, int64_t ring_capacity)
+    : name(name) {
+  const bool create = ring_num > 0;
+  int fd = shm_open(name.c_str(), create ? (O_CREAT | O_EXCL | O_RDWR) : O_RDWR, 0600);
+  PCHECK(fd != -1) << "Fail to open shared memory " << name;
+  if (create) {
+    size = SegmentByteSize(ring_num, ring_capacity);
+    PCHECK(ftruncate(fd, size) == 0) << "Fail to allocate " << size << " bytes shared memory";
+  } else {
+    struct stat st {};
+    PCHECK(fstat(fd, &st) == 0);
+    size = st.st_size;
+  }
+  ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  PCHECK(ptr != MAP_FAILED);
+  PCHECK(close(fd) == 0);
+  if (create) {
+    ShmSegmentHeader* segment_header = new (header()) ShmSegmentHeader;
+    segment_header->ring_num = ring_num;
+    segment_header->ring_capacity = ring_capacity;
+    segment_header->doorbell.store(0);
+    segment_header->receiver_sleeping.store(0);
+    FOR_RANGE(int64_t, ring_id, 0, ring_num) {
+      ShmRingHeader* ring = new (ring_header(ring_id)) ShmRingHeader;
+      ring->head.store(0);
+      ring->tail.store(0);
+    }
+    segment_header->magic = kShmSegmentMagic;
+  } else {
+    CHECK_EQ(header()->magic, kShmSegmentMagic);
+    CHECK_EQ(size, SegmentByteSize(header()->ring_num, header()->ring_capacity));
+  }
+}
+
+ShmSegment::~ShmSegment() { PCHECK(munmap(ptr, size) == 0); }
+
+ShmRingHeader* ShmSegment::ring_header(int64_t ring_id) const {
+  char* ring_ptr = static_cast<char*>(ptr) + RoundUpToCacheLine(sizeof(ShmSegmentHeader))
+                   + ring_id * RingByteSize(header()->ring_capacity);
+  return reinterpret_cast<ShmRingHeader*>(ring_ptr);
+}
+
+void ShmSegment::Push(int64_t ring_id, const ActorMsg& msg) const {
+  ShmRingHeader* ring = ring_header(ring_id);
+  const uint64_t capacity = header()->ring_capacity;
+  const uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+  // the receiver never blocks while draining, a full ring only has to wait
+  while (tail - ring->head.load(std::memory_order_acquire) >= capacity) {
+    std::this_thread::yield();
+  }
+  ring_slots(ring_id)[tail % capacity] = msg;
+  ring->tail.store(tail + 1, std::memory_order_release);
+  // pairs with the fence in ShmCommNet::PollSegment, either the receiver sees the message or we
+  // see it asleep
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (header()->receiver_sleeping.load(std::memory_order_relaxed) != 0) {
+    header()->doorbell.fetch_add(1, std::memory_order_release);
+    FutexWakeOne(&header()->doorbell);
+  }
+}
+
+bool ShmSegment::AllRingsEmpty() const {
+  FOR_RANGE(int64_t, ring_id, 0, header()->ring_num) {
+    const ShmRingHeader* ring = ring_header(ring_id);
+    if (ring->head.load(std::memory_order_relaxed)
+        != ring->tail.load(std::memory_order_acquire)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ReadFromProcess(int64_t pid, uint64_t src, void* dst, size_t size) {
+  char* dst_ptr = static_cast<char*>(dst);
+  while (size > 0) {
+    struct iovec local_iov {};
+    local_iov.iov_base = dst_ptr;
+    local_iov.iov_len = size;
+    struct iovec remote_iov {};
+    remote_iov.iov_base = reinterpret_cast<void*>(src);
+    remote_iov.iov_len = size;
+    ssize_t n = process_vm_readv(pid, &local_iov, 1, &remote_iov, 1, 0);
+    if (n <= 0) { return false; }
+    dst_ptr += n;
+    src += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool ProbeCrossMemoryAttach(int64_t pid, uint64_t probe_addr) {
+  uint64_t magic = 0;
+  return ReadFromProcess(pid, probe_addr, &magic, sizeof(magic)) && magic == kShmSegmentMagic;
+}
+
+}  // namespace oneflow
+
+#endif  // __linux__
@@ -0,0 +1,96 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMM_NETWORK_SHM_SHM_SEGMENT_H_
+#define ONEFLOW_CORE_COMM_NETWORK_SHM_SHM_SEGMENT_H_
+
+#ifdef __linux__
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/lazy/actor/actor_message.h"
+
+namespace oneflow {
+
+constexpr uint64_t kShmSegmentMagic = 0x4f46534d434e4554;  // "OFSMCNET"
+
+static_assert(std::is_trivially_copyable<ActorMsg>::value, "");
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "shm rings need address-free atomics");
+
+struct ShmSegmentHeader {
+  uint64_t magic;
+  int64_t ring_num;
+  int64_t ring_capacity;
+  // futex word, bumped by senders that find the receiver asleep
+  alignas(64) std::atomic<uint32_t> doorbell;
+  std::atomic<uint32_t> receiver_sleeping;
+};
+
+struct ShmRingHeader {
+  // next slot to pop, only written by the receiver
+  alignas(64) std::atomic<uint64_t> head;
+  // next slot to push, only written by the sender
+  alignas(64) std::atomic<uint64_t> tail;
+};
+
+// A POSIX shared memory segment of ring_num single-producer single-consumer rings of ActorMsg,
+// each with ring_capacity slots. The receiver creates it and every sender maps it by name.
+struct ShmSegment {
+  OF_DISALLOW_COPY_AND_MOVE(ShmSegment);
+  // creates the segment when ring_num > 0, otherwise opens the one created by the peer
+  ShmSegment(const std::string& name, int64_t ring_num, int64_t ring_capacity);
+  ~ShmSegment();
+
+  ShmSegmentHeader* header() const { return static_cast<ShmSegmentHeader*>(ptr); }
+  ShmRingHeader* ring_header(int64_t ring_id) const;
+  ActorMsg* ring_slots(int64_t ring_id) const {
+    return reinterpret_cast<ActorMsg*>(ring_header(ring_id) + 1);
+  }
+
+  // Waits while the ring is full, then pushes msg and wakes the receiver if it sleeps.
+  void Push(int64_t ring_id, const ActorMsg& msg) const;
+  // Pops the messages pushed so far into the ring and calls handler on each of them in order.
+  // Returns the number of messages popped.
+  template<typename Handler>
+  int64_t Drain(int64_t ring_id, const Handler& handler) const {
+    ShmRingHeader* ring = ring_header(ring_id);
+    const uint64_t capacity = header()->ring_capacity;
+    const uint64_t tail = ring->tail.load(std::memory_order_acquire);
+    const uint64_t begin = ring->head.load(std::memory_order_relaxed);
+    for (uint64_t head = begin; head != tail; ++head) {
+      const ActorMsg msg = ring_slots(ring_id)[head % capacity];
+      ring->head.store(head + 1, std::memory_order_release);
+      handler(msg);
+    }
+    return static_cast<int64_t>(tail - begin);
+  }
+  bool AllRingsEmpty() const;
+
+  std::string name;
+  void* ptr;
+  size_t size;
+};
+
+// Copies size bytes at address src of process pid into dst with process_vm_readv.
+bool ReadFromProcess(int64_t pid, uint64_t src, void* dst, size_t size);
+
+// Whether reads from process pid can use cross memory attach, checked by reading the segment
+// magic that process published at probe_addr. Fails when the process is gone or not attachable.
+bool ProbeCrossMemoryAttach(int64_t pid, uint64_t probe_addr);
+
+}  // namespace oneflow
+
+#endif  // __linux__
+
+#endif  // ONEFLOW_CORE_COMM_NETWORK_SHM_SHM_SEGMENT_H_
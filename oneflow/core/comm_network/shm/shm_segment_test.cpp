@@ -0,0 +1,113 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifdef __linux__
+
+#include "oneflow/core/comm_network/shm/shm_segment.h"
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <gtest/gtest.h>
+
+namespace oneflow {
+
+namespace {
+
+std::string GenTestSegmentName(const std::string& test_name) {
+  return "/oneflow_shm_segment_test_" + test_name + "_" + std::to_string(getpid());
+}
+
+ActorMsg MakeMsg(int64_t id) { return ActorMsg::BuildCommandMsg(id, ActorCmd::kStart); }
+
+TEST(ShmSegment, RingWrapAround) {
+  const std::string name = GenTestSegmentName("wrap");
+  ShmSegment segment(name, 2, 3);
+  ASSERT_EQ(shm_unlink(name.c_str()), 0);
+  ASSERT_TRUE(segment.AllRingsEmpty());
+  int64_t pushed = 0;
+  int64_t popped = 0;
+  // rounds of 1, 2 and 3 messages walk head and tail across the 3 slots many times
+  FOR_RANGE(int64_t, round, 0, 300) {
+    const int64_t n = round % 3 + 1;
+    FOR_RANGE(int64_t, i, 0, n) { segment.Push(1, MakeMsg(pushed++)); }
+    ASSERT_FALSE(segment.AllRingsEmpty());
+    ASSERT_EQ(segment.Drain(0, [](const ActorMsg&) { FAIL(); }), 0);
+    const int64_t drained = segment.Drain(1, [&](const ActorMsg& msg) {
+      ASSERT_EQ(msg.dst_actor_id(), popped);
+      ++popped;
+    });
+    ASSERT_EQ(drained, n);
+    ASSERT_TRUE(segment.AllRingsEmpty());
+  }
+  ASSERT_EQ(popped, pushed);
+  ASSERT_EQ(segment.ring_header(1)->head.load(), pushed);
+  ASSERT_EQ(segment.ring_header(1)->tail.load(), pushed);
+}
+
+TEST(ShmSegment, ProducerInAnotherProcess) {
+  const std::string name = GenTestSegmentName("process");
+  const int64_t msg_num = 20000;
+  ShmSegment segment(name, 2, 8);
+  const pid_t pid = fork();
+  ASSERT_NE(pid, -1);
+  if (pid == 0) {
+    // the producer blocks on the full ring until the parent drains it
+    ShmSegment peer(name, 0, 0);
+    FOR_RANGE(int64_t, i, 0, msg_num) { peer.Push(1, MakeMsg(i)); }
+    _exit(0);
+  }
+  int64_t popped = 0;
+  bool in_order = true;
+  while (popped < msg_num) {
+    const int64_t drained = segment.Drain(1, [&](const ActorMsg& msg) {
+      in_order = in_order && msg.dst_actor_id() == popped;
+      ++popped;
+    });
+    if (drained == 0) { std::this_thread::yield(); }
+  }
+  int status = 0;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  ASSERT_EQ(shm_unlink(name.c_str()), 0);
+  ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  ASSERT_TRUE(in_order);
+  ASSERT_EQ(popped, msg_num);
+  ASSERT_TRUE(segment.AllRingsEmpty());
+}
+
+TEST(ShmSegment, ProbeCrossMemoryAttach) {
+  const std::string name = GenTestSegmentName("probe");
+  ShmSegment segment(name, 1, 1);
+  ASSERT_EQ(shm_unlink(name.c_str()), 0);
+  const uint64_t probe_addr = reinterpret_cast<uint64_t>(&segment.header()->magic);
+  const uint64_t not_magic = 0;
+  // a process that allows reads and publishes the magic is attachable
+  ASSERT_TRUE(ProbeCrossMemoryAttach(getpid(), probe_addr));
+  ASSERT_FALSE(ProbeCrossMemoryAttach(getpid(), reinterpret_cast<uint64_t>(&not_magic)));
+  // a process that is gone makes ShmCommNet fall back to reads through EpollCommNet
+  const pid_t pid = fork();
+  ASSERT_NE(pid, -1);
+  if (pid == 0) { _exit(0); }
+  int status = 0;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  ASSERT_FALSE(ProbeCrossMemoryAttach(pid, probe_addr));
+  uint64_t value = 0;
+  ASSERT_FALSE(ReadFromProcess(pid, probe_addr, &value, sizeof(value)));
+}
+
+}  // namespace
+
+}  // namespace oneflow
+
+#endif  // __linux__
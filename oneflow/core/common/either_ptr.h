@@ -70,6 +70,12 @@ class EitherPtr final {
     return Get(tag<T>{});
   }
 
+  // Moves the held pointer out, leaving a null pointer of the same type behind.
+  template<typename T>
+  std::shared_ptr<T> Move() {
+    return std::move(const_cast<std::shared_ptr<T>&>(Get(tag<T>{})));
+  }
+
  private:
   template<typename T, typename Enable = void>
   struct UnionType;
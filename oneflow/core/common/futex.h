@@ -0,0 +1,63 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMMON_FUTEX_H_
+#define ONEFLOW_CORE_COMMON_FUTEX_H_
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <thread>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif  // __linux__
+
+namespace oneflow {
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "");
+
+// Blocks while *word == expected, for at most timeout_ms. It may return early and spuriously, so
+// callers always re-check their condition. The word may live in memory shared between processes.
+inline void FutexWait(std::atomic<uint32_t>* word, uint32_t expected, int64_t timeout_ms) {
+#ifdef __linux__
+  struct timespec timeout {};
+  timeout.tv_sec = timeout_ms / 1000;
+  timeout.tv_nsec = (timeout_ms % 1000) * 1000000;
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, &timeout, nullptr,
+          0);
+#else
+  if (word->load(std::memory_order_acquire) == expected) {
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+  }
+#endif  // __linux__
+}
+
+inline void FutexWakeOne(std::atomic<uint32_t>* word) {
+#ifdef __linux__
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+#endif  // __linux__
+}
+
+inline void FutexWakeAll(std::atomic<uint32_t>* word) {
+#ifdef __linux__
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif  // __linux__
+}
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_COMMON_FUTEX_H_
@@ -20,6 +20,7 @@ limitations under the License.
 #include <google/protobuf/text_format.h>
 #include "oneflow/core/common/type_traits.h"
 #include "oneflow/core/common/either_ptr.h"
+#include "oneflow/core/common/maybe_allocator.h"
 #include "oneflow/core/common/shared_or_scalar.h"
 #include "oneflow/core/common/error.h"
 #include "oneflow/core/common/preprocessor.h"
@@ -42,8 +43,8 @@ class Maybe<T, typename std::enable_if<!(std::is_same<T, void>::value || IsScala
                                        && !std::is_reference<T>::value>::type>
     final {
  public:
-  Maybe(const T& data) : data_or_error_(std::make_shared<T>(data)) {}
-  Maybe(T&& data) : data_or_error_(std::make_shared<T>(std::move(data))) {}
+  Maybe(const T& data) : data_or_error_(private_details::NewMaybeData<T>(data)) {}
+  Maybe(T&& data) : data_or_error_(private_details::NewMaybeData<T>(std::move(data))) {}
   Maybe(const Error& error) : data_or_error_(error.error_proto()) {}
   Maybe(const std::shared_ptr<T>& data) : data_or_error_(data) {}
   Maybe(std::shared_ptr<T>&& data) : data_or_error_(std::move(data)) {}
@@ -53,9 +54,14 @@ class Maybe<T, typename std::enable_if<!(std::is_same<T, void>::value || IsScala
   ~Maybe() = default;
 
   bool IsOk() const { return data_or_error_.template Has<T>(); }
-  std::shared_ptr<T> Data_YouAreNotAllowedToCallThisFuncOutsideThisFile() const {
+  std::shared_ptr<T> Data_YouAreNotAllowedToCallThisFuncOutsideThisFile() const& {
     return data_or_error_.template Get<T>();
   }
+  // JUST and CHECK_JUST always call this on a temporary, hand the pointer over without touching
+  // the reference count.
+  std::shared_ptr<T> Data_YouAreNotAllowedToCallThisFuncOutsideThisFile() && {
+    return data_or_error_.template Move<T>();
+  }
   std::shared_ptr<cfg::ErrorProto> error() const {
     return data_or_error_.template Get<cfg::ErrorProto>();
   }
@@ -0,0 +1,147 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMMON_MAYBE_ALLOCATOR_H_
+#define ONEFLOW_CORE_COMMON_MAYBE_ALLOCATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+
+namespace oneflow {
+
+namespace private_details {
+
+// Per-thread free lists of small blocks for the values successful Maybe<T> results carry. Every
+// non-scalar Maybe<T> built from a value puts T and its shared_ptr control block into one such
+// block, so the success path of the eager dispatch chain stops going through malloc once the
+// lists are warm. A block freed on another thread than it was allocated on simply joins that
+// thread's list.
+class MaybeBlockCache final {
+ public:
+  static constexpr size_t kBlockAlignment = 16;
+  static constexpr size_t kMaxBlockSize = 512;
+  static constexpr size_t kNumSizeClasses = kMaxBlockSize / kBlockAlignment + 1;
+  static constexpr uint32_t kMaxCachedBlocksPerClass = 256;
+
+  static void* Allocate(size_t size) {
+    const size_t size_class = SizeClass(size);
+    State* state = ThreadLocalState();
+    if (size_class < kNumSizeClasses && !state->dead) {
+      FreeBlock* block = state->heads[size_class];
+      if (block != nullptr) {
+        state->heads[size_class] = block->next;
+        state->counts[size_class] -= 1;
+        return block;
+      }
+      return ::operator new(size_class * kBlockAlignment);
+    }
+    return ::operator new(size);
+  }
+
+  static void Deallocate(void* ptr, size_t size) {
+    const size_t size_class = SizeClass(size);
+    State* state = ThreadLocalState();
+    if (size_class < kNumSizeClasses && !state->dead
+        && state->counts[size_class] < kMaxCachedBlocksPerClass) {
+      auto* block = static_cast<FreeBlock*>(ptr);
+      block->next = state->heads[size_class];
+      state->heads[size_class] = block;
+      state->counts[size_class] += 1;
+      RegisterThreadExit();
+      return;
+    }
+    ::operator delete(ptr);
+  }
+
+ private:
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+  // Trivially destructible so that it stays readable while other thread_local objects holding
+  // Maybe values are destroyed after the cache has been flushed.
+  struct State {
+    FreeBlock* heads[kNumSizeClasses];
+    uint32_t counts[kNumSizeClasses];
+    bool dead;
+  };
+
+  struct ThreadExitFlusher {
+    ~ThreadExitFlusher() {
+      State* state = ThreadLocalState();
+      for (size_t i = 0; i < kNumSizeClasses; ++i) {
+        while (state->heads[i] != nullptr) {
+          FreeBlock* block = state->heads[i];
+          state->heads[i] = block->next;
+          ::operator delete(block);
+        }
+        state->counts[i] = 0;
+      }
+      state->dead = true;
+    }
+  };
+
+  static size_t SizeClass(size_t size) { return (size + kBlockAlignment - 1) / kBlockAlignment; }
+
+  static State* ThreadLocalState() {
+    static thread_local State state{};
+    return &state;
+  }
+
+  static void RegisterThreadExit() {
+    static thread_local ThreadExitFlusher flusher;
+    (void)flusher;
+  }
+};
+
+// std::allocator replacement for std::allocate_shared backed by MaybeBlockCache. Only used for
+// types aligned to at most MaybeBlockCache::kBlockAlignment.
+template<typename T>
+class MaybeAllocator final {
+ public:
+  using value_type = T;
+
+  MaybeAllocator() = default;
+  template<typename U>
+  MaybeAllocator(const MaybeAllocator<U>&) {}  // NOLINT
+
+  T* allocate(size_t n) { return static_cast<T*>(MaybeBlockCache::Allocate(n * sizeof(T))); }
+  void deallocate(T* ptr, size_t n) { MaybeBlockCache::Deallocate(ptr, n * sizeof(T)); }
+};
+
+template<typename T, typename U>
+bool operator==(const MaybeAllocator<T>&, const MaybeAllocator<U>&) {
+  return true;
+}
+
+template<typename T, typename U>
+bool operator!=(const MaybeAllocator<T>&, const MaybeAllocator<U>&) {
+  return false;
+}
+
+template<typename T, typename... Args>
+std::shared_ptr<T> NewMaybeData(Args&&... args) {
+  return (alignof(T) <= MaybeBlockCache::kBlockAlignment)
+             ? std::allocate_shared<T>(MaybeAllocator<T>(), std::forward<Args>(args)...)
+             : std::make_shared<T>(std::forward<Args>(args)...);
+}
+
+}  // namespace private_details
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_COMMON_MAYBE_ALLOCATOR_H_
@@ -0,0 +1,87 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+// Reports the cost of a dispatch-like chain of three non-scalar Maybe results per op, next to the
+// same chain built on std::make_shared. Usage: maybe_benchmark [num_ops]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include "oneflow/core/common/maybe.h"
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+namespace {
+
+Maybe<std::vector<int64_t>> InferShape(const std::vector<int64_t>& shape) {
+  if (shape.empty()) { return Error::InvalidValueError("") << "empty shape"; }
+  return shape;
+}
+
+Maybe<std::vector<int64_t>> InferBroadcastShape(const std::vector<int64_t>& lhs,
+                                                const std::vector<int64_t>& rhs) {
+  const auto& lhs_shape = JUST(InferShape(lhs));
+  const auto& rhs_shape = JUST(InferShape(rhs));
+  std::vector<int64_t> shape(*lhs_shape);
+  for (size_t i = 0; i < shape.size(); ++i) { shape[i] = std::max(shape[i], rhs_shape->at(i)); }
+  return shape;
+}
+
+Maybe<int64_t> DispatchOp(const std::vector<int64_t>& lhs, const std::vector<int64_t>& rhs) {
+  const auto& shape = JUST(InferBroadcastShape(lhs, rhs));
+  return shape->back();
+}
+
+int64_t MakeSharedDispatchOp(const std::vector<int64_t>& lhs, const std::vector<int64_t>& rhs) {
+  const auto lhs_shape = std::make_shared<std::vector<int64_t>>(lhs);
+  const auto rhs_shape = std::make_shared<std::vector<int64_t>>(rhs);
+  auto shape = std::make_shared<std::vector<int64_t>>(*lhs_shape);
+  for (size_t i = 0; i < shape->size(); ++i) {
+    shape->at(i) = std::max(shape->at(i), rhs_shape->at(i));
+  }
+  const std::shared_ptr<std::vector<int64_t>> result = shape;
+  return result->back();
+}
+
+double NanosecondsPerOp(int64_t num_ops, int64_t expected, const std::function<int64_t()>& op) {
+  // warm up the per-thread caches before timing
+  for (int64_t i = 0; i < num_ops / 10; ++i) { op(); }
+  int64_t sum = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (int64_t i = 0; i < num_ops; ++i) { sum += op(); }
+  const auto end = std::chrono::steady_clock::now();
+  CHECK_EQ(sum, expected * num_ops);
+  return std::chrono::duration<double, std::nano>(end - start).count() / num_ops;
+}
+
+}  // namespace
+
+}  // namespace oneflow
+
+int main(int argc, char** argv) {
+  using namespace oneflow;
+  const int64_t num_ops = argc > 1 ? std::atoll(argv[1]) : 1000000;
+  const std::vector<int64_t> lhs{8, 1, 128, 64};
+  const std::vector<int64_t> rhs{1, 16, 128, 64};
+  const double make_shared_ns =
+      NanosecondsPerOp(num_ops, 64, [&]() { return MakeSharedDispatchOp(lhs, rhs); });
+  const double maybe_ns =
+      NanosecondsPerOp(num_ops, 64, [&]() { return CHECK_JUST(DispatchOp(lhs, rhs)); });
+  std::printf("make_shared chain: %.1f ns/op\n", make_shared_ns);
+  std::printf("Maybe chain:       %.1f ns/op\n", maybe_ns);
+  return 0;
+}
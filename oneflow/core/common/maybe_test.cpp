@@ -16,6 +16,7 @@ limitations under the License.
 #include "oneflow/core/common/maybe.h"
 #include <gtest/gtest-death-test.h>
 #include <memory>
+#include <thread>
 #include "oneflow/core/common/util.h"
 
 namespace oneflow {
@@ -70,5 +71,61 @@ TEST(Maybe, CHECK_OK) {
 
 TEST(Maybe, Noncopyable) { Maybe<std::unique_ptr<int>> a{std::make_unique<int>(1)}; }
 
+TEST(Maybe, JustLeavesLvalueIntact) {
+  auto f = [](const Maybe<std::vector<int64_t>>& maybe) -> Maybe<int64_t> {
+    const auto& first = JUST(maybe);
+    const auto& second = JUST(maybe);
+    return first->size() + second->size();
+  };
+  Maybe<std::vector<int64_t>> maybe(std::vector<int64_t>{1, 2, 3});
+  ASSERT_EQ(CHECK_JUST(f(maybe)), 6);
+  ASSERT_EQ(CHECK_JUST(maybe)->size(), 3);
+  ASSERT_EQ(maybe.GetOrThrow().size(), 3);
+}
+
+TEST(Maybe, ValueFreedOnAnotherThread) {
+  std::vector<Maybe<std::string>> values;
+  for (int i = 0; i < 1000; ++i) { values.emplace_back(std::to_string(i)); }
+  std::thread([&]() { values.clear(); }).join();
+  for (int i = 0; i < 1000; ++i) {
+    Maybe<std::string> value(std::to_string(i));
+    ASSERT_EQ(*CHECK_JUST(value), std::to_string(i));
+  }
+}
+
+namespace {
+
+Maybe<std::vector<int64_t>> InferShape(const std::vector<int64_t>& shape) {
+  if (shape.empty()) { return Error::InvalidValueError("") << "empty shape"; }
+  return shape;
+}
+
+Maybe<std::vector<int64_t>> InferBroadcastShape(const std::vector<int64_t>& lhs,
+                                                const std::vector<int64_t>& rhs) {
+  const auto& lhs_shape = JUST(InferShape(lhs));
+  const auto& rhs_shape = JUST(InferShape(rhs));
+  std::vector<int64_t> shape(*lhs_shape);
+  for (size_t i = 0; i < shape.size(); ++i) { shape[i] = std::max(shape[i], rhs_shape->at(i)); }
+  return shape;
+}
+
+Maybe<int64_t> DispatchOp(const std::vector<int64_t>& lhs, const std::vector<int64_t>& rhs) {
+  const auto& shape = JUST(InferBroadcastShape(lhs, rhs));
+  return shape->back();
+}
+
+}  // namespace
+
+// JUST on the rvalue Maybe of a call moves the value out through a chain of calls, and an error
+// raised at the bottom of the chain still reaches the top.
+TEST(Maybe, JustOnRvalueChain) {
+  ASSERT_EQ(CHECK_JUST(DispatchOp({8, 1, 128, 64}, {1, 16, 128, 64})), 64);
+  const auto& shape = CHECK_JUST(InferBroadcastShape({8, 1, 3}, {1, 16, 2}));
+  ASSERT_EQ(*shape, (std::vector<int64_t>{8, 16, 3}));
+  const Maybe<int64_t> error = DispatchOp({1, 2}, {});
+  ASSERT_FALSE(error.IsOk());
+  ASSERT_NE(error.error()->msg().find("empty shape"), std::string::npos);
+}
+
 }  // namespace test
 }  // namespace oneflow
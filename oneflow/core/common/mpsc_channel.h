@@ -0,0 +1,235 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMMON_MPSC_CHANNEL_H_
+#define ONEFLOW_CORE_COMMON_MPSC_CHANNEL_H_
+
+#include "oneflow/core/common/channel.h"
+#include "oneflow/core/common/futex.h"
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+// Counters of the consumer side, only touched by the consumer thread.
+struct MpscChannelStats {
+  // ReceiveMany calls that got at least one item, and the items they got
+  int64_t receive_cnt = 0;
+  int64_t item_cnt = 0;
+  // the most items found in the channel by one ReceiveMany
+  int64_t max_depth = 0;
+  // ReceiveMany calls that found the channel empty, how many of them slept, and the time spent
+  int64_t wait_cnt = 0;
+  int64_t sleep_cnt = 0;
+  int64_t wait_ns = 0;
+};
+
+// Bounded lock-free channel with many producers and a single consumer. Producers reserve a run
+// of slots with one CAS and publish every slot on its own, the consumer drains published slots in
+// order. An empty channel makes the consumer spin for a while and then sleep on a futex, which
+// producers only touch when the consumer is actually asleep.
+template<typename T>
+class MpscChannel final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(MpscChannel);
+  explicit MpscChannel(size_t capacity);
+  ~MpscChannel() = default;
+
+  // Block while the channel is full.
+  template<typename U>
+  ChannelStatus Send(U&& item);
+  template<typename ForwardIt>
+  ChannelStatus SendMany(ForwardIt first, ForwardIt last);
+  // Sends as many items as there is room for, returns the end of the sent prefix.
+  template<typename ForwardIt>
+  ForwardIt TrySendMany(ForwardIt first, ForwardIt last);
+
+  // Consumer only.
+  ChannelStatus ReceiveMany(std::queue<T>* items);
+  size_t TryReceiveMany(std::queue<T>* items);
+  const MpscChannelStats& stats() const { return stats_; }
+
+  void Close();
+  bool is_closed() const { return is_closed_.load(std::memory_order_acquire); }
+  size_t capacity() const { return capacity_; }
+
+ private:
+  struct Slot {
+    // pos + 1 once the item of position pos is published
+    std::atomic<uint64_t> seq;
+    T item;
+  };
+
+  bool IsReadable() const {
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    return slots_[head & mask_].seq.load(std::memory_order_acquire) == head + 1;
+  }
+  void WakeConsumerIfSleeping();
+
+  static constexpr int64_t kMaxSpinRound = 1 << 12;
+  static constexpr int64_t kFutexWaitTimeoutMs = 100;
+  static constexpr size_t kCacheLineSize = 64;
+
+  size_t capacity_;
+  uint64_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+  // The hot words are padded apart instead of aligned, as the channel may be a member of objects
+  // created by a plain new, which does not honour extended alignment before C++17.
+  char padding0_[kCacheLineSize];
+  // next position to reserve, shared by the producers
+  std::atomic<uint64_t> tail_;
+  char padding1_[kCacheLineSize];
+  // next position to consume, only written by the consumer
+  std::atomic<uint64_t> head_;
+  char padding2_[kCacheLineSize];
+  std::atomic<uint32_t> futex_word_;
+  std::atomic<bool> consumer_sleeping_;
+  std::atomic<bool> is_closed_;
+  char padding3_[kCacheLineSize];
+  MpscChannelStats stats_;
+};
+
+template<typename T>
+MpscChannel<T>::MpscChannel(size_t capacity)
+    : tail_(0), head_(0), futex_word_(0), consumer_sleeping_(false), is_closed_(false) {
+  CHECK_GT(capacity, 0);
+  capacity_ = 1;
+  while (capacity_ < capacity) { capacity_ *= 2; }
+  mask_ = capacity_ - 1;
+  slots_.reset(new Slot[capacity_]);
+  FOR_RANGE(size_t, i, 0, capacity_) { slots_[i].seq.store(0, std::memory_order_relaxed); }
+}
+
+template<typename T>
+template<typename U>
+ChannelStatus MpscChannel<T>::Send(U&& item) {
+  while (true) {
+    if (is_closed_.load(std::memory_order_acquire)) { return kChannelStatusErrorClosed; }
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) >= capacity_) {
+      std::this_thread::yield();
+    } else if (tail_.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed)) {
+      Slot* slot = &slots_[tail & mask_];
+      slot->item = std::forward<U>(item);
+      slot->seq.store(tail + 1, std::memory_order_release);
+      WakeConsumerIfSleeping();
+      return kChannelStatusSuccess;
+    }
+  }
+}
+
+template<typename T>
+template<typename ForwardIt>
+ChannelStatus MpscChannel<T>::SendMany(ForwardIt first, ForwardIt last) {
+  while (first != last) {
+    if (is_closed_.load(std::memory_order_acquire)) { return kChannelStatusErrorClosed; }
+    ForwardIt sent_end = TrySendMany(first, last);
+    if (sent_end == first) { std::this_thread::yield(); }
+    first = sent_end;
+  }
+  return kChannelStatusSuccess;
+}
+
+template<typename T>
+template<typename ForwardIt>
+ForwardIt MpscChannel<T>::TrySendMany(ForwardIt first, ForwardIt last) {
+  const uint64_t item_num = std::distance(first, last);
+  if (item_num == 0 || is_closed_.load(std::memory_order_acquire)) { return first; }
+  uint64_t tail = tail_.load(std::memory_order_relaxed);
+  uint64_t reserve_num = 0;
+  do {
+    // the consumer frees slots in order, so everything below head + capacity is free
+    const uint64_t room = capacity_ - (tail - head_.load(std::memory_order_acquire));
+    reserve_num = std::min(room, item_num);
+    if (reserve_num == 0) { return first; }
+  } while (!tail_.compare_exchange_weak(tail, tail + reserve_num, std::memory_order_relaxed));
+  FOR_RANGE(uint64_t, pos, tail, tail + reserve_num) {
+    Slot* slot = &slots_[pos & mask_];
+    slot->item = *first;
+    slot->seq.store(pos + 1, std::memory_order_release);
+    ++first;
+  }
+  WakeConsumerIfSleeping();
+  return first;
+}
+
+template<typename T>
+size_t MpscChannel<T>::TryReceiveMany(std::queue<T>* items) {
+  uint64_t head = head_.load(std::memory_order_relaxed);
+  const uint64_t begin = head;
+  while (true) {
+    Slot* slot = &slots_[head & mask_];
+    if (slot->seq.load(std::memory_order_acquire) != head + 1) { break; }
+    items->push(std::move(slot->item));
+    ++head;
+  }
+  // publishing the new head hands the slots back to the producers
+  if (head != begin) { head_.store(head, std::memory_order_release); }
+  return head - begin;
+}
+
+template<typename T>
+ChannelStatus MpscChannel<T>::ReceiveMany(std::queue<T>* items) {
+  size_t received = TryReceiveMany(items);
+  if (received == 0) {
+    const auto start = std::chrono::steady_clock::now();
+    stats_.wait_cnt += 1;
+    int64_t spin_round = 0;
+    while (true) {
+      // a closed channel still hands out what was sent before Close
+      const bool is_closed = is_closed_.load(std::memory_order_acquire);
+      received = TryReceiveMany(items);
+      if (received > 0) { break; }
+      if (is_closed) { return kChannelStatusErrorClosed; }
+      if (++spin_round < kMaxSpinRound) { continue; }
+      const uint32_t futex_val = futex_word_.load(std::memory_order_acquire);
+      consumer_sleeping_.store(true, std::memory_order_relaxed);
+      // pairs with the fence in WakeConsumerIfSleeping, either we see the item or they see us
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (!IsReadable() && !is_closed_.load(std::memory_order_acquire)) {
+        stats_.sleep_cnt += 1;
+        FutexWait(&futex_word_, futex_val, kFutexWaitTimeoutMs);
+      }
+      consumer_sleeping_.store(false, std::memory_order_relaxed);
+      spin_round = 0;
+    }
+    stats_.wait_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+  }
+  stats_.receive_cnt += 1;
+  stats_.item_cnt += received;
+  stats_.max_depth = std::max<int64_t>(stats_.max_depth, received);
+  return kChannelStatusSuccess;
+}
+
+template<typename T>
+void MpscChannel<T>::Close() {
+  is_closed_.store(true, std::memory_order_release);
+  futex_word_.fetch_add(1, std::memory_order_release);
+  FutexWakeAll(&futex_word_);
+}
+
+template<typename T>
+void MpscChannel<T>::WakeConsumerIfSleeping() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (consumer_sleeping_.load(std::memory_order_relaxed)) {
+    futex_word_.fetch_add(1, std::memory_order_release);
+    FutexWakeOne(&futex_word_);
+  }
+}
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_COMMON_MPSC_CHANNEL_H_
@@ -0,0 +1,118 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "gtest/gtest.h"
+#include "oneflow/core/common/mpsc_channel.h"
+
+namespace oneflow {
+
+namespace {
+
+// items are producer_id * kItemNumPerProducer + i, so the consumer can check per producer order
+constexpr int64_t kItemNumPerProducer = 20000;
+
+void ReceiveAndCheck(MpscChannel<int64_t>* channel, int64_t producer_num) {
+  std::vector<int64_t> next(producer_num, 0);
+  std::queue<int64_t> items;
+  int64_t received = 0;
+  while (received < producer_num * kItemNumPerProducer) {
+    ASSERT_EQ(channel->ReceiveMany(&items), kChannelStatusSuccess);
+    while (!items.empty()) {
+      const int64_t producer_id = items.front() / kItemNumPerProducer;
+      ASSERT_EQ(items.front() % kItemNumPerProducer, next.at(producer_id));
+      next.at(producer_id) += 1;
+      items.pop();
+      received += 1;
+    }
+  }
+}
+
+}  // namespace
+
+TEST(MpscChannel, capacity_is_power_of_two) {
+  MpscChannel<int> channel(100);
+  ASSERT_EQ(channel.capacity(), 128);
+}
+
+TEST(MpscChannel, 8sender_keep_order) {
+  MpscChannel<int64_t> channel(64);
+  const int64_t producer_num = 8;
+  std::vector<std::thread> senders;
+  for (int64_t producer_id = 0; producer_id < producer_num; ++producer_id) {
+    senders.emplace_back([&channel, producer_id]() {
+      for (int64_t i = 0; i < kItemNumPerProducer; ++i) {
+        ASSERT_EQ(channel.Send(producer_id * kItemNumPerProducer + i), kChannelStatusSuccess);
+      }
+    });
+  }
+  ReceiveAndCheck(&channel, producer_num);
+  for (std::thread& sender : senders) { sender.join(); }
+  ASSERT_EQ(channel.stats().item_cnt, producer_num * kItemNumPerProducer);
+  ASSERT_LE(channel.stats().max_depth, 64);
+}
+
+TEST(MpscChannel, 4sender_send_many) {
+  MpscChannel<int64_t> channel(100);
+  const int64_t producer_num = 4;
+  std::vector<std::thread> senders;
+  for (int64_t producer_id = 0; producer_id < producer_num; ++producer_id) {
+    senders.emplace_back([&channel, producer_id]() {
+      std::vector<int64_t> batch;
+      for (int64_t i = 0; i < kItemNumPerProducer; ++i) {
+        batch.push_back(producer_id * kItemNumPerProducer + i);
+        // batches larger than the capacity have to go in several runs
+        if (batch.size() == 300 || i + 1 == kItemNumPerProducer) {
+          ASSERT_EQ(channel.SendMany(batch.cbegin(), batch.cend()), kChannelStatusSuccess);
+          batch.clear();
+        }
+      }
+    });
+  }
+  ReceiveAndCheck(&channel, producer_num);
+  for (std::thread& sender : senders) { sender.join(); }
+}
+
+TEST(MpscChannel, try_send_many_stops_when_full) {
+  MpscChannel<int> channel(4);
+  std::vector<int> items{0, 1, 2, 3, 4, 5};
+  ASSERT_EQ(channel.TrySendMany(items.cbegin(), items.cend()) - items.cbegin(), 4);
+  std::queue<int> received;
+  ASSERT_EQ(channel.TryReceiveMany(&received), 4);
+  ASSERT_EQ(channel.TrySendMany(items.cbegin() + 4, items.cend()), items.cend());
+  ASSERT_EQ(channel.TryReceiveMany(&received), 2);
+  for (int i = 0; i < 6; ++i) {
+    ASSERT_EQ(received.front(), i);
+    received.pop();
+  }
+}
+
+TEST(MpscChannel, close_wakes_sleeping_consumer) {
+  MpscChannel<int> channel(16);
+  ASSERT_EQ(channel.Send(1), kChannelStatusSuccess);
+  std::thread receiver([&channel]() {
+    std::queue<int> items;
+    ASSERT_EQ(channel.ReceiveMany(&items), kChannelStatusSuccess);
+    ASSERT_EQ(items.size(), 1);
+    // blocks until Close, and the consumer has long gone to sleep by then
+    ASSERT_EQ(channel.ReceiveMany(&items), kChannelStatusErrorClosed);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  channel.Close();
+  receiver.join();
+  ASSERT_EQ(channel.Send(2), kChannelStatusErrorClosed);
+  ASSERT_GE(channel.stats().sleep_cnt, 1);
+}
+
+}  // namespace oneflow
@@ -37,6 +37,15 @@ NotifierStatus Notifier::WaitAndClearNotifiedCnt() {
   return kNotifierStatusSuccess;
 }
 
+NotifierStatus Notifier::TimedWaitAndClearNotifiedCnt(size_t timeout_us) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cond_.wait_for(lock, std::chrono::microseconds(timeout_us),
+                 [this]() { return notified_cnt_ > 0 || is_closed_; });
+  if (notified_cnt_ == 0 && is_closed_) { return kNotifierStatusErrorClosed; }
+  notified_cnt_ = 0;
+  return kNotifierStatusSuccess;
+}
+
 void Notifier::Close() {
   std::unique_lock<std::mutex> lock(mutex_);
   is_closed_ = true;
@@ -30,6 +30,9 @@ class Notifier final {
 
   NotifierStatus Notify();
   NotifierStatus WaitAndClearNotifiedCnt();
+  // Same as WaitAndClearNotifiedCnt, but also returns kNotifierStatusSuccess once timeout_us
+  // elapsed without a notification.
+  NotifierStatus TimedWaitAndClearNotifiedCnt(size_t timeout_us);
   void Close();
 
  private:
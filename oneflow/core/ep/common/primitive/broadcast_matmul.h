@@ -137,10 +137,10 @@ void ForEachMatmul(DataType data_type, size_t m, size_t n, size_t k, Scalar beta
   int64_t b_batch_index[max_num_dims]{};
   int64_t c_batch_index[max_num_dims]{};
   int64_t broadcast_batch_index[max_num_dims]{};
-  bool init_c = true;
   for (int64_t broadcast_batch_id = 0; broadcast_batch_id < broadcast_batch_count;
        ++broadcast_batch_id) {
     broadcast_index_helper.OffsetToNdIndex(broadcast_batch_id, broadcast_batch_index);
+    bool init_c = true;
     for (int64_t i = 0; i < num_batch_dims; ++i) {
       if (a_batch_dims[i] == 1) {
         a_batch_index[i] = 0;
@@ -0,0 +1,39 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_EP_CPU_CPU_ISA_H_
+#define ONEFLOW_CORE_EP_CPU_CPU_ISA_H_
+
+namespace oneflow {
+
+namespace ep {
+
+// Instruction set levels the hand-vectorized CPU primitives are specialized for, ordered so that
+// a higher level implies every lower one.
+enum class CpuIsa {
+  kScalar = 0,
+  kAvx2 = 1,    // AVX2 + FMA + F16C
+  kAvx512 = 2,  // AVX-512F on top of kAvx2
+};
+
+// The best ISA level supported by both the running CPU and this build, detected once. It can be
+// capped with ONEFLOW_EP_CPU_MAX_ISA=scalar|avx2|avx512, e.g. to compare against the scalar path.
+CpuIsa GetCpuIsa();
+
+}  // namespace ep
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_EP_CPU_CPU_ISA_H_
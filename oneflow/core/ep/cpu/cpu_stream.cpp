@@ -14,6 +14,8 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/thread/thread_pool.h"
+#include "oneflow/core/platform/include/pthread_fork.h"
 
 namespace oneflow {
 
@@ -27,6 +29,21 @@ Maybe<void> CpuStream::Sync() { return Maybe<void>::Ok(); }
 
 void CpuStream::RecordEvent(Event* /*event*/) {}
 
+void CpuStream::ParallelFor(int64_t begin, int64_t end,
+                            const std::function<void(int64_t begin, int64_t end)>& func,
+                            int64_t grain_size) {
+  if (begin >= end) { return; }
+  grain_size = std::max<int64_t>(grain_size, 1);
+  ThreadPool* thread_pool = Global<ThreadPool>::Get();
+  if (end - begin <= grain_size || thread_pool == nullptr || thread_pool->thread_num() <= 1
+      || pthread_fork::IsForkedSubProcess()) {
+    func(begin, end);
+    return;
+  }
+  thread_pool->ParallelFor(Range(begin, end), grain_size,
+                           [&func](const Range& range) { func(range.begin(), range.end()); });
+}
+
 }  // namespace ep
 
 }  // namespace oneflow
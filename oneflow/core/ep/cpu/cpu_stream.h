@@ -25,6 +25,9 @@ namespace oneflow {
 
 namespace ep {
 
+// Minimal number of elements, or of element-sized units of work, a ParallelFor chunk should take.
+constexpr int64_t kParallelForDefaultGrain = 32768;
+
 class CpuStream : public Stream {
  public:
   OF_DISALLOW_COPY_AND_MOVE(CpuStream);
@@ -42,6 +45,12 @@ class CpuStream : public Stream {
   Maybe<void> Sync() override;
   void RecordEvent(Event* event) override;
 
+  // Run func over sub-ranges of [begin, end) of at least grain_size each, in the global
+  // ThreadPool when the range is large enough. Falls back to the calling thread otherwise.
+  void ParallelFor(int64_t begin, int64_t end,
+                   const std::function<void(int64_t begin, int64_t end)>& func,
+                   int64_t grain_size = kParallelForDefaultGrain);
+
 #ifdef WITH_ONEDNN
   dnnl::engine* onednn_engine() const { return onednn_engine_.get(); }
   dnnl::stream* onednn_stream() const { return onednn_stream_.get(); }
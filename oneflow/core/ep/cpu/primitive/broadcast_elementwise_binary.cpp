@@ -13,13 +13,12 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 */
-
 #include "oneflow/core/ep/include/primitive/broadcast_elementwise_binary.h"
 #include "oneflow/core/ep/common/primitive/broadcast_elementwise_binary.h"
 #include "oneflow/core/ep/cpu/primitive/binary_functor.h"
 #include "oneflow/core/ep/cpu/primitive/type_seq.h"
-#include "oneflow/core/ndarray/ndarray_util.h"
-#include "oneflow/core/ndarray/xpu_var_ndarray.h"
+#include "oneflow/core/ep/cpu/primitive/elementwise_util.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
 
 namespace oneflow {
 
@@ -39,9 +38,100 @@ float16 GetValue<float16>(Scalar value) {
   return static_cast<float16>(GetValue<float>(value));
 }
 
-template<BinaryOp binary_op, typename Src, typename Dst,
-         void (*binary_func)(ep::Stream* stream, const XpuVarNdarray<Dst>& z,
-                             const XpuVarNdarray<const Src>& x, const XpuVarNdarray<const Src>& y)>
+// Computes n elements of dst. A broadcast operand is the single value it points to, the other
+// operands are n contiguous elements.
+template<typename Src, typename Dst>
+using BinaryRowFunc = void (*)(const Src* src0, const Src* src1, Dst* dst, size_t n);
+
+template<BinaryOp binary_op, typename Src, typename Dst, bool src0_broadcast, bool src1_broadcast>
+void BinaryRowScalar(const Src* src0, const Src* src1, Dst* dst, size_t n) {
+  const BinaryFunctor<DeviceType::kCPU, binary_op, Src, Dst> functor;
+  if (src0_broadcast && src1_broadcast) {
+    const Dst value = functor(*src0, *src1);
+    for (size_t i = 0; i < n; ++i) { dst[i] = value; }
+  } else if (src0_broadcast) {
+    const Src src0_value = *src0;
+    for (size_t i = 0; i < n; ++i) { dst[i] = functor(src0_value, src1[i]); }
+  } else if (src1_broadcast) {
+    const Src src1_value = *src1;
+    for (size_t i = 0; i < n; ++i) { dst[i] = functor(src0[i], src1_value); }
+  } else {
+    for (size_t i = 0; i < n; ++i) { dst[i] = functor(src0[i], src1[i]); }
+  }
+}
+
+template<BinaryOp binary_op, typename Src, typename Dst>
+BinaryRowFunc<Src, Dst> GetBinaryRowScalarFunc(bool src0_broadcast, bool src1_broadcast) {
+  if (src0_broadcast && src1_broadcast) {
+    return BinaryRowScalar<binary_op, Src, Dst, true, true>;
+  } else if (src0_broadcast) {
+    return BinaryRowScalar<binary_op, Src, Dst, true, false>;
+  } else if (src1_broadcast) {
+    return BinaryRowScalar<binary_op, Src, Dst, false, true>;
+  } else {
+    return BinaryRowScalar<binary_op, Src, Dst, false, false>;
+  }
+}
+
+template<BinaryOp binary_op, typename Src, typename Dst>
+struct BinaryRow {
+  static BinaryRowFunc<Src, Dst> Get(bool src0_broadcast, bool src1_broadcast) {
+    return GetBinaryRowScalarFunc<binary_op, Src, Dst>(src0_broadcast, src1_broadcast);
+  }
+};
+
+template<BinaryOp binary_op>
+struct BinaryRow<binary_op, float, float> {
+  static BinaryRowFunc<float, float> Get(bool src0_broadcast, bool src1_broadcast) {
+    const FloatBinaryRowFunc func =
+        GetFloatBinaryRowFunc(binary_op, src0_broadcast, src1_broadcast, GetCpuIsa());
+    if (func != nullptr) { return func; }
+    return GetBinaryRowScalarFunc<binary_op, float, float>(src0_broadcast, src1_broadcast);
+  }
+};
+
+// Walks dst, of simplified dims, as rows of its innermost dim. The pattern of every broadcast
+// case is then one of same shape, scalar operand, row broadcast ([m, n] op [1, n]) or column
+// broadcast ([m, n] op [m, 1]) inside a row, which the row functions are specialized for. The
+// elements are split over the thread pool regardless of the row length.
+template<BinaryOp binary_op, typename Src, typename Dst>
+void LaunchRows(Stream* stream, size_t num_dims, const int64_t* src0_dims, const Src* src0,
+                const int64_t* src1_dims, const Src* src1, const int64_t* dst_dims, Dst* dst) {
+  int64_t src0_strides[kMaxNumDims];
+  int64_t src1_strides[kMaxNumDims];
+  int64_t src0_stride = 1;
+  int64_t src1_stride = 1;
+  for (int64_t d = num_dims - 1; d >= 0; --d) {
+    src0_strides[d] = src0_dims[d] == 1 ? 0 : src0_stride;
+    src1_strides[d] = src1_dims[d] == 1 ? 0 : src1_stride;
+    src0_stride *= src0_dims[d];
+    src1_stride *= src1_dims[d];
+  }
+  const int64_t cols = dst_dims[num_dims - 1];
+  const BinaryRowFunc<Src, Dst> row_func = BinaryRow<binary_op, Src, Dst>::Get(
+      src0_strides[num_dims - 1] == 0, src1_strides[num_dims - 1] == 0);
+  stream->As<CpuStream>()->ParallelFor(
+      0, GetElementCount(num_dims, dst_dims), [&](int64_t begin, int64_t end) {
+        int64_t row = begin / cols;
+        int64_t col = begin - row * cols;
+        for (int64_t i = begin; i < end; ++row, col = 0) {
+          int64_t src0_offset = col * src0_strides[num_dims - 1];
+          int64_t src1_offset = col * src1_strides[num_dims - 1];
+          int64_t outer_index = row;
+          for (int64_t d = num_dims - 2; d >= 0; --d) {
+            const int64_t index = outer_index % dst_dims[d];
+            outer_index /= dst_dims[d];
+            src0_offset += index * src0_strides[d];
+            src1_offset += index * src1_strides[d];
+          }
+          const int64_t n = std::min(cols - col, end - i);
+          row_func(src0 + src0_offset, src1 + src1_offset, dst + i, n);
+          i += n;
+        }
+      });
+}
+
+template<BinaryOp binary_op, typename Src, typename Dst>
 class BroadcastElementwiseBinaryImpl : public BroadcastElementwiseBinary {
  public:
   OF_DISALLOW_COPY_AND_MOVE(BroadcastElementwiseBinaryImpl);
@@ -50,26 +140,30 @@ class BroadcastElementwiseBinaryImpl : public BroadcastElementwiseBinary {
 
   void Launch(Stream* stream, Scalar src0, size_t num_src1_dims, const int64_t* src1_dims,
               const void* src1, void* dst) override {
-    int64_t elem_cnt = GetElementCount(num_src1_dims, src1_dims);
-    Src src0_val = GetValue<Src>(src0);
-    binary_func(stream, XpuVarNdarray<Dst>(Shape({elem_cnt}), reinterpret_cast<Dst*>(dst), 1),
-                XpuVarNdarray<const Src>(Shape({1}), &src0_val, 1),
-                XpuVarNdarray<const Src>(Shape({elem_cnt}), reinterpret_cast<const Src*>(src1), 1));
+    const int64_t elem_cnt = GetElementCount(num_src1_dims, src1_dims);
+    if (elem_cnt == 0) { return; }
+    const Src src0_val = GetValue<Src>(src0);
+    const int64_t src0_dim = 1;
+    LaunchRows<binary_op, Src, Dst>(stream, 1, &src0_dim, &src0_val, &elem_cnt,
+                                    reinterpret_cast<const Src*>(src1), &elem_cnt,
+                                    reinterpret_cast<Dst*>(dst));
   }
   void Launch(Stream* stream, size_t num_src0_dims, const int64_t* src0_dims, const void* src0,
               Scalar src1, void* dst) override {
-    int64_t elem_cnt = GetElementCount(num_src0_dims, src0_dims);
-    Src src1_val = GetValue<Src>(src1);
-    binary_func(stream, XpuVarNdarray<Dst>(Shape({elem_cnt}), reinterpret_cast<Dst*>(dst), 1),
-                XpuVarNdarray<const Src>(Shape({elem_cnt}), reinterpret_cast<const Src*>(src0), 1),
-                XpuVarNdarray<const Src>(Shape({1}), &src1_val, 1));
+    const int64_t elem_cnt = GetElementCount(num_src0_dims, src0_dims);
+    if (elem_cnt == 0) { return; }
+    const Src src1_val = GetValue<Src>(src1);
+    const int64_t src1_dim = 1;
+    LaunchRows<binary_op, Src, Dst>(stream, 1, &elem_cnt, reinterpret_cast<const Src*>(src0),
+                                    &src1_dim, &src1_val, &elem_cnt, reinterpret_cast<Dst*>(dst));
   }
   void Launch(Stream* stream, size_t num_src0_dims, const int64_t* src0_dims, const void* src0,
               size_t num_src1_dims, const int64_t* src1_dims, const void* src1,
               void* dst) override {
-    DimVector src0_dim_vec;
-    DimVector src1_dim_vec;
-    DimVector dst_dim_vec;
+    if (GetElementCount(num_src0_dims, src0_dims) == 0
+        || GetElementCount(num_src1_dims, src1_dims) == 0) {
+      return;
+    }
     size_t num_dims = 0;
     int64_t simplified_src0_dims[kMaxNumDims];
     int64_t simplified_src1_dims[kMaxNumDims];
@@ -79,37 +173,20 @@ class BroadcastElementwiseBinaryImpl : public BroadcastElementwiseBinary {
                                        simplified_dst_dims);
     CheckInplace(num_dims, simplified_src0_dims, src0, simplified_src1_dims, src1,
                  simplified_dst_dims, dst);
-    for (int64_t i = 0; i < num_dims; ++i) {
-      src0_dim_vec.push_back(simplified_src0_dims[i]);
-      src1_dim_vec.push_back(simplified_src1_dims[i]);
-      dst_dim_vec.push_back(simplified_dst_dims[i]);
-    }
-    binary_func(
-        stream, XpuVarNdarray<Dst>(Shape(dst_dim_vec), reinterpret_cast<Dst*>(dst), num_dims),
-        XpuVarNdarray<const Src>(Shape(src0_dim_vec), reinterpret_cast<const Src*>(src0), num_dims),
-        XpuVarNdarray<const Src>(Shape(src1_dim_vec), reinterpret_cast<const Src*>(src1),
-                                 num_dims));
+    LaunchRows<binary_op, Src, Dst>(stream, num_dims, simplified_src0_dims,
+                                    reinterpret_cast<const Src*>(src0), simplified_src1_dims,
+                                    reinterpret_cast<const Src*>(src1), simplified_dst_dims,
+                                    reinterpret_cast<Dst*>(dst));
   }
 };
 
-template<BinaryOp binary_op, typename Src, typename Dst,
-         void (*binary_func)(ep::Stream* stream, const XpuVarNdarray<Dst>& z,
-                             const XpuVarNdarray<const Src>& x, const XpuVarNdarray<const Src>& y)>
+template<BinaryOp binary_op, typename Src, typename Dst>
 std::unique_ptr<BroadcastElementwiseBinary> NewBroadcastElementwiseBinary() {
   return std::unique_ptr<BroadcastElementwiseBinary>(
-      new BroadcastElementwiseBinaryImpl<binary_op, Src, Dst, binary_func>());
+      new BroadcastElementwiseBinaryImpl<binary_op, Src, Dst>());
 }
 
-#define BINARY_MATH_OP_NDARRAY_PAIR         \
-  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kAdd, Add) \
-  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kSub, Sub) \
-  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kMul, Mul) \
-  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kDiv, Div) \
-  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kMax, Max) \
-  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kMin, Min) \
-  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kPow, Pow)
-
-#define NDARRAY_BINARY_TYPE_SEQ \
+#define BINARY_TYPE_SEQ         \
   CPU_PRIMITIVE_INT8_TYPE_SEQ   \
   CPU_PRIMITIVE_UINT8_TYPE_SEQ  \
   CPU_PRIMITIVE_INT32_TYPE_SEQ  \
@@ -118,17 +195,6 @@ std::unique_ptr<BroadcastElementwiseBinary> NewBroadcastElementwiseBinary() {
   CPU_PRIMITIVE_DOUBLE_TYPE_SEQ \
   CPU_PRIMITIVE_FLOAT16_TYPE_SEQ
 
-#define BINARY_LOGICAL_COMPARISION_OP_NDARRAY_PAIR  \
-  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kEqual, EQ)        \
-  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kNotEqual, NE)     \
-  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kLessThan, LT)     \
-  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kLessEqual, LE)    \
-  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kGreaterThan, GT)  \
-  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kGreaterEqual, GE) \
-  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kLogicalAnd, AND)  \
-  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kLogicalOr, OR)    \
-  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kLogicalXor, XOR)
-
 class BroadcastElementwiseBinaryFactoryImpl : public BroadcastElementwiseBinaryFactory {
  public:
   OF_DISALLOW_COPY_AND_MOVE(BroadcastElementwiseBinaryFactoryImpl);
@@ -138,33 +204,27 @@ class BroadcastElementwiseBinaryFactoryImpl : public BroadcastElementwiseBinaryF
   std::unique_ptr<BroadcastElementwiseBinary> New(BinaryOp binary_op, DataType src_type,
                                                   DataType dst_type, size_t max_num_dims) override {
     if (max_num_dims > kMaxNumDims) { return nullptr; }
-#define MAKE_NEW_BROADCAST_ELEMENTWISE_BINARY_MATH_ENTRY(binary_op_pair, data_type_pair) \
-  {std::make_tuple(OF_PP_PAIR_FIRST(binary_op_pair), OF_PP_PAIR_SECOND(data_type_pair),  \
-                   OF_PP_PAIR_SECOND(data_type_pair)),                                   \
-   NewBroadcastElementwiseBinary<                                                        \
-       OF_PP_PAIR_FIRST(binary_op_pair), OF_PP_PAIR_FIRST(data_type_pair),               \
-       OF_PP_PAIR_FIRST(data_type_pair),                                                 \
-       &NdarrayUtil<DeviceType::kCPU, OF_PP_PAIR_FIRST(data_type_pair)>::OF_PP_CAT(      \
-           Broadcast, OF_PP_PAIR_SECOND(binary_op_pair))>},
-
-#define MAKE_NEW_BROADCAST_ELEMENTWISE_BINARY_COMPARASION_AND_LOGICAL_ENTRY(                \
-    binary_op_pair, src_data_type_pair, dst_data_type_pair)                                 \
-  {std::make_tuple(OF_PP_PAIR_FIRST(binary_op_pair), OF_PP_PAIR_SECOND(src_data_type_pair), \
-                   OF_PP_PAIR_SECOND(dst_data_type_pair)),                                  \
-   NewBroadcastElementwiseBinary<                                                           \
-       OF_PP_PAIR_FIRST(binary_op_pair), OF_PP_PAIR_FIRST(src_data_type_pair),              \
-       OF_PP_PAIR_FIRST(dst_data_type_pair),                                                \
-       &NdarrayUtil<DeviceType::kCPU, OF_PP_PAIR_FIRST(src_data_type_pair)>::OF_PP_CAT(     \
-           Broadcast, OF_PP_PAIR_SECOND(binary_op_pair))>},
+#define MAKE_NEW_BROADCAST_ELEMENTWISE_BINARY_MATH_ENTRY(binary_op, data_type_pair) \
+  {std::make_tuple(binary_op, OF_PP_PAIR_SECOND(data_type_pair),                    \
+                   OF_PP_PAIR_SECOND(data_type_pair)),                              \
+   NewBroadcastElementwiseBinary<binary_op, OF_PP_PAIR_FIRST(data_type_pair),       \
+                                 OF_PP_PAIR_FIRST(data_type_pair)>},
+
+#define MAKE_NEW_BROADCAST_ELEMENTWISE_BINARY_COMPARASION_AND_LOGICAL_ENTRY(      \
+    binary_op, src_data_type_pair, dst_data_type_pair)                            \
+  {std::make_tuple(binary_op, OF_PP_PAIR_SECOND(src_data_type_pair),              \
+                   OF_PP_PAIR_SECOND(dst_data_type_pair)),                        \
+   NewBroadcastElementwiseBinary<binary_op, OF_PP_PAIR_FIRST(src_data_type_pair), \
+                                 OF_PP_PAIR_FIRST(dst_data_type_pair)>},
 
     static const std::map<std::tuple<BinaryOp, DataType, DataType>,
                           std::function<std::unique_ptr<BroadcastElementwiseBinary>()>>
         new_broadcast_elementwise_binary_handle{
             OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(MAKE_NEW_BROADCAST_ELEMENTWISE_BINARY_MATH_ENTRY,
-                                             BINARY_MATH_OP_NDARRAY_PAIR, NDARRAY_BINARY_TYPE_SEQ)
+                                             BINARY_MATH_OP_SEQ, BINARY_TYPE_SEQ)
                 OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(
                     MAKE_NEW_BROADCAST_ELEMENTWISE_BINARY_COMPARASION_AND_LOGICAL_ENTRY,
-                    BINARY_LOGICAL_COMPARISION_OP_NDARRAY_PAIR, NDARRAY_BINARY_TYPE_SEQ,
+                    BINARY_COMPARISION_OP_SEQ BINARY_LOGICAL_OP_SEQ, BINARY_TYPE_SEQ,
                     CPU_PRIMITIVE_INT8_TYPE_SEQ)};
 
 #undef MAKE_NEW_BROADCAST_ELEMENTWISE_BINARY_COMPARASION_AND_LOGICAL_ENTRY
@@ -0,0 +1,136 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ep/include/primitive/broadcast_elementwise_binary.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/common/nd_index_offset_helper.h"
+#include <gtest/gtest.h>
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+namespace {
+
+template<typename T>
+std::vector<T> MakeInput(const std::vector<int64_t>& dims, int64_t seed) {
+  int64_t count = 1;
+  for (int64_t dim : dims) { count *= dim; }
+  std::vector<T> values(count);
+  for (int64_t i = 0; i < count; ++i) { values[i] = static_cast<T>((i * 7 + seed) % 23 - 11); }
+  return values;
+}
+
+// Naive reference of dst = src0 - src1 with numpy broadcasting, dims are left-padded with 1s.
+template<typename T>
+std::vector<T> ReferenceSub(const std::vector<int64_t>& src0_dims, const std::vector<T>& src0,
+                            const std::vector<int64_t>& src1_dims, const std::vector<T>& src1,
+                            std::vector<int64_t>* dst_dims) {
+  const size_t num_dims = std::max(src0_dims.size(), src1_dims.size());
+  std::vector<int64_t> dims0(num_dims - src0_dims.size(), 1);
+  dims0.insert(dims0.end(), src0_dims.begin(), src0_dims.end());
+  std::vector<int64_t> dims1(num_dims - src1_dims.size(), 1);
+  dims1.insert(dims1.end(), src1_dims.begin(), src1_dims.end());
+  dst_dims->resize(num_dims);
+  for (size_t d = 0; d < num_dims; ++d) { (*dst_dims)[d] = std::max(dims0[d], dims1[d]); }
+  NdIndexOffsetHelper<int64_t, 8> dst_helper(dst_dims->data(), num_dims);
+  NdIndexOffsetHelper<int64_t, 8> src0_helper(dims0.data(), num_dims);
+  NdIndexOffsetHelper<int64_t, 8> src1_helper(dims1.data(), num_dims);
+  int64_t count = 1;
+  for (int64_t dim : *dst_dims) { count *= dim; }
+  std::vector<T> dst(count);
+  for (int64_t i = 0; i < count; ++i) {
+    int64_t index[8];
+    int64_t index0[8];
+    int64_t index1[8];
+    dst_helper.OffsetToNdIndex(i, index, num_dims);
+    for (size_t d = 0; d < num_dims; ++d) {
+      index0[d] = dims0[d] == 1 ? 0 : index[d];
+      index1[d] = dims1[d] == 1 ? 0 : index[d];
+    }
+    dst[i] = src0[src0_helper.NdIndexToOffset(index0, num_dims)]
+             - src1[src1_helper.NdIndexToOffset(index1, num_dims)];
+  }
+  return dst;
+}
+
+template<typename T>
+void TestBroadcastSub(const std::vector<int64_t>& src0_dims,
+                      const std::vector<int64_t>& src1_dims) {
+  const std::vector<T> src0 = MakeInput<T>(src0_dims, 3);
+  const std::vector<T> src1 = MakeInput<T>(src1_dims, 5);
+  std::vector<int64_t> dst_dims;
+  const std::vector<T> expected = ReferenceSub(src0_dims, src0, src1_dims, src1, &dst_dims);
+  std::unique_ptr<BroadcastElementwiseBinary> sub =
+      NewPrimitive<BroadcastElementwiseBinaryFactory>(DeviceType::kCPU, BinaryOp::kSub,
+                                                      GetDataType<T>::value,
+                                                      GetDataType<T>::value, dst_dims.size());
+  ASSERT_TRUE(sub);
+  CpuStream stream(nullptr);
+  std::vector<T> dst(expected.size());
+  sub->Launch(&stream, src0_dims.size(), src0_dims.data(), src0.data(), src1_dims.size(),
+              src1_dims.data(), src1.data(), dst.data());
+  for (size_t i = 0; i < dst.size(); ++i) { ASSERT_EQ(dst[i], expected[i]) << "offset " << i; }
+}
+
+template<typename T>
+void TestBroadcastSubShapes() {
+  // same shape
+  TestBroadcastSub<T>({3, 5, 7}, {3, 5, 7});
+  // scalar operand
+  TestBroadcastSub<T>({1}, {37, 3});
+  TestBroadcastSub<T>({37, 3}, {1, 1});
+  // row broadcast
+  TestBroadcastSub<T>({33, 65}, {65});
+  TestBroadcastSub<T>({1, 65}, {33, 65});
+  // column broadcast
+  TestBroadcastSub<T>({33, 65}, {33, 1});
+  TestBroadcastSub<T>({33, 1}, {33, 65});
+  // outer
+  TestBroadcastSub<T>({33, 1}, {1, 65});
+  // bias over a middle dim, as in NCHW
+  TestBroadcastSub<T>({4, 6, 17}, {1, 6, 1});
+  TestBroadcastSub<T>({2, 1, 3, 1, 9}, {5, 1, 7, 1});
+  // large enough to be split into chunks in the middle of rows
+  TestBroadcastSub<T>({300, 1000}, {300, 1});
+  TestBroadcastSub<T>({2, 100000}, {100000});
+}
+
+TEST(BroadcastElementwiseBinary, Float) { TestBroadcastSubShapes<float>(); }
+
+TEST(BroadcastElementwiseBinary, Int32) { TestBroadcastSubShapes<int32_t>(); }
+
+TEST(BroadcastElementwiseBinary, ScalarOperand) {
+  const std::vector<int64_t> dims = {3, 50};
+  const std::vector<float> src = MakeInput<float>(dims, 1);
+  std::unique_ptr<BroadcastElementwiseBinary> sub =
+      NewPrimitive<BroadcastElementwiseBinaryFactory>(DeviceType::kCPU, BinaryOp::kSub,
+                                                      DataType::kFloat, DataType::kFloat, 2);
+  ASSERT_TRUE(sub);
+  CpuStream stream(nullptr);
+  std::vector<float> dst(src.size());
+  sub->Launch(&stream, Scalar(2.5), dims.size(), dims.data(), src.data(), dst.data());
+  for (size_t i = 0; i < dst.size(); ++i) { ASSERT_EQ(dst[i], 2.5f - src[i]); }
+  sub->Launch(&stream, dims.size(), dims.data(), src.data(), Scalar(2.5), dst.data());
+  for (size_t i = 0; i < dst.size(); ++i) { ASSERT_EQ(dst[i], src[i] - 2.5f); }
+}
+
+}  // namespace
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
@@ -17,6 +17,8 @@ limitations under the License.
 #include "oneflow/core/ep/include/primitive/broadcast_matmul.h"
 #include "oneflow/core/ep/common/primitive/broadcast_matmul.h"
 #include "oneflow/core/common/blas.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/ep/cpu/primitive/vectorized_math.h"
 
 namespace oneflow {
 
@@ -42,47 +44,148 @@ CBLAS_TRANSPOSE GetCblasTranspose(BlasTransposeType transpose_type) {
   }
 }
 
+// Rows of c one gemm call covers at least when a single matmul is split across threads, so that
+// the packing of b each call repeats stays cheap relative to the block.
+constexpr int64_t kMinRowsPerBlock = 64;
+// Multiply-adds a ParallelFor chunk should cover at least.
+constexpr int64_t kMinMacsPerChunk = 1 << 18;
+
+struct MatmulBatch {
+  const void* a;
+  const void* b;
+  void* c;
+  Scalar beta;
+};
+
+// Computes rows [row_begin, row_begin + rows) of c = alpha * op(a) * op(b) + beta * c. Calls
+// accumulating into the same block of c come as one sequence marked by load_c and store_c.
 template<typename T>
-void CblasMatmul(CBLAS_TRANSPOSE trans_a, CBLAS_TRANSPOSE trans_b, int m, int n, int k, T alpha,
-                 const T* a, const T* b, T beta, T* c) {
-  int lda = 0;
-  if (trans_a == CblasNoTrans) {
-    lda = k;
-  } else if (trans_a == CblasTrans) {
-    lda = m;
-  } else {
-    UNIMPLEMENTED();
-  }
-  int ldb = 0;
-  if (trans_b == CblasNoTrans) {
-    ldb = n;
-  } else if (trans_b == CblasTrans) {
-    ldb = k;
-  } else {
-    UNIMPLEMENTED();
+class NativeGemm {
+ public:
+  using ComputeType = T;
+
+  void Run(CBLAS_TRANSPOSE trans_a, CBLAS_TRANSPOSE trans_b, int64_t m, int64_t n, int64_t k,
+           int64_t row_begin, int64_t rows, T alpha, const T* a, const T* b, T beta, T* c,
+           bool /*load_c*/, bool /*store_c*/) {
+    const int lda = (trans_a == CblasNoTrans) ? k : m;
+    const int ldb = (trans_b == CblasNoTrans) ? n : k;
+    const T* a_block = (trans_a == CblasNoTrans) ? a + row_begin * k : a + row_begin;
+    cblas_gemm<T>(CblasRowMajor, trans_a, trans_b, rows, n, k, alpha, a_block, lda, b, ldb, beta,
+                  c + row_begin * n, n);
   }
-  const int ldc = n;
-  cblas_gemm<T>(CblasRowMajor, trans_a, trans_b, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc);
-}
+};
 
+// float16 / bfloat16 operands are widened to float and multiplied by sgemm. The block of c stays
+// in float for a whole accumulation sequence and is rounded once when it is written back.
 template<typename T>
-void LaunchCblasBroadcastMatmul(Stream* /*stream*/, DataType data_type,
+class ReducedPrecisionGemm {
+ public:
+  using ComputeType = float;
+
+  ReducedPrecisionGemm() : isa_(GetCpuIsa()), converted_b_(nullptr) {}
+
+  void Run(CBLAS_TRANSPOSE trans_a, CBLAS_TRANSPOSE trans_b, int64_t m, int64_t n, int64_t k,
+           int64_t row_begin, int64_t rows, float alpha, const T* a, const T* b, float beta, T* c,
+           bool load_c, bool store_c) {
+    if (b != converted_b_) {
+      b_buf_.resize(k * n);
+      ConvertToFloat(isa_, b, b_buf_.data(), k * n);
+      converted_b_ = b;
+    }
+    a_buf_.resize(rows * k);
+    int lda = 0;
+    if (trans_a == CblasNoTrans) {
+      ConvertToFloat(isa_, a + row_begin * k, a_buf_.data(), rows * k);
+      lda = k;
+    } else {
+      for (int64_t i = 0; i < k; ++i) {
+        ConvertToFloat(isa_, a + i * m + row_begin, a_buf_.data() + i * rows, rows);
+      }
+      lda = rows;
+    }
+    const int ldb = (trans_b == CblasNoTrans) ? n : k;
+    T* c_block = c + row_begin * n;
+    if (load_c) {
+      c_buf_.resize(rows * n);
+      if (beta != 0) { ConvertToFloat(isa_, c_block, c_buf_.data(), rows * n); }
+    }
+    cblas_gemm<float>(CblasRowMajor, trans_a, trans_b, rows, n, k, alpha, a_buf_.data(), lda,
+                      b_buf_.data(), ldb, beta, c_buf_.data(), n);
+    if (store_c) { ConvertFromFloat(isa_, c_buf_.data(), c_block, rows * n); }
+  }
+
+ private:
+  CpuIsa isa_;
+  const T* converted_b_;
+  std::vector<float> a_buf_;
+  std::vector<float> b_buf_;
+  std::vector<float> c_buf_;
+};
+
+// Every (batch, block of rows of c) is an independent gemm and they are spread over the thread
+// pool. When c is broadcast, several batches accumulate into the same c, so the tasks are the row
+// blocks only and each of them walks all batches grouped by c, in order within a group.
+template<typename T, typename Gemm>
+void LaunchCblasBroadcastMatmul(Stream* stream, DataType data_type,
                                 BlasTransposeType transpose_a, BlasTransposeType transpose_b,
                                 int64_t num_batch_dims, const int64_t* broadcast_batch_dims,
                                 const int64_t* a_batch_dims, const int64_t* b_batch_dims,
                                 const int64_t* c_batch_dims, int64_t m, int64_t n, int64_t k,
                                 Scalar alpha, const void* a, const void* b, Scalar beta, void* c) {
+  using ComputeType = typename Gemm::ComputeType;
   const CBLAS_TRANSPOSE cblas_trans_a = GetCblasTranspose(transpose_a);
   const CBLAS_TRANSPOSE cblas_trans_b = GetCblasTranspose(transpose_b);
-  const T alpha_value = alpha.Value<T>();
+  const ComputeType alpha_value = alpha.Value<ComputeType>();
+  std::vector<MatmulBatch> batches;
   auto func = [&](const void* batch_a, const void* batch_b, void* batch_c, Scalar batch_beta) {
-    const T beta_value = batch_beta.Value<T>();
-    CblasMatmul<T>(cblas_trans_a, cblas_trans_b, m, n, k, alpha_value,
-                   static_cast<const T*>(batch_a), static_cast<const T*>(batch_b), beta_value,
-                   static_cast<T*>(batch_c));
+    batches.push_back(MatmulBatch{batch_a, batch_b, batch_c, batch_beta});
   };
   ForEachMatmul<kMaxNumDims>(data_type, m, n, k, beta, num_batch_dims, broadcast_batch_dims,
                              a_batch_dims, b_batch_dims, c_batch_dims, a, b, c, func);
+  bool broadcast_c = false;
+  for (int64_t i = 0; i < num_batch_dims; ++i) {
+    if (c_batch_dims[i] != broadcast_batch_dims[i]) { broadcast_c = true; }
+  }
+  if (broadcast_c) {
+    // ForEachMatmul interleaves the c blocks when c is broadcast over an inner batch dim only,
+    // bring the batches of each c together so that every accumulation sequence is contiguous.
+    std::stable_sort(batches.begin(), batches.end(),
+                     [](const MatmulBatch& lhs, const MatmulBatch& rhs) { return lhs.c < rhs.c; });
+  }
+  const int64_t rows_per_block =
+      std::min(m, std::max(kMinRowsPerBlock, (kMinMacsPerChunk + n * k - 1) / (n * k)));
+  const int64_t num_row_blocks = (m + rows_per_block - 1) / rows_per_block;
+  const int64_t num_tasks =
+      broadcast_c ? num_row_blocks : static_cast<int64_t>(batches.size()) * num_row_blocks;
+  const int64_t macs_per_task =
+      rows_per_block * n * k * (broadcast_c ? static_cast<int64_t>(batches.size()) : 1);
+  auto RunBatchRows = [&](Gemm* gemm, const MatmulBatch& batch, int64_t row_block, bool load_c,
+                          bool store_c) {
+    const int64_t row_begin = row_block * rows_per_block;
+    gemm->Run(cblas_trans_a, cblas_trans_b, m, n, k, row_begin,
+              std::min(rows_per_block, m - row_begin), alpha_value,
+              static_cast<const T*>(batch.a), static_cast<const T*>(batch.b),
+              batch.beta.Value<ComputeType>(), static_cast<T*>(batch.c), load_c, store_c);
+  };
+  stream->As<CpuStream>()->ParallelFor(
+      0, num_tasks,
+      [&](int64_t begin, int64_t end) {
+        Gemm gemm;
+        for (int64_t task = begin; task < end; ++task) {
+          if (broadcast_c) {
+            for (size_t i = 0; i < batches.size(); ++i) {
+              const bool load_c = i == 0 || batches.at(i - 1).c != batches.at(i).c;
+              const bool store_c =
+                  i + 1 == batches.size() || batches.at(i + 1).c != batches.at(i).c;
+              RunBatchRows(&gemm, batches.at(i), task, load_c, store_c);
+            }
+          } else {
+            RunBatchRows(&gemm, batches.at(task / num_row_blocks), task % num_row_blocks, true,
+                         true);
+          }
+        }
+      },
+      std::max<int64_t>(kMinMacsPerChunk / macs_per_task, 1));
 }
 
 void LaunchBroadcastMatmul(Stream* stream, DataType data_type, BlasTransposeType transpose_a,
@@ -92,13 +195,21 @@ void LaunchBroadcastMatmul(Stream* stream, DataType data_type, BlasTransposeType
                            int64_t n, int64_t k, Scalar alpha, const void* a, const void* b,
                            Scalar beta, void* c) {
   if (data_type == DataType::kFloat) {
-    LaunchCblasBroadcastMatmul<float>(stream, data_type, transpose_a, transpose_b, num_batch_dims,
-                                      broadcast_batch_dims, a_batch_dims, b_batch_dims,
-                                      c_batch_dims, m, n, k, alpha, a, b, beta, c);
+    LaunchCblasBroadcastMatmul<float, NativeGemm<float>>(
+        stream, data_type, transpose_a, transpose_b, num_batch_dims, broadcast_batch_dims,
+        a_batch_dims, b_batch_dims, c_batch_dims, m, n, k, alpha, a, b, beta, c);
   } else if (data_type == DataType::kDouble) {
-    LaunchCblasBroadcastMatmul<double>(stream, data_type, transpose_a, transpose_b, num_batch_dims,
-                                       broadcast_batch_dims, a_batch_dims, b_batch_dims,
-                                       c_batch_dims, m, n, k, alpha, a, b, beta, c);
+    LaunchCblasBroadcastMatmul<double, NativeGemm<double>>(
+        stream, data_type, transpose_a, transpose_b, num_batch_dims, broadcast_batch_dims,
+        a_batch_dims, b_batch_dims, c_batch_dims, m, n, k, alpha, a, b, beta, c);
+  } else if (data_type == DataType::kFloat16) {
+    LaunchCblasBroadcastMatmul<float16, ReducedPrecisionGemm<float16>>(
+        stream, data_type, transpose_a, transpose_b, num_batch_dims, broadcast_batch_dims,
+        a_batch_dims, b_batch_dims, c_batch_dims, m, n, k, alpha, a, b, beta, c);
+  } else if (data_type == DataType::kBFloat16) {
+    LaunchCblasBroadcastMatmul<bfloat16, ReducedPrecisionGemm<bfloat16>>(
+        stream, data_type, transpose_a, transpose_b, num_batch_dims, broadcast_batch_dims,
+        a_batch_dims, b_batch_dims, c_batch_dims, m, n, k, alpha, a, b, beta, c);
   } else {
     UNIMPLEMENTED();
   }
@@ -114,7 +225,8 @@ class BroadcastMatmulFactoryImpl : public BroadcastMatmulFactory {
                                        BlasTransposeType transpose_b,
                                        size_t max_num_dims) override {
     if (max_num_dims > kMaxNumDims) { return nullptr; }
-    if (data_type == DataType::kFloat || data_type == DataType::kDouble) {
+    if (data_type == DataType::kFloat || data_type == DataType::kDouble
+        || data_type == DataType::kFloat16 || data_type == DataType::kBFloat16) {
       return std::make_unique<BroadcastMatmulImpl<kMaxNumDims>>(data_type, transpose_a,
                                                                 transpose_b);
     } else {
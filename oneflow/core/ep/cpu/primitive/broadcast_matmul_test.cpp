@@ -0,0 +1,159 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ep/include/primitive/broadcast_matmul.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/ep/cpu/primitive/vectorized_math.h"
+#include <gtest/gtest.h>
+#include <random>
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+namespace {
+
+// c[batch] = sum over broadcast batches of a[batch] * b[batch]. Every batch dim of a and b is
+// broadcast where it is 1, and c is reduced over every batch dim where it is 1.
+template<typename T>
+void TestBroadcastMatmulNd(DataType data_type, const std::vector<int64_t>& a_batch_dims,
+                           const std::vector<int64_t>& b_batch_dims,
+                           const std::vector<int64_t>& c_batch_dims, int64_t m, int64_t n,
+                           int64_t k, BlasTransposeType trans_a, BlasTransposeType trans_b,
+                           float tolerance) {
+  const size_t num_batch_dims = a_batch_dims.size();
+  std::vector<int64_t> batch_dims(num_batch_dims);
+  int64_t batch = 1;
+  for (size_t i = 0; i < num_batch_dims; ++i) {
+    batch_dims[i] = std::max(a_batch_dims[i], b_batch_dims[i]);
+    batch *= batch_dims[i];
+  }
+  // Offset of broadcast batch p in an operand with the given batch dims.
+  auto BatchOffset = [&](const std::vector<int64_t>& dims, int64_t p) {
+    int64_t offset = 0;
+    int64_t remaining = p;
+    int64_t stride = 1;
+    for (int64_t i = static_cast<int64_t>(num_batch_dims) - 1; i >= 0; --i) {
+      const int64_t index = remaining % batch_dims[i];
+      remaining /= batch_dims[i];
+      if (dims[i] != 1) { offset += index * stride; }
+      stride *= dims[i];
+    }
+    return offset;
+  };
+  auto Count = [](const std::vector<int64_t>& dims) {
+    int64_t count = 1;
+    for (int64_t dim : dims) { count *= dim; }
+    return count;
+  };
+  const int64_t a_batch = Count(a_batch_dims);
+  const int64_t b_batch = Count(b_batch_dims);
+  const int64_t c_batch = Count(c_batch_dims);
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  auto Random = [&](int64_t size) {
+    std::vector<T> v(size);
+    for (auto& x : v) { x = FromFloat<T>(dist(rng)); }
+    return v;
+  };
+  const std::vector<T> a = Random(a_batch * m * k);
+  const std::vector<T> b = Random(b_batch * k * n);
+  std::vector<T> c = Random(c_batch * m * n);
+  const float alpha = 1.5f;
+  const float beta = 0.5f;
+  std::vector<double> expected(c_batch * m * n);
+  for (int64_t i = 0; i < c_batch * m * n; ++i) { expected[i] = beta * ToFloat(c[i]); }
+  for (int64_t p = 0; p < batch; ++p) {
+    const T* a_p = a.data() + BatchOffset(a_batch_dims, p) * m * k;
+    const T* b_p = b.data() + BatchOffset(b_batch_dims, p) * k * n;
+    double* c_p = expected.data() + BatchOffset(c_batch_dims, p) * m * n;
+    for (int64_t i = 0; i < m; ++i) {
+      for (int64_t j = 0; j < n; ++j) {
+        double sum = 0;
+        for (int64_t l = 0; l < k; ++l) {
+          const T a_il = trans_a == BlasTransposeType::N ? a_p[i * k + l] : a_p[l * m + i];
+          const T b_lj = trans_b == BlasTransposeType::N ? b_p[l * n + j] : b_p[j * k + l];
+          sum += static_cast<double>(ToFloat(a_il)) * ToFloat(b_lj);
+        }
+        c_p[i * n + j] += alpha * sum;
+      }
+    }
+  }
+  std::vector<int64_t> a_dims(a_batch_dims);
+  a_dims.push_back(trans_a == BlasTransposeType::N ? m : k);
+  a_dims.push_back(trans_a == BlasTransposeType::N ? k : m);
+  std::vector<int64_t> b_dims(b_batch_dims);
+  b_dims.push_back(trans_b == BlasTransposeType::N ? k : n);
+  b_dims.push_back(trans_b == BlasTransposeType::N ? n : k);
+  std::vector<int64_t> c_dims(c_batch_dims);
+  c_dims.push_back(m);
+  c_dims.push_back(n);
+  const size_t num_dims = num_batch_dims + 2;
+  std::unique_ptr<BroadcastMatmul> matmul = NewPrimitive<BroadcastMatmulFactory>(
+      DeviceType::kCPU, data_type, trans_a, trans_b, num_dims);
+  ASSERT_TRUE(matmul);
+  CpuStream stream(nullptr);
+  matmul->Launch(&stream, alpha, num_dims, a_dims.data(), a.data(), num_dims, b_dims.data(),
+                 b.data(), beta, num_dims, c_dims.data(), c.data());
+  for (int64_t i = 0; i < c_batch * m * n; ++i) {
+    ASSERT_NEAR(ToFloat(c[i]), expected[i], tolerance * std::max(1.0, std::abs(expected[i])))
+        << "offset " << i;
+  }
+}
+
+template<typename T>
+void TestBroadcastMatmul(DataType data_type, int64_t a_batch, int64_t b_batch, int64_t c_batch,
+                         int64_t m, int64_t n, int64_t k, BlasTransposeType trans_a,
+                         BlasTransposeType trans_b, float tolerance) {
+  TestBroadcastMatmulNd<T>(data_type, {a_batch}, {b_batch}, {c_batch}, m, n, k, trans_a, trans_b,
+                           tolerance);
+}
+
+template<typename T>
+void TestBroadcastMatmulShapes(DataType data_type, float tolerance) {
+  const BlasTransposeType N = BlasTransposeType::N;
+  const BlasTransposeType T_ = BlasTransposeType::T;
+  TestBroadcastMatmul<T>(data_type, 1, 1, 1, 150, 33, 17, N, N, tolerance);
+  TestBroadcastMatmul<T>(data_type, 6, 6, 6, 9, 33, 17, N, T_, tolerance);
+  TestBroadcastMatmul<T>(data_type, 6, 1, 6, 130, 5, 7, T_, N, tolerance);
+  TestBroadcastMatmul<T>(data_type, 1, 6, 6, 70, 5, 7, T_, T_, tolerance);
+  TestBroadcastMatmul<T>(data_type, 6, 6, 1, 140, 5, 7, N, N, tolerance);
+  TestBroadcastMatmul<T>(data_type, 8, 8, 8, 96, 64, 64, N, T_, tolerance);
+  TestBroadcastMatmul<T>(data_type, 6, 6, 1, 300, 40, 40, T_, N, tolerance);
+  // c broadcast over the outer or the inner batch dim only, so that the c blocks interleave.
+  TestBroadcastMatmulNd<T>(data_type, {3, 2}, {3, 2}, {1, 2}, 70, 9, 11, N, N, tolerance);
+  TestBroadcastMatmulNd<T>(data_type, {2, 3}, {2, 3}, {2, 1}, 70, 9, 11, N, T_, tolerance);
+  TestBroadcastMatmulNd<T>(data_type, {2, 1}, {1, 3}, {2, 1}, 130, 9, 11, T_, N, tolerance);
+}
+
+TEST(CpuBroadcastMatmul, Float) { TestBroadcastMatmulShapes<float>(DataType::kFloat, 1e-5); }
+
+TEST(CpuBroadcastMatmul, Double) { TestBroadcastMatmulShapes<double>(DataType::kDouble, 1e-5); }
+
+TEST(CpuBroadcastMatmul, Float16) {
+  TestBroadcastMatmulShapes<float16>(DataType::kFloat16, 2e-3);
+}
+
+TEST(CpuBroadcastMatmul, BFloat16) {
+  TestBroadcastMatmulShapes<bfloat16>(DataType::kBFloat16, 2e-2);
+}
+
+}  // namespace
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
@@ -16,6 +16,8 @@ limitations under the License.
 #include "oneflow/core/ep/common/primitive/elementwise_unary.h"
 #include "oneflow/core/ep/cpu/primitive/unary_functor.h"
 #include "oneflow/core/ep/cpu/primitive/type_seq.h"
+#include "oneflow/core/ep/cpu/primitive/elementwise_util.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
 
 namespace oneflow {
 
@@ -24,20 +26,54 @@ namespace primitive {
 
 namespace {
 
+template<UnaryOp unary_op, typename Src, typename Dst>
+void UnaryRowScalar(const Src* src, Dst* dst, size_t n) {
+  const UnaryFunctor<DeviceType::kCPU, unary_op, Dst, Src> functor;
+  for (size_t i = 0; i < n; ++i) { dst[i] = functor(src[i]); }
+}
+
+template<UnaryOp unary_op, typename Src, typename Dst>
+struct UnaryRow {
+  using Func = void (*)(const Src* src, Dst* dst, size_t n);
+  static Func Get() { return UnaryRowScalar<unary_op, Src, Dst>; }
+};
+
+template<UnaryOp unary_op>
+struct UnaryRow<unary_op, float, float> {
+  using Func = FloatUnaryRowFunc;
+  static Func Get() {
+    const FloatUnaryRowFunc func = GetFloatUnaryRowFunc(unary_op, GetCpuIsa());
+    return func != nullptr ? func : UnaryRowScalar<unary_op, float, float>;
+  }
+};
+
+// Gelu and Tanh cost tens of cycles per element, so they are split into smaller chunks than the
+// memory bound ops.
+int64_t GetUnaryGrain(UnaryOp unary_op) {
+  if (unary_op == UnaryOp::kGelu || unary_op == UnaryOp::kTanh) {
+    return kParallelForDefaultGrain / 8;
+  }
+  return kParallelForDefaultGrain;
+}
+
 template<UnaryOp unary_op, typename Src, typename Dst>
 class ElementwiseUnaryImpl : public ElementwiseUnary {
  public:
   OF_DISALLOW_COPY_AND_MOVE(ElementwiseUnaryImpl);
-  ElementwiseUnaryImpl() = default;
+  ElementwiseUnaryImpl() : row_func_(UnaryRow<unary_op, Src, Dst>::Get()) {}
   ~ElementwiseUnaryImpl() override = default;
 
   void Launch(Stream* stream, const void* src_ptr, void* dst_ptr, size_t count) override {
     Dst* dst = reinterpret_cast<Dst*>(dst_ptr);
     const Src* src = reinterpret_cast<const Src*>(src_ptr);
-    for (size_t i = 0; i < count; ++i) {
-      dst[i] = UnaryFunctor<DeviceType::kCPU, unary_op, Dst, Src>()(src[i]);
-    }
+    stream->As<CpuStream>()->ParallelFor(
+        0, count,
+        [&](int64_t begin, int64_t end) { row_func_(src + begin, dst + begin, end - begin); },
+        GetUnaryGrain(unary_op));
   }
+
+ private:
+  const typename UnaryRow<unary_op, Src, Dst>::Func row_func_;
 };
 
 template<UnaryOp unary_op, typename Src, typename Dst>
@@ -0,0 +1,201 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ep/cpu/primitive/elementwise_util.h"
+#include "oneflow/core/ep/cpu/primitive/unary_functor.h"
+#include "oneflow/core/ep/cpu/primitive/binary_functor.h"
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+namespace {
+
+#ifdef OF_EP_CPU_X86_SIMD
+
+// Lane-wise versions of the float functors. They give the same results as the scalar functors,
+// except for Gelu and Tanh which are within a few ulp. _mm*_max_ps and _mm*_min_ps return their
+// second operand unless the first one is strictly greater/less, like the scalar ternaries, so NaN
+// and signed zero come out the same.
+
+template<UnaryOp unary_op>
+struct VecUnaryOp;
+
+template<>
+struct VecUnaryOp<UnaryOp::kRelu> {
+  OF_EP_CPU_TARGET_AVX2 static __m256 Apply(__m256 x) {
+    return _mm256_max_ps(x, _mm256_setzero_ps());
+  }
+  OF_EP_CPU_TARGET_AVX512 static __m512 Apply(__m512 x) {
+    return _mm512_max_ps(x, _mm512_setzero_ps());
+  }
+};
+
+template<>
+struct VecUnaryOp<UnaryOp::kGelu> {
+  OF_EP_CPU_TARGET_AVX2 static __m256 Apply(__m256 x) { return avx2::Gelu(x); }
+  OF_EP_CPU_TARGET_AVX512 static __m512 Apply(__m512 x) { return avx512::Gelu(x); }
+};
+
+template<>
+struct VecUnaryOp<UnaryOp::kTanh> {
+  OF_EP_CPU_TARGET_AVX2 static __m256 Apply(__m256 x) { return avx2::Tanh(x); }
+  OF_EP_CPU_TARGET_AVX512 static __m512 Apply(__m512 x) { return avx512::Tanh(x); }
+};
+
+template<BinaryOp binary_op>
+struct VecBinaryOp;
+
+#define DEFINE_VEC_BINARY_OP(binary_op, intrinsic)                    \
+  template<>                                                          \
+  struct VecBinaryOp<binary_op> {                                     \
+    OF_EP_CPU_TARGET_AVX2 static __m256 Apply(__m256 a, __m256 b) {   \
+      return OF_PP_CAT(_mm256_, intrinsic)(a, b);                     \
+    }                                                                 \
+    OF_EP_CPU_TARGET_AVX512 static __m512 Apply(__m512 a, __m512 b) { \
+      return OF_PP_CAT(_mm512_, intrinsic)(a, b);                     \
+    }                                                                 \
+  };
+
+DEFINE_VEC_BINARY_OP(BinaryOp::kAdd, add_ps)
+DEFINE_VEC_BINARY_OP(BinaryOp::kSub, sub_ps)
+DEFINE_VEC_BINARY_OP(BinaryOp::kMul, mul_ps)
+DEFINE_VEC_BINARY_OP(BinaryOp::kDiv, div_ps)
+DEFINE_VEC_BINARY_OP(BinaryOp::kMax, max_ps)
+DEFINE_VEC_BINARY_OP(BinaryOp::kMin, min_ps)
+
+#undef DEFINE_VEC_BINARY_OP
+
+template<UnaryOp unary_op>
+OF_EP_CPU_TARGET_AVX2 void UnaryRowAvx2(const float* src, float* dst, size_t n) {
+  using namespace avx2;
+  size_t i = 0;
+  for (; i + kVecSize <= n; i += kVecSize) {
+    Store(dst + i, VecUnaryOp<unary_op>::Apply(Load(src + i)));
+  }
+  const UnaryFunctor<DeviceType::kCPU, unary_op, float, float> functor;
+  for (; i < n; ++i) { dst[i] = functor(src[i]); }
+}
+
+template<UnaryOp unary_op>
+OF_EP_CPU_TARGET_AVX512 void UnaryRowAvx512(const float* src, float* dst, size_t n) {
+  using namespace avx512;
+  size_t i = 0;
+  for (; i + kVecSize <= n; i += kVecSize) {
+    Store(dst + i, VecUnaryOp<unary_op>::Apply(Load(src + i)));
+  }
+  const UnaryFunctor<DeviceType::kCPU, unary_op, float, float> functor;
+  for (; i < n; ++i) { dst[i] = functor(src[i]); }
+}
+
+template<BinaryOp binary_op, bool src0_broadcast, bool src1_broadcast>
+OF_EP_CPU_TARGET_AVX2 void BinaryRowAvx2(const float* src0, const float* src1, float* dst,
+                                         size_t n) {
+  using namespace avx2;
+  const __m256 src0_vec = src0_broadcast ? _mm256_set1_ps(*src0) : _mm256_setzero_ps();
+  const __m256 src1_vec = src1_broadcast ? _mm256_set1_ps(*src1) : _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + kVecSize <= n; i += kVecSize) {
+    Store(dst + i, VecBinaryOp<binary_op>::Apply(src0_broadcast ? src0_vec : Load(src0 + i),
+                                                 src1_broadcast ? src1_vec : Load(src1 + i)));
+  }
+  const broadcast_elementwise_binary::BinaryFunctor<DeviceType::kCPU, binary_op, float, float>
+      functor;
+  for (; i < n; ++i) {
+    dst[i] = functor(src0[src0_broadcast ? 0 : i], src1[src1_broadcast ? 0 : i]);
+  }
+}
+
+template<BinaryOp binary_op, bool src0_broadcast, bool src1_broadcast>
+OF_EP_CPU_TARGET_AVX512 void BinaryRowAvx512(const float* src0, const float* src1, float* dst,
+                                             size_t n) {
+  using namespace avx512;
+  const __m512 src0_vec = src0_broadcast ? _mm512_set1_ps(*src0) : _mm512_setzero_ps();
+  const __m512 src1_vec = src1_broadcast ? _mm512_set1_ps(*src1) : _mm512_setzero_ps();
+  size_t i = 0;
+  for (; i + kVecSize <= n; i += kVecSize) {
+    Store(dst + i, VecBinaryOp<binary_op>::Apply(src0_broadcast ? src0_vec : Load(src0 + i),
+                                                 src1_broadcast ? src1_vec : Load(src1 + i)));
+  }
+  const broadcast_elementwise_binary::BinaryFunctor<DeviceType::kCPU, binary_op, float, float>
+      functor;
+  for (; i < n; ++i) {
+    dst[i] = functor(src0[src0_broadcast ? 0 : i], src1[src1_broadcast ? 0 : i]);
+  }
+}
+
+template<UnaryOp unary_op>
+FloatUnaryRowFunc GetUnaryRowFunc(CpuIsa isa) {
+  if (isa == CpuIsa::kAvx512) { return UnaryRowAvx512<unary_op>; }
+  if (isa == CpuIsa::kAvx2) { return UnaryRowAvx2<unary_op>; }
+  return nullptr;
+}
+
+template<BinaryOp binary_op>
+FloatBinaryRowFunc GetBinaryRowFunc(bool src0_broadcast, bool src1_broadcast, CpuIsa isa) {
+  if (src0_broadcast && src1_broadcast) { return nullptr; }
+  if (isa == CpuIsa::kAvx512) {
+    if (src0_broadcast) { return BinaryRowAvx512<binary_op, true, false>; }
+    if (src1_broadcast) { return BinaryRowAvx512<binary_op, false, true>; }
+    return BinaryRowAvx512<binary_op, false, false>;
+  }
+  if (isa == CpuIsa::kAvx2) {
+    if (src0_broadcast) { return BinaryRowAvx2<binary_op, true, false>; }
+    if (src1_broadcast) { return BinaryRowAvx2<binary_op, false, true>; }
+    return BinaryRowAvx2<binary_op, false, false>;
+  }
+  return nullptr;
+}
+
+#endif  // OF_EP_CPU_X86_SIMD
+
+}  // namespace
+
+FloatUnaryRowFunc GetFloatUnaryRowFunc(UnaryOp unary_op, CpuIsa isa) {
+#ifdef OF_EP_CPU_X86_SIMD
+  switch (unary_op) {
+    case UnaryOp::kRelu: return GetUnaryRowFunc<UnaryOp::kRelu>(isa);
+    case UnaryOp::kGelu: return GetUnaryRowFunc<UnaryOp::kGelu>(isa);
+    case UnaryOp::kTanh: return GetUnaryRowFunc<UnaryOp::kTanh>(isa);
+    default: break;
+  }
+#endif  // OF_EP_CPU_X86_SIMD
+  return nullptr;
+}
+
+FloatBinaryRowFunc GetFloatBinaryRowFunc(BinaryOp binary_op, bool src0_broadcast,
+                                         bool src1_broadcast, CpuIsa isa) {
+#ifdef OF_EP_CPU_X86_SIMD
+#define BINARY_ROW_FUNC_CASE(op) \
+  case op: return GetBinaryRowFunc<op>(src0_broadcast, src1_broadcast, isa);
+  switch (binary_op) {
+    BINARY_ROW_FUNC_CASE(BinaryOp::kAdd)
+    BINARY_ROW_FUNC_CASE(BinaryOp::kSub)
+    BINARY_ROW_FUNC_CASE(BinaryOp::kMul)
+    BINARY_ROW_FUNC_CASE(BinaryOp::kDiv)
+    BINARY_ROW_FUNC_CASE(BinaryOp::kMax)
+    BINARY_ROW_FUNC_CASE(BinaryOp::kMin)
+    default: break;
+  }
+#undef BINARY_ROW_FUNC_CASE
+#endif  // OF_EP_CPU_X86_SIMD
+  return nullptr;
+}
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
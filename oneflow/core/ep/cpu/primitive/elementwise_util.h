@@ -0,0 +1,47 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_EP_CPU_PRIMITIVE_ELEMENTWISE_UTIL_H_
+#define ONEFLOW_CORE_EP_CPU_PRIMITIVE_ELEMENTWISE_UTIL_H_
+
+#include "oneflow/core/ep/cpu/primitive/vectorized_math.h"
+#include "oneflow/core/ep/include/primitive/unary_op.h"
+#include "oneflow/core/ep/include/primitive/binary_op.h"
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+// Computes n elements of a float unary op, dst may alias src.
+using FloatUnaryRowFunc = void (*)(const float* src, float* dst, size_t n);
+
+// Computes n elements of a float binary op. A broadcast operand is the single value it points
+// to, the other operands are n contiguous elements. dst may alias a non-broadcast operand.
+using FloatBinaryRowFunc = void (*)(const float* src0, const float* src1, float* dst, size_t n);
+
+// Both return nullptr when the op has no vectorized kernel for isa, callers then keep their
+// scalar loop.
+FloatUnaryRowFunc GetFloatUnaryRowFunc(UnaryOp unary_op, CpuIsa isa);
+
+FloatBinaryRowFunc GetFloatBinaryRowFunc(BinaryOp binary_op, bool src0_broadcast,
+                                         bool src1_broadcast, CpuIsa isa);
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_EP_CPU_PRIMITIVE_ELEMENTWISE_UTIL_H_
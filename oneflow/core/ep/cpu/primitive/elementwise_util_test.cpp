@@ -0,0 +1,154 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ep/cpu/primitive/elementwise_util.h"
+#include "oneflow/core/ep/cpu/primitive/binary_functor.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <random>
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+namespace {
+
+std::vector<CpuIsa> GetVectorizedIsas() {
+  std::vector<CpuIsa> isas;
+  if (GetCpuIsa() >= CpuIsa::kAvx2) { isas.push_back(CpuIsa::kAvx2); }
+  if (GetCpuIsa() >= CpuIsa::kAvx512) { isas.push_back(CpuIsa::kAvx512); }
+  return isas;
+}
+
+std::vector<float> RandomRow(size_t n, float scale, std::mt19937* rng) {
+  std::uniform_real_distribution<float> dist(-scale, scale);
+  std::vector<float> row(n);
+  for (auto& v : row) { v = dist(*rng); }
+  return row;
+}
+
+double ReferenceUnary(UnaryOp unary_op, double x) {
+  switch (unary_op) {
+    case UnaryOp::kRelu: return x > 0 ? x : 0;
+    case UnaryOp::kGelu: return 0.5 * x * std::erfc(-x / std::sqrt(2.0));
+    case UnaryOp::kTanh: return std::tanh(x);
+    default: return NAN;
+  }
+}
+
+void TestUnaryRow(UnaryOp unary_op, CpuIsa isa) {
+  std::mt19937 rng(0);
+  const FloatUnaryRowFunc row_func = GetFloatUnaryRowFunc(unary_op, isa);
+  ASSERT_NE(row_func, nullptr);
+  for (size_t n : {1, 7, 16, 33, 1000}) {
+    std::vector<float> x = RandomRow(n, 12.0f, &rng);
+    if (n > 8) {
+      x[0] = 0.0f;
+      x[1] = -0.0f;
+      x[2] = 1e-20f;
+      x[3] = 0.6f;
+      x[4] = -100.0f;
+      x[5] = 100.0f;
+      x[6] = NAN;
+    }
+    std::vector<float> y(n);
+    row_func(x.data(), y.data(), n);
+    for (size_t i = 0; i < n; ++i) {
+      const double expected = ReferenceUnary(unary_op, x[i]);
+      if (std::isnan(expected)) {
+        ASSERT_TRUE(std::isnan(y[i])) << "n " << n << " index " << i;
+      } else {
+        ASSERT_NEAR(y[i], expected, 1e-6 * std::max(1.0, std::abs(expected)))
+            << "n " << n << " index " << i << " x " << x[i];
+      }
+    }
+    // in place
+    row_func(x.data(), x.data(), n);
+    for (size_t i = 0; i < n; ++i) {
+      if (!std::isnan(y[i])) { ASSERT_EQ(x[i], y[i]); }
+    }
+  }
+}
+
+template<BinaryOp binary_op>
+void TestBinaryRow(CpuIsa isa) {
+  std::mt19937 rng(1);
+  const broadcast_elementwise_binary::BinaryFunctor<DeviceType::kCPU, binary_op, float, float>
+      functor;
+  for (size_t n : {1, 7, 16, 33, 1000}) {
+    std::vector<float> src0 = RandomRow(n, 10.0f, &rng);
+    std::vector<float> src1 = RandomRow(n, 10.0f, &rng);
+    if (n > 8) {
+      src0[0] = NAN;
+      src1[1] = NAN;
+      src0[2] = -0.0f;
+      src1[2] = 0.0f;
+      src1[3] = src0[3];
+    }
+    for (bool src0_broadcast : {false, true}) {
+      for (bool src1_broadcast : {false, true}) {
+        if (src0_broadcast && src1_broadcast) { continue; }
+        const FloatBinaryRowFunc row_func =
+            GetFloatBinaryRowFunc(binary_op, src0_broadcast, src1_broadcast, isa);
+        ASSERT_NE(row_func, nullptr);
+        std::vector<float> dst(n);
+        row_func(src0.data(), src1.data(), dst.data(), n);
+        for (size_t i = 0; i < n; ++i) {
+          const float expected =
+              functor(src0[src0_broadcast ? 0 : i], src1[src1_broadcast ? 0 : i]);
+          if (std::isnan(expected)) {
+            ASSERT_TRUE(std::isnan(dst[i]));
+          } else {
+            ASSERT_EQ(dst[i], expected) << "n " << n << " index " << i;
+            ASSERT_EQ(std::signbit(dst[i]), std::signbit(expected));
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(ElementwiseUtil, UnaryRowFunc) {
+  for (CpuIsa isa : GetVectorizedIsas()) {
+    TestUnaryRow(UnaryOp::kRelu, isa);
+    TestUnaryRow(UnaryOp::kGelu, isa);
+    TestUnaryRow(UnaryOp::kTanh, isa);
+  }
+}
+
+TEST(ElementwiseUtil, BinaryRowFunc) {
+  for (CpuIsa isa : GetVectorizedIsas()) {
+    TestBinaryRow<BinaryOp::kAdd>(isa);
+    TestBinaryRow<BinaryOp::kSub>(isa);
+    TestBinaryRow<BinaryOp::kMul>(isa);
+    TestBinaryRow<BinaryOp::kDiv>(isa);
+    TestBinaryRow<BinaryOp::kMax>(isa);
+    TestBinaryRow<BinaryOp::kMin>(isa);
+  }
+}
+
+TEST(ElementwiseUtil, ScalarIsaHasNoRowFunc) {
+  EXPECT_EQ(GetFloatUnaryRowFunc(UnaryOp::kRelu, CpuIsa::kScalar), nullptr);
+  EXPECT_EQ(GetFloatBinaryRowFunc(BinaryOp::kAdd, false, false, CpuIsa::kScalar), nullptr);
+  EXPECT_EQ(GetFloatBinaryRowFunc(BinaryOp::kPow, false, false, GetCpuIsa()), nullptr);
+}
+
+}  // namespace
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
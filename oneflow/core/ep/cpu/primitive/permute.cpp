@@ -15,6 +15,8 @@ limitations under the License.
 */
 #include "oneflow/core/ep/include/primitive/permute.h"
 #include "oneflow/core/ep/common/primitive/permute_impl.h"
+#include "oneflow/core/ep/cpu/primitive/vectorized_math.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
 
 namespace oneflow {
 
@@ -27,30 +29,238 @@ namespace internal {
 
 namespace {
 
+// Side of the square blocks the transpose path walks, small enough that a block of the largest
+// movement size still sits in L1 for both src and dst.
+constexpr int64_t kTransposeBlockSize = 32;
+
+template<size_t movement_size>
+using MovementType = typename std::aligned_storage<movement_size, movement_size>::type;
+
+// dst[n * dst_ld + m] = src[m * src_ld + n] for m < rows, n < cols.
+template<size_t movement_size>
+void TransposeTileScalar(const MovementType<movement_size>* src, int64_t src_ld,
+                         MovementType<movement_size>* dst, int64_t dst_ld, int64_t rows,
+                         int64_t cols) {
+  for (int64_t n = 0; n < cols; ++n) {
+    for (int64_t m = 0; m < rows; ++m) { dst[n * dst_ld + m] = src[m * src_ld + n]; }
+  }
+}
+
+#ifdef OF_EP_CPU_X86_SIMD
+
+// The shuffles only move bits around, so reinterpreting 4/8-byte elements as float/double is
+// exact for any payload.
+OF_EP_CPU_TARGET_AVX2 void Transpose8x8Avx2(const float* src, int64_t src_ld, float* dst,
+                                            int64_t dst_ld) {
+  __m256 r[8];
+  for (int i = 0; i < 8; ++i) { r[i] = _mm256_loadu_ps(src + i * src_ld); }
+  __m256 t[8];
+  for (int i = 0; i < 4; ++i) {
+    t[2 * i] = _mm256_unpacklo_ps(r[2 * i], r[2 * i + 1]);
+    t[2 * i + 1] = _mm256_unpackhi_ps(r[2 * i], r[2 * i + 1]);
+  }
+  __m256 u[8];
+  for (int i = 0; i < 2; ++i) {
+    u[4 * i] = _mm256_shuffle_ps(t[4 * i], t[4 * i + 2], _MM_SHUFFLE(1, 0, 1, 0));
+    u[4 * i + 1] = _mm256_shuffle_ps(t[4 * i], t[4 * i + 2], _MM_SHUFFLE(3, 2, 3, 2));
+    u[4 * i + 2] = _mm256_shuffle_ps(t[4 * i + 1], t[4 * i + 3], _MM_SHUFFLE(1, 0, 1, 0));
+    u[4 * i + 3] = _mm256_shuffle_ps(t[4 * i + 1], t[4 * i + 3], _MM_SHUFFLE(3, 2, 3, 2));
+  }
+  for (int i = 0; i < 4; ++i) {
+    _mm256_storeu_ps(dst + i * dst_ld, _mm256_permute2f128_ps(u[i], u[i + 4], 0x20));
+    _mm256_storeu_ps(dst + (i + 4) * dst_ld, _mm256_permute2f128_ps(u[i], u[i + 4], 0x31));
+  }
+}
+
+OF_EP_CPU_TARGET_AVX2 void Transpose4x4Avx2(const double* src, int64_t src_ld, double* dst,
+                                            int64_t dst_ld) {
+  const __m256d r0 = _mm256_loadu_pd(src);
+  const __m256d r1 = _mm256_loadu_pd(src + src_ld);
+  const __m256d r2 = _mm256_loadu_pd(src + 2 * src_ld);
+  const __m256d r3 = _mm256_loadu_pd(src + 3 * src_ld);
+  const __m256d t0 = _mm256_unpacklo_pd(r0, r1);
+  const __m256d t1 = _mm256_unpackhi_pd(r0, r1);
+  const __m256d t2 = _mm256_unpacklo_pd(r2, r3);
+  const __m256d t3 = _mm256_unpackhi_pd(r2, r3);
+  _mm256_storeu_pd(dst, _mm256_permute2f128_pd(t0, t2, 0x20));
+  _mm256_storeu_pd(dst + dst_ld, _mm256_permute2f128_pd(t1, t3, 0x20));
+  _mm256_storeu_pd(dst + 2 * dst_ld, _mm256_permute2f128_pd(t0, t2, 0x31));
+  _mm256_storeu_pd(dst + 3 * dst_ld, _mm256_permute2f128_pd(t1, t3, 0x31));
+}
+
+template<size_t movement_size>
+struct TransposeAvx2Traits;
+
+template<>
+struct TransposeAvx2Traits<4> {
+  using Type = float;
+  static constexpr int64_t kTileSize = 8;
+  OF_EP_CPU_TARGET_AVX2 static void Tile(const Type* src, int64_t src_ld, Type* dst,
+                                         int64_t dst_ld) {
+    Transpose8x8Avx2(src, src_ld, dst, dst_ld);
+  }
+};
+
+template<>
+struct TransposeAvx2Traits<8> {
+  using Type = double;
+  static constexpr int64_t kTileSize = 4;
+  OF_EP_CPU_TARGET_AVX2 static void Tile(const Type* src, int64_t src_ld, Type* dst,
+                                         int64_t dst_ld) {
+    Transpose4x4Avx2(src, src_ld, dst, dst_ld);
+  }
+};
+
+template<size_t movement_size>
+OF_EP_CPU_TARGET_AVX2 void TransposeBlockAvx2(const MovementType<movement_size>* src,
+                                              int64_t src_ld, MovementType<movement_size>* dst,
+                                              int64_t dst_ld, int64_t rows, int64_t cols) {
+  using Traits = TransposeAvx2Traits<movement_size>;
+  using T = typename Traits::Type;
+  constexpr int64_t tile = Traits::kTileSize;
+  const int64_t full_rows = rows / tile * tile;
+  const int64_t full_cols = cols / tile * tile;
+  for (int64_t n = 0; n < full_cols; n += tile) {
+    for (int64_t m = 0; m < full_rows; m += tile) {
+      Traits::Tile(reinterpret_cast<const T*>(src + m * src_ld + n), src_ld,
+                   reinterpret_cast<T*>(dst + n * dst_ld + m), dst_ld);
+    }
+  }
+  TransposeTileScalar<movement_size>(src + full_rows * src_ld, src_ld, dst + full_rows, dst_ld,
+                                     rows - full_rows, full_cols);
+  TransposeTileScalar<movement_size>(src + full_cols, src_ld, dst + full_cols * dst_ld, dst_ld,
+                                     rows, cols - full_cols);
+}
+
+#endif  // OF_EP_CPU_X86_SIMD
+
+template<size_t movement_size>
+using TransposeBlockFunc = void (*)(const MovementType<movement_size>* src, int64_t src_ld,
+                                    MovementType<movement_size>* dst, int64_t dst_ld,
+                                    int64_t rows, int64_t cols);
+
+template<size_t movement_size>
+TransposeBlockFunc<movement_size> GetTransposeBlockFunc(std::false_type /*has_simd_tile*/) {
+  return TransposeTileScalar<movement_size>;
+}
+
+template<size_t movement_size>
+TransposeBlockFunc<movement_size> GetTransposeBlockFunc(std::true_type /*has_simd_tile*/) {
+#ifdef OF_EP_CPU_X86_SIMD
+  if (GetCpuIsa() >= CpuIsa::kAvx2) { return TransposeBlockAvx2<movement_size>; }
+#endif  // OF_EP_CPU_X86_SIMD
+  return TransposeTileScalar<movement_size>;
+}
+
+// The innermost dimension stays in place, so every run of it is one contiguous copy.
 template<size_t num_dims, size_t movement_size, typename IndexType>
-void PermuteKernel(PermuteKernelParams<num_dims, IndexType> params) {
-  using T = typename std::aligned_storage<movement_size, movement_size>::type;
+void CopyRows(CpuStream* stream, const PermuteKernelParams<num_dims, IndexType>& params,
+              const int64_t* src_dims) {
+  using T = MovementType<movement_size>;
   const T* src = reinterpret_cast<const T*>(params.src);
   T* dst = reinterpret_cast<T*>(params.dst);
-  for (IndexType i = 0; i < params.count; ++i) {
-    IndexType src_index[num_dims];
-    IndexType dst_index[num_dims];
-    params.dst_index_helper.OffsetToNdIndex(i, dst_index);
-    for (size_t dim = 0; dim < num_dims; ++dim) {
-      src_index[params.permutation[dim]] = dst_index[dim];
+  const IndexType row_size = src_dims[num_dims - 1];
+  const IndexType num_rows = params.count / row_size;
+  stream->ParallelFor(
+      0, num_rows,
+      [&](int64_t begin, int64_t end) {
+        IndexType src_index[num_dims];
+        IndexType dst_index[num_dims];
+        for (IndexType row = begin; row < end; ++row) {
+          const IndexType dst_offset = row * row_size;
+          params.dst_index_helper.OffsetToNdIndex(dst_offset, dst_index);
+          for (size_t dim = 0; dim < num_dims; ++dim) {
+            src_index[params.permutation[dim]] = dst_index[dim];
+          }
+          const IndexType src_offset = params.src_index_helper.NdIndexToOffset(src_index);
+          std::memcpy(dst + dst_offset, src + src_offset, row_size * sizeof(T));
+        }
+      },
+      std::max<int64_t>(kParallelForDefaultGrain / row_size, 1));
+}
+
+// The innermost dimension moves. Every dst matrix [src dim n, src dim m] with m = the new
+// innermost dimension and n = the old one is a 2-D transpose of a strided src matrix, done in
+// cache-sized blocks. Work is split over (batch, block of n).
+template<size_t num_dims, size_t movement_size, typename IndexType>
+void BatchTranspose(CpuStream* stream, const PermuteKernelParams<num_dims, IndexType>& params,
+                    const int64_t* src_dims) {
+  using T = MovementType<movement_size>;
+  const T* src = reinterpret_cast<const T*>(params.src);
+  T* dst = reinterpret_cast<T*>(params.dst);
+  int64_t src_strides[num_dims];
+  int64_t dst_dims[num_dims];
+  int64_t dst_strides[num_dims];
+  src_strides[num_dims - 1] = 1;
+  dst_strides[num_dims - 1] = 1;
+  for (size_t i = 0; i < num_dims; ++i) { dst_dims[i] = src_dims[params.permutation[i]]; }
+  for (int i = static_cast<int>(num_dims) - 2; i >= 0; --i) {
+    src_strides[i] = src_strides[i + 1] * src_dims[i + 1];
+    dst_strides[i] = dst_strides[i + 1] * dst_dims[i + 1];
+  }
+  const int m_src_dim = params.permutation[num_dims - 1];
+  const int64_t rows = src_dims[m_src_dim];
+  const int64_t cols = src_dims[num_dims - 1];
+  const int64_t src_ld = src_strides[m_src_dim];
+  int64_t dst_ld = 0;
+  // remaining dims in dst order, with the matching src stride
+  int64_t batch_dims[num_dims];
+  int64_t batch_src_strides[num_dims];
+  int64_t batch_dst_strides[num_dims];
+  int num_batch_dims = 0;
+  for (size_t i = 0; i + 1 < num_dims; ++i) {
+    if (params.permutation[i] == static_cast<int>(num_dims) - 1) {
+      dst_ld = dst_strides[i];
+    } else {
+      batch_dims[num_batch_dims] = dst_dims[i];
+      batch_src_strides[num_batch_dims] = src_strides[params.permutation[i]];
+      batch_dst_strides[num_batch_dims] = dst_strides[i];
+      num_batch_dims += 1;
     }
-    IndexType src_offset = params.src_index_helper.NdIndexToOffset(src_index);
-    dst[i] = src[src_offset];
   }
+  const int64_t num_col_blocks = (cols + kTransposeBlockSize - 1) / kTransposeBlockSize;
+  const int64_t num_batches = params.count / (rows * cols);
+  const TransposeBlockFunc<movement_size> block_func = GetTransposeBlockFunc<movement_size>(
+      std::integral_constant<bool, movement_size == 4 || movement_size == 8>());
+  stream->ParallelFor(
+      0, num_batches * num_col_blocks,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t unit = begin; unit < end; ++unit) {
+          int64_t batch = unit / num_col_blocks;
+          const int64_t col_begin = (unit % num_col_blocks) * kTransposeBlockSize;
+          const int64_t col_size = std::min(cols - col_begin, kTransposeBlockSize);
+          int64_t src_offset = col_begin;
+          int64_t dst_offset = col_begin * dst_ld;
+          for (int i = num_batch_dims - 1; i >= 0; --i) {
+            const int64_t index = batch % batch_dims[i];
+            batch /= batch_dims[i];
+            src_offset += index * batch_src_strides[i];
+            dst_offset += index * batch_dst_strides[i];
+          }
+          for (int64_t row_begin = 0; row_begin < rows; row_begin += kTransposeBlockSize) {
+            block_func(src + src_offset + row_begin * src_ld, src_ld, dst + dst_offset + row_begin,
+                       dst_ld, std::min(rows - row_begin, kTransposeBlockSize), col_size);
+          }
+        }
+      },
+      std::max<int64_t>(kParallelForDefaultGrain / (kTransposeBlockSize * rows), 1));
 }
 
 template<size_t num_dims, size_t movement_size, typename IndexType>
 void LaunchKernel(Stream* stream, const int64_t* src_dims, const void* src, const int* permutation,
                   void* dst, size_t count) {
+  // An empty tensor has a zero dim, which both paths below would divide by.
+  if (count == 0) { return; }
   PermuteKernelParams<num_dims, IndexType> params =
       MakePermuteParams<num_dims, IndexType>(src_dims, src, permutation, dst, count);
-  PermuteKernel<num_dims, movement_size, IndexType>(params);
+  CpuStream* cpu_stream = stream->As<CpuStream>();
+  if (params.permutation[num_dims - 1] == static_cast<int>(num_dims) - 1) {
+    CopyRows<num_dims, movement_size, IndexType>(cpu_stream, params, src_dims);
+  } else {
+    BatchTranspose<num_dims, movement_size, IndexType>(cpu_stream, params, src_dims);
+  }
 }
+
 class PermuteImpl : public Permute {
  public:
   OF_DISALLOW_COPY_AND_MOVE(PermuteImpl);
@@ -0,0 +1,89 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ep/include/primitive/permute.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/common/nd_index_offset_helper.h"
+#include <gtest/gtest.h>
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+namespace {
+
+template<typename T>
+void TestPermute(const std::vector<int64_t>& src_dims, const std::vector<int>& permutation) {
+  const size_t num_dims = src_dims.size();
+  int64_t count = 1;
+  for (int64_t dim : src_dims) { count *= dim; }
+  std::vector<T> src(count);
+  for (int64_t i = 0; i < count; ++i) { src[i] = static_cast<T>(i % 251); }
+  std::vector<T> dst(count);
+  std::vector<int64_t> dst_dims(num_dims);
+  for (size_t i = 0; i < num_dims; ++i) { dst_dims[i] = src_dims[permutation[i]]; }
+  NdIndexOffsetHelper<int64_t, 8> src_helper(src_dims.data(), num_dims);
+  NdIndexOffsetHelper<int64_t, 8> dst_helper(dst_dims.data(), num_dims);
+  std::vector<T> expected(count);
+  for (int64_t i = 0; i < count; ++i) {
+    int64_t dst_index[8];
+    int64_t src_index[8];
+    dst_helper.OffsetToNdIndex(i, dst_index, num_dims);
+    for (size_t dim = 0; dim < num_dims; ++dim) { src_index[permutation[dim]] = dst_index[dim]; }
+    expected[i] = src[src_helper.NdIndexToOffset(src_index, num_dims)];
+  }
+  std::unique_ptr<Permute> permute = NewPrimitive<PermuteFactory>(DeviceType::kCPU, num_dims);
+  ASSERT_TRUE(permute);
+  CpuStream stream(nullptr);
+  permute->Launch(&stream, GetDataType<T>::value, num_dims, src_dims.data(), src.data(),
+                  permutation.data(), dst.data());
+  for (int64_t i = 0; i < count; ++i) { ASSERT_EQ(dst[i], expected[i]) << "offset " << i; }
+}
+
+template<typename T>
+void TestPermuteShapes() {
+  TestPermute<T>({37, 45}, {1, 0});
+  TestPermute<T>({64, 128}, {1, 0});
+  TestPermute<T>({2, 3, 17, 19}, {0, 2, 3, 1});
+  TestPermute<T>({2, 17, 19, 3}, {0, 3, 1, 2});
+  TestPermute<T>({4, 9, 5, 33}, {0, 2, 1, 3});
+  TestPermute<T>({3, 5, 7, 11, 13}, {4, 2, 0, 3, 1});
+  TestPermute<T>({6, 70, 9}, {2, 0, 1});
+  TestPermute<T>({16, 130, 67}, {2, 0, 1});
+  TestPermute<T>({16, 130, 67}, {1, 0, 2});
+}
+
+TEST(CpuPermute, EmptyTensor) {
+  TestPermute<float>({0, 5}, {1, 0});
+  TestPermute<float>({2, 3, 0}, {1, 0, 2});
+  TestPermute<float>({3, 0, 4}, {2, 0, 1});
+  TestPermute<int8_t>({7, 0}, {1, 0});
+}
+
+TEST(CpuPermute, Permute) {
+  TestPermuteShapes<int8_t>();
+  TestPermuteShapes<int32_t>();
+  TestPermuteShapes<float>();
+  TestPermuteShapes<double>();
+  TestPermuteShapes<int64_t>();
+}
+
+}  // namespace
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
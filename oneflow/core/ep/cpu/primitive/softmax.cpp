@@ -16,6 +16,8 @@ limitations under the License.
 #include "oneflow/core/ep/include/primitive/softmax.h"
 #include "oneflow/core/ep/include/primitive/log_softmax.h"
 #include "oneflow/core/ep/cpu/primitive/type_seq.h"
+#include "oneflow/core/ep/cpu/primitive/softmax_util.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
 
 namespace oneflow {
 
@@ -24,44 +26,48 @@ namespace primitive {
 
 namespace {
 
-enum class Algorithm {
-  kSoftmax,
-  kLogSoftmax,
-};
+template<SoftmaxAlgorithm algorithm>
+void SoftmaxCpu(CpuStream* stream, size_t rows, size_t cols, const double* x, double* y) {
+  stream->ParallelFor(
+      0, rows,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+          SoftmaxRowScalar<algorithm, double>(x + i * cols, y + i * cols, cols);
+        }
+      },
+      GetSoftmaxRowGrain(cols));
+}
 
-template<Algorithm algorithm, typename T>
-void SoftmaxCpu(size_t rows, size_t cols, const T* x, T* y) {
-  for (size_t i = 0; i < rows; ++i) {
-    size_t row_offset = i * cols;
-    const T* row_x = x + row_offset;
-    T* row_y = y + row_offset;
-    const T row_max = *std::max_element(row_x, row_x + cols);
-    T row_sum = 0;
-    for (size_t j = 0; j < cols; ++j) {
-      if (algorithm == Algorithm::kSoftmax) {
-        T exp_x = std::exp(row_x[j] - row_max);
-        row_sum += exp_x;
-        row_y[j] = exp_x;
-      } else if (algorithm == Algorithm::kLogSoftmax) {
-        row_y[j] = row_x[j] - row_max;
-        row_sum += std::exp(row_y[j]);
-      } else {
-        UNIMPLEMENTED();
-      }
-    }
-    for (size_t j = 0; j < cols; ++j) {
-      if (algorithm == Algorithm::kSoftmax) {
-        row_y[j] /= row_sum;
-      } else if (algorithm == Algorithm::kLogSoftmax) {
-        row_y[j] -= std::log(row_sum);
-      } else {
-        UNIMPLEMENTED();
-      }
-    }
-  }
+template<SoftmaxAlgorithm algorithm>
+void SoftmaxCpu(CpuStream* stream, size_t rows, size_t cols, const float* x, float* y) {
+  const SoftmaxRowFunc row_func = GetSoftmaxRowFunc(algorithm, GetCpuIsa());
+  stream->ParallelFor(
+      0, rows,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) { row_func(x + i * cols, y + i * cols, cols); }
+      },
+      GetSoftmaxRowGrain(cols));
+}
+
+// Reduced precision types are widened a row at a time and computed in float.
+template<SoftmaxAlgorithm algorithm, typename T>
+void SoftmaxCpu(CpuStream* stream, size_t rows, size_t cols, const T* x, T* y) {
+  const CpuIsa isa = GetCpuIsa();
+  const SoftmaxRowFunc row_func = GetSoftmaxRowFunc(algorithm, isa);
+  stream->ParallelFor(
+      0, rows,
+      [&](int64_t begin, int64_t end) {
+        std::vector<float> row_buf(cols);
+        for (int64_t i = begin; i < end; ++i) {
+          ConvertToFloat(isa, x + i * cols, row_buf.data(), cols);
+          row_func(row_buf.data(), row_buf.data(), cols);
+          ConvertFromFloat(isa, row_buf.data(), y + i * cols, cols);
+        }
+      },
+      GetSoftmaxRowGrain(cols));
 }
 
-template<typename SoftmaxBase, Algorithm algorithm, typename T>
+template<typename SoftmaxBase, SoftmaxAlgorithm algorithm, typename T>
 class SoftmaxImpl : public SoftmaxBase {
  public:
   OF_DISALLOW_COPY_AND_MOVE(SoftmaxImpl);
@@ -69,16 +75,17 @@ class SoftmaxImpl : public SoftmaxBase {
   ~SoftmaxImpl() override = default;
 
   void Launch(Stream* stream, size_t rows, size_t cols, const void* x, void* y) override {
-    SoftmaxCpu<algorithm, T>(rows, cols, reinterpret_cast<const T*>(x), reinterpret_cast<T*>(y));
+    SoftmaxCpu<algorithm>(stream->As<CpuStream>(), rows, cols, reinterpret_cast<const T*>(x),
+                          reinterpret_cast<T*>(y));
   }
 };
 
-template<typename SoftmaxBase, Algorithm algorithm, typename T>
+template<typename SoftmaxBase, SoftmaxAlgorithm algorithm, typename T>
 std::unique_ptr<SoftmaxBase> NewSoftmax() {
   return std::unique_ptr<SoftmaxBase>(new SoftmaxImpl<SoftmaxBase, algorithm, T>());
 }
 
-template<typename FactoryBase, typename SoftmaxBase, Algorithm algorithm>
+template<typename FactoryBase, typename SoftmaxBase, SoftmaxAlgorithm algorithm>
 class GenericSoftmaxFactoryImpl : public FactoryBase {
  public:
   OF_DISALLOW_COPY_AND_MOVE(GenericSoftmaxFactoryImpl);
@@ -91,7 +98,9 @@ class GenericSoftmaxFactoryImpl : public FactoryBase {
 
     static const std::map<DataType, std::function<std::unique_ptr<SoftmaxBase>()>>
         new_softmax_handle{
-            OF_PP_FOR_EACH_TUPLE(MAKE_NEW_SOFTMAX_ENTRY, CPU_PRIMITIVE_FLOATING_TYPE_SEQ)};
+            OF_PP_FOR_EACH_TUPLE(MAKE_NEW_SOFTMAX_ENTRY,
+                                 CPU_PRIMITIVE_FLOATING_TYPE_SEQ CPU_PRIMITIVE_FLOAT16_TYPE_SEQ
+                                     CPU_PRIMITIVE_BFLOAT16_TYPE_SEQ)};
 #undef MAKE_NEW_SOFTMAX_ENTRY
     const auto it = new_softmax_handle.find(data_type);
     if (it != new_softmax_handle.end()) {
@@ -102,9 +111,10 @@ class GenericSoftmaxFactoryImpl : public FactoryBase {
   }
 };
 
-using SoftmaxFactoryImpl = GenericSoftmaxFactoryImpl<SoftmaxFactory, Softmax, Algorithm::kSoftmax>;
+using SoftmaxFactoryImpl =
+    GenericSoftmaxFactoryImpl<SoftmaxFactory, Softmax, SoftmaxAlgorithm::kSoftmax>;
 using LogSoftmaxFactoryImpl =
-    GenericSoftmaxFactoryImpl<LogSoftmaxFactory, LogSoftmax, Algorithm::kLogSoftmax>;
+    GenericSoftmaxFactoryImpl<LogSoftmaxFactory, LogSoftmax, SoftmaxAlgorithm::kLogSoftmax>;
 REGISTER_PRIMITIVE_FACTORY(DeviceType::kCPU, SoftmaxFactory, SoftmaxFactoryImpl);
 REGISTER_PRIMITIVE_FACTORY(DeviceType::kCPU, LogSoftmaxFactory, LogSoftmaxFactoryImpl);
 
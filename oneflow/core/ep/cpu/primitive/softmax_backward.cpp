@@ -16,6 +16,8 @@ limitations under the License.
 #include "oneflow/core/ep/include/primitive/softmax_backward.h"
 #include "oneflow/core/ep/include/primitive/log_softmax_backward.h"
 #include "oneflow/core/ep/cpu/primitive/type_seq.h"
+#include "oneflow/core/ep/cpu/primitive/softmax_util.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
 
 namespace oneflow {
 
@@ -24,41 +26,56 @@ namespace primitive {
 
 namespace {
 
-enum class Algorithm {
-  kSoftmax,
-  kLogSoftmax,
-};
+template<SoftmaxAlgorithm algorithm>
+void SoftmaxBackwardCpu(CpuStream* stream, size_t rows, size_t cols, const double* y,
+                        const double* dy, double* dx) {
+  stream->ParallelFor(
+      0, rows,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+          SoftmaxBackwardRowScalar<algorithm, double>(y + i * cols, dy + i * cols, dx + i * cols,
+                                                      cols);
+        }
+      },
+      GetSoftmaxRowGrain(cols));
+}
 
-template<Algorithm algorithm, typename T>
-void SoftmaxBackwardCpu(size_t rows, size_t cols, const T* y, const T* dy, T* dx) {
-  for (size_t i = 0; i < rows; ++i) {
-    size_t row_offset = i * cols;
-    const T* row_y = y + row_offset;
-    const T* row_dy = dy + row_offset;
-    T* row_dx = dx + row_offset;
-    T row_sum = 0;
-    for (size_t j = 0; j < cols; ++j) {
-      if (algorithm == Algorithm::kSoftmax) {
-        row_sum += row_y[j] * row_dy[j];
-      } else if (algorithm == Algorithm::kLogSoftmax) {
-        row_sum += row_dy[j];
-      } else {
-        UNIMPLEMENTED();
-      }
-    }
-    for (size_t j = 0; j < cols; ++j) {
-      if (algorithm == Algorithm::kSoftmax) {
-        row_dx[j] = (row_dy[j] - row_sum) * row_y[j];
-      } else if (algorithm == Algorithm::kLogSoftmax) {
-        row_dx[j] = row_dy[j] - std::exp(row_y[j]) * row_sum;
-      } else {
-        UNIMPLEMENTED();
-      }
-    }
-  }
+template<SoftmaxAlgorithm algorithm>
+void SoftmaxBackwardCpu(CpuStream* stream, size_t rows, size_t cols, const float* y,
+                        const float* dy, float* dx) {
+  const SoftmaxBackwardRowFunc row_func = GetSoftmaxBackwardRowFunc(algorithm, GetCpuIsa());
+  stream->ParallelFor(
+      0, rows,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+          row_func(y + i * cols, dy + i * cols, dx + i * cols, cols);
+        }
+      },
+      GetSoftmaxRowGrain(cols));
+}
+
+// Reduced precision types are widened a row at a time and computed in float.
+template<SoftmaxAlgorithm algorithm, typename T>
+void SoftmaxBackwardCpu(CpuStream* stream, size_t rows, size_t cols, const T* y, const T* dy,
+                        T* dx) {
+  const CpuIsa isa = GetCpuIsa();
+  const SoftmaxBackwardRowFunc row_func = GetSoftmaxBackwardRowFunc(algorithm, isa);
+  stream->ParallelFor(
+      0, rows,
+      [&](int64_t begin, int64_t end) {
+        std::vector<float> y_buf(cols);
+        std::vector<float> dy_buf(cols);
+        for (int64_t i = begin; i < end; ++i) {
+          ConvertToFloat(isa, y + i * cols, y_buf.data(), cols);
+          ConvertToFloat(isa, dy + i * cols, dy_buf.data(), cols);
+          row_func(y_buf.data(), dy_buf.data(), dy_buf.data(), cols);
+          ConvertFromFloat(isa, dy_buf.data(), dx + i * cols, cols);
+        }
+      },
+      GetSoftmaxRowGrain(cols));
 }
 
-template<typename SoftmaxBackwardBase, Algorithm algorithm, typename T>
+template<typename SoftmaxBackwardBase, SoftmaxAlgorithm algorithm, typename T>
 class SoftmaxBackwardImpl : public SoftmaxBackwardBase {
  public:
   OF_DISALLOW_COPY_AND_MOVE(SoftmaxBackwardImpl);
@@ -67,18 +84,19 @@ class SoftmaxBackwardImpl : public SoftmaxBackwardBase {
 
   void Launch(Stream* stream, size_t rows, size_t cols, const void* y, const void* dy,
               void* dx) override {
-    SoftmaxBackwardCpu<algorithm, T>(rows, cols, reinterpret_cast<const T*>(y),
-                                     reinterpret_cast<const T*>(dy), reinterpret_cast<T*>(dx));
+    SoftmaxBackwardCpu<algorithm>(stream->As<CpuStream>(), rows, cols,
+                                  reinterpret_cast<const T*>(y), reinterpret_cast<const T*>(dy),
+                                  reinterpret_cast<T*>(dx));
   }
 };
 
-template<typename SoftmaxBackwardBase, Algorithm algorithm, typename T>
+template<typename SoftmaxBackwardBase, SoftmaxAlgorithm algorithm, typename T>
 std::unique_ptr<SoftmaxBackwardBase> NewSoftmaxBackward() {
   return std::unique_ptr<SoftmaxBackwardBase>(
       new SoftmaxBackwardImpl<SoftmaxBackwardBase, algorithm, T>());
 }
 
-template<typename BackwardFactoryBase, typename SoftmaxBackwardBase, Algorithm algorithm>
+template<typename BackwardFactoryBase, typename SoftmaxBackwardBase, SoftmaxAlgorithm algorithm>
 class GenericSoftmaxBackwardFactoryImpl : public BackwardFactoryBase {
  public:
   OF_DISALLOW_COPY_AND_MOVE(GenericSoftmaxBackwardFactoryImpl);
@@ -91,7 +109,9 @@ class GenericSoftmaxBackwardFactoryImpl : public BackwardFactoryBase {
 
     static const std::map<DataType, std::function<std::unique_ptr<SoftmaxBackwardBase>()>>
         new_softmax_backward_handle{
-            OF_PP_FOR_EACH_TUPLE(MAKE_NEW_SOFTMAX_BACKWARD_ENTRY, CPU_PRIMITIVE_FLOATING_TYPE_SEQ)};
+            OF_PP_FOR_EACH_TUPLE(MAKE_NEW_SOFTMAX_BACKWARD_ENTRY,
+                                 CPU_PRIMITIVE_FLOATING_TYPE_SEQ CPU_PRIMITIVE_FLOAT16_TYPE_SEQ
+                                     CPU_PRIMITIVE_BFLOAT16_TYPE_SEQ)};
 #undef MAKE_NEW_SOFTMAX_BACKWARD_ENTRY
     const auto it = new_softmax_backward_handle.find(data_type);
     if (it != new_softmax_backward_handle.end()) {
@@ -103,10 +123,11 @@ class GenericSoftmaxBackwardFactoryImpl : public BackwardFactoryBase {
 };
 
 using SoftmaxBackwardFactoryImpl =
-    GenericSoftmaxBackwardFactoryImpl<SoftmaxBackwardFactory, SoftmaxBackward, Algorithm::kSoftmax>;
+    GenericSoftmaxBackwardFactoryImpl<SoftmaxBackwardFactory, SoftmaxBackward,
+                                      SoftmaxAlgorithm::kSoftmax>;
 using LogSoftmaxBackwardFactoryImpl =
     GenericSoftmaxBackwardFactoryImpl<LogSoftmaxBackwardFactory, LogSoftmaxBackward,
-                                      Algorithm::kLogSoftmax>;
+                                      SoftmaxAlgorithm::kLogSoftmax>;
 REGISTER_PRIMITIVE_FACTORY(DeviceType::kCPU, SoftmaxBackwardFactory, SoftmaxBackwardFactoryImpl);
 REGISTER_PRIMITIVE_FACTORY(DeviceType::kCPU, LogSoftmaxBackwardFactory,
                            LogSoftmaxBackwardFactoryImpl);
@@ -0,0 +1,244 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ep/cpu/primitive/softmax_util.h"
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+namespace {
+
+#ifdef OF_EP_CPU_X86_SIMD
+
+// Softmax has to materialize exp(x - max) anyway, so it takes a cheap max pass, then one pass
+// that writes the exponentials and sums them, then the rescale. log_softmax does not keep the
+// exponentials, so it folds max and sum into a single read of x with a per-lane running max whose
+// sum is rescaled when the max grows.
+
+OF_EP_CPU_TARGET_AVX2 void SoftmaxRowAvx2(const float* x, float* y, size_t cols) {
+  using namespace avx2;
+  size_t j = 0;
+  __m256 max_vec = _mm256_set1_ps(-std::numeric_limits<float>::infinity());
+  for (; j + kVecSize <= cols; j += kVecSize) { max_vec = _mm256_max_ps(max_vec, Load(x + j)); }
+  float row_max = ReduceMax(max_vec);
+  for (; j < cols; ++j) { row_max = std::max(row_max, x[j]); }
+  const __m256 row_max_vec = _mm256_set1_ps(row_max);
+  __m256 sum_vec = _mm256_setzero_ps();
+  for (j = 0; j + kVecSize <= cols; j += kVecSize) {
+    const __m256 exp_x = Exp(_mm256_sub_ps(Load(x + j), row_max_vec));
+    Store(y + j, exp_x);
+    sum_vec = _mm256_add_ps(sum_vec, exp_x);
+  }
+  float row_sum = ReduceAdd(sum_vec);
+  for (; j < cols; ++j) {
+    y[j] = std::exp(x[j] - row_max);
+    row_sum += y[j];
+  }
+  const float inv_row_sum = 1.0f / row_sum;
+  const __m256 inv_row_sum_vec = _mm256_set1_ps(inv_row_sum);
+  for (j = 0; j + kVecSize <= cols; j += kVecSize) {
+    Store(y + j, _mm256_mul_ps(Load(y + j), inv_row_sum_vec));
+  }
+  for (; j < cols; ++j) { y[j] *= inv_row_sum; }
+}
+
+OF_EP_CPU_TARGET_AVX2 void LogSoftmaxRowAvx2(const float* x, float* y, size_t cols) {
+  using namespace avx2;
+  size_t j = 0;
+  // lowest() rather than -inf keeps max_vec - new_max finite for rows that start with -inf
+  __m256 max_vec = _mm256_set1_ps(std::numeric_limits<float>::lowest());
+  __m256 sum_vec = _mm256_setzero_ps();
+  for (; j + kVecSize <= cols; j += kVecSize) {
+    const __m256 x_vec = Load(x + j);
+    const __m256 new_max_vec = _mm256_max_ps(max_vec, x_vec);
+    sum_vec = _mm256_fmadd_ps(sum_vec, Exp(_mm256_sub_ps(max_vec, new_max_vec)),
+                              Exp(_mm256_sub_ps(x_vec, new_max_vec)));
+    max_vec = new_max_vec;
+  }
+  float row_max = ReduceMax(max_vec);
+  float row_sum =
+      ReduceAdd(_mm256_mul_ps(sum_vec, Exp(_mm256_sub_ps(max_vec, _mm256_set1_ps(row_max)))));
+  for (; j < cols; ++j) {
+    if (x[j] > row_max) {
+      row_sum = row_sum * std::exp(row_max - x[j]) + 1.0f;
+      row_max = x[j];
+    } else {
+      row_sum += std::exp(x[j] - row_max);
+    }
+  }
+  const float log_row_sum = std::log(row_sum);
+  const __m256 row_max_vec = _mm256_set1_ps(row_max);
+  const __m256 log_row_sum_vec = _mm256_set1_ps(log_row_sum);
+  for (j = 0; j + kVecSize <= cols; j += kVecSize) {
+    Store(y + j, _mm256_sub_ps(_mm256_sub_ps(Load(x + j), row_max_vec), log_row_sum_vec));
+  }
+  for (; j < cols; ++j) { y[j] = x[j] - row_max - log_row_sum; }
+}
+
+OF_EP_CPU_TARGET_AVX2 void SoftmaxBackwardRowAvx2(const float* y, const float* dy, float* dx,
+                                                  size_t cols) {
+  using namespace avx2;
+  size_t j = 0;
+  __m256 sum_vec = _mm256_setzero_ps();
+  for (; j + kVecSize <= cols; j += kVecSize) {
+    sum_vec = _mm256_fmadd_ps(Load(y + j), Load(dy + j), sum_vec);
+  }
+  float row_sum = ReduceAdd(sum_vec);
+  for (; j < cols; ++j) { row_sum += y[j] * dy[j]; }
+  const __m256 row_sum_vec = _mm256_set1_ps(row_sum);
+  for (j = 0; j + kVecSize <= cols; j += kVecSize) {
+    Store(dx + j, _mm256_mul_ps(_mm256_sub_ps(Load(dy + j), row_sum_vec), Load(y + j)));
+  }
+  for (; j < cols; ++j) { dx[j] = (dy[j] - row_sum) * y[j]; }
+}
+
+OF_EP_CPU_TARGET_AVX2 void LogSoftmaxBackwardRowAvx2(const float* y, const float* dy, float* dx,
+                                                     size_t cols) {
+  using namespace avx2;
+  size_t j = 0;
+  __m256 sum_vec = _mm256_setzero_ps();
+  for (; j + kVecSize <= cols; j += kVecSize) { sum_vec = _mm256_add_ps(sum_vec, Load(dy + j)); }
+  float row_sum = ReduceAdd(sum_vec);
+  for (; j < cols; ++j) { row_sum += dy[j]; }
+  const __m256 row_sum_vec = _mm256_set1_ps(row_sum);
+  for (j = 0; j + kVecSize <= cols; j += kVecSize) {
+    Store(dx + j, _mm256_fnmadd_ps(Exp(Load(y + j)), row_sum_vec, Load(dy + j)));
+  }
+  for (; j < cols; ++j) { dx[j] = dy[j] - std::exp(y[j]) * row_sum; }
+}
+
+OF_EP_CPU_TARGET_AVX512 void SoftmaxRowAvx512(const float* x, float* y, size_t cols) {
+  using namespace avx512;
+  size_t j = 0;
+  __m512 max_vec = _mm512_set1_ps(-std::numeric_limits<float>::infinity());
+  for (; j + kVecSize <= cols; j += kVecSize) { max_vec = _mm512_max_ps(max_vec, Load(x + j)); }
+  float row_max = ReduceMax(max_vec);
+  for (; j < cols; ++j) { row_max = std::max(row_max, x[j]); }
+  const __m512 row_max_vec = _mm512_set1_ps(row_max);
+  __m512 sum_vec = _mm512_setzero_ps();
+  for (j = 0; j + kVecSize <= cols; j += kVecSize) {
+    const __m512 exp_x = Exp(_mm512_sub_ps(Load(x + j), row_max_vec));
+    Store(y + j, exp_x);
+    sum_vec = _mm512_add_ps(sum_vec, exp_x);
+  }
+  float row_sum = ReduceAdd(sum_vec);
+  for (; j < cols; ++j) {
+    y[j] = std::exp(x[j] - row_max);
+    row_sum += y[j];
+  }
+  const float inv_row_sum = 1.0f / row_sum;
+  const __m512 inv_row_sum_vec = _mm512_set1_ps(inv_row_sum);
+  for (j = 0; j + kVecSize <= cols; j += kVecSize) {
+    Store(y + j, _mm512_mul_ps(Load(y + j), inv_row_sum_vec));
+  }
+  for (; j < cols; ++j) { y[j] *= inv_row_sum; }
+}
+
+OF_EP_CPU_TARGET_AVX512 void LogSoftmaxRowAvx512(const float* x, float* y, size_t cols) {
+  using namespace avx512;
+  size_t j = 0;
+  __m512 max_vec = _mm512_set1_ps(std::numeric_limits<float>::lowest());
+  __m512 sum_vec = _mm512_setzero_ps();
+  for (; j + kVecSize <= cols; j += kVecSize) {
+    const __m512 x_vec = Load(x + j);
+    const __m512 new_max_vec = _mm512_max_ps(max_vec, x_vec);
+    sum_vec = _mm512_fmadd_ps(sum_vec, Exp(_mm512_sub_ps(max_vec, new_max_vec)),
+                              Exp(_mm512_sub_ps(x_vec, new_max_vec)));
+    max_vec = new_max_vec;
+  }
+  float row_max = ReduceMax(max_vec);
+  float row_sum =
+      ReduceAdd(_mm512_mul_ps(sum_vec, Exp(_mm512_sub_ps(max_vec, _mm512_set1_ps(row_max)))));
+  for (; j < cols; ++j) {
+    if (x[j] > row_max) {
+      row_sum = row_sum * std::exp(row_max - x[j]) + 1.0f;
+      row_max = x[j];
+    } else {
+      row_sum += std::exp(x[j] - row_max);
+    }
+  }
+  const float log_row_sum = std::log(row_sum);
+  const __m512 row_max_vec = _mm512_set1_ps(row_max);
+  const __m512 log_row_sum_vec = _mm512_set1_ps(log_row_sum);
+  for (j = 0; j + kVecSize <= cols; j += kVecSize) {
+    Store(y + j, _mm512_sub_ps(_mm512_sub_ps(Load(x + j), row_max_vec), log_row_sum_vec));
+  }
+  for (; j < cols; ++j) { y[j] = x[j] - row_max - log_row_sum; }
+}
+
+OF_EP_CPU_TARGET_AVX512 void SoftmaxBackwardRowAvx512(const float* y, const float* dy, float* dx,
+                                                      size_t cols) {
+  using namespace avx512;
+  size_t j = 0;
+  __m512 sum_vec = _mm512_setzero_ps();
+  for (; j + kVecSize <= cols; j += kVecSize) {
+    sum_vec = _mm512_fmadd_ps(Load(y + j), Load(dy + j), sum_vec);
+  }
+  float row_sum = ReduceAdd(sum_vec);
+  for (; j < cols; ++j) { row_sum += y[j] * dy[j]; }
+  const __m512 row_sum_vec = _mm512_set1_ps(row_sum);
+  for (j = 0; j + kVecSize <= cols; j += kVecSize) {
+    Store(dx + j, _mm512_mul_ps(_mm512_sub_ps(Load(dy + j), row_sum_vec), Load(y + j)));
+  }
+  for (; j < cols; ++j) { dx[j] = (dy[j] - row_sum) * y[j]; }
+}
+
+OF_EP_CPU_TARGET_AVX512 void LogSoftmaxBackwardRowAvx512(const float* y, const float* dy,
+                                                         float* dx, size_t cols) {
+  using namespace avx512;
+  size_t j = 0;
+  __m512 sum_vec = _mm512_setzero_ps();
+  for (; j + kVecSize <= cols; j += kVecSize) { sum_vec = _mm512_add_ps(sum_vec, Load(dy + j)); }
+  float row_sum = ReduceAdd(sum_vec);
+  for (; j < cols; ++j) { row_sum += dy[j]; }
+  const __m512 row_sum_vec = _mm512_set1_ps(row_sum);
+  for (j = 0; j + kVecSize <= cols; j += kVecSize) {
+    Store(dx + j, _mm512_fnmadd_ps(Exp(Load(y + j)), row_sum_vec, Load(dy + j)));
+  }
+  for (; j < cols; ++j) { dx[j] = dy[j] - std::exp(y[j]) * row_sum; }
+}
+
+#endif  // OF_EP_CPU_X86_SIMD
+
+}  // namespace
+
+SoftmaxRowFunc GetSoftmaxRowFunc(SoftmaxAlgorithm algorithm, CpuIsa isa) {
+  const bool log = (algorithm == SoftmaxAlgorithm::kLogSoftmax);
+#ifdef OF_EP_CPU_X86_SIMD
+  if (isa == CpuIsa::kAvx512) { return log ? LogSoftmaxRowAvx512 : SoftmaxRowAvx512; }
+  if (isa == CpuIsa::kAvx2) { return log ? LogSoftmaxRowAvx2 : SoftmaxRowAvx2; }
+#endif  // OF_EP_CPU_X86_SIMD
+  return log ? SoftmaxRowScalar<SoftmaxAlgorithm::kLogSoftmax, float>
+             : SoftmaxRowScalar<SoftmaxAlgorithm::kSoftmax, float>;
+}
+
+SoftmaxBackwardRowFunc GetSoftmaxBackwardRowFunc(SoftmaxAlgorithm algorithm, CpuIsa isa) {
+  const bool log = (algorithm == SoftmaxAlgorithm::kLogSoftmax);
+#ifdef OF_EP_CPU_X86_SIMD
+  if (isa == CpuIsa::kAvx512) {
+    return log ? LogSoftmaxBackwardRowAvx512 : SoftmaxBackwardRowAvx512;
+  }
+  if (isa == CpuIsa::kAvx2) { return log ? LogSoftmaxBackwardRowAvx2 : SoftmaxBackwardRowAvx2; }
+#endif  // OF_EP_CPU_X86_SIMD
+  return log ? SoftmaxBackwardRowScalar<SoftmaxAlgorithm::kLogSoftmax, float>
+             : SoftmaxBackwardRowScalar<SoftmaxAlgorithm::kSoftmax, float>;
+}
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
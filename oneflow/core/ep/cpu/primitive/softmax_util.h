@@ -0,0 +1,91 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_EP_CPU_PRIMITIVE_SOFTMAX_UTIL_H_
+#define ONEFLOW_CORE_EP_CPU_PRIMITIVE_SOFTMAX_UTIL_H_
+
+#include "oneflow/core/ep/cpu/primitive/vectorized_math.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+enum class SoftmaxAlgorithm {
+  kSoftmax,
+  kLogSoftmax,
+};
+
+// Computes one row of softmax or log_softmax in float, y may alias x.
+using SoftmaxRowFunc = void (*)(const float* x, float* y, size_t cols);
+
+// Computes one row of the softmax or log_softmax gradient from the forward output y, dx may alias
+// dy.
+using SoftmaxBackwardRowFunc = void (*)(const float* y, const float* dy, float* dx, size_t cols);
+
+SoftmaxRowFunc GetSoftmaxRowFunc(SoftmaxAlgorithm algorithm, CpuIsa isa);
+
+SoftmaxBackwardRowFunc GetSoftmaxBackwardRowFunc(SoftmaxAlgorithm algorithm, CpuIsa isa);
+
+// Rows per ParallelFor chunk so that a chunk covers about kParallelForDefaultGrain elements.
+inline int64_t GetSoftmaxRowGrain(size_t cols) {
+  return kParallelForDefaultGrain / std::max<int64_t>(cols, 1);
+}
+
+template<SoftmaxAlgorithm algorithm, typename T>
+void SoftmaxRowScalar(const T* x, T* y, size_t cols) {
+  T row_max = -std::numeric_limits<T>::infinity();
+  for (size_t j = 0; j < cols; ++j) { row_max = std::max(row_max, x[j]); }
+  T row_sum = 0;
+  for (size_t j = 0; j < cols; ++j) {
+    const T exp_x = std::exp(x[j] - row_max);
+    if (algorithm == SoftmaxAlgorithm::kSoftmax) { y[j] = exp_x; }
+    row_sum += exp_x;
+  }
+  if (algorithm == SoftmaxAlgorithm::kSoftmax) {
+    const T inv_row_sum = static_cast<T>(1) / row_sum;
+    for (size_t j = 0; j < cols; ++j) { y[j] *= inv_row_sum; }
+  } else {
+    const T log_row_sum = std::log(row_sum);
+    for (size_t j = 0; j < cols; ++j) { y[j] = x[j] - row_max - log_row_sum; }
+  }
+}
+
+template<SoftmaxAlgorithm algorithm, typename T>
+void SoftmaxBackwardRowScalar(const T* y, const T* dy, T* dx, size_t cols) {
+  T row_sum = 0;
+  for (size_t j = 0; j < cols; ++j) {
+    if (algorithm == SoftmaxAlgorithm::kSoftmax) {
+      row_sum += y[j] * dy[j];
+    } else {
+      row_sum += dy[j];
+    }
+  }
+  for (size_t j = 0; j < cols; ++j) {
+    if (algorithm == SoftmaxAlgorithm::kSoftmax) {
+      dx[j] = (dy[j] - row_sum) * y[j];
+    } else {
+      dx[j] = dy[j] - std::exp(y[j]) * row_sum;
+    }
+  }
+}
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_EP_CPU_PRIMITIVE_SOFTMAX_UTIL_H_
@@ -0,0 +1,131 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ep/cpu/primitive/softmax_util.h"
+#include <gtest/gtest.h>
+#include <random>
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+namespace {
+
+std::vector<CpuIsa> GetSupportedIsas() {
+  std::vector<CpuIsa> isas{CpuIsa::kScalar};
+  if (GetCpuIsa() >= CpuIsa::kAvx2) { isas.push_back(CpuIsa::kAvx2); }
+  if (GetCpuIsa() >= CpuIsa::kAvx512) { isas.push_back(CpuIsa::kAvx512); }
+  return isas;
+}
+
+std::vector<float> RandomRow(size_t cols, float scale, std::mt19937* rng) {
+  std::uniform_real_distribution<float> dist(-scale, scale);
+  std::vector<float> row(cols);
+  for (auto& v : row) { v = dist(*rng); }
+  return row;
+}
+
+template<SoftmaxAlgorithm algorithm>
+std::vector<float> ReferenceSoftmax(const std::vector<float>& x) {
+  std::vector<double> x_d(x.begin(), x.end());
+  std::vector<double> y_d(x.size());
+  SoftmaxRowScalar<algorithm, double>(x_d.data(), y_d.data(), x.size());
+  return std::vector<float>(y_d.begin(), y_d.end());
+}
+
+template<SoftmaxAlgorithm algorithm>
+void TestSoftmaxRow(CpuIsa isa) {
+  std::mt19937 rng(0);
+  const SoftmaxRowFunc row_func = GetSoftmaxRowFunc(algorithm, isa);
+  for (size_t cols : {1, 7, 16, 33, 100, 1000, 50257}) {
+    std::vector<float> x = RandomRow(cols, 20.0f, &rng);
+    if (cols > 8) { x[3] = -std::numeric_limits<float>::infinity(); }
+    const std::vector<float> expected = ReferenceSoftmax<algorithm>(x);
+    std::vector<float> y(cols);
+    row_func(x.data(), y.data(), cols);
+    for (size_t j = 0; j < cols; ++j) {
+      if (std::isinf(expected[j])) {
+        ASSERT_EQ(y[j], expected[j]) << "cols " << cols << " index " << j;
+      } else {
+        ASSERT_NEAR(y[j], expected[j], 1e-5 * std::max(1.0f, std::abs(expected[j])))
+            << "cols " << cols << " index " << j;
+      }
+    }
+    // in place
+    row_func(x.data(), x.data(), cols);
+    for (size_t j = 0; j < cols; ++j) { ASSERT_EQ(x[j], y[j]); }
+  }
+}
+
+template<SoftmaxAlgorithm algorithm>
+void TestSoftmaxBackwardRow(CpuIsa isa) {
+  std::mt19937 rng(1);
+  const SoftmaxBackwardRowFunc row_func = GetSoftmaxBackwardRowFunc(algorithm, isa);
+  for (size_t cols : {1, 7, 16, 33, 1000}) {
+    const std::vector<float> y = ReferenceSoftmax<algorithm>(RandomRow(cols, 5.0f, &rng));
+    const std::vector<float> dy = RandomRow(cols, 1.0f, &rng);
+    std::vector<double> y_d(y.begin(), y.end());
+    std::vector<double> dy_d(dy.begin(), dy.end());
+    std::vector<double> expected(cols);
+    SoftmaxBackwardRowScalar<algorithm, double>(y_d.data(), dy_d.data(), expected.data(), cols);
+    std::vector<float> dx(cols);
+    row_func(y.data(), dy.data(), dx.data(), cols);
+    for (size_t j = 0; j < cols; ++j) {
+      ASSERT_NEAR(dx[j], expected[j], 1e-4) << "cols " << cols << " index " << j;
+    }
+  }
+}
+
+TEST(Softmax, RowFunc) {
+  for (CpuIsa isa : GetSupportedIsas()) {
+    TestSoftmaxRow<SoftmaxAlgorithm::kSoftmax>(isa);
+    TestSoftmaxRow<SoftmaxAlgorithm::kLogSoftmax>(isa);
+  }
+}
+
+TEST(Softmax, BackwardRowFunc) {
+  for (CpuIsa isa : GetSupportedIsas()) {
+    TestSoftmaxBackwardRow<SoftmaxAlgorithm::kSoftmax>(isa);
+    TestSoftmaxBackwardRow<SoftmaxAlgorithm::kLogSoftmax>(isa);
+  }
+}
+
+TEST(Softmax, ReducedPrecisionConvert) {
+  std::mt19937 rng(2);
+  const std::vector<float> x = RandomRow(37, 100.0f, &rng);
+  for (CpuIsa isa : GetSupportedIsas()) {
+    std::vector<float16> h(x.size());
+    std::vector<bfloat16> b(x.size());
+    std::vector<float> h_back(x.size());
+    std::vector<float> b_back(x.size());
+    ConvertFromFloat(isa, x.data(), h.data(), x.size());
+    ConvertFromFloat(isa, x.data(), b.data(), x.size());
+    ConvertToFloat(isa, h.data(), h_back.data(), x.size());
+    ConvertToFloat(isa, b.data(), b_back.data(), x.size());
+    for (size_t i = 0; i < x.size(); ++i) {
+      ASSERT_NEAR(h_back[i], x[i], std::abs(x[i]) / 1024);
+      ASSERT_EQ(b_back[i], BFloat16ToFloat(FloatToBFloat16(x[i])));
+      ASSERT_NEAR(b_back[i], x[i], std::abs(x[i]) / 128);
+    }
+  }
+}
+
+}  // namespace
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
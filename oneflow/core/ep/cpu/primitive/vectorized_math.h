@@ -0,0 +1,338 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_EP_CPU_PRIMITIVE_VECTORIZED_MATH_H_
+#define ONEFLOW_CORE_EP_CPU_PRIMITIVE_VECTORIZED_MATH_H_
+
+#include <cstring>
+#include "oneflow/core/common/data_type.h"
+#include "oneflow/core/ep/cpu/cpu_isa.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define OF_EP_CPU_X86_SIMD
+#include <immintrin.h>
+// Functions using these are only called after GetCpuIsa() confirms the instructions are available,
+// so the library can be built for the baseline x86-64 target.
+#define OF_EP_CPU_TARGET_AVX2 __attribute__((target("avx2,fma,f16c")))
+#define OF_EP_CPU_TARGET_AVX512 __attribute__((target("avx512f,avx2,fma,f16c")))
+#endif
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+// bfloat16 has no host arithmetic type, the CPU primitives keep it as raw bits and compute in
+// float.
+struct bfloat16 {
+  uint16_t bits;
+};
+
+inline float BFloat16ToFloat(bfloat16 x) {
+  const uint32_t bits = static_cast<uint32_t>(x.bits) << 16;
+  float y;
+  std::memcpy(&y, &bits, sizeof(y));
+  return y;
+}
+
+inline bfloat16 FloatToBFloat16(float x) {
+  uint32_t bits;
+  std::memcpy(&bits, &x, sizeof(bits));
+  if (x != x) { return bfloat16{0x7FC0}; }
+  // round to nearest even
+  bits += 0x7FFF + ((bits >> 16) & 1);
+  return bfloat16{static_cast<uint16_t>(bits >> 16)};
+}
+
+template<typename T>
+inline float ToFloat(T x) {
+  return static_cast<float>(x);
+}
+
+template<>
+inline float ToFloat<bfloat16>(bfloat16 x) {
+  return BFloat16ToFloat(x);
+}
+
+template<typename T>
+inline T FromFloat(float x) {
+  return static_cast<T>(x);
+}
+
+template<>
+inline bfloat16 FromFloat<bfloat16>(float x) {
+  return FloatToBFloat16(x);
+}
+
+#ifdef OF_EP_CPU_X86_SIMD
+
+namespace avx2 {
+
+constexpr size_t kVecSize = 8;
+
+// Cephes-style expf: exp(x) = 2^n * exp(r), |r| <= ln(2)/2, with a degree 5 polynomial for
+// exp(r). Max relative error is about 2 ulp, results below the float range flush to zero and NaN
+// propagates.
+OF_EP_CPU_TARGET_AVX2 inline __m256 Exp(__m256 x) {
+  const __m256 underflow = _mm256_cmp_ps(x, _mm256_set1_ps(-87.3365447505531f), _CMP_LT_OQ);
+  x = _mm256_min_ps(_mm256_set1_ps(88.3762626647949f), x);
+  x = _mm256_max_ps(_mm256_set1_ps(-87.3365447505531f), x);
+  __m256 n = _mm256_mul_ps(x, _mm256_set1_ps(1.44269504088896341f));
+  n = _mm256_round_ps(n, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  __m256 r = _mm256_fnmadd_ps(n, _mm256_set1_ps(0.693359375f), x);
+  r = _mm256_fnmadd_ps(n, _mm256_set1_ps(-2.12194440e-4f), r);
+  __m256 p = _mm256_set1_ps(1.9875691500E-4f);
+  p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.3981999507E-3f));
+  p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(8.3334519073E-3f));
+  p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(4.1665795894E-2f));
+  p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.6666665459E-1f));
+  p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(5.0000001201E-1f));
+  p = _mm256_fmadd_ps(p, _mm256_mul_ps(r, r), r);
+  p = _mm256_add_ps(p, _mm256_set1_ps(1.0f));
+  const __m256i e = _mm256_slli_epi32(
+      _mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(0x7F)), 23);
+  return _mm256_andnot_ps(underflow, _mm256_mul_ps(p, _mm256_castsi256_ps(e)));
+}
+
+// Cephes-style tanhf: an odd polynomial for |x| < 0.625, 1 - 2 / (exp(2|x|) + 1) with the sign
+// of x restored above it. Saturates to +-1 and propagates NaN.
+OF_EP_CPU_TARGET_AVX2 inline __m256 Tanh(__m256 x) {
+  const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+  const __m256 abs_x = _mm256_andnot_ps(sign_mask, x);
+  const __m256 x2 = _mm256_mul_ps(x, x);
+  __m256 p = _mm256_set1_ps(-5.70498872745E-3f);
+  p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(2.06390887954E-2f));
+  p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(-5.37397155531E-2f));
+  p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(1.33314422036E-1f));
+  p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(-3.33332819422E-1f));
+  const __m256 small = _mm256_fmadd_ps(_mm256_mul_ps(p, x2), x, x);
+  const __m256 e = Exp(_mm256_add_ps(abs_x, abs_x));
+  __m256 large = _mm256_sub_ps(_mm256_set1_ps(1.0f),
+                               _mm256_div_ps(_mm256_set1_ps(2.0f),
+                                             _mm256_add_ps(e, _mm256_set1_ps(1.0f))));
+  large = _mm256_or_ps(large, _mm256_and_ps(sign_mask, x));
+  return _mm256_blendv_ps(small, large, _mm256_cmp_ps(abs_x, _mm256_set1_ps(0.625f), _CMP_GE_OQ));
+}
+
+// gelu(x) = x * Phi(x) = 0.5 * x * erfc(-x / sqrt(2)). erfc is the Chebyshev fit from Numerical
+// Recipes (erfcc, relative error below 1.2e-7), which stays accurate in the negative tail where
+// 1 + erf(x / sqrt(2)) would cancel.
+OF_EP_CPU_TARGET_AVX2 inline __m256 Gelu(__m256 x) {
+  const __m256 z = _mm256_mul_ps(x, _mm256_set1_ps(-0.70710678118654752f));
+  const __m256 a = _mm256_andnot_ps(_mm256_set1_ps(-0.0f), z);
+  const __m256 t = _mm256_div_ps(_mm256_set1_ps(1.0f),
+                                 _mm256_fmadd_ps(a, _mm256_set1_ps(0.5f), _mm256_set1_ps(1.0f)));
+  __m256 p = _mm256_set1_ps(0.17087277f);
+  p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(-0.82215223f));
+  p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(1.48851587f));
+  p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(-1.13520398f));
+  p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(0.27886807f));
+  p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(-0.18628806f));
+  p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(0.09678418f));
+  p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(0.37409196f));
+  p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(1.00002368f));
+  p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(-1.26551223f));
+  const __m256 erfc = _mm256_mul_ps(t, Exp(_mm256_fnmadd_ps(a, a, p)));
+  const __m256 negative_z = _mm256_cmp_ps(z, _mm256_setzero_ps(), _CMP_LT_OQ);
+  const __m256 two_phi =
+      _mm256_blendv_ps(erfc, _mm256_sub_ps(_mm256_set1_ps(2.0f), erfc), negative_z);
+  return _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), x), two_phi);
+}
+
+OF_EP_CPU_TARGET_AVX2 inline float ReduceAdd(__m256 x) {
+  __m128 v = _mm_add_ps(_mm256_castps256_ps128(x), _mm256_extractf128_ps(x, 1));
+  v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+  v = _mm_add_ss(v, _mm_movehdup_ps(v));
+  return _mm_cvtss_f32(v);
+}
+
+OF_EP_CPU_TARGET_AVX2 inline float ReduceMax(__m256 x) {
+  __m128 v = _mm_max_ps(_mm256_castps256_ps128(x), _mm256_extractf128_ps(x, 1));
+  v = _mm_max_ps(v, _mm_movehl_ps(v, v));
+  v = _mm_max_ss(v, _mm_movehdup_ps(v));
+  return _mm_cvtss_f32(v);
+}
+
+OF_EP_CPU_TARGET_AVX2 inline __m256 Load(const float* ptr) { return _mm256_loadu_ps(ptr); }
+
+OF_EP_CPU_TARGET_AVX2 inline __m256 Load(const float16* ptr) {
+  return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr)));
+}
+
+OF_EP_CPU_TARGET_AVX2 inline __m256 Load(const bfloat16* ptr) {
+  const __m256i x = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr)));
+  return _mm256_castsi256_ps(_mm256_slli_epi32(x, 16));
+}
+
+OF_EP_CPU_TARGET_AVX2 inline void Store(float* ptr, __m256 x) { _mm256_storeu_ps(ptr, x); }
+
+OF_EP_CPU_TARGET_AVX2 inline void Store(float16* ptr, __m256 x) {
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(ptr), _mm256_cvtps_ph(x, _MM_FROUND_TO_NEAREST_INT));
+}
+
+OF_EP_CPU_TARGET_AVX2 inline void Store(bfloat16* ptr, __m256 x) {
+  const __m256i bits = _mm256_castps_si256(x);
+  const __m256i lsb = _mm256_and_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(1));
+  __m256i y = _mm256_add_epi32(_mm256_add_epi32(bits, _mm256_set1_epi32(0x7FFF)), lsb);
+  y = _mm256_srli_epi32(y, 16);
+  const __m256i nan = _mm256_castps_si256(_mm256_cmp_ps(x, x, _CMP_UNORD_Q));
+  y = _mm256_blendv_epi8(y, _mm256_set1_epi32(0x7FC0), nan);
+  const __m128i packed =
+      _mm_packus_epi32(_mm256_castsi256_si128(y), _mm256_extracti128_si256(y, 1));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(ptr), packed);
+}
+
+// Converts the leading multiple of kVecSize elements and returns how many were converted.
+template<typename T>
+OF_EP_CPU_TARGET_AVX2 size_t ConvertToFloat(const T* src, float* dst, size_t n) {
+  size_t i = 0;
+  for (; i + kVecSize <= n; i += kVecSize) { Store(dst + i, Load(src + i)); }
+  return i;
+}
+
+template<typename T>
+OF_EP_CPU_TARGET_AVX2 size_t ConvertFromFloat(const float* src, T* dst, size_t n) {
+  size_t i = 0;
+  for (; i + kVecSize <= n; i += kVecSize) { Store(dst + i, Load(src + i)); }
+  return i;
+}
+
+}  // namespace avx2
+
+namespace avx512 {
+
+constexpr size_t kVecSize = 16;
+
+// Same reduction as avx2::Exp, the 2^n scaling is done with scalef which handles the range
+// limits itself.
+OF_EP_CPU_TARGET_AVX512 inline __m512 Exp(__m512 x) {
+  const __mmask16 underflow = _mm512_cmp_ps_mask(x, _mm512_set1_ps(-87.3365447505531f), _CMP_LT_OQ);
+  x = _mm512_min_ps(_mm512_set1_ps(88.7228391116729996f), x);
+  __m512 n = _mm512_mul_ps(x, _mm512_set1_ps(1.44269504088896341f));
+  n = _mm512_roundscale_ps(n, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  __m512 r = _mm512_fnmadd_ps(n, _mm512_set1_ps(0.693359375f), x);
+  r = _mm512_fnmadd_ps(n, _mm512_set1_ps(-2.12194440e-4f), r);
+  __m512 p = _mm512_set1_ps(1.9875691500E-4f);
+  p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(1.3981999507E-3f));
+  p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(8.3334519073E-3f));
+  p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(4.1665795894E-2f));
+  p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(1.6666665459E-1f));
+  p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(5.0000001201E-1f));
+  p = _mm512_fmadd_ps(p, _mm512_mul_ps(r, r), r);
+  p = _mm512_add_ps(p, _mm512_set1_ps(1.0f));
+  return _mm512_maskz_mov_ps(static_cast<__mmask16>(~underflow), _mm512_scalef_ps(p, n));
+}
+
+// Same as avx2::Tanh.
+OF_EP_CPU_TARGET_AVX512 inline __m512 Tanh(__m512 x) {
+  const __m512 abs_x = _mm512_abs_ps(x);
+  const __m512 x2 = _mm512_mul_ps(x, x);
+  __m512 p = _mm512_set1_ps(-5.70498872745E-3f);
+  p = _mm512_fmadd_ps(p, x2, _mm512_set1_ps(2.06390887954E-2f));
+  p = _mm512_fmadd_ps(p, x2, _mm512_set1_ps(-5.37397155531E-2f));
+  p = _mm512_fmadd_ps(p, x2, _mm512_set1_ps(1.33314422036E-1f));
+  p = _mm512_fmadd_ps(p, x2, _mm512_set1_ps(-3.33332819422E-1f));
+  const __m512 small = _mm512_fmadd_ps(_mm512_mul_ps(p, x2), x, x);
+  const __m512 e = Exp(_mm512_add_ps(abs_x, abs_x));
+  const __m512 large = _mm512_sub_ps(
+      _mm512_set1_ps(1.0f),
+      _mm512_div_ps(_mm512_set1_ps(2.0f), _mm512_add_ps(e, _mm512_set1_ps(1.0f))));
+  const __mmask16 is_large = _mm512_cmp_ps_mask(abs_x, _mm512_set1_ps(0.625f), _CMP_GE_OQ);
+  const __m512i sign = _mm512_and_si512(_mm512_castps_si512(x), _mm512_set1_epi32(0x80000000));
+  return _mm512_mask_mov_ps(
+      small, is_large, _mm512_castsi512_ps(_mm512_or_si512(_mm512_castps_si512(large), sign)));
+}
+
+// Same as avx2::Gelu.
+OF_EP_CPU_TARGET_AVX512 inline __m512 Gelu(__m512 x) {
+  const __m512 z = _mm512_mul_ps(x, _mm512_set1_ps(-0.70710678118654752f));
+  const __m512 a = _mm512_abs_ps(z);
+  const __m512 t = _mm512_div_ps(_mm512_set1_ps(1.0f),
+                                 _mm512_fmadd_ps(a, _mm512_set1_ps(0.5f), _mm512_set1_ps(1.0f)));
+  __m512 p = _mm512_set1_ps(0.17087277f);
+  p = _mm512_fmadd_ps(p, t, _mm512_set1_ps(-0.82215223f));
+  p = _mm512_fmadd_ps(p, t, _mm512_set1_ps(1.48851587f));
+  p = _mm512_fmadd_ps(p, t, _mm512_set1_ps(-1.13520398f));
+  p = _mm512_fmadd_ps(p, t, _mm512_set1_ps(0.27886807f));
+  p = _mm512_fmadd_ps(p, t, _mm512_set1_ps(-0.18628806f));
+  p = _mm512_fmadd_ps(p, t, _mm512_set1_ps(0.09678418f));
+  p = _mm512_fmadd_ps(p, t, _mm512_set1_ps(0.37409196f));
+  p = _mm512_fmadd_ps(p, t, _mm512_set1_ps(1.00002368f));
+  p = _mm512_fmadd_ps(p, t, _mm512_set1_ps(-1.26551223f));
+  const __m512 erfc = _mm512_mul_ps(t, Exp(_mm512_fnmadd_ps(a, a, p)));
+  const __mmask16 negative_z = _mm512_cmp_ps_mask(z, _mm512_setzero_ps(), _CMP_LT_OQ);
+  const __m512 two_phi = _mm512_mask_sub_ps(erfc, negative_z, _mm512_set1_ps(2.0f), erfc);
+  return _mm512_mul_ps(_mm512_mul_ps(_mm512_set1_ps(0.5f), x), two_phi);
+}
+
+OF_EP_CPU_TARGET_AVX512 inline float ReduceAdd(__m512 x) { return _mm512_reduce_add_ps(x); }
+
+OF_EP_CPU_TARGET_AVX512 inline float ReduceMax(__m512 x) { return _mm512_reduce_max_ps(x); }
+
+OF_EP_CPU_TARGET_AVX512 inline __m512 Load(const float* ptr) { return _mm512_loadu_ps(ptr); }
+
+OF_EP_CPU_TARGET_AVX512 inline __m512 Load(const float16* ptr) {
+  return _mm512_cvtph_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr)));
+}
+
+OF_EP_CPU_TARGET_AVX512 inline __m512 Load(const bfloat16* ptr) {
+  const __m512i x =
+      _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr)));
+  return _mm512_castsi512_ps(_mm512_slli_epi32(x, 16));
+}
+
+OF_EP_CPU_TARGET_AVX512 inline void Store(float* ptr, __m512 x) { _mm512_storeu_ps(ptr, x); }
+
+OF_EP_CPU_TARGET_AVX512 inline void Store(float16* ptr, __m512 x) {
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(ptr),
+                      _mm512_cvtps_ph(x, _MM_FROUND_TO_NEAREST_INT));
+}
+
+OF_EP_CPU_TARGET_AVX512 inline void Store(bfloat16* ptr, __m512 x) {
+  avx2::Store(ptr, _mm512_castps512_ps256(x));
+  avx2::Store(ptr + avx2::kVecSize,
+              _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(x), 1)));
+}
+
+}  // namespace avx512
+
+#endif  // OF_EP_CPU_X86_SIMD
+
+// Widens n elements of src into dst, which may not alias.
+template<typename T>
+void ConvertToFloat(CpuIsa isa, const T* src, float* dst, size_t n) {
+  size_t i = 0;
+#ifdef OF_EP_CPU_X86_SIMD
+  if (isa >= CpuIsa::kAvx2) { i = avx2::ConvertToFloat(src, dst, n); }
+#endif  // OF_EP_CPU_X86_SIMD
+  for (; i < n; ++i) { dst[i] = ToFloat(src[i]); }
+}
+
+// Narrows n floats of src into dst with round-to-nearest-even.
+template<typename T>
+void ConvertFromFloat(CpuIsa isa, const float* src, T* dst, size_t n) {
+  size_t i = 0;
+#ifdef OF_EP_CPU_X86_SIMD
+  if (isa >= CpuIsa::kAvx2) { i = avx2::ConvertFromFloat(src, dst, n); }
+#endif  // OF_EP_CPU_X86_SIMD
+  for (; i < n; ++i) { dst[i] = FromFloat<T>(src[i]); }
+}
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_EP_CPU_PRIMITIVE_VECTORIZED_MATH_H_
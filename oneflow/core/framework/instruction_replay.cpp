@@ -16,6 +16,11 @@ limitations under the License.
 
 #include <list>
 #include "oneflow/core/framework/instruction_replay.h"
+#include "oneflow/core/framework/shut_down_util.h"
+#include "oneflow/core/eager/eager_blob_object.h"
+#include "oneflow/core/eager/local_call_opkernel_phy_instr_operand.h"
+#include "oneflow/core/vm/consume_local_dep_object_phy_instr_operand.h"
+#include "oneflow/core/vm/release_tensor_arg_phy_instr_operand.h"
 #include "oneflow/core/vm/vm_util.h"
 #include "oneflow/core/vm/instruction.h"
 
@@ -33,6 +38,17 @@ std::list<intrusive::shared_ptr<vm::InstructionMsg>>* RecordedInstructionList()
   return &list;
 }
 
+InstructionCapture** CurrentInstructionCapture() {
+  static thread_local InstructionCapture* capture = nullptr;
+  return &capture;
+}
+
+Maybe<void> RunClones(const std::vector<intrusive::shared_ptr<vm::InstructionMsg>>& instructions) {
+  vm::InstructionMsgList instr_msg_list;
+  for (const auto& instr_msg : instructions) { instr_msg_list.EmplaceBack(instr_msg->Clone()); }
+  return vm::Run(&instr_msg_list);
+}
+
 }  // namespace
 
 namespace debug {
@@ -59,4 +75,101 @@ void ReplayInstructions() {
 
 }  // namespace debug
 
+InstructionCapture::~InstructionCapture() {
+  if (capturing_) { *CurrentInstructionCapture() = nullptr; }
+  if (!IsShuttingDown()) { ReleaseIntermediates(); }
+}
+
+InstructionCapture* InstructionCapture::Current() { return *CurrentInstructionCapture(); }
+
+void InstructionCapture::Record(const intrusive::shared_ptr<vm::InstructionMsg>& instruction) {
+  instructions_.emplace_back(instruction);
+}
+
+Maybe<void> InstructionCapture::BeginCapture() {
+  CHECK_OR_RETURN(Current() == nullptr) << "another capture is running on this thread";
+  ReleaseIntermediates();
+  Reset();
+  capturing_ = true;
+  *CurrentInstructionCapture() = this;
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> InstructionCapture::EndCapture() {
+  CHECK_OR_RETURN(capturing_) << "the capture has not begun";
+  capturing_ = false;
+  *CurrentInstructionCapture() = nullptr;
+  std::vector<intrusive::shared_ptr<vm::InstructionMsg>> instructions;
+  instructions.swap(instructions_);
+  HashSet<const vm::EagerBlobObject*> produced;
+  HashSet<const vm::EagerBlobObject*> inputs;
+  for (const auto& instr_msg : instructions) {
+    const auto& operand = instr_msg->phy_instr_operand();
+    const auto* call = dynamic_cast<const vm::LocalCallOpKernelPhyInstrOperand*>(operand.get());
+    const auto* release = dynamic_cast<const vm::ReleaseTensorArgPhyInstrOperand*>(operand.get());
+    if (call != nullptr) {
+      if (call->consistent_tensor_infer_result()) {
+        Reset();
+        return Error::UnimplementedError() << "consistent tensors can not be captured";
+      }
+      for (const auto& input : *call->inputs()) {
+        if (produced.count(input.get()) > 0 || !inputs.emplace(input.get()).second) { continue; }
+        inputs_.emplace_back(
+            CapturedInput{input, input->blob_desc().shape(), input->blob_desc().data_type()});
+      }
+      for (const auto& output : *call->outputs()) { produced.emplace(output.get()); }
+      instructions_.emplace_back(instr_msg);
+    } else if (release != nullptr) {
+      if (inputs.count(release->eager_blob_object().get()) > 0) {
+        Reset();
+        return Error::RuntimeError()
+               << "an input of the captured step has been dropped during the capture";
+      }
+      deferred_release_instructions_.emplace_back(instr_msg);
+    } else if (dynamic_cast<const vm::ConsumeLocalDepObjectPhyInstrOperand*>(operand.get())) {
+      // stream synchronization, replayed as is
+      instructions_.emplace_back(instr_msg);
+    } else {
+      Reset();
+      return Error::UnimplementedError()
+             << "instruction " << instr_msg->instr_type_name() << " can not be captured";
+    }
+  }
+  valid_ = true;
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> InstructionCapture::Replay() {
+  CHECK_OR_RETURN(valid_) << "there is no valid capture to replay";
+  for (const auto& input : inputs_) {
+    const auto& blob_desc = input.eager_blob_object->blob_desc();
+    if (blob_desc.shape() != input.shape || blob_desc.data_type() != input.data_type) {
+      ReleaseIntermediates();
+      Reset();
+      return Error::RuntimeError() << "the shape of a captured input changed from "
+                                   << input.shape.ToString() << " to "
+                                   << blob_desc.shape().ToString()
+                                   << ", the capture is invalidated";
+    }
+  }
+  JUST(RunClones(instructions_));
+  replayed_ = true;
+  return Maybe<void>::Ok();
+}
+
+void InstructionCapture::ReleaseIntermediates() {
+  // the step itself released them, they only got memory again by replays
+  if (!replayed_) { return; }
+  CHECK_JUST(RunClones(deferred_release_instructions_));
+  replayed_ = false;
+}
+
+void InstructionCapture::Reset() {
+  valid_ = false;
+  replayed_ = false;
+  instructions_.clear();
+  deferred_release_instructions_.clear();
+  inputs_.clear();
+}
+
 }  // namespace oneflow
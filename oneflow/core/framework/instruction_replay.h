@@ -17,10 +17,18 @@ limitations under the License.
 #ifndef ONEFLOW_CORE_FRAMEWORK_INSTRUCTION_REPLAY_H_
 #define ONEFLOW_CORE_FRAMEWORK_INSTRUCTION_REPLAY_H_
 
+#include "oneflow/core/common/maybe.h"
+#include "oneflow/core/common/shape.h"
 #include "oneflow/core/vm/instruction.h"
 
 namespace oneflow {
 
+namespace vm {
+
+class EagerBlobObject;
+
+}  // namespace vm
+
 namespace debug {
 
 bool RecordingInstructions();
@@ -37,6 +45,48 @@ void ReplayInstructions();
 
 }  // namespace debug
 
+// Captures the instructions the calling thread sends to the vm during one step, and launches
+// them again without going through op dispatch, inference and instruction building.
+//
+// A replay reads and writes the very tensors of the captured step, so callers copy the next inputs
+// into the captured input tensors and read the results from the captured output tensors. Tensors
+// created and dropped inside the step keep their memory while the capture lives, so replays do not
+// allocate. A replay fails and invalidates the capture once an input changed its shape.
+class InstructionCapture final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(InstructionCapture);
+  InstructionCapture() : capturing_(false), valid_(false), replayed_(false) {}
+  ~InstructionCapture();
+
+  Maybe<void> BeginCapture();
+  Maybe<void> EndCapture();
+  Maybe<void> Replay();
+  bool valid() const { return valid_; }
+  size_t instruction_num() const { return instructions_.size(); }
+
+  // the capture the calling thread is recording into, nullptr if none
+  static InstructionCapture* Current();
+  void Record(const intrusive::shared_ptr<vm::InstructionMsg>& instruction);
+
+ private:
+  struct CapturedInput {
+    std::shared_ptr<vm::EagerBlobObject> eager_blob_object;
+    Shape shape;
+    DataType data_type;
+  };
+
+  void ReleaseIntermediates();
+  void Reset();
+
+  bool capturing_;
+  bool valid_;
+  bool replayed_;
+  std::vector<intrusive::shared_ptr<vm::InstructionMsg>> instructions_;
+  // releases of the tensors dropped inside the step, only launched when the capture goes away
+  std::vector<intrusive::shared_ptr<vm::InstructionMsg>> deferred_release_instructions_;
+  std::vector<CapturedInput> inputs_;
+};
+
 }  // namespace oneflow
 
 #endif  // ONEFLOW_CORE_FRAMEWORK_INSTRUCTION_REPLAY_H_
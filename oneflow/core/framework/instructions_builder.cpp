@@ -1864,6 +1864,11 @@ Maybe<void> PhysicalRun(const std::function<Maybe<void>(InstructionsBuilder*)>&
       debug::RecordInstruction(instruction_msg);
     }
   }
+  if (auto* capture = InstructionCapture::Current()) {
+    INTRUSIVE_FOR_EACH(instruction_msg, instructions_builder.mut_instruction_list()) {
+      capture->Record(instruction_msg);
+    }
+  }
   JUST(Global<vm::EagerOneflow>::Get()->RunPhysicalInstruction(
       instructions_builder.mut_instruction_list(), instructions_builder.eager_symbol_list()));
   return Maybe<void>::Ok();
@@ -0,0 +1,135 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/mirrored_tensor_infer_cache.h"
+#include "oneflow/core/framework/op_expr.h"
+
+namespace oneflow {
+namespace one {
+
+namespace {
+
+const Stride& GetStride(const MirroredTensorMeta& tensor_meta) {
+  static const Stride empty_stride;
+  return tensor_meta.stride_ptr() ? tensor_meta.stride() : empty_stride;
+}
+
+Maybe<void> InferByUserOpExpr(
+    const UserOpExpr& user_op_expr, const AttrMap& attrs, Symbol<Device> op_device,
+    const std::function<const MirroredTensorMeta*(int32_t)>& TensorMeta4InputIndex,
+    const std::function<TensorMeta*(int32_t)>& TensorMeta4OutputIndex) {
+  const std::string& device_tag = JUST(op_device->of_type());
+  return user_op_expr.InferPhysicalShapeAndDType(attrs, device_tag, TensorMeta4InputIndex,
+                                                 TensorMeta4OutputIndex);
+}
+
+}  // namespace
+
+/* static */ size_t MirroredTensorInferCache::DefaultCapacity() {
+  static const size_t capacity =
+      std::max<int64_t>(ParseIntegerFromEnv("ONEFLOW_EAGER_INFER_CACHE_SIZE", 64), 0);
+  return capacity;
+}
+
+bool MirroredTensorInferCache::Match(
+    const Entry& entry, const AttrMap& attrs, Symbol<Device> op_device, int32_t input_size,
+    const std::function<const MirroredTensorMeta*(int32_t)>& TensorMeta4InputIndex) const {
+  if (entry.op_device != op_device) { return false; }
+  if (entry.input_metas.size() != input_size) { return false; }
+  for (int32_t i = 0; i < input_size; ++i) {
+    const InputMeta& cached = entry.input_metas.at(i);
+    const MirroredTensorMeta* tensor_meta = TensorMeta4InputIndex(i);
+    if (cached.dtype != tensor_meta->dtype() || cached.is_dynamic != tensor_meta->is_dynamic()
+        || cached.shape != tensor_meta->shape() || cached.stride != GetStride(*tensor_meta)) {
+      return false;
+    }
+  }
+  return entry.attrs == attrs;
+}
+
+Maybe<void> MirroredTensorInferCache::GetOrInfer(
+    const UserOpExpr& user_op_expr, const AttrMap& attrs, Symbol<Device> op_device,
+    const std::function<const MirroredTensorMeta*(int32_t)>& TensorMeta4InputIndex,
+    const std::function<TensorMeta*(int32_t)>& TensorMeta4OutputIndex) {
+  // captures a single reference so that the std::function holding it does not allocate
+  return GetOrInfer(attrs, op_device, user_op_expr.input_size(), user_op_expr.output_size(),
+                    TensorMeta4InputIndex, TensorMeta4OutputIndex,
+                    [&user_op_expr](const AttrMap& infer_attrs, Symbol<Device> infer_device,
+                                    const std::function<const MirroredTensorMeta*(int32_t)>& In,
+                                    const std::function<TensorMeta*(int32_t)>& Out) {
+                      return InferByUserOpExpr(user_op_expr, infer_attrs, infer_device, In, Out);
+                    });
+}
+
+Maybe<void> MirroredTensorInferCache::GetOrInfer(
+    const AttrMap& attrs, Symbol<Device> op_device, int32_t input_size, int32_t output_size,
+    const std::function<const MirroredTensorMeta*(int32_t)>& TensorMeta4InputIndex,
+    const std::function<TensorMeta*(int32_t)>& TensorMeta4OutputIndex, const InferFn& Infer) {
+  if (capacity_ == 0) {
+    return Infer(attrs, op_device, TensorMeta4InputIndex, TensorMeta4OutputIndex);
+  }
+  size_t hash_value = Hash(attrs, op_device);
+  for (int32_t i = 0; i < input_size; ++i) {
+    const MirroredTensorMeta* tensor_meta = TensorMeta4InputIndex(i);
+    AddHash(&hash_value, tensor_meta->shape(), GetStride(*tensor_meta), tensor_meta->dtype(),
+            tensor_meta->is_dynamic());
+  }
+  auto hash_iter = hash2entry_.find(hash_value);
+  if (hash_iter != hash2entry_.end()) {
+    const auto& entry_iter = hash_iter->second;
+    if (Match(*entry_iter, attrs, op_device, input_size, TensorMeta4InputIndex)) {
+      entries_.splice(entries_.begin(), entries_, entry_iter);
+      for (int32_t i = 0; i < output_size; ++i) {
+        const OutputMeta& cached = entry_iter->output_metas.at(i);
+        TensorMeta* tensor_meta = TensorMeta4OutputIndex(i);
+        // copy into the shape the meta owns, it may be reused by a later inference
+        *tensor_meta->mut_shape() = cached.shape;
+        *tensor_meta->mut_data_type() = cached.dtype;
+        tensor_meta->set_is_dynamic(cached.is_dynamic);
+      }
+      return Maybe<void>::Ok();
+    }
+    // hash collision, the newer entry replaces the older one
+    entries_.erase(entry_iter);
+    hash2entry_.erase(hash_iter);
+  }
+  JUST(Infer(attrs, op_device, TensorMeta4InputIndex, TensorMeta4OutputIndex));
+  Entry entry;
+  entry.hash_value = hash_value;
+  entry.attrs = attrs;
+  entry.op_device = op_device;
+  entry.input_metas.reserve(input_size);
+  for (int32_t i = 0; i < input_size; ++i) {
+    const MirroredTensorMeta* tensor_meta = TensorMeta4InputIndex(i);
+    entry.input_metas.emplace_back(InputMeta{tensor_meta->shape(), GetStride(*tensor_meta),
+                                             tensor_meta->dtype(), tensor_meta->is_dynamic()});
+  }
+  entry.output_metas.reserve(output_size);
+  for (int32_t i = 0; i < output_size; ++i) {
+    const TensorMeta* tensor_meta = TensorMeta4OutputIndex(i);
+    entry.output_metas.emplace_back(
+        OutputMeta{tensor_meta->shape(), tensor_meta->dtype(), tensor_meta->is_dynamic()});
+  }
+  entries_.push_front(std::move(entry));
+  hash2entry_.emplace(hash_value, entries_.begin());
+  if (entries_.size() > capacity_) {
+    hash2entry_.erase(entries_.back().hash_value);
+    entries_.pop_back();
+  }
+  return Maybe<void>::Ok();
+}
+
+}  // namespace one
+}  // namespace oneflow
@@ -0,0 +1,103 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_FRAMEWORK_MIRRORED_TENSOR_INFER_CACHE_H_
+#define ONEFLOW_CORE_FRAMEWORK_MIRRORED_TENSOR_INFER_CACHE_H_
+
+#include <list>
+#include "oneflow/core/common/symbol.h"
+#include "oneflow/core/common/maybe.h"
+#include "oneflow/core/framework/attr_map.h"
+#include "oneflow/core/framework/device.h"
+#include "oneflow/core/framework/stride.h"
+#include "oneflow/core/framework/tensor_meta.h"
+
+namespace oneflow {
+namespace one {
+
+class UserOpExpr;
+
+// Memoizes the physical shape/dtype inference of one UserOpExpr for eager mirrored calls. Entries
+// are keyed on the attrs, the op device and the shape, stride, dtype and is_dynamic of every
+// input, and the least recently used entry is evicted once capacity is reached. Like
+// ConsistentTensorInferCache it is owned by the op expr and not thread safe.
+class MirroredTensorInferCache final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(MirroredTensorInferCache);
+  explicit MirroredTensorInferCache(size_t capacity) : capacity_(capacity) {}
+  ~MirroredTensorInferCache() = default;
+
+  using InferFn = std::function<Maybe<void>(
+      const AttrMap& attrs, Symbol<Device> op_device,
+      const std::function<const MirroredTensorMeta*(int32_t)>& TensorMeta4InputIndex,
+      const std::function<TensorMeta*(int32_t)>& TensorMeta4OutputIndex)>;
+
+  // Writes the inferred metas of every output to TensorMeta4OutputIndex(i), from the cache when
+  // possible and by running the op's inference functions otherwise.
+  Maybe<void> GetOrInfer(
+      const UserOpExpr& user_op_expr, const AttrMap& attrs, Symbol<Device> op_device,
+      const std::function<const MirroredTensorMeta*(int32_t)>& TensorMeta4InputIndex,
+      const std::function<TensorMeta*(int32_t)>& TensorMeta4OutputIndex);
+
+  // Same as above for an op with input_size inputs and output_size outputs whose inference is
+  // Infer, which only runs on a miss.
+  Maybe<void> GetOrInfer(
+      const AttrMap& attrs, Symbol<Device> op_device, int32_t input_size, int32_t output_size,
+      const std::function<const MirroredTensorMeta*(int32_t)>& TensorMeta4InputIndex,
+      const std::function<TensorMeta*(int32_t)>& TensorMeta4OutputIndex, const InferFn& Infer);
+
+  size_t capacity() const { return capacity_; }
+  size_t size() const { return entries_.size(); }
+
+  // Capacity of the cache each UserOpExpr creates, from ONEFLOW_EAGER_INFER_CACHE_SIZE. 0 turns
+  // the cache off.
+  static size_t DefaultCapacity();
+
+ private:
+  struct InputMeta {
+    Shape shape;
+    Stride stride;
+    DataType dtype;
+    bool is_dynamic;
+  };
+
+  struct OutputMeta {
+    Shape shape;
+    DataType dtype;
+    bool is_dynamic;
+  };
+
+  struct Entry {
+    size_t hash_value;
+    AttrMap attrs;
+    Symbol<Device> op_device;
+    std::vector<InputMeta> input_metas;
+    std::vector<OutputMeta> output_metas;
+  };
+
+  bool Match(const Entry& entry, const AttrMap& attrs, Symbol<Device> op_device,
+             int32_t input_size,
+             const std::function<const MirroredTensorMeta*(int32_t)>& TensorMeta4InputIndex) const;
+
+  size_t capacity_;
+  // most recently used first
+  std::list<Entry> entries_;
+  HashMap<size_t, std::list<Entry>::iterator> hash2entry_;
+};
+
+}  // namespace one
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_FRAMEWORK_MIRRORED_TENSOR_INFER_CACHE_H_
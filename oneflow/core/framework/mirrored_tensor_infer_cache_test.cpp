@@ -0,0 +1,164 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "gtest/gtest.h"
+#include "oneflow/core/framework/mirrored_tensor_infer_cache.h"
+#include "oneflow/core/framework/attr_value.h"
+
+namespace oneflow {
+namespace one {
+namespace test {
+
+namespace {
+
+AttrMap MakeAttrs(int32_t axis) {
+  MutableAttrMap attrs;
+  CHECK_JUST(attrs.SetAttr<int32_t>("axis", axis));
+  return AttrMap(attrs);
+}
+
+MirroredTensorMeta MakeInputMeta(const Shape& shape, const Stride& stride, DataType dtype,
+                                 Symbol<Device> device) {
+  return MirroredTensorMeta(std::make_shared<const Shape>(shape), dtype, device,
+                            std::make_shared<const Stride>(stride), 0);
+}
+
+// A single-input, single-output op whose output is the input flattened, counting how often its
+// inference runs.
+class MirroredTensorInferCacheTest : public testing::Test {
+ protected:
+  MirroredTensorInferCacheTest() : infer_count_(0) {
+    // "auto" devices are the only ones that can be created without a running env
+    device_ = CHECK_JUST(Device::New("auto", 0));
+    other_device_ = CHECK_JUST(Device::New("auto", 1));
+    Infer_ = [this](const AttrMap& attrs, Symbol<Device> op_device,
+                    const std::function<const MirroredTensorMeta*(int32_t)>& TensorMeta4InputIndex,
+                    const std::function<TensorMeta*(int32_t)>& TensorMeta4OutputIndex)
+        -> Maybe<void> {
+      infer_count_ += 1;
+      const MirroredTensorMeta* input = TensorMeta4InputIndex(0);
+      TensorMeta* output = TensorMeta4OutputIndex(0);
+      *output->mut_shape() = Shape({input->shape().elem_cnt()});
+      *output->mut_data_type() = input->dtype();
+      output->set_is_dynamic(input->is_dynamic());
+      return Maybe<void>::Ok();
+    };
+  }
+
+  // Runs the cache on input and checks the output it writes, whether it comes from the cache or
+  // from Infer_.
+  void GetOrInfer(MirroredTensorInferCache* cache, const AttrMap& attrs, Symbol<Device> op_device,
+                  const MirroredTensorMeta& input) {
+    TensorMeta output(std::make_shared<Shape>(Shape({7, 7})), DataType::kInvalidDataType);
+    output.set_is_dynamic(!input.is_dynamic());
+    CHECK_JUST(cache->GetOrInfer(
+        attrs, op_device, 1, 1, [&](int32_t) { return &input; },
+        [&](int32_t) { return &output; }, Infer_));
+    ASSERT_EQ(output.shape(), Shape({input.shape().elem_cnt()}));
+    ASSERT_EQ(output.dtype(), input.dtype());
+    ASSERT_EQ(output.is_dynamic(), input.is_dynamic());
+  }
+
+  Symbol<Device> device_;
+  Symbol<Device> other_device_;
+  int64_t infer_count_;
+  MirroredTensorInferCache::InferFn Infer_;
+};
+
+}  // namespace
+
+TEST_F(MirroredTensorInferCacheTest, hit) {
+  MirroredTensorInferCache cache(16);
+  const AttrMap attrs = MakeAttrs(1);
+  const auto input = MakeInputMeta(Shape({2, 3}), Stride({3, 1}), DataType::kFloat, device_);
+  GetOrInfer(&cache, attrs, device_, input);
+  ASSERT_EQ(infer_count_, 1);
+  GetOrInfer(&cache, attrs, device_, input);
+  // an equal but distinct input meta and attrs hit as well
+  GetOrInfer(&cache, MakeAttrs(1), device_,
+             MakeInputMeta(Shape({2, 3}), Stride({3, 1}), DataType::kFloat, device_));
+  ASSERT_EQ(infer_count_, 1);
+  ASSERT_EQ(cache.size(), 1);
+}
+
+TEST_F(MirroredTensorInferCacheTest, miss_on_each_key_component) {
+  MirroredTensorInferCache cache(16);
+  const AttrMap attrs = MakeAttrs(1);
+  const auto input = MakeInputMeta(Shape({2, 3}), Stride({3, 1}), DataType::kFloat, device_);
+  auto dynamic_input = input;
+  dynamic_input.set_is_dynamic(true);
+  struct Call {
+    AttrMap attrs;
+    Symbol<Device> op_device;
+    MirroredTensorMeta input;
+  };
+  const std::vector<Call> calls{
+      {attrs, device_, input},
+      {MakeAttrs(2), device_, input},
+      {attrs, device_, MakeInputMeta(Shape({3, 2}), Stride({3, 1}), DataType::kFloat, device_)},
+      {attrs, device_, MakeInputMeta(Shape({2, 3}), Stride({1, 2}), DataType::kFloat, device_)},
+      {attrs, device_, MakeInputMeta(Shape({2, 3}), Stride({3, 1}), DataType::kDouble, device_)},
+      {attrs, other_device_, input},
+      {attrs, device_, dynamic_input},
+  };
+  for (size_t i = 0; i < calls.size(); ++i) {
+    GetOrInfer(&cache, calls[i].attrs, calls[i].op_device, calls[i].input);
+    ASSERT_EQ(infer_count_, i + 1) << "call " << i;
+  }
+  ASSERT_EQ(cache.size(), calls.size());
+  for (const Call& call : calls) { GetOrInfer(&cache, call.attrs, call.op_device, call.input); }
+  ASSERT_EQ(infer_count_, calls.size());
+}
+
+TEST_F(MirroredTensorInferCacheTest, lru_eviction) {
+  MirroredTensorInferCache cache(2);
+  const AttrMap attrs = MakeAttrs(1);
+  const auto a = MakeInputMeta(Shape({1}), Stride({1}), DataType::kFloat, device_);
+  const auto b = MakeInputMeta(Shape({2}), Stride({1}), DataType::kFloat, device_);
+  const auto c = MakeInputMeta(Shape({3}), Stride({1}), DataType::kFloat, device_);
+  GetOrInfer(&cache, attrs, device_, a);
+  GetOrInfer(&cache, attrs, device_, b);
+  ASSERT_EQ(infer_count_, 2);
+  // a becomes the most recently used, so c evicts b
+  GetOrInfer(&cache, attrs, device_, a);
+  GetOrInfer(&cache, attrs, device_, c);
+  ASSERT_EQ(infer_count_, 3);
+  ASSERT_EQ(cache.size(), 2);
+  GetOrInfer(&cache, attrs, device_, a);
+  ASSERT_EQ(infer_count_, 3);
+  // b comes back and evicts c, the least recently used now
+  GetOrInfer(&cache, attrs, device_, b);
+  ASSERT_EQ(infer_count_, 4);
+  GetOrInfer(&cache, attrs, device_, a);
+  ASSERT_EQ(infer_count_, 4);
+  GetOrInfer(&cache, attrs, device_, c);
+  ASSERT_EQ(infer_count_, 5);
+  ASSERT_EQ(cache.size(), 2);
+}
+
+TEST_F(MirroredTensorInferCacheTest, zero_capacity) {
+  MirroredTensorInferCache cache(0);
+  const AttrMap attrs = MakeAttrs(1);
+  const auto input = MakeInputMeta(Shape({2, 3}), Stride({3, 1}), DataType::kFloat, device_);
+  for (int i = 1; i <= 3; ++i) {
+    GetOrInfer(&cache, attrs, device_, input);
+    ASSERT_EQ(infer_count_, i);
+  }
+  ASSERT_EQ(cache.size(), 0);
+}
+
+}  // namespace test
+}  // namespace one
+}  // namespace oneflow
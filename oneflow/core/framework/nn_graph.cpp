@@ -31,7 +31,9 @@ limitations under the License.
 #include "oneflow/core/job/job_instance.h"
 #include "oneflow/core/job/critical_section_instance.h"
 #include "oneflow/core/job/lazy_mode.h"
+#include "oneflow/core/job/plan_cache.h"
 #include "oneflow/core/job/plan_util.h"
+#include "oneflow/core/job_rewriter/job_completer.h"
 #include "oneflow/core/persistence/tee_persistent_log_stream.h"
 #include "oneflow/core/vm/vm_util.h"
 #include "oneflow/core/profiler/profiler.h"
@@ -264,12 +266,23 @@ Maybe<void> NNGraph::CompileAndInitRuntime() {
   auto scope = std::make_unique<GlobalJobDescScope>(job_.job_conf(), job_ctx->job_id());
   if (GlobalProcessCtx::IsThisProcessMaster()) {
     double start = GetCurTime();
-    // TODO(chengcheng): new memory reused by chunk
-    Compiler().Compile(&job_, &plan_, /* need_job_complete */ true);
+    std::unique_ptr<PlanCache> plan_cache = PlanCache::NewFromEnv();
+    if (plan_cache) {
+      // NOTE: the cache is keyed by the optimized job, so complete the job before looking up.
+      JUST(JobCompleter().Complete(&job_));
+      plan_cache_hit_ = plan_cache->TryLoad(job_, job_ctx->job_id(), &plan_);
+    }
+    if (!plan_cache_hit_) {
+      // TODO(chengcheng): new memory reused by chunk
+      Compiler().Compile(&job_, &plan_, /* need_job_complete */ !plan_cache);
+      if (plan_cache) { plan_cache->Save(plan_); }
+    }
     PlanUtil::GenMemBlockAndChunkWithVariableOpNames4Plan(&plan_, variable_op_names_);
 
     LOG(INFO) << "\njob_id: " << job_ctx->job_id() << " , job_name: " << name_
-              << " , compile time: " << (GetCurTime() - start) / 1000000000.0 << " seconds.\n";
+              << " , compile time: " << (GetCurTime() - start) / 1000000000.0 << " seconds"
+              << (plan_cache ? (plan_cache_hit_ ? " (plan cache hit).\n" : " (plan cache miss).\n")
+                             : ".\n");
     if (Global<ResourceDesc, ForSession>::Get()->enable_debug_mode()) {
       TeePersistentLogStream::Create("job_" + name_ + "_plan")->Write(plan_);
       PlanUtil::ToDotFile(plan_, "job_" + name_ + "_plan.dot");
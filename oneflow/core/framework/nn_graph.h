@@ -30,7 +30,7 @@ class Blob;
 class NNGraph final : public NNGraphIf {
  public:
   explicit NNGraph(const std::string& name)
-      : name_(name), runtime_inited_(false), is_closed_(false) {}
+      : name_(name), runtime_inited_(false), is_closed_(false), plan_cache_hit_(false) {}
   ~NNGraph();
 
   const std::string& job_name() const override { return name_; }
@@ -41,6 +41,8 @@ class NNGraph final : public NNGraphIf {
   const std::vector<std::string>& inputs_tensor_meta_str() const;
   const std::vector<std::string>& outputs_tensor_meta_str() const;
   int64_t variable_op_size() const;
+  // Whether the plan of this graph was loaded from the plan cache, see PlanCache.
+  bool plan_cache_hit() const { return plan_cache_hit_; }
 
   Maybe<void> RegisterInputOpNamesAndTensors(
       const std::vector<std::string>& inputs_op_names,
@@ -76,6 +78,7 @@ class NNGraph final : public NNGraphIf {
   std::unique_ptr<Runtime> runtime_;
   bool runtime_inited_;
   bool is_closed_;
+  bool plan_cache_hit_;
 };
 
 Maybe<void> RunLazyNNGraph(const one::TensorTuple& inputs, const one::TensorTuple& outputs,
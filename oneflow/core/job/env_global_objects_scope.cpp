@@ -27,6 +27,7 @@ limitations under the License.
 #include "oneflow/core/job/global_for.h"
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/persistence/file_system.h"
+#include "oneflow/core/persistence/snapshot.h"
 #include "oneflow/core/device/cuda_util.h"
 #include "oneflow/core/vm/virtual_machine_scope.h"
 #include "oneflow/core/job/job_build_and_infer_ctx_mgr.h"
@@ -43,6 +44,7 @@ limitations under the License.
 #include "oneflow/core/comm_network/comm_network.h"
 #include "oneflow/core/comm_network/epoll/epoll_comm_network.h"
 #include "oneflow/core/comm_network/ibverbs/ibverbs_comm_network.h"
+#include "oneflow/core/comm_network/shm/shm_comm_network.h"
 #include "oneflow/core/kernel/chain_kernel_observer.h"
 #include "oneflow/core/kernel/sync_check_kernel_observer.h"
 #include "oneflow/core/kernel/blob_access_checker_kernel_observer.h"
@@ -128,6 +130,25 @@ bool CommNetIBEnabled() {
 
 #endif
 
+#ifdef __linux__
+
+bool CommNetShmEnabled() {
+  // NumOfProcessPerNode is the same on every rank, so all ranks make the same choice
+  return GlobalProcessCtx::NumOfProcessPerNode() > 1
+         && ParseBooleanFromEnv("ONEFLOW_COMM_NET_SHM_ENABLE", true);
+}
+
+void NewCommNetWithoutIB() {
+  if (CommNetShmEnabled()) {
+    Global<ShmCommNet>::New();
+    Global<CommNet>::SetAllocated(Global<ShmCommNet>::Get());
+  } else {
+    Global<CommNet>::SetAllocated(Global<EpollCommNet>::Get());
+  }
+}
+
+#endif  // __linux__
+
 }  // namespace
 
 Maybe<void> EnvGlobalObjectsScope::Init(const EnvProto& env_proto) {
@@ -191,10 +212,10 @@ Maybe<void> EnvGlobalObjectsScope::Init(const EnvProto& env_proto) {
         Global<IBVerbsCommNet>::New();
         Global<CommNet>::SetAllocated(Global<IBVerbsCommNet>::Get());
       } else {
-        Global<CommNet>::SetAllocated(Global<EpollCommNet>::Get());
+        NewCommNetWithoutIB();
       }
 #else
-      Global<CommNet>::SetAllocated(Global<EpollCommNet>::Get());
+      NewCommNetWithoutIB();
 #endif  // WITH_RDMA
     }
 #endif  // __linux__
@@ -223,6 +244,7 @@ EnvGlobalObjectsScope::~EnvGlobalObjectsScope() {
     CHECK_JUST(session_ctx->TryClose());
   }
   Global<KernelObserver>::Delete();
+  SnapshotWriter::WaitAsyncWrites();
   if (!Global<ResourceDesc, ForSession>::Get()->enable_dry_run()) {
 #ifdef __linux__
     if (Global<ResourceDesc, ForSession>::Get()->process_ranks().size() > 1) {
@@ -24,6 +24,8 @@ limitations under the License.
 
 namespace oneflow {
 
+class IdState;
+
 class IDMgr final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(IDMgr);
@@ -35,6 +37,10 @@ class IDMgr final {
 
   TaskIdGenerator* GetTaskIdGenerator() { return &task_id_gen_; }
 
+  // snapshot and restore of all id counters, used to reproduce the ids of a cached plan
+  void SaveIdState(IdState* id_state) const;
+  void LoadIdState(const IdState& id_state);
+
  private:
   friend class Global<IDMgr>;
   IDMgr();
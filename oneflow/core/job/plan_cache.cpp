@@ -0,0 +1,164 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job/plan_cache.h"
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include "oneflow/core/common/protobuf.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/control/global_process_ctx.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/id_manager.h"
+#include "oneflow/core/job/plan_cache.pb.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/job/version.h"
+#include "oneflow/core/persistence/file_system.h"
+
+namespace oneflow {
+
+namespace {
+
+constexpr const char* kPlanCacheEntrySuffix = ".plan";
+
+// map fields are serialized in an unspecified order by default
+std::string SerializeDeterministically(const PbMessage& msg) {
+  std::string out;
+  {
+    google::protobuf::io::StringOutputStream string_stream(&out);
+    google::protobuf::io::CodedOutputStream coded_stream(&string_stream);
+    coded_stream.SetSerializationDeterministic(true);
+    CHECK(msg.SerializePartialToCodedStream(&coded_stream));
+  }
+  return out;
+}
+
+bool IsPlanEntryName(const std::string& name) {
+  const size_t suffix_len = std::strlen(kPlanCacheEntrySuffix);
+  return name.size() > suffix_len
+         && name.compare(name.size() - suffix_len, suffix_len, kPlanCacheEntrySuffix) == 0;
+}
+
+bool IsPlanValid(const Plan& plan, int64_t job_id) {
+  if (plan.task_size() == 0) { return false; }
+  if (plan.job_confs().job_id2job_conf().count(job_id) == 0) { return false; }
+  for (const TaskProto& task : plan.task()) {
+    if (task.job_id() != job_id) { return false; }
+  }
+  return true;
+}
+
+}  // namespace
+
+PlanCache::PlanCache(const std::string& cache_dir, int64_t capacity)
+    : cache_dir_(cache_dir), capacity_(capacity) {
+  CHECK_GT(capacity_, 0);
+  LocalFS()->RecursivelyCreateDirIfNotExist(cache_dir_);
+}
+
+/* static */ std::unique_ptr<PlanCache> PlanCache::NewFromEnv() {
+  const std::string cache_dir = GetStringFromEnv("ONEFLOW_PLAN_CACHE_DIR", "");
+  const int64_t capacity = ParseIntegerFromEnv("ONEFLOW_PLAN_CACHE_CAPACITY", 16);
+  if (cache_dir.empty() || capacity <= 0) { return nullptr; }
+  return std::make_unique<PlanCache>(cache_dir, capacity);
+}
+
+std::string PlanCache::EntryPath() const {
+  std::stringstream ss;
+  ss << std::hex << std::setw(16) << std::setfill('0') << std::hash<std::string>()(key_)
+     << kPlanCacheEntrySuffix;
+  return JoinPath(cache_dir_, ss.str());
+}
+
+bool PlanCache::TryLoad(const Job& job, int64_t job_id, Plan* plan) {
+  {
+    PlanCacheKey key;
+    key.set_version(GetOneFlowGitVersion());
+    key.set_job_id(job_id);
+    *key.mutable_job() = job;
+    *key.mutable_resource() = Global<ResourceDesc, ForSession>::Get()->resource();
+    key.set_world_size(GlobalProcessCtx::WorldSize());
+    key.set_node_size(GlobalProcessCtx::NodeSize());
+    Global<IDMgr>::Get()->SaveIdState(key.mutable_id_state());
+    key_ = SerializeDeterministically(key);
+  }
+  const std::string path = EntryPath();
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) { return false; }
+  PlanCacheEntry entry;
+  if (!TryParseProtoFromPbFile(path, &entry) || entry.key() != key_
+      || !IsPlanValid(entry.plan(), job_id)) {
+    // corrupted, written by an incompatible build or a hash collision
+    LOG(WARNING) << "Drop unusable plan cache entry " << path;
+    unlink(path.c_str());
+    return false;
+  }
+  *plan = std::move(*entry.mutable_plan());
+  Global<IDMgr>::Get()->LoadIdState(entry.id_state());
+  // bump the modification time which orders entries for eviction
+  utime(path.c_str(), nullptr);
+  return true;
+}
+
+void PlanCache::Save(const Plan& plan) {
+  CHECK(!key_.empty()) << "PlanCache::Save must follow PlanCache::TryLoad";
+  PlanCacheEntry entry;
+  entry.set_key(key_);
+  *entry.mutable_plan() = plan;
+  Global<IDMgr>::Get()->SaveIdState(entry.mutable_id_state());
+  const std::string path = EntryPath();
+  // write then rename so that concurrent readers never see a partial entry
+  const std::string tmp_path = path + ".tmp." + std::to_string(getpid());
+  {
+    std::ofstream out_stream(tmp_path, std::ofstream::out | std::ofstream::binary);
+    if (!entry.SerializeToOstream(&out_stream)) {
+      LOG(WARNING) << "Fail to write plan cache entry " << tmp_path;
+      out_stream.close();
+      unlink(tmp_path.c_str());
+      return;
+    }
+  }
+  if (rename(tmp_path.c_str(), path.c_str()) != 0) {
+    LOG(WARNING) << "Fail to rename plan cache entry " << tmp_path << " to " << path;
+    unlink(tmp_path.c_str());
+    return;
+  }
+  Evict();
+}
+
+void PlanCache::Evict() {
+  const std::string cur_path = EntryPath();
+  std::vector<std::pair<std::pair<int64_t, int64_t>, std::string>> mtime_and_paths;
+  for (const std::string& name : LocalFS()->ListDir(cache_dir_)) {
+    if (!IsPlanEntryName(name)) { continue; }
+    const std::string path = JoinPath(cache_dir_, name);
+    // the entry just saved is the most recently used one
+    if (path == cur_path) { continue; }
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) { continue; }
+    mtime_and_paths.emplace_back(std::make_pair(st.st_mtim.tv_sec, st.st_mtim.tv_nsec), path);
+  }
+  if (mtime_and_paths.size() < static_cast<size_t>(capacity_)) { return; }
+  std::sort(mtime_and_paths.begin(), mtime_and_paths.end());
+  const size_t evict_num = mtime_and_paths.size() + 1 - capacity_;
+  for (size_t i = 0; i < evict_num; ++i) {
+    LOG(INFO) << "Evict plan cache entry " << mtime_and_paths.at(i).second;
+    unlink(mtime_and_paths.at(i).second.c_str());
+  }
+}
+
+}  // namespace oneflow
@@ -0,0 +1,55 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_JOB_PLAN_CACHE_H_
+#define ONEFLOW_CORE_JOB_PLAN_CACHE_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/job/job.pb.h"
+#include "oneflow/core/job/plan.pb.h"
+
+namespace oneflow {
+
+// On-disk cache of compiled plans, enabled by setting ONEFLOW_PLAN_CACHE_DIR. An entry is keyed
+// by the optimized job, the resource config, the world layout, the OneFlow version and the id
+// counters of Global<IDMgr>, so a hit reproduces exactly the plan Compiler::Compile would build.
+// At most ONEFLOW_PLAN_CACHE_CAPACITY (default 16) entries are kept, least recently used first out.
+class PlanCache final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(PlanCache);
+  PlanCache(const std::string& cache_dir, int64_t capacity);
+  ~PlanCache() = default;
+
+  // Returns nullptr if the plan cache is disabled.
+  static std::unique_ptr<PlanCache> NewFromEnv();
+
+  // Must be called right before compiling `job`. On a hit the cached plan is copied into `plan`
+  // and Global<IDMgr> is advanced as if the plan had just been compiled.
+  bool TryLoad(const Job& job, int64_t job_id, Plan* plan);
+  // Stores the plan compiled for the job of the last TryLoad.
+  void Save(const Plan& plan);
+
+ private:
+  std::string EntryPath() const;
+  void Evict();
+
+  std::string cache_dir_;
+  int64_t capacity_;
+  std::string key_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_JOB_PLAN_CACHE_H_
@@ -0,0 +1,186 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <stdlib.h>
+#include <chrono>
+#include <thread>
+#include "oneflow/core/control/global_process_ctx.h"
+#include "oneflow/core/job/id_manager.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/plan_cache.h"
+#include "oneflow/core/persistence/file_system.h"
+
+namespace oneflow {
+
+namespace {
+
+EnvProto GetEnvProto() {
+  EnvProto ret;
+  auto* machine = ret.add_machine();
+  machine->set_id(0);
+  machine->set_addr("127.0.0.1");
+  ret.set_ctrl_port(9527);
+  return ret;
+}
+
+Resource GetResource() {
+  Resource ret;
+  ret.set_machine_num(1);
+  ret.set_gpu_device_num(0);
+  ret.set_cpu_device_num(1);
+  return ret;
+}
+
+void New() {
+  Global<EnvDesc>::New(GetEnvProto());
+  Global<ProcessCtx>::New();
+  Global<ProcessCtx>::Get()->mutable_ctrl_addr()->Add();
+  Global<ProcessCtx>::Get()->set_rank(0);
+  Global<ProcessCtx>::Get()->set_node_size(1);
+  Global<ResourceDesc, ForSession>::New(GetResource(), GlobalProcessCtx::NumOfProcessPerNode());
+  Global<IDMgr>::New();
+}
+
+void Delete() {
+  Global<IDMgr>::Delete();
+  Global<ProcessCtx>::Delete();
+  Global<ResourceDesc, ForSession>::Delete();
+  Global<EnvDesc>::Delete();
+}
+
+std::string NewCacheDir() {
+  char dir_template[] = "/tmp/plan_cache_test_XXXXXX";
+  CHECK_NOTNULL(mkdtemp(dir_template));
+  return dir_template;
+}
+
+Job MakeJob(const std::string& job_name) {
+  Job job;
+  job.mutable_job_conf()->set_job_name(job_name);
+  return job;
+}
+
+Plan MakePlan(int64_t job_id, int64_t task_num) {
+  Plan plan;
+  for (int64_t i = 0; i < task_num; ++i) {
+    TaskProto* task = plan.add_task();
+    task->set_task_type(kNormalForward);
+    task->set_machine_id(0);
+    task->set_thrd_id(0);
+    task->set_task_id(i);
+    task->set_job_id(job_id);
+    task->mutable_task_set_info()->set_chain_id(i);
+    task->mutable_task_set_info()->set_order_in_graph(i);
+    task->mutable_exec_sequence();
+    // compiling a plan consumes ids
+    Global<IDMgr>::Get()->NewRegstDescId();
+  }
+  plan.mutable_block_chunk_list();
+  plan.mutable_collective_boxing_plan();
+  plan.mutable_ctrl_regst_desc_info();
+  (*plan.mutable_job_confs()->mutable_job_id2job_conf())[job_id].set_job_name("job");
+  return plan;
+}
+
+}  // namespace
+
+TEST(PlanCache, load_saved_plan) {
+  New();
+  const std::string cache_dir = NewCacheDir();
+  const Job job = MakeJob("job");
+  {
+    PlanCache plan_cache(cache_dir, 4);
+    Plan plan;
+    ASSERT_FALSE(plan_cache.TryLoad(job, 0, &plan));
+    plan_cache.Save(MakePlan(0, 3));
+  }
+  Global<IDMgr>::Delete();
+  Global<IDMgr>::New();
+  {
+    PlanCache plan_cache(cache_dir, 4);
+    Plan plan;
+    ASSERT_TRUE(plan_cache.TryLoad(job, 0, &plan));
+    ASSERT_EQ(plan.task_size(), 3);
+    // ids consumed by the cached compilation are skipped
+    ASSERT_EQ(Global<IDMgr>::Get()->NewRegstDescId(), 3);
+  }
+  {
+    // the id state differs now
+    PlanCache plan_cache(cache_dir, 4);
+    Plan plan;
+    ASSERT_FALSE(plan_cache.TryLoad(job, 0, &plan));
+  }
+  LocalFS()->RecursivelyDeleteDir(cache_dir);
+  Delete();
+}
+
+TEST(PlanCache, miss_on_different_job) {
+  New();
+  const std::string cache_dir = NewCacheDir();
+  {
+    PlanCache plan_cache(cache_dir, 4);
+    Plan plan;
+    ASSERT_FALSE(plan_cache.TryLoad(MakeJob("job"), 0, &plan));
+    Global<IDMgr>::Delete();
+    Global<IDMgr>::New();
+    plan_cache.Save(MakePlan(0, 1));
+  }
+  Global<IDMgr>::Delete();
+  Global<IDMgr>::New();
+  {
+    PlanCache plan_cache(cache_dir, 4);
+    Plan plan;
+    ASSERT_FALSE(plan_cache.TryLoad(MakeJob("other_job"), 0, &plan));
+    ASSERT_FALSE(plan_cache.TryLoad(MakeJob("job"), 1, &plan));
+  }
+  LocalFS()->RecursivelyDeleteDir(cache_dir);
+  Delete();
+}
+
+TEST(PlanCache, evict_least_recently_used) {
+  New();
+  const std::string cache_dir = NewCacheDir();
+  PlanCache plan_cache(cache_dir, 2);
+  const std::vector<std::string> job_names{"job0", "job1", "job2"};
+  // entries are ordered by modification time, which the file system keeps at a coarse granularity
+  const auto WaitForNextTimestamp = []() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  };
+  for (const std::string& job_name : job_names) {
+    WaitForNextTimestamp();
+    Global<IDMgr>::Delete();
+    Global<IDMgr>::New();
+    Plan plan;
+    ASSERT_FALSE(plan_cache.TryLoad(MakeJob(job_name), 0, &plan));
+    plan_cache.Save(MakePlan(0, 1));
+    if (job_name == "job1") {
+      // touch job0 so that job1 becomes the least recently used entry
+      WaitForNextTimestamp();
+      Global<IDMgr>::Delete();
+      Global<IDMgr>::New();
+      ASSERT_TRUE(plan_cache.TryLoad(MakeJob("job0"), 0, &plan));
+    }
+  }
+  for (const std::string& job_name : job_names) {
+    Global<IDMgr>::Delete();
+    Global<IDMgr>::New();
+    Plan plan;
+    ASSERT_EQ(plan_cache.TryLoad(MakeJob(job_name), 0, &plan), job_name != "job1");
+  }
+  LocalFS()->RecursivelyDeleteDir(cache_dir);
+  Delete();
+}
+
+}  // namespace oneflow
@@ -20,6 +20,7 @@ limitations under the License.
 #include "oneflow/core/job/nd_sbp_util.h"
 #include "oneflow/core/operator/operator.h"
 #include "oneflow/core/persistence/snapshot.h"
+#include "oneflow/core/thread/thread_manager.h"
 #include "oneflow/core/ep/cuda/cuda_stream.h"
 #include "oneflow/core/ep/cpu/cpu_stream.h"
 #include "oneflow/core/ep/include/device_manager_registry.h"
@@ -197,6 +198,46 @@ class AutoSyncBlobAccessor<DeviceType::kCPU> final {
   Blob* underlying_;
 };
 
+// Host memory the staging blobs of device variables may take before SnapshotSliceLoader flushes.
+constexpr int64_t kMaxSnapshotLoadStagingBytes = int64_t(1) << 30;
+
+// Reads slices of snapshot variables into blobs, one variable per task of the global ThreadPool,
+// so that loading time follows the size of the local slices rather than the number of variables.
+// Device blobs are read into host staging blobs that Flush copies to the device.
+template<DeviceType device_type>
+class SnapshotSliceLoader final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(SnapshotSliceLoader);
+  explicit SnapshotSliceLoader(ep::Stream* stream) : stream_(stream), staging_bytes_(0) {}
+  ~SnapshotSliceLoader() { Flush(); }
+
+  void Add(const std::string& snapshot_path, const std::string& key,
+           const Shape& logical_blob_shape, const TensorSliceView& slice, Blob* blob) {
+    accessors_.emplace_back(new AutoSyncBlobAccessor<device_type>(stream_, blob, false, true));
+    Blob* host_blob = accessors_.back()->host_blob();
+    reads_.emplace_back([snapshot_path, key, logical_blob_shape, slice, host_blob]() {
+      const SnapshotReader reader(snapshot_path);
+      reader.Read(key, logical_blob_shape, slice, host_blob);
+    });
+    if (device_type != DeviceType::kCPU) { staging_bytes_ += blob->ByteSizeOfBlobBody(); }
+    if (staging_bytes_ >= kMaxSnapshotLoadStagingBytes) { Flush(); }
+  }
+
+  void Flush() {
+    MultiThreadLoop(reads_.size(), [&](size_t i) { reads_.at(i)(); });
+    reads_.clear();
+    // copies the staging blobs to the device
+    accessors_.clear();
+    staging_bytes_ = 0;
+  }
+
+ private:
+  ep::Stream* stream_;
+  std::vector<std::unique_ptr<AutoSyncBlobAccessor<device_type>>> accessors_;
+  std::vector<std::function<void()>> reads_;
+  int64_t staging_bytes_;
+};
+
 }  // namespace
 
 template<DeviceType device_type>
@@ -248,13 +289,13 @@ class ModelInitV2Kernel final : public Kernel {
   void Forward(KernelContext* ctx) const override { ForwardDataContent(ctx); }
   void ForwardDataContent(KernelContext* ctx) const override {
     const ModelInitV2OpConf& conf = this->op_conf().model_init_v2_conf();
-
+    SnapshotSliceLoader<device_type> snapshot_loader(ctx->stream());
     FOR_RANGE(int64_t, i, 0, conf.variable_op_name_size()) {
       Blob* ref = ctx->BnInOp2Blob(GenRepeatedBn("ref", i));
       const DataType data_type = ref->data_type();
       const VariableOpConf& original_variable_conf = conf.original_variable_conf(i);
-      AutoSyncBlobAccessor<device_type> ref_accessor(ctx->stream(), ref, false, true);
       if (original_variable_conf.has_initializer()) {
+        AutoSyncBlobAccessor<device_type> ref_accessor(ctx->stream(), ref, false, true);
         std::mt19937 random_seed_gen(seeds_.at(i));
         InitializeWithConfUtil::SwitchInitializeWithConf(
             SwitchCase(data_type), original_variable_conf.initializer(), random_seed_gen(),
@@ -265,12 +306,13 @@ class ModelInitV2Kernel final : public Kernel {
             GenLogicalBlobName(conf.variable_op_name(i), original_variable_conf.out());
         const std::string key = snapshot_conf.has_key() ? snapshot_conf.key() : var_lbn;
         const Shape logical_blob_shape(original_variable_conf.shape());
-        const SnapshotReader reader(snapshot_conf.path());
-        reader.Read(key, logical_blob_shape, tensor_slice_views_.at(i), ref_accessor.host_blob());
+        snapshot_loader.Add(snapshot_conf.path(), key, logical_blob_shape,
+                            tensor_slice_views_.at(i), ref);
       } else {
         UNIMPLEMENTED();
       }
     }
+    snapshot_loader.Flush();
   }
 
   std::vector<int64_t> seeds_;
@@ -310,16 +352,17 @@ class ModelLoadV2Kernel final : public Kernel {
     const ModelLoadV2OpConf& conf = this->op_conf().model_load_v2_conf();
     const Blob* path = ctx->BnInOp2Blob("path");
     const std::string snapshot_path = SyncReadStringFromBlob<device_type>(ctx->stream(), path);
-    SnapshotReader reader(snapshot_path);
+    SnapshotSliceLoader<device_type> snapshot_loader(ctx->stream());
     FOR_RANGE(int64_t, i, 0, conf.variable_op_name_size()) {
       Blob* ref = ctx->BnInOp2Blob(GenRepeatedBn("ref", i));
       const VariableOpConf& original_variable_conf = conf.original_variable_conf(i);
       const Shape logical_blob_shape(original_variable_conf.shape());
       const std::string& var_lbn =
           GenLogicalBlobName(conf.variable_op_name(i), original_variable_conf.out());
-      AutoSyncBlobAccessor<device_type> ref_accessor(ctx->stream(), ref, false, true);
-      reader.Read(var_lbn, logical_blob_shape, tensor_slice_views_.at(i), ref_accessor.host_blob());
+      snapshot_loader.Add(snapshot_path, var_lbn, logical_blob_shape, tensor_slice_views_.at(i),
+                          ref);
     }
+    snapshot_loader.Flush();
   }
   std::vector<TensorSliceView> tensor_slice_views_;
 };
@@ -389,7 +432,9 @@ class ModelSaveV2Kernel final : public Kernel {
     const ModelSaveV2OpConf& conf = this->op_conf().model_save_v2_conf();
     const Blob* path_blob = ctx->BnInOp2Blob("path");
     const std::string snapshot_path = SyncReadStringFromBlob<device_type>(ctx->stream(), path_blob);
-    SnapshotWriter writer(snapshot_path);
+    // Parts are read back right away by the rank that assembles the variable, and snapshot_done is
+    // written by the caller once the job returns, so the writes are synchronous.
+    SnapshotWriter writer(snapshot_path, false);
     SnapshotReader reader(snapshot_path);
     FOR_RANGE(int64_t, i, 0, conf.variable_op_name_size()) {
       if (!need_do_saves_.at(i)) { continue; }
@@ -27,16 +27,9 @@ void ActorMsgBus::SendMsg(const ActorMsg& msg) {
     SendMsgWithoutCommNet(msg);
   } else {
     if (msg.IsDataRegstMsgToConsumer()) {
-      int64_t comm_net_sequence;
-      {
-        std::unique_lock<std::mutex> lock(
-            regst_desc_id_dst_actor_id2comm_net_sequence_number_mutex_);
-        int64_t& comm_net_sequence_ref =
-            regst_desc_id_dst_actor_id2comm_net_sequence_number_[std::make_pair(
-                msg.regst_desc_id(), msg.dst_actor_id())];
-        comm_net_sequence = comm_net_sequence_ref;
-        comm_net_sequence_ref += 1;
-      }
+      // the counters live in the RtRegstDesc, so numbering does not serialize the senders
+      const int64_t comm_net_sequence =
+          msg.regst()->regst_desc()->NextCommNetSequenceNumber(msg.dst_actor_id());
       ActorMsg new_msg = msg;
       new_msg.set_comm_net_sequence_number(comm_net_sequence);
       Global<CommNet>::Get()->SendActorMsg(dst_machine_id, new_msg);
@@ -69,6 +69,11 @@ class WritableFile {
   // persisted, depending on the implementation.
   virtual void Flush() = 0;
 
+  // Flushes the file and syncs its contents to the storage device, like fsync.
+  //
+  // The contents persist even if the OS or machine crashes after a successful sync.
+  virtual void Sync() = 0;
+
  private:
 };
 
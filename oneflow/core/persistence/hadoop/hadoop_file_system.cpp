@@ -225,6 +225,8 @@ class HDFSWritableFile : public WritableFile {
 
   void Flush() override { PCHECK(hdfs_->hdfsHFlush(fs_, file_) == 0) << filename_; }
 
+  void Sync() override { PCHECK(hdfs_->hdfsHSync(fs_, file_) == 0) << filename_; }
+
  private:
   std::string filename_;
   LibHDFS* hdfs_;
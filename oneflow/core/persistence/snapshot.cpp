@@ -15,11 +15,9 @@ limitations under the License.
 */
 #include "oneflow/core/persistence/snapshot.h"
 #include "oneflow/core/common/str_util.h"
-#include "oneflow/core/persistence/persistent_in_stream.h"
-#include "oneflow/core/persistence/persistent_out_stream.h"
-#include "oneflow/core/register/tensor_slice_copier.h"
-#include "oneflow/core/ep/cpu/cpu_stream.h"
-#include "oneflow/core/ep/include/device_manager_registry.h"
+#include "oneflow/core/persistence/file_system.h"
+#include "oneflow/core/register/blob.h"
+#include "oneflow/core/thread/thread_pool.h"
 
 namespace oneflow {
 
@@ -29,10 +27,179 @@ std::string GenDataFilePath(const std::string& root, const std::string& key) {
   return JoinPath(root, key);
 }
 
+// A gap between two byte ranges of a slice is read through when it is not longer than a page,
+// which the file system would fetch anyway, or than the ranges themselves, which bounds the extra
+// bytes by the slice size.
+constexpr int64_t kSnapshotReadPageBytes = 4096;
+// Limit of a read-through span, which is staged in a buffer before its ranges are copied out.
+constexpr int64_t kMaxSnapshotReadSpanBytes = 8 * 1024 * 1024;
+
+// Reads slice of the row-major blob of logical_blob_shape stored in file to dst. Only the byte
+// ranges of the slice are read: the axes after the last axis the slice does not fully cover are
+// contiguous in the file, so each index of the axes up to it is one range.
+void ReadSliceRanges(const fs::RandomAccessFile& file, const Shape& logical_blob_shape,
+                     int64_t elem_size, const TensorSliceView& slice, char* dst) {
+  if (slice.shape().elem_cnt() == 0) { return; }
+  if (logical_blob_shape.NumAxes() == 0) {
+    file.Read(0, elem_size, dst);
+    return;
+  }
+  int64_t range_axis = logical_blob_shape.NumAxes() - 1;
+  while (range_axis > 0 && slice.At(range_axis).size() == logical_blob_shape.At(range_axis)) {
+    range_axis -= 1;
+  }
+  const int64_t range_bytes = slice.shape().Count(range_axis) * elem_size;
+  const int64_t num_ranges = slice.shape().Count(0, range_axis);
+  const auto RangeOffset = [&](int64_t range_id) -> int64_t {
+    int64_t offset = slice.At(range_axis).begin() * logical_blob_shape.Count(range_axis + 1);
+    for (int64_t axis = range_axis - 1; axis >= 0; --axis) {
+      const int64_t index = range_id % slice.At(axis).size();
+      range_id /= slice.At(axis).size();
+      offset += (slice.At(axis).begin() + index) * logical_blob_shape.Count(axis + 1);
+    }
+    return offset * elem_size;
+  };
+  const int64_t max_gap_bytes = std::max(kSnapshotReadPageBytes, range_bytes);
+  std::vector<char> buffer;
+  int64_t range_id = 0;
+  while (range_id < num_ranges) {
+    const int64_t span_begin = RangeOffset(range_id);
+    int64_t span_end = span_begin + range_bytes;
+    int64_t span_range_end = range_id + 1;
+    for (; span_range_end < num_ranges; ++span_range_end) {
+      const int64_t next_begin = RangeOffset(span_range_end);
+      if (next_begin - span_end > max_gap_bytes
+          || next_begin + range_bytes - span_begin > kMaxSnapshotReadSpanBytes) {
+        break;
+      }
+      span_end = next_begin + range_bytes;
+    }
+    char* span_dst = dst + range_id * range_bytes;
+    if (span_end - span_begin == (span_range_end - range_id) * range_bytes) {
+      file.Read(span_begin, span_end - span_begin, span_dst);
+    } else {
+      buffer.resize(span_end - span_begin);
+      file.Read(span_begin, buffer.size(), buffer.data());
+      for (int64_t i = range_id; i < span_range_end; ++i) {
+        std::memcpy(dst + i * range_bytes, buffer.data() + RangeOffset(i) - span_begin,
+                    range_bytes);
+      }
+    }
+    range_id = span_range_end;
+  }
+}
+
+// Files are appended in chunks of this size, which bounds each call of the file system.
+constexpr size_t kSnapshotWriteChunkBytes = 64 * 1024 * 1024;
+
+// The directory of path is created by SnapshotWriter before, so the file is opened on SnapshotFS
+// directly rather than through PersistentOutStream, which asks CtrlClient to create it once.
+void WriteSnapshotFile(const std::string& path, const char* data, size_t size, bool sync) {
+  std::unique_ptr<fs::WritableFile> file;
+  SnapshotFS()->NewWritableFile(path, &file);
+  for (size_t offset = 0; offset < size; offset += kSnapshotWriteChunkBytes) {
+    file->Append(data + offset, std::min(kSnapshotWriteChunkBytes, size - offset));
+  }
+  if (sync) { file->Sync(); }
+  file->Close();
+}
+
+// Writes the files of asynchronous SnapshotWriters on a pool of its own, so that they don't hold
+// the compute ThreadPool, and keeps count of the pending writes of every snapshot.
+class AsyncSnapshotWriteQueue final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(AsyncSnapshotWriteQueue);
+  ~AsyncSnapshotWriteQueue() = delete;
+
+  // Never destroyed, so that writes pending at exit don't race with static destructors.
+  static AsyncSnapshotWriteQueue* Get() {
+    static AsyncSnapshotWriteQueue* queue = new AsyncSnapshotWriteQueue();
+    return queue;
+  }
+
+  void Write(const std::string& root_path, const std::string& path, const char* data, size_t size,
+             bool sync) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cond_.wait(lock, [&]() {
+        return buffered_bytes_ == 0 || buffered_bytes_ + size <= max_buffered_bytes_;
+      });
+      buffered_bytes_ += size;
+      root_path2pending_cnt_[root_path] += 1;
+      if (!pool_) {
+        pool_.reset(
+            new ThreadPool(ParseIntegerFromEnv("ONEFLOW_SNAPSHOT_ASYNC_WRITE_THREAD_NUM", 4)));
+      }
+    }
+    auto buffer = std::make_shared<std::vector<char>>(data, data + size);
+    pool_->AddWork([this, root_path, path, buffer, sync]() {
+      WriteSnapshotFile(path, buffer->data(), buffer->size(), sync);
+      OnWriteDone(root_path, buffer->size());
+    });
+  }
+
+  // Runs Callback after the pending writes of root_path, by the thread of the last one.
+  void AddDoneCallback(const std::string& root_path, const std::function<void()>& Callback) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (root_path2pending_cnt_.count(root_path) > 0) {
+        root_path2done_callbacks_[root_path].emplace_back(Callback);
+        return;
+      }
+    }
+    Callback();
+  }
+
+  void Wait(const std::string& root_path) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [&]() { return root_path2pending_cnt_.count(root_path) == 0; });
+  }
+
+  void WaitAll() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [&]() { return root_path2pending_cnt_.empty(); });
+  }
+
+ private:
+  AsyncSnapshotWriteQueue()
+      : buffered_bytes_(0),
+        max_buffered_bytes_(
+            ParseIntegerFromEnv("ONEFLOW_SNAPSHOT_ASYNC_WRITE_BUFFER_SIZE", int64_t(4) << 30)) {}
+
+  void OnWriteDone(const std::string& root_path, size_t size) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    buffered_bytes_ -= size;
+    // the callbacks run while the last write is still pending, so that Wait covers them
+    while (root_path2pending_cnt_.at(root_path) == 1
+           && root_path2done_callbacks_.count(root_path) > 0) {
+      std::vector<std::function<void()>> callbacks;
+      callbacks.swap(root_path2done_callbacks_.at(root_path));
+      root_path2done_callbacks_.erase(root_path);
+      lock.unlock();
+      for (const auto& Callback : callbacks) { Callback(); }
+      lock.lock();
+    }
+    int64_t& pending_cnt = root_path2pending_cnt_.at(root_path);
+    pending_cnt -= 1;
+    if (pending_cnt == 0) { root_path2pending_cnt_.erase(root_path); }
+    cond_.notify_all();
+  }
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::unique_ptr<ThreadPool> pool_;
+  int64_t buffered_bytes_;
+  const int64_t max_buffered_bytes_;
+  HashMap<std::string, int64_t> root_path2pending_cnt_;
+  HashMap<std::string, std::vector<std::function<void()>>> root_path2done_callbacks_;
+};
+
 }  // namespace
 
 SnapshotReader::SnapshotReader(const std::string& snapshot_root_path)
-    : root_path_(snapshot_root_path) {}
+    : root_path_(snapshot_root_path) {
+  AsyncSnapshotWriteQueue::Get()->Wait(root_path_);
+}
 
 bool SnapshotReader::HasKey(const std::string& key) const {
   const std::string path = GenDataFilePath(root_path_, key);
@@ -53,22 +220,9 @@ void SnapshotReader::Read(const std::string& key, const Shape& logical_blob_shap
   const int64_t logical_blob_size = logical_blob_shape.elem_cnt() * GetSizeOfDataType(data_type);
   CHECK_EQ(SnapshotFS()->GetFileSize(path), logical_blob_size)
       << "unexpected model snapshot size, path: " << path;
-  if (slice.shape().Count(1) == logical_blob_shape.Count(1)) {
-    PersistentInStream in_stream(
-        SnapshotFS(), path,
-        slice.At(0).begin() * slice.shape().Count(1) * GetSizeOfDataType(data_type));
-    in_stream.ReadFully(dst, slice.shape().elem_cnt() * GetSizeOfDataType(data_type));
-  } else {
-    std::vector<char> buffer(logical_blob_size);
-    PersistentInStream in_stream(SnapshotFS(), path);
-    in_stream.ReadFully(buffer.data(), logical_blob_size);
-    TensorSliceCopier copier(slice, logical_blob_slice, data_type, DeviceType::kCPU);
-    auto device = Global<ep::DeviceManagerRegistry>::Get()->GetDevice(DeviceType::kCPU, 0);
-    CHECK(device);
-    auto* stream = device->CreateStream();
-    copier.Copy(stream, dst, buffer.data());
-    device->DestroyStream(stream);
-  }
+  std::unique_ptr<fs::RandomAccessFile> file;
+  SnapshotFS()->NewRandomAccessFile(path, &file);
+  ReadSliceRanges(*file, logical_blob_shape, GetSizeOfDataType(data_type), slice, dst);
 }
 
 void SnapshotReader::Read(const std::string& key, const Shape& logical_blob_shape,
@@ -80,7 +234,13 @@ void SnapshotReader::Read(const std::string& key, const Shape& logical_blob_shap
 void SnapshotReader::Close() {}
 
 SnapshotWriter::SnapshotWriter(const std::string& snapshot_root_path)
-    : root_path_(snapshot_root_path) {
+    : SnapshotWriter(snapshot_root_path,
+                     ParseBooleanFromEnv("ONEFLOW_SNAPSHOT_ASYNC_WRITE", false)) {}
+
+SnapshotWriter::SnapshotWriter(const std::string& snapshot_root_path, bool async)
+    : root_path_(snapshot_root_path),
+      async_(async),
+      sync_(ParseBooleanFromEnv("ONEFLOW_SNAPSHOT_SYNC_WRITE", false)) {
   OfCallOnce("SnapshotWriteCheckRootPath-" + snapshot_root_path, [&]() {
     if (SnapshotFS()->FileExists(snapshot_root_path)) {
       CHECK(SnapshotFS()->IsDirectory(snapshot_root_path))
@@ -98,8 +258,11 @@ void SnapshotWriter::Write(const std::string& key, const char* data, size_t size
   const std::string dir_path = Dirname(path);
   SnapshotFS()->CreateDirIfNotExist(dir_path);
   CHECK(!SnapshotFS()->FileExists(path));
-  PersistentOutStream out_stream(SnapshotFS(), path);
-  out_stream.Write(data, size);
+  if (async_) {
+    AsyncSnapshotWriteQueue::Get()->Write(root_path_, path, data, size, sync_);
+  } else {
+    WriteSnapshotFile(path, data, size, sync_);
+  }
 }
 
 void SnapshotWriter::Write(const std::string& key, const Blob* blob) {
@@ -107,7 +270,16 @@ void SnapshotWriter::Write(const std::string& key, const Blob* blob) {
 }
 
 void SnapshotWriter::Close() {
-  PersistentOutStream out_stream(SnapshotFS(), JoinPath(root_path_, "snapshot_done"));
+  const std::string path = JoinPath(root_path_, "snapshot_done");
+  const bool sync = sync_;
+  const auto WriteDone = [path, sync]() { WriteSnapshotFile(path, nullptr, 0, sync); };
+  if (async_) {
+    AsyncSnapshotWriteQueue::Get()->AddDoneCallback(root_path_, WriteDone);
+  } else {
+    WriteDone();
+  }
 }
 
+void SnapshotWriter::WaitAsyncWrites() { AsyncSnapshotWriteQueue::Get()->WaitAll(); }
+
 }  // namespace oneflow
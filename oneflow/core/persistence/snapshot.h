@@ -43,19 +43,38 @@ class SnapshotReader final {
   const std::string root_path_;
 };
 
+// An asynchronous SnapshotWriter copies the data of Write to a host buffer and returns, the files
+// are written by a background pool. Close returns right away too, snapshot_done is written after
+// all the files of the snapshot are. SnapshotReader waits for the pending writes of its snapshot.
+//
+// Environment variables:
+//   ONEFLOW_SNAPSHOT_ASYNC_WRITE: default of async, false by default. It only affects the legacy
+//     model_save op, ModelSaveV2 always writes synchronously because its part files are read back
+//     right away and its snapshot_done is written by the caller
+//   ONEFLOW_SNAPSHOT_SYNC_WRITE: sync the files to the storage device, like fsync, before
+//     snapshot_done is written, false by default
+//   ONEFLOW_SNAPSHOT_ASYNC_WRITE_THREAD_NUM: threads of the background pool, 4 by default
+//   ONEFLOW_SNAPSHOT_ASYNC_WRITE_BUFFER_SIZE: bytes of data waiting to be written, Write blocks
+//     when they would exceed it, 4GiB by default
 class SnapshotWriter final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(SnapshotWriter);
   SnapshotWriter() = delete;
   explicit SnapshotWriter(const std::string& snapshot_root_path);
+  SnapshotWriter(const std::string& snapshot_root_path, bool async);
   ~SnapshotWriter() = default;
 
   void Write(const std::string& key, const char* data, size_t size);
   void Write(const std::string& key, const Blob* blob);
   void Close();
 
+  // Waits for the pending writes of all asynchronous SnapshotWriters.
+  static void WaitAsyncWrites();
+
  private:
   const std::string root_path_;
+  const bool async_;
+  const bool sync_;
 };
 
 }  // namespace oneflow
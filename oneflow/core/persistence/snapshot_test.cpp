@@ -0,0 +1,238 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "oneflow/core/persistence/snapshot.h"
+#include "oneflow/core/persistence/file_system.h"
+#include "oneflow/core/common/nd_index_offset_helper.h"
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/rpc/include/base.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+std::string TestSnapshotRootPath(const std::string& name) {
+  std::string current_dir = GetCwd();
+  StringReplace(&current_dir, '\\', '/');
+  const std::string root_path = JoinPath(current_dir, "tmp_snapshot_test_" + name);
+  if (SnapshotFS()->IsDirectory(root_path)) { SnapshotFS()->RecursivelyDeleteDir(root_path); }
+  return root_path;
+}
+
+std::vector<float> GenBlob(const Shape& shape) {
+  std::vector<float> blob(shape.elem_cnt());
+  for (int64_t i = 0; i < blob.size(); ++i) { blob[i] = static_cast<float>(i); }
+  return blob;
+}
+
+void WriteBlobFile(const std::string& root_path, const std::string& key,
+                   const std::vector<float>& blob) {
+  std::unique_ptr<fs::WritableFile> file;
+  SnapshotFS()->NewWritableFile(JoinPath(root_path, key), &file);
+  file->Append(reinterpret_cast<const char*>(blob.data()), blob.size() * sizeof(float));
+  file->Close();
+}
+
+// Copies slice out of blob element by element.
+std::vector<float> ReadSliceByElement(const std::vector<float>& blob, const Shape& shape,
+                                      const TensorSliceView& slice) {
+  std::vector<float> out(slice.shape().elem_cnt());
+  const int64_t num_axes = shape.NumAxes();
+  if (num_axes == 0) {
+    out.at(0) = blob.at(0);
+    return out;
+  }
+  NdIndexOffsetHelper<int64_t, SHAPE_MAX_AXIS_SIZE> slice_helper(slice.shape().dim_vec().data(),
+                                                                  num_axes);
+  NdIndexOffsetHelper<int64_t, SHAPE_MAX_AXIS_SIZE> blob_helper(shape.dim_vec().data(), num_axes);
+  int64_t index[SHAPE_MAX_AXIS_SIZE];
+  for (int64_t i = 0; i < out.size(); ++i) {
+    slice_helper.OffsetToNdIndex(i, index, num_axes);
+    for (int64_t axis = 0; axis < num_axes; ++axis) { index[axis] += slice.At(axis).begin(); }
+    out.at(i) = blob.at(blob_helper.NdIndexToOffset(index, num_axes));
+  }
+  return out;
+}
+
+void TestReadSlice(const SnapshotReader& reader, const std::string& key,
+                   const std::vector<float>& blob, const Shape& shape,
+                   const TensorSliceView& slice) {
+  std::vector<float> out(slice.shape().elem_cnt());
+  reader.Read(key, shape, DataType::kFloat, slice, reinterpret_cast<char*>(out.data()));
+  ASSERT_EQ(out, ReadSliceByElement(blob, shape, slice));
+}
+
+// SnapshotWriter creates its root directory through OfCallOnce, which only needs TryLock and
+// NotifyDone of a single process.
+class SingleProcessCtrlClient final : public CtrlClient {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(SingleProcessCtrlClient);
+  SingleProcessCtrlClient() = default;
+  ~SingleProcessCtrlClient() override = default;
+
+  TryLockResult TryLock(const std::string& name) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return done_names_.emplace(name).second ? TryLockResult::kLocked : TryLockResult::kDone;
+  }
+  void NotifyDone(const std::string& name) override {}
+  void WaitUntilDone(const std::string& name) override {}
+
+  void Barrier(const std::string& barrier_name) override { UNIMPLEMENTED(); }
+  void Barrier(const std::string& barrier_name, int32_t barrier_num) override { UNIMPLEMENTED(); }
+  void PushKV(const std::string& k, std::function<void(std::string*)> VSetter) override {
+    UNIMPLEMENTED();
+  }
+  void PushKV(const std::string& k, const std::string& v) override { UNIMPLEMENTED(); }
+  void PushKV(const std::string& k, const PbMessage& msg) override { UNIMPLEMENTED(); }
+  void PushMasterKV(const std::string& k, const PbMessage& msg) override { UNIMPLEMENTED(); }
+  void ClearKV(const std::string& k) override { UNIMPLEMENTED(); }
+  void ClearMasterKV(const std::string& k) override { UNIMPLEMENTED(); }
+  void PullKV(const std::string& k, std::function<void(const std::string&)> VGetter) override {
+    UNIMPLEMENTED();
+  }
+  void PullKV(const std::string& k, std::string* v) override { UNIMPLEMENTED(); }
+  void PullKV(const std::string& k, PbMessage* msg) override { UNIMPLEMENTED(); }
+  void PullMasterKV(const std::string& k, PbMessage* msg) override { UNIMPLEMENTED(); }
+  void Clear() override { UNIMPLEMENTED(); }
+  int32_t IncreaseCount(const std::string& k, int32_t v) override {
+    UNIMPLEMENTED();
+    return 0;
+  }
+  void EraseCount(const std::string& k) override { UNIMPLEMENTED(); }
+
+ private:
+  std::mutex mutex_;
+  HashSet<std::string> done_names_;
+};
+
+constexpr int64_t kNumAsyncFiles = 16;
+constexpr int64_t kAsyncFileElemCnt = 256 * 1024;
+
+std::string AsyncFileKey(int64_t i) { return "var_" + std::to_string(i) + "/out"; }
+
+// Writes kNumAsyncFiles files with an asynchronous SnapshotWriter and closes it, the writes are
+// still pending when it returns.
+void WriteAsyncSnapshot(const std::string& root_path, const std::vector<float>& blob) {
+  SnapshotWriter writer(root_path, true);
+  FOR_RANGE(int64_t, i, 0, kNumAsyncFiles) {
+    writer.Write(AsyncFileKey(i), reinterpret_cast<const char*>(blob.data()),
+                 blob.size() * sizeof(float));
+  }
+  writer.Close();
+}
+
+bool IsSnapshotDone(const std::string& root_path) {
+  return SnapshotFS()->FileExists(JoinPath(root_path, "snapshot_done"));
+}
+
+void CheckAsyncSnapshotFiles(const std::string& root_path) {
+  FOR_RANGE(int64_t, i, 0, kNumAsyncFiles) {
+    const std::string path = JoinPath(root_path, AsyncFileKey(i));
+    ASSERT_TRUE(SnapshotFS()->FileExists(path));
+    ASSERT_EQ(SnapshotFS()->GetFileSize(path), kAsyncFileElemCnt * sizeof(float));
+  }
+}
+
+class AsyncSnapshotWriterTest : public testing::Test {
+ protected:
+  void SetUp() override { Global<CtrlClient>::SetAllocated(new SingleProcessCtrlClient()); }
+  void TearDown() override {
+    SnapshotWriter::WaitAsyncWrites();
+    Global<CtrlClient>::Delete();
+  }
+};
+
+}  // namespace
+
+TEST(SnapshotReader, read_slice) {
+  const std::string root_path = TestSnapshotRootPath("read_slice");
+  const Shape shape_3d({4, 5, 6});
+  const Shape shape_2d({16, 2048});
+  const Shape shape_0d(DimVector{});
+  const Shape shape_1x1({1, 1});
+  const std::vector<float> blob_3d = GenBlob(shape_3d);
+  const std::vector<float> blob_2d = GenBlob(shape_2d);
+  const std::vector<float> blob_0d = GenBlob(shape_0d);
+  const std::vector<float> blob_1x1 = GenBlob(shape_1x1);
+  SnapshotFS()->RecursivelyCreateDir(root_path);
+  WriteBlobFile(root_path, "blob_3d", blob_3d);
+  WriteBlobFile(root_path, "blob_2d", blob_2d);
+  WriteBlobFile(root_path, "blob_0d", blob_0d);
+  WriteBlobFile(root_path, "blob_1x1", blob_1x1);
+  SnapshotReader reader(root_path);
+  // full slice, one range
+  TestReadSlice(reader, "blob_3d", blob_3d, shape_3d, TensorSliceView(shape_3d));
+  // partial slice on the inner axis, ranges merged over small gaps
+  TestReadSlice(reader, "blob_3d", blob_3d, shape_3d, TensorSliceView({{0, 4}, {0, 5}, {1, 4}}));
+  // partial slice on an outer axis, one contiguous range
+  TestReadSlice(reader, "blob_3d", blob_3d, shape_3d, TensorSliceView({{1, 3}, {0, 5}, {0, 6}}));
+  // partial slices on the middle axis and on all axes
+  TestReadSlice(reader, "blob_3d", blob_3d, shape_3d, TensorSliceView({{0, 4}, {2, 3}, {0, 6}}));
+  TestReadSlice(reader, "blob_3d", blob_3d, shape_3d, TensorSliceView({{1, 4}, {1, 3}, {2, 5}}));
+  // partial slice on the inner axis with gaps longer than a page, ranges read one by one
+  TestReadSlice(reader, "blob_2d", blob_2d, shape_2d, TensorSliceView({{0, 16}, {100, 200}}));
+  TestReadSlice(reader, "blob_2d", blob_2d, shape_2d, TensorSliceView({{3, 11}, {1024, 2048}}));
+  TestReadSlice(reader, "blob_2d", blob_2d, shape_2d, TensorSliceView({{5, 6}, {7, 8}}));
+  // 0-d and single-element blobs
+  TestReadSlice(reader, "blob_0d", blob_0d, shape_0d, TensorSliceView(shape_0d));
+  TestReadSlice(reader, "blob_1x1", blob_1x1, shape_1x1, TensorSliceView(shape_1x1));
+  SnapshotFS()->RecursivelyDeleteDir(root_path);
+}
+
+TEST_F(AsyncSnapshotWriterTest, snapshot_done_after_all_files) {
+  const std::string root_path = TestSnapshotRootPath("snapshot_done_after_all_files");
+  const std::vector<float> blob = GenBlob(Shape({kAsyncFileElemCnt}));
+  WriteAsyncSnapshot(root_path, blob);
+  // whenever snapshot_done shows up, all the files of the snapshot are complete
+  while (!IsSnapshotDone(root_path)) { std::this_thread::yield(); }
+  CheckAsyncSnapshotFiles(root_path);
+  SnapshotFS()->RecursivelyDeleteDir(root_path);
+}
+
+TEST_F(AsyncSnapshotWriterTest, reader_waits_for_pending_writes) {
+  const std::string root_path = TestSnapshotRootPath("reader_waits_for_pending_writes");
+  const Shape shape({kAsyncFileElemCnt});
+  const std::vector<float> blob = GenBlob(shape);
+  WriteAsyncSnapshot(root_path, blob);
+  SnapshotReader reader(root_path);
+  ASSERT_TRUE(IsSnapshotDone(root_path));
+  FOR_RANGE(int64_t, i, 0, kNumAsyncFiles) {
+    TestReadSlice(reader, AsyncFileKey(i), blob, shape, TensorSliceView(shape));
+  }
+  SnapshotFS()->RecursivelyDeleteDir(root_path);
+}
+
+TEST_F(AsyncSnapshotWriterTest, wait_async_writes) {
+  const std::string root_path_0 = TestSnapshotRootPath("wait_async_writes_0");
+  const std::string root_path_1 = TestSnapshotRootPath("wait_async_writes_1");
+  const std::vector<float> blob = GenBlob(Shape({kAsyncFileElemCnt}));
+  WriteAsyncSnapshot(root_path_0, blob);
+  WriteAsyncSnapshot(root_path_1, blob);
+  SnapshotWriter::WaitAsyncWrites();
+  ASSERT_TRUE(IsSnapshotDone(root_path_0));
+  ASSERT_TRUE(IsSnapshotDone(root_path_1));
+  CheckAsyncSnapshotFiles(root_path_0);
+  CheckAsyncSnapshotFiles(root_path_1);
+  SnapshotFS()->RecursivelyDeleteDir(root_path_0);
+  SnapshotFS()->RecursivelyDeleteDir(root_path_1);
+}
+
+}  // namespace test
+
+}  // namespace oneflow
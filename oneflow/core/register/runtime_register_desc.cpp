@@ -22,6 +22,10 @@ RtRegstDesc::RtRegstDesc(const RegstDescProto& proto) {
   regst_desc_id_ = proto.regst_desc_id();
   producer_actor_id_ = proto.producer_task_id();
   consumers_actor_id_ = PbRf2StdVec(proto.consumer_task_id());
+  consumer_comm_net_sequence_numbers_.reset(new std::atomic<int64_t>[consumers_actor_id_.size()]);
+  for (size_t i = 0; i < consumers_actor_id_.size(); ++i) {
+    consumer_comm_net_sequence_numbers_[i].store(0, std::memory_order_relaxed);
+  }
   register_num_ = proto.register_num();
   mem_case_ = proto.mem_case();
   regst_desc_type_ = proto.regst_desc_type();
@@ -54,6 +58,17 @@ RtRegstDesc::RtRegstDesc(const RegstDescProto& proto) {
   }
 }
 
+int64_t RtRegstDesc::NextCommNetSequenceNumber(int64_t consumer_actor_id) const {
+  for (size_t i = 0; i < consumers_actor_id_.size(); ++i) {
+    if (consumers_actor_id_[i] == consumer_actor_id) {
+      return consumer_comm_net_sequence_numbers_[i].fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  LOG(FATAL) << "actor " << consumer_actor_id << " does not consume regst desc "
+             << regst_desc_id_;
+  return -1;
+}
+
 int64_t RtRegstDesc::GetOrdinalForLbi(const LogicalBlobId& lbi) const {
   auto it = lbi2blob_desc_ordinal_.find(lbi);
   if (it != lbi2blob_desc_ordinal_.cend()) {
@@ -49,6 +49,9 @@ class RtRegstDesc {
   size_t SeparatedHeaderByteSize4OneRegst() const;
   size_t MainByteSize4OneRegst() const;
   const Shape& data_regst_time_shape() const;
+  // Numbers the data regst messages sent to a consumer on another machine, which processes them
+  // in this order.
+  int64_t NextCommNetSequenceNumber(int64_t consumer_actor_id) const;
 
   void ForEachBlobDescOffsetInOnRegst(
       const std::function<void(int64_t ordinal, const LogicalBlobId& lbi, const BlobDesc* desc,
@@ -58,6 +61,8 @@ class RtRegstDesc {
   int64_t regst_desc_id_;
   int64_t producer_actor_id_;
   std::vector<int64_t> consumers_actor_id_;
+  // one counter for each consumer in consumers_actor_id_
+  mutable std::unique_ptr<std::atomic<int64_t>[]> consumer_comm_net_sequence_numbers_;
   int64_t register_num_;
   RegstDescTypeProto regst_desc_type_;
   MemoryCase mem_case_;
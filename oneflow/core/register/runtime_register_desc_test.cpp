@@ -0,0 +1,102 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/register/runtime_register_desc.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <thread>
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+RegstDescProto CtrlRegstDescProto(const std::vector<int64_t>& consumers) {
+  RegstDescProto proto;
+  proto.set_regst_desc_id(7);
+  proto.set_producer_task_id(1);
+  for (int64_t consumer : consumers) { proto.add_consumer_task_id(consumer); }
+  proto.set_min_register_num(1);
+  proto.set_max_register_num(1);
+  proto.set_register_num(1);
+  proto.mutable_mem_case()->mutable_host_mem();
+  proto.mutable_regst_desc_type()->mutable_ctrl_regst_desc();
+  proto.set_enable_reuse_mem(false);
+  proto.set_mem_block_id(-1);
+  proto.set_mem_block_offset(-1);
+  return proto;
+}
+
+}  // namespace
+
+TEST(RtRegstDesc, comm_net_sequence_number_starts_at_zero) {
+  RtRegstDesc regst_desc(CtrlRegstDescProto({10, 20, 30}));
+  ASSERT_EQ(regst_desc.NextCommNetSequenceNumber(30), 0);
+  ASSERT_EQ(regst_desc.NextCommNetSequenceNumber(10), 0);
+  ASSERT_EQ(regst_desc.NextCommNetSequenceNumber(20), 0);
+  ASSERT_EQ(regst_desc.NextCommNetSequenceNumber(10), 1);
+}
+
+TEST(RtRegstDesc, comm_net_sequence_number_per_consumer) {
+  RtRegstDesc regst_desc(CtrlRegstDescProto({10, 20, 30}));
+  for (int64_t i = 0; i < 5; ++i) { ASSERT_EQ(regst_desc.NextCommNetSequenceNumber(20), i); }
+  ASSERT_EQ(regst_desc.NextCommNetSequenceNumber(10), 0);
+  ASSERT_EQ(regst_desc.NextCommNetSequenceNumber(30), 0);
+  ASSERT_EQ(regst_desc.NextCommNetSequenceNumber(20), 5);
+  ASSERT_EQ(regst_desc.NextCommNetSequenceNumber(30), 1);
+}
+
+TEST(RtRegstDesc, comm_net_sequence_number_concurrent_senders) {
+  const std::vector<int64_t> consumers{10, 20, 30};
+  RtRegstDesc regst_desc(CtrlRegstDescProto(consumers));
+  constexpr int kThreadNum = 8;
+  constexpr int kNumbersPerThread = 2000;
+  // numbers[thread][consumer] holds what that thread got for that consumer
+  std::vector<std::vector<std::vector<int64_t>>> numbers(
+      kThreadNum, std::vector<std::vector<int64_t>>(consumers.size()));
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreadNum; ++t) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < kNumbersPerThread; ++i) {
+        // every thread sends to every consumer, starting from a different one
+        const size_t c = (t + i) % consumers.size();
+        numbers[t][c].push_back(regst_desc.NextCommNetSequenceNumber(consumers[c]));
+      }
+    });
+  }
+  for (auto& thread : threads) { thread.join(); }
+  int64_t total = 0;
+  for (size_t c = 0; c < consumers.size(); ++c) {
+    std::vector<int64_t> all;
+    for (int t = 0; t < kThreadNum; ++t) {
+      // a single sender sees its own numbers increase
+      ASSERT_TRUE(std::is_sorted(numbers[t][c].begin(), numbers[t][c].end()));
+      all.insert(all.end(), numbers[t][c].begin(), numbers[t][c].end());
+    }
+    std::sort(all.begin(), all.end());
+    for (size_t i = 0; i < all.size(); ++i) {
+      ASSERT_EQ(all[i], static_cast<int64_t>(i)) << "consumer " << c;
+    }
+    ASSERT_EQ(regst_desc.NextCommNetSequenceNumber(consumers[c]),
+              static_cast<int64_t>(all.size()));
+    total += all.size();
+  }
+  ASSERT_EQ(total, kThreadNum * kNumbersPerThread);
+}
+
+}  // namespace test
+
+}  // namespace oneflow
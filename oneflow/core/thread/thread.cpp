@@ -23,7 +23,15 @@ limitations under the License.
 
 namespace oneflow {
 
-Thread::Thread(const StreamId& stream_id) : thrd_id_(EncodeStreamIdToInt64(stream_id)) {
+namespace {
+
+thread_local Thread* current_thread = nullptr;
+
+}  // namespace
+
+Thread::Thread(const StreamId& stream_id)
+    : msg_channel_(ParseIntegerFromEnv("ONEFLOW_THREAD_MSG_CHANNEL_CAPACITY", 16384)),
+      thrd_id_(EncodeStreamIdToInt64(stream_id)) {
   local_msg_queue_enabled_ =
       ParseBooleanFromEnv("ONEFLOW_THREAD_ENABLE_LOCAL_MESSAGE_QUEUE", false);
   light_actor_enabled_ = ParseBooleanFromEnv("ONEFLOW_ACTOR_ENABLE_LIGHT_ACTOR", false);
@@ -34,6 +42,7 @@ Thread::Thread(const StreamId& stream_id) : thrd_id_(EncodeStreamIdToInt64(strea
     OF_PROFILER_NAME_THIS_HOST_THREAD("_" + DeviceTypeName(stream_id.device_id().device_type())
                                       + std::to_string(stream_id.device_id().device_index())
                                       + "_actor");
+    current_thread = this;
     CHECK_JUST(stream_ctx_->stream()->OnExecutionContextSetup());
     PollMsgChannel();
     CHECK_JUST(stream_ctx_->stream()->OnExecutionContextTeardown());
@@ -44,8 +53,15 @@ Thread::~Thread() {
   actor_thread_.join();
   CHECK(id2task_.empty());
   msg_channel_.Close();
+  const MpscChannelStats& stats = msg_channel_.stats();
+  LOG(INFO) << "thread " << thrd_id_ << " received " << stats.item_cnt << " msgs in "
+            << stats.receive_cnt << " batches, max queue depth " << stats.max_depth << ", waited "
+            << stats.wait_cnt << " times (" << stats.sleep_cnt << " asleep) for "
+            << stats.wait_ns / 1000000 << " ms";
 }
 
+Thread* Thread::Current() { return current_thread; }
+
 void Thread::AddTask(const TaskProto& task) {
   std::unique_lock<std::mutex> lck(id2task_mtx_);
   CHECK(id2task_.emplace(task.task_id(), task).second);
@@ -17,7 +17,7 @@ limitations under the License.
 #define ONEFLOW_CORE_THREAD_THREAD_H_
 
 #include "oneflow/core/lazy/actor/actor_message_bus.h"
-#include "oneflow/core/common/channel.h"
+#include "oneflow/core/common/mpsc_channel.h"
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/job/task.pb.h"
 #include "oneflow/core/lazy/actor/actor.h"
@@ -35,13 +35,13 @@ class Thread {
 
   void AddTask(const TaskProto&);
 
-  Channel<ActorMsg>* GetMsgChannelPtr() { return &msg_channel_; }
+  MpscChannel<ActorMsg>* GetMsgChannelPtr() { return &msg_channel_; }
 
   inline void EnqueueActorMsg(const ActorMsg& msg) {
     if (UseLocalMsgQueue()) {
       local_msg_queue_.push(msg);
     } else {
-      msg_channel_.Send(msg);
+      SendToMsgChannel(&msg, &msg + 1);
     }
   }
 
@@ -50,7 +50,7 @@ class Thread {
     if (UseLocalMsgQueue()) {
       for (auto it = first; it != last; ++it) { local_msg_queue_.push(*it); }
     } else {
-      for (auto it = first; it != last; ++it) { msg_channel_.Send(*it); }
+      SendToMsgChannel(first, last);
     }
   }
 
@@ -64,11 +64,30 @@ class Thread {
     return local_msg_queue_enabled_ && std::this_thread::get_id() == actor_thread_.get_id();
   }
 
+  template<typename ForwardIt>
+  inline void SendToMsgChannel(ForwardIt first, ForwardIt last) {
+    while (true) {
+      first = msg_channel_.TrySendMany(first, last);
+      if (first == last) { break; }
+      CHECK(!msg_channel_.is_closed());
+      // The channel is full. An actor thread keeps draining its own channel into its local queue
+      // meanwhile, so actor threads sending to each other or to themselves can not deadlock.
+      Thread* current = Current();
+      if (current == nullptr
+          || current->msg_channel_.TryReceiveMany(&current->local_msg_queue_) == 0) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  // the Thread whose actor thread is the caller, nullptr for other threads
+  static Thread* Current();
+
   HashMap<int64_t, TaskProto> id2task_;
   std::mutex id2task_mtx_;
 
   std::thread actor_thread_;
-  Channel<ActorMsg> msg_channel_;
+  MpscChannel<ActorMsg> msg_channel_;
   HashMap<int64_t, std::pair<std::unique_ptr<ActorContext>, std::unique_ptr<ActorBase>>>
       id2actor_ptr_;
   HashMap<int64_t, int64_t> id2job_id_;
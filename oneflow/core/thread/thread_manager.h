@@ -54,20 +54,10 @@ void MultiThreadLoop(size_t num, const DoEachT& DoEach) {
     SingleThreadLoop(num, DoEach);
     return;
   }
-  size_t thread_num = Global<ThreadPool>::Get()->thread_num();
-  thread_num = std::min(num, thread_num);
-  BalancedSplitter bs(num, thread_num);
-  BlockingCounter bc(thread_num);
-  FOR_RANGE(size_t, range_id, 0, thread_num) {
-    Global<ThreadPool>::Get()->AddWork([&bc, &bs, range_id, DoEach] {
-      size_t start = bs.At(range_id).begin();
-      size_t end = bs.At(range_id).end();
-      FOR_RANGE(size_t, i, start, end) { DoEach(i); }
-      bc.Decrease();
-    });
-  }
-  // buzy loop wait.
-  bc.WaitUntilCntEqualZero();
+  // chunks are claimed dynamically by the pool, so slow items don't stall a fixed partition
+  Global<ThreadPool>::Get()->ParallelFor(Range(0, num), 1, [&DoEach](const Range& range) {
+    FOR_RANGE(size_t, i, range.begin(), range.end()) { DoEach(i); }
+  });
 }
 
 }  // namespace oneflow
@@ -13,32 +13,238 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 */
+#include <array>
 #include "oneflow/core/thread/thread_pool.h"
+#include "oneflow/core/common/blocking_counter.h"
 
 namespace oneflow {
 
+namespace {
+
+constexpr int32_t kSpinCountBeforePark = 1024;
+constexpr int64_t kChunkNumPerThread = 4;
+
+struct WorkerCtx {
+  const ThreadPool* pool = nullptr;
+  int32_t worker_id = -1;
+};
+
+thread_local WorkerCtx worker_ctx;
+
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#else
+  std::this_thread::yield();
+#endif
+}
+
+}  // namespace
+
+// Bounded Chase-Lev deque, see "Correct and Efficient Work-Stealing for Weak Memory Models",
+// Le et al., PPoPP'13. Only the owner calls Push/Pop, any thread may call Steal.
+class ThreadPool::WorkStealingDeque final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(WorkStealingDeque);
+  WorkStealingDeque() : top_(0), bottom_(0) {
+    for (auto& task : buffer_) { task.store(nullptr, std::memory_order_relaxed); }
+  }
+  ~WorkStealingDeque() = default;
+
+  // Return false if the deque is full.
+  bool Push(Task* task) {
+    const int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    const int64_t top = top_.load(std::memory_order_acquire);
+    if (bottom - top >= kCapacity) { return false; }
+    buffer_[bottom & kIndexMask].store(task, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  Task* Pop() {
+    const int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    bottom_.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = top_.load(std::memory_order_relaxed);
+    if (top > bottom) {
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    Task* task = buffer_[bottom & kIndexMask].load(std::memory_order_relaxed);
+    if (top == bottom) {
+      // the last task, race with thieves
+      if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                        std::memory_order_relaxed)) {
+        task = nullptr;
+      }
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return task;
+  }
+
+  Task* Steal() {
+    int64_t top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t bottom = bottom_.load(std::memory_order_acquire);
+    if (top >= bottom) { return nullptr; }
+    Task* task = buffer_[top & kIndexMask].load(std::memory_order_acquire);
+    if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return task;
+  }
+
+ private:
+  static constexpr int64_t kCapacity = 4096;
+  static constexpr int64_t kIndexMask = kCapacity - 1;
+
+  std::atomic<int64_t> top_;
+  // keep top_ and bottom_ on different cache lines
+  char padding_[64 - sizeof(std::atomic<int64_t>)];
+  std::atomic<int64_t> bottom_;
+  std::array<std::atomic<Task*>, kCapacity> buffer_;
+};
+
 ThreadPool::ThreadPool(int32_t thread_num)
-    : work_chans_(thread_num), threads_(thread_num), work_cnt_(0) {
+    : threads_(thread_num), pending_task_cnt_(0), sleeping_thread_cnt_(0), is_closed_(false) {
+  FOR_RANGE(int32_t, i, 0, thread_num) { deques_.emplace_back(new WorkStealingDeque()); }
   FOR_RANGE(int32_t, i, 0, thread_num) {
-    Channel<std::function<void()>>* chan = &(work_chans_.at(i));
-    threads_[i] = std::thread([chan]() {
-      std::function<void()> work;
-      while (chan->Receive(&work) == kChannelStatusSuccess) { work(); }
-    });
+    threads_[i] = std::thread([this, i]() { WorkerLoop(i); });
   }
 }
 
 ThreadPool::~ThreadPool() {
-  FOR_RANGE(int32_t, i, 0, work_chans_.size()) {
-    work_chans_.at(i).Close();
-    threads_.at(i).join();
+  {
+    std::unique_lock<std::mutex> lock(park_mutex_);
+    is_closed_ = true;
   }
+  park_cond_.notify_all();
+  for (auto& thread : threads_) { thread.join(); }
+  CHECK(shared_queue_.empty());
+}
+
+int32_t ThreadPool::CurrentWorkerId() const {
+  return worker_ctx.pool == this ? worker_ctx.worker_id : -1;
 }
 
 void ThreadPool::AddWork(const std::function<void()>& work) {
-  const size_t cur_chan_idx =
-      work_cnt_.fetch_add(1, std::memory_order_relaxed) % work_chans_.size();
-  work_chans_.at(cur_chan_idx).Send(work);
+  Task* task = new Task(work);
+  const int32_t worker_id = CurrentWorkerId();
+  if (worker_id < 0 || !deques_.at(worker_id)->Push(task)) {
+    std::unique_lock<std::mutex> lock(shared_queue_mutex_);
+    shared_queue_.push_back(task);
+  }
+  pending_task_cnt_.fetch_add(1, std::memory_order_seq_cst);
+  NotifyWorkerIfSleeping();
+}
+
+void ThreadPool::NotifyWorkerIfSleeping() {
+  // Pairs with the seq_cst increment of sleeping_thread_cnt_ in WorkerLoop: either the worker
+  // sees the pending task, or we see the sleeping worker and notify it under park_mutex_.
+  if (sleeping_thread_cnt_.load(std::memory_order_seq_cst) > 0) {
+    std::unique_lock<std::mutex> lock(park_mutex_);
+    park_cond_.notify_one();
+  }
+}
+
+ThreadPool::Task* ThreadPool::TrySteal(int32_t worker_id) {
+  const int32_t deque_num = deques_.size();
+  // start from a different victim for every worker to spread contention
+  const int32_t offset = worker_id < 0 ? 0 : worker_id + 1;
+  FOR_RANGE(int32_t, i, 0, deque_num) {
+    const int32_t victim = (offset + i) % deque_num;
+    if (victim == worker_id) { continue; }
+    Task* task = deques_.at(victim)->Steal();
+    if (task != nullptr) { return task; }
+  }
+  return nullptr;
+}
+
+ThreadPool::Task* ThreadPool::TryGetTask(int32_t worker_id) {
+  Task* task = worker_id >= 0 ? deques_.at(worker_id)->Pop() : nullptr;
+  if (task == nullptr) {
+    std::unique_lock<std::mutex> lock(shared_queue_mutex_);
+    if (!shared_queue_.empty()) {
+      task = shared_queue_.front();
+      shared_queue_.pop_front();
+    }
+  }
+  if (task == nullptr) { task = TrySteal(worker_id); }
+  if (task != nullptr) { pending_task_cnt_.fetch_sub(1, std::memory_order_relaxed); }
+  return task;
+}
+
+void ThreadPool::RunTask(Task* task) {
+  (*task)();
+  delete task;
+}
+
+void ThreadPool::WorkerLoop(int32_t worker_id) {
+  worker_ctx.pool = this;
+  worker_ctx.worker_id = worker_id;
+  while (true) {
+    Task* task = TryGetTask(worker_id);
+    if (task != nullptr) {
+      RunTask(task);
+      continue;
+    }
+    bool has_pending_task = false;
+    FOR_RANGE(int32_t, i, 0, kSpinCountBeforePark) {
+      if (pending_task_cnt_.load(std::memory_order_relaxed) > 0) {
+        has_pending_task = true;
+        break;
+      }
+      CpuRelax();
+    }
+    if (has_pending_task) { continue; }
+    std::unique_lock<std::mutex> lock(park_mutex_);
+    sleeping_thread_cnt_.fetch_add(1, std::memory_order_seq_cst);
+    park_cond_.wait(lock, [this]() {
+      return is_closed_ || pending_task_cnt_.load(std::memory_order_seq_cst) > 0;
+    });
+    sleeping_thread_cnt_.fetch_sub(1, std::memory_order_relaxed);
+    if (is_closed_ && pending_task_cnt_.load(std::memory_order_seq_cst) == 0) { break; }
+  }
+  worker_ctx = WorkerCtx();
+}
+
+void ThreadPool::ParallelFor(const Range& range, int64_t grain,
+                             const std::function<void(const Range&)>& DoEachRange) {
+  const int64_t size = range.size();
+  if (size <= 0) { return; }
+  const int64_t max_chunk_num = std::max<int64_t>(thread_num(), 1) * kChunkNumPerThread;
+  const int64_t chunk_size = std::max<int64_t>(grain, RoundUp(size, max_chunk_num) / max_chunk_num);
+  const int64_t chunk_num = RoundUp(size, chunk_size) / chunk_size;
+  if (chunk_num == 1 || thread_num() == 0) {
+    DoEachRange(range);
+    return;
+  }
+  struct ForkJoinCtx {
+    ForkJoinCtx() : next_chunk(0), done_chunk_cnt(0), bc(1) {}
+    std::atomic<int64_t> next_chunk;
+    std::atomic<int64_t> done_chunk_cnt;
+    BlockingCounter bc;
+  };
+  // helpers may start after ParallelFor returns, so they share the ctx instead of the stack
+  auto ctx = std::make_shared<ForkJoinCtx>();
+  const auto& RunChunks = [ctx, chunk_num, chunk_size, range, &DoEachRange]() {
+    while (true) {
+      const int64_t chunk = ctx->next_chunk.fetch_add(1, std::memory_order_relaxed);
+      if (chunk >= chunk_num) { break; }
+      const int64_t begin = range.begin() + chunk * chunk_size;
+      DoEachRange(Range(begin, std::min(begin + chunk_size, range.end())));
+      if (ctx->done_chunk_cnt.fetch_add(1, std::memory_order_acq_rel) + 1 == chunk_num) {
+        ctx->bc.Decrease();
+      }
+    }
+  };
+  // DoEachRange is only touched for claimed chunks, which all finish before ParallelFor returns
+  const int64_t helper_num = std::min<int64_t>(thread_num(), chunk_num - 1);
+  FOR_RANGE(int64_t, i, 0, helper_num) { AddWork(RunChunks); }
+  RunChunks();
+  ctx->bc.WaitUntilCntEqualZero();
 }
 
 }  // namespace oneflow
@@ -16,11 +16,17 @@ limitations under the License.
 #ifndef ONEFLOW_CORE_THREAD_THREAD_POOL_H_
 #define ONEFLOW_CORE_THREAD_THREAD_POOL_H_
 
+#include <deque>
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/common/channel.h"
+#include "oneflow/core/common/range.h"
 
 namespace oneflow {
 
+// ThreadPool is a work-stealing scheduler. Every worker owns a bounded lock-free deque: work
+// added by a worker is pushed to its own deque and popped LIFO, idle workers steal FIFO from the
+// others. Work added by non-worker threads goes through a shared FIFO queue, so a pool of one
+// thread runs external work in submission order. Idle workers spin for a while before parking.
 class ThreadPool final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(ThreadPool);
@@ -31,11 +37,37 @@ class ThreadPool final {
   int32_t thread_num() const { return threads_.size(); }
   void AddWork(const std::function<void()>& work);
 
+  // Fork-join loop: split range into chunks of at least grain elements, run DoEachRange on them
+  // in the pool and the calling thread, and return when all chunks are done. Chunks are claimed
+  // dynamically, so uneven chunk costs are balanced between threads. Safe to nest.
+  void ParallelFor(const Range& range, int64_t grain,
+                   const std::function<void(const Range&)>& DoEachRange);
+
  private:
-  std::vector<Channel<std::function<void()>>> work_chans_;
+  using Task = std::function<void()>;
+  class WorkStealingDeque;
+
+  void WorkerLoop(int32_t worker_id);
+  // Try to get a task from the own deque, the shared queue, then the deques of others.
+  Task* TryGetTask(int32_t worker_id);
+  Task* TrySteal(int32_t worker_id);
+  void RunTask(Task* task);
+  void NotifyWorkerIfSleeping();
+  // Worker index of the calling thread in this pool, -1 if it isn't a worker of this pool.
+  int32_t CurrentWorkerId() const;
+
+  std::vector<std::unique_ptr<WorkStealingDeque>> deques_;
   std::vector<std::thread> threads_;
 
-  std::atomic<size_t> work_cnt_;
+  std::mutex shared_queue_mutex_;
+  std::deque<Task*> shared_queue_;
+
+  // number of tasks pushed but not popped yet, used to decide whether to park
+  std::atomic<int64_t> pending_task_cnt_;
+  std::atomic<int32_t> sleeping_thread_cnt_;
+  std::mutex park_mutex_;
+  std::condition_variable park_cond_;
+  bool is_closed_;
 };
 
 }  // namespace oneflow
@@ -0,0 +1,88 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/thread/thread_pool.h"
+#include "oneflow/core/common/blocking_counter.h"
+
+namespace oneflow {
+
+TEST(ThreadPool, add_work) {
+  ThreadPool thread_pool(4);
+  std::atomic<int64_t> sum(0);
+  BlockingCounter bc(1000);
+  for (int64_t i = 0; i < 1000; ++i) {
+    thread_pool.AddWork([i, &sum, &bc]() {
+      sum += i;
+      bc.Decrease();
+    });
+  }
+  bc.WaitUntilCntEqualZero();
+  ASSERT_EQ(sum, 999 * 1000 / 2);
+}
+
+TEST(ThreadPool, single_thread_keeps_order) {
+  ThreadPool thread_pool(1);
+  std::vector<int64_t> order;
+  BlockingCounter bc(100);
+  for (int64_t i = 0; i < 100; ++i) {
+    thread_pool.AddWork([i, &order, &bc]() {
+      order.push_back(i);
+      bc.Decrease();
+    });
+  }
+  bc.WaitUntilCntEqualZero();
+  for (int64_t i = 0; i < 100; ++i) { ASSERT_EQ(order.at(i), i); }
+}
+
+TEST(ThreadPool, parallel_for) {
+  ThreadPool thread_pool(4);
+  std::vector<int32_t> visits(10007, 0);
+  thread_pool.ParallelFor(Range(7, 10007), 16, [&](const Range& range) {
+    ASSERT_GE(range.size(), 1);
+    for (int64_t i = range.begin(); i < range.end(); ++i) { visits.at(i) += 1; }
+  });
+  for (int64_t i = 0; i < 10007; ++i) { ASSERT_EQ(visits.at(i), i < 7 ? 0 : 1); }
+}
+
+TEST(ThreadPool, nested_parallel_for) {
+  ThreadPool thread_pool(2);
+  std::atomic<int64_t> cnt(0);
+  thread_pool.ParallelFor(Range(0, 64), 1, [&](const Range& outer) {
+    for (int64_t i = outer.begin(); i < outer.end(); ++i) {
+      thread_pool.ParallelFor(Range(0, 64), 1, [&](const Range& inner) { cnt += inner.size(); });
+    }
+  });
+  ASSERT_EQ(cnt, 64 * 64);
+}
+
+TEST(ThreadPool, work_added_by_worker) {
+  ThreadPool thread_pool(3);
+  std::atomic<int64_t> cnt(0);
+  BlockingCounter bc(100 * 10);
+  for (int64_t i = 0; i < 100; ++i) {
+    thread_pool.AddWork([&]() {
+      for (int64_t j = 0; j < 10; ++j) {
+        thread_pool.AddWork([&]() {
+          cnt += 1;
+          bc.Decrease();
+        });
+      }
+    });
+  }
+  bc.WaitUntilCntEqualZero();
+  ASSERT_EQ(cnt, 1000);
+}
+
+}  // namespace oneflow
@@ -14,17 +14,254 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include <cstdlib>
+#include <limits>
 #include "oneflow/core/vm/cpu_allocator.h"
 #include "oneflow/core/common/util.h"
 
 namespace oneflow {
 namespace vm {
 
+namespace {
+
+constexpr size_t kLinearBinMaxSize = 512;
+constexpr int32_t kLinearBinNumSize = kLinearBinMaxSize / kHostAlignSize;
+constexpr int32_t kLinearBinMaxShift = 9;  // log2(kLinearBinMaxSize)
+
+std::atomic<uint64_t> allocator_unique_id_counter(0);
+
+}  // namespace
+
+CpuAllocator::CpuAllocator()
+    : CpuAllocator(ParseBooleanFromEnv("ONEFLOW_VM_CPU_ALLOCATOR_CACHING", true),
+                   ParseIntegerFromEnv("ONEFLOW_VM_CPU_ALLOCATOR_MAX_CACHED_MB", -1) * 1048576) {}
+
+CpuAllocator::CpuAllocator(bool enable_caching, int64_t max_cached_bytes)
+    : Allocator(),
+      unique_id_(allocator_unique_id_counter++),
+      enable_caching_(enable_caching),
+      max_cached_bytes_(max_cached_bytes),
+      hit_count_(0),
+      miss_count_(0),
+      allocated_bytes_(0),
+      cached_bytes_(0) {
+  for (int32_t i = 0; i < kBinNumSize; ++i) {
+    size_t bin_size = BinSize4BinNum(i);
+    CHECK_EQ(bin_size % kHostAlignSize, 0);
+    CHECK_EQ(BinNum4Size(bin_size), i);
+    if (i > 0) { CHECK_EQ(BinNum4Size(BinSize4BinNum(i - 1) + 1), i); }
+  }
+  CHECK_EQ(BinNum4Size(BinSize4BinNum(kBinNumSize - 1) + 1), kInvalidBinNum);
+  CHECK_EQ(BinSize4BinNum(kThreadCacheBinNumSize - 1), 256 * 1024UL);
+}
+
+CpuAllocator::~CpuAllocator() {
+  {
+    // detach first so that no exiting thread flushes into the bins after they are released
+    std::unique_lock<std::mutex> lock(thread_caches_mutex_);
+    for (const auto& thread_cache : thread_caches_) {
+      std::unique_lock<std::mutex> cache_lock(thread_cache->mutex);
+      thread_cache->owner = nullptr;
+    }
+  }
+  ReleaseCachedMemory();
+}
+
+int32_t CpuAllocator::BinNum4Size(size_t size) {
+  if (size <= kLinearBinMaxSize) {
+    return std::max<int32_t>(static_cast<int32_t>((size + kHostAlignSize - 1) / kHostAlignSize) - 1,
+                             0);
+  }
+  // size is in (2^shift, 2^(shift+1)], which is split into four classes of 2^(shift-2) bytes
+  const int32_t shift = 63 ^ __builtin_clzll(size - 1);
+  const size_t step = static_cast<size_t>(1) << (shift - 2);
+  const size_t sub_bin = (size - (static_cast<size_t>(1) << shift) + step - 1) / step;
+  const int32_t bin_num =
+      kLinearBinNumSize + (shift - kLinearBinMaxShift) * 4 + static_cast<int32_t>(sub_bin) - 1;
+  return bin_num < kBinNumSize ? bin_num : kInvalidBinNum;
+}
+
+size_t CpuAllocator::BinSize4BinNum(int32_t bin_num) {
+  if (bin_num < kLinearBinNumSize) { return (bin_num + 1) * kHostAlignSize; }
+  const int32_t shift = kLinearBinMaxShift + (bin_num - kLinearBinNumSize) / 4;
+  const size_t sub_bin = (bin_num - kLinearBinNumSize) % 4 + 1;
+  return (static_cast<size_t>(1) << shift) + sub_bin * (static_cast<size_t>(1) << (shift - 2));
+}
+
+struct CpuAllocator::ThreadCacheRegistry final {
+  ~ThreadCacheRegistry() {
+    for (const auto& pair : id2cache) {
+      ThreadCache* thread_cache = pair.second.get();
+      std::unique_lock<std::mutex> lock(thread_cache->mutex);
+      if (thread_cache->owner != nullptr) { thread_cache->owner->FlushThreadCache(thread_cache); }
+    }
+  }
+
+  // Keyed by unique_id_ rather than the allocator address, so that a destroyed allocator is never
+  // confused with a new one at the same address.
+  HashMap<uint64_t, std::shared_ptr<ThreadCache>> id2cache;
+};
+
+CpuAllocator::ThreadCache* CpuAllocator::GetThreadCache() {
+  static thread_local uint64_t last_id = std::numeric_limits<uint64_t>::max();
+  static thread_local ThreadCache* last_cache = nullptr;
+  if (last_id == unique_id_) { return last_cache; }
+  static thread_local ThreadCacheRegistry registry;
+  auto it = registry.id2cache.find(unique_id_);
+  if (it == registry.id2cache.end()) {
+    auto thread_cache = std::make_shared<ThreadCache>();
+    thread_cache->owner = this;
+    {
+      std::unique_lock<std::mutex> lock(thread_caches_mutex_);
+      thread_caches_.emplace_back(thread_cache);
+    }
+    it = registry.id2cache.emplace(unique_id_, thread_cache).first;
+  }
+  last_id = unique_id_;
+  last_cache = it->second.get();
+  return last_cache;
+}
+
+void CpuAllocator::FlushThreadCache(ThreadCache* thread_cache) {
+  for (int32_t i = 0; i < kThreadCacheBinNumSize; ++i) {
+    auto* ptrs = &thread_cache->bins.at(i);
+    if (ptrs->empty()) { continue; }
+    Bin* bin = &bins_.at(i);
+    std::unique_lock<std::mutex> lock(bin->mutex);
+    bin->ptrs.insert(bin->ptrs.end(), ptrs->begin(), ptrs->end());
+    ptrs->clear();
+  }
+}
+
+char* CpuAllocator::AllocateFromSystem(size_t aligned_size) {
+  char* ptr = reinterpret_cast<char*>(aligned_alloc(kHostAlignSize, aligned_size));
+  if (ptr == nullptr && enable_caching_) {
+    // cached blocks may be enough for the OS to satisfy the request
+    ReleaseCachedMemory();
+    ptr = reinterpret_cast<char*>(aligned_alloc(kHostAlignSize, aligned_size));
+  }
+  CHECK(ptr != nullptr) << "Error! : Out of memory when allocate size : " << aligned_size
+                        << ".\n The allocated_bytes of this CpuAllocator is : "
+                        << allocated_bytes_.load();
+  allocated_bytes_ += aligned_size;
+  return ptr;
+}
+
+void CpuAllocator::DeallocateToSystem(char* ptr, size_t aligned_size) {
+  std::free(ptr);
+  allocated_bytes_ -= aligned_size;
+}
+
+bool CpuAllocator::TryHoldCachedBytes(size_t size) {
+  const int64_t cached_bytes = cached_bytes_.fetch_add(size) + size;
+  if (max_cached_bytes_ >= 0 && cached_bytes > max_cached_bytes_) {
+    cached_bytes_ -= size;
+    return false;
+  }
+  return true;
+}
+
 void CpuAllocator::Allocate(char** mem_ptr, std::size_t size) {
-  *mem_ptr = reinterpret_cast<char*>(aligned_alloc(kHostAlignSize, size));
+  if (size == 0) {
+    *mem_ptr = nullptr;
+    return;
+  }
+  const int32_t bin_num = enable_caching_ ? BinNum4Size(size) : kInvalidBinNum;
+  if (bin_num == kInvalidBinNum) {
+    miss_count_ += 1;
+    *mem_ptr = AllocateFromSystem(RoundUp(size, kHostAlignSize));
+    return;
+  }
+  const size_t bin_size = BinSize4BinNum(bin_num);
+  char* ptr = nullptr;
+  if (bin_num < kThreadCacheBinNumSize) {
+    ThreadCache* thread_cache = GetThreadCache();
+    std::unique_lock<std::mutex> lock(thread_cache->mutex);
+    auto* ptrs = &thread_cache->bins.at(bin_num);
+    if (!ptrs->empty()) {
+      ptr = ptrs->back();
+      ptrs->pop_back();
+    }
+  }
+  if (ptr == nullptr) {
+    Bin* bin = &bins_.at(bin_num);
+    std::unique_lock<std::mutex> lock(bin->mutex);
+    if (!bin->ptrs.empty()) {
+      ptr = bin->ptrs.back();
+      bin->ptrs.pop_back();
+    }
+  }
+  if (ptr != nullptr) {
+    hit_count_ += 1;
+    cached_bytes_ -= bin_size;
+  } else {
+    miss_count_ += 1;
+    ptr = AllocateFromSystem(bin_size);
+  }
+  *mem_ptr = ptr;
+}
+
+void CpuAllocator::Deallocate(char* mem_ptr, std::size_t size) {
+  if (mem_ptr == nullptr) { return; }
+  const int32_t bin_num = enable_caching_ ? BinNum4Size(size) : kInvalidBinNum;
+  if (bin_num == kInvalidBinNum) {
+    DeallocateToSystem(mem_ptr, RoundUp(size, kHostAlignSize));
+    return;
+  }
+  const size_t bin_size = BinSize4BinNum(bin_num);
+  if (!TryHoldCachedBytes(bin_size)) {
+    DeallocateToSystem(mem_ptr, bin_size);
+    return;
+  }
+  if (bin_num < kThreadCacheBinNumSize) {
+    ThreadCache* thread_cache = GetThreadCache();
+    std::unique_lock<std::mutex> lock(thread_cache->mutex);
+    auto* ptrs = &thread_cache->bins.at(bin_num);
+    if (ptrs->size() < kThreadCacheBinCapacity) {
+      ptrs->push_back(mem_ptr);
+      return;
+    }
+  }
+  Bin* bin = &bins_.at(bin_num);
+  std::unique_lock<std::mutex> lock(bin->mutex);
+  bin->ptrs.push_back(mem_ptr);
 }
 
-void CpuAllocator::Deallocate(char* mem_ptr, std::size_t size) { std::free(mem_ptr); }
+void CpuAllocator::ReleaseCachedMemory() {
+  size_t released_bytes = 0;
+  {
+    std::unique_lock<std::mutex> lock(thread_caches_mutex_);
+    for (const auto& thread_cache : thread_caches_) {
+      std::unique_lock<std::mutex> cache_lock(thread_cache->mutex);
+      for (int32_t i = 0; i < kThreadCacheBinNumSize; ++i) {
+        auto* ptrs = &thread_cache->bins.at(i);
+        for (char* ptr : *ptrs) {
+          DeallocateToSystem(ptr, BinSize4BinNum(i));
+          released_bytes += BinSize4BinNum(i);
+        }
+        ptrs->clear();
+      }
+    }
+  }
+  for (int32_t i = 0; i < kBinNumSize; ++i) {
+    Bin* bin = &bins_.at(i);
+    std::unique_lock<std::mutex> lock(bin->mutex);
+    for (char* ptr : bin->ptrs) {
+      DeallocateToSystem(ptr, BinSize4BinNum(i));
+      released_bytes += BinSize4BinNum(i);
+    }
+    bin->ptrs.clear();
+  }
+  cached_bytes_ -= released_bytes;
+}
+
+CpuAllocatorStats CpuAllocator::GetStats() const {
+  CpuAllocatorStats stats;
+  stats.hit_count = hit_count_.load();
+  stats.miss_count = miss_count_.load();
+  stats.allocated_bytes = allocated_bytes_.load();
+  stats.cached_bytes = cached_bytes_.load();
+  return stats;
+}
 
 COMMAND(Global<CpuAllocator>::SetAllocated(new CpuAllocator()));
 
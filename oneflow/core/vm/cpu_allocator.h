@@ -16,19 +16,100 @@ limitations under the License.
 #ifndef ONEFLOW_CORE_VM_CPU_ALLOCATOR_H_
 #define ONEFLOW_CORE_VM_CPU_ALLOCATOR_H_
 
+#include <array>
+#include <atomic>
 #include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
 #include "oneflow/core/vm/allocator.h"
 
 namespace oneflow {
 namespace vm {
 
+struct CpuAllocatorStats {
+  int64_t hit_count = 0;
+  int64_t miss_count = 0;
+  // bytes obtained from the OS and not yet returned, in use or cached
+  int64_t allocated_bytes = 0;
+  // bytes held in the free lists of the allocator
+  int64_t cached_bytes = 0;
+};
+
+// CpuAllocator caches freed host memory in size-class bins so that eager tensors with recurring
+// shapes do not go through malloc/free on every op.
+//
+// Size classes are linear with 64 bytes granularity up to 512 bytes, and four classes per power of
+// two above, like
+//    BinNum:   Bin0, ..., Bin7, Bin8, Bin9, Bin10, Bin11, Bin12, ..., Bin83
+//    BinSize:  64,   ..., 512,  640,  768,  896,   1024,  1280,  ..., 256MB
+// so the internal fragmentation of a block is at most 25%. Requests larger than the last bin go
+// to the OS directly.
+//
+// Freed blocks go to a per-thread cache first and spill to the central bins when the thread
+// cache is full. Cached bytes are bounded by ONEFLOW_VM_CPU_ALLOCATOR_MAX_CACHED_MB (unbounded if
+// negative); blocks that would exceed the bound are released to the OS. When the OS fails to
+// provide memory, all cached blocks are released and the allocation is retried. Caching can be
+// turned off with ONEFLOW_VM_CPU_ALLOCATOR_CACHING=false.
 class CpuAllocator final : public Allocator {
  public:
-  explicit CpuAllocator() = default;
-  ~CpuAllocator() override = default;
+  explicit CpuAllocator();
+  CpuAllocator(bool enable_caching, int64_t max_cached_bytes);
+  ~CpuAllocator() override;
 
   void Allocate(char** mem_ptr, std::size_t size) override;
   void Deallocate(char* mem_ptr, std::size_t size) override;
+
+  // Return all cached blocks, including those in the thread caches, to the OS.
+  void ReleaseCachedMemory();
+  CpuAllocatorStats GetStats() const;
+
+ private:
+  static constexpr int32_t kInvalidBinNum = -1;
+  static constexpr int32_t kBinNumSize = 84;
+  static constexpr int32_t kThreadCacheBinNumSize = 44;  // bins up to 256KB
+  static constexpr int32_t kThreadCacheBinCapacity = 16;
+
+  struct Bin {
+    std::mutex mutex;
+    std::vector<char*> ptrs;
+  };
+
+  // ThreadCache is only ever touched by its thread, except when ReleaseCachedMemory() drains it,
+  // so its mutex is uncontended. It is shared by the allocator and the thread, whichever goes
+  // away first detaches it: the allocator by resetting owner, the thread by flushing the cached
+  // blocks to the central bins of the owner.
+  struct ThreadCache {
+    std::mutex mutex;
+    CpuAllocator* owner = nullptr;
+    std::array<std::vector<char*>, kThreadCacheBinNumSize> bins;
+  };
+  // thread local map from allocator unique_id_ to ThreadCache, flushes all caches at thread exit
+  struct ThreadCacheRegistry;
+
+  static int32_t BinNum4Size(size_t size);
+  static size_t BinSize4BinNum(int32_t bin_num);
+
+  ThreadCache* GetThreadCache();
+  // Move blocks of thread_cache into the central bins, thread_cache->mutex must be held
+  void FlushThreadCache(ThreadCache* thread_cache);
+  char* AllocateFromSystem(size_t aligned_size);
+  void DeallocateToSystem(char* ptr, size_t aligned_size);
+  // Try to account size bytes into cached_bytes_, fail if it would exceed max_cached_bytes_.
+  bool TryHoldCachedBytes(size_t size);
+
+  const uint64_t unique_id_;
+  const bool enable_caching_;
+  const int64_t max_cached_bytes_;
+  std::array<Bin, kBinNumSize> bins_;
+
+  std::mutex thread_caches_mutex_;
+  std::vector<std::shared_ptr<ThreadCache>> thread_caches_;
+
+  std::atomic<int64_t> hit_count_;
+  std::atomic<int64_t> miss_count_;
+  std::atomic<int64_t> allocated_bytes_;
+  std::atomic<int64_t> cached_bytes_;
 };
 
 }  // namespace vm
@@ -0,0 +1,101 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/vm/cpu_allocator.h"
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+namespace vm {
+
+TEST(CpuAllocator, cache_hit_and_miss) {
+  CpuAllocator allocator(true, -1);
+  char* ptr = nullptr;
+  allocator.Allocate(&ptr, 1000);
+  ASSERT_TRUE(ptr != nullptr);
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(ptr) % kHostAlignSize, 0);
+  allocator.Deallocate(ptr, 1000);
+  ASSERT_EQ(allocator.GetStats().miss_count, 1);
+  ASSERT_EQ(allocator.GetStats().hit_count, 0);
+  ASSERT_EQ(allocator.GetStats().cached_bytes, 1024);
+
+  // 900 bytes is in the same size class as 1000 bytes
+  char* cached_ptr = nullptr;
+  allocator.Allocate(&cached_ptr, 900);
+  ASSERT_EQ(cached_ptr, ptr);
+  ASSERT_EQ(allocator.GetStats().hit_count, 1);
+  ASSERT_EQ(allocator.GetStats().cached_bytes, 0);
+  allocator.Deallocate(cached_ptr, 900);
+
+  allocator.ReleaseCachedMemory();
+  ASSERT_EQ(allocator.GetStats().cached_bytes, 0);
+  ASSERT_EQ(allocator.GetStats().allocated_bytes, 0);
+}
+
+TEST(CpuAllocator, distinct_live_blocks) {
+  CpuAllocator allocator(true, -1);
+  std::vector<char*> ptrs;
+  for (int i = 0; i < 512; ++i) {
+    char* ptr = nullptr;
+    allocator.Allocate(&ptr, 10000);
+    ASSERT_TRUE(ptr != nullptr);
+    ptrs.emplace_back(ptr);
+  }
+  std::sort(ptrs.begin(), ptrs.end());
+  for (int i = 0; i < 512; ++i) {
+    if (i > 0) { ASSERT_TRUE(ptrs.at(i) - ptrs.at(i - 1) >= 10000); }
+    allocator.Deallocate(ptrs.at(i), 10000);
+  }
+  ASSERT_EQ(allocator.GetStats().allocated_bytes, allocator.GetStats().cached_bytes);
+}
+
+TEST(CpuAllocator, max_cached_bytes) {
+  CpuAllocator allocator(true, 4096);
+  char* ptr0 = nullptr;
+  char* ptr1 = nullptr;
+  allocator.Allocate(&ptr0, 4096);
+  allocator.Allocate(&ptr1, 4096);
+  allocator.Deallocate(ptr0, 4096);
+  allocator.Deallocate(ptr1, 4096);
+  // the second block exceeds the bound and goes back to the OS
+  ASSERT_EQ(allocator.GetStats().cached_bytes, 4096);
+  ASSERT_EQ(allocator.GetStats().allocated_bytes, 4096);
+}
+
+TEST(CpuAllocator, cross_thread_deallocate) {
+  CpuAllocator allocator(true, -1);
+  std::vector<char*> ptrs(64);
+  for (auto& ptr : ptrs) { allocator.Allocate(&ptr, 256); }
+  std::thread thread([&]() {
+    for (char* ptr : ptrs) { allocator.Deallocate(ptr, 256); }
+  });
+  thread.join();
+  ASSERT_EQ(allocator.GetStats().cached_bytes, 64 * 256);
+  for (auto& ptr : ptrs) { allocator.Allocate(&ptr, 256); }
+  ASSERT_EQ(allocator.GetStats().hit_count, 64);
+  for (char* ptr : ptrs) { allocator.Deallocate(ptr, 256); }
+}
+
+TEST(CpuAllocator, caching_disabled) {
+  CpuAllocator allocator(false, -1);
+  char* ptr = nullptr;
+  allocator.Allocate(&ptr, 100);
+  allocator.Deallocate(ptr, 100);
+  ASSERT_EQ(allocator.GetStats().cached_bytes, 0);
+  ASSERT_EQ(allocator.GetStats().allocated_bytes, 0);
+  ASSERT_EQ(allocator.GetStats().hit_count, 0);
+}
+
+}  // namespace vm
+}  // namespace oneflow
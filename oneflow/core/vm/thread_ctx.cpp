@@ -19,9 +19,10 @@ limitations under the License.
 namespace oneflow {
 namespace vm {
 
-void ThreadCtx::LoopRun(const std::function<void(ThreadCtx*)>& Initializer) {
+void ThreadCtx::LoopRun(const std::function<void(ThreadCtx*)>& Initializer,
+                        const std::function<void()>& AfterRun) {
   Initializer(this);
-  while (ReceiveAndRun() == intrusive::kChannelStatusSuccess) {}
+  while (ReceiveAndRun() == intrusive::kChannelStatusSuccess) { AfterRun(); }
 }
 
 intrusive::ChannelStatus ThreadCtx::ReceiveAndRun() {
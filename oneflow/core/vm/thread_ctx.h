@@ -50,7 +50,9 @@ class ThreadCtx final : public intrusive::Base {
     __Init__();
     set_stream_rt_desc(&stream_rt_desc);
   }
-  void LoopRun(const std::function<void(ThreadCtx*)>& Initializer);
+  // AfterRun is called every time a batch of received instructions has been run.
+  void LoopRun(const std::function<void(ThreadCtx*)>& Initializer,
+               const std::function<void()>& AfterRun);
   intrusive::ChannelStatus TryReceiveAndRun();
 
  private:
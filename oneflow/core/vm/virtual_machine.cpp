@@ -91,19 +91,49 @@ void GetWorkerThreadInitializer(intrusive::shared_ptr<vm::VirtualMachineEngine>
   };
 }
 
+vm::SchedulerPolicy GetSchedulerPolicyFromEnv() {
+  const std::string policy = GetStringFromEnv("ONEFLOW_VM_SCHEDULER_POLICY", "latency");
+  if (policy == "latency") {
+    return vm::SchedulerPolicy::kLatency;
+  } else if (policy == "balanced") {
+    return vm::SchedulerPolicy::kBalanced;
+  } else if (policy == "efficiency") {
+    return vm::SchedulerPolicy::kEfficiency;
+  } else {
+    LOG(FATAL) << "ONEFLOW_VM_SCHEDULER_POLICY should be latency, balanced or efficiency, but got "
+               << policy;
+  }
+  return vm::SchedulerPolicy::kLatency;
+}
+
 }  // namespace
 
 VirtualMachine::VirtualMachine(const Resource& resource, int64_t this_machine_id)
     : vm_(intrusive::make_shared<vm::VirtualMachineEngine>(
-        vm::MakeVmDesc(resource, this_machine_id).Get())) {
+        vm::MakeVmDesc(resource, this_machine_id).Get())),
+      scheduler_policy_(GetSchedulerPolicyFromEnv()),
+      // The cost of os thread switching is about 5-10 microseconds. Doing more scheduling in
+      // a single waiting up can reach higher performance.
+      max_spin_us_(ParseIntegerFromEnv("ONEFLOW_VM_SCHEDULER_SPIN_MICROSECONDS", 1000)),
+      avg_idle_us_(0),
+      wakeup_cnt_(0),
+      schedule_cnt_(0),
+      spin_us_(0),
+      flying_instruction_cnt_(0),
+      max_flying_instruction_cnt_(0) {
   OF_PROFILER_NAME_THIS_HOST_THREAD("_VM::Main");
   std::function<void()> SchedulerInitializer;
   GetSchedulerThreadInitializer(&SchedulerInitializer);
   std::function<void(vm::ThreadCtx*)> WorkerInitializer;
   GetWorkerThreadInitializer(vm_, &WorkerInitializer);
+  std::function<void()> AfterWorkerRun = [] {};
+  if (scheduler_policy_ == vm::SchedulerPolicy::kEfficiency) {
+    // The scheduler thread sleeps between completions, wake it up to release the instructions.
+    AfterWorkerRun = [this] { notifier_.Notify(); };
+  }
   CHECK_JUST(ForEachThreadCtx(vm_.Mutable(), [&](vm::ThreadCtx* thread_ctx) -> Maybe<void> {
-    auto thread =
-        std::make_unique<std::thread>(&vm::ThreadCtx::LoopRun, thread_ctx, WorkerInitializer);
+    auto thread = std::make_unique<std::thread>(&vm::ThreadCtx::LoopRun, thread_ctx,
+                                                WorkerInitializer, AfterWorkerRun);
     worker_threads_.push_back(std::move(thread));
     return Maybe<void>::Ok();
   }));
@@ -160,6 +190,10 @@ Maybe<void> VirtualMachine::Receive(vm::InstructionMsgList* instr_list) {
 
 namespace {
 
+// How long the scheduler thread sleeps under the efficiency policy before it polls the in-flight
+// instructions again.
+constexpr size_t kEfficiencyPollingMicroseconds = 100;
+
 template<typename T>
 int MicrosecondsFrom(const T& start) {
   return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now()
@@ -169,37 +203,99 @@ int MicrosecondsFrom(const T& start) {
 
 }  // namespace
 
+vm::SchedulerStats VirtualMachine::scheduler_stats() const {
+  vm::SchedulerStats stats{};
+  stats.wakeup_cnt = wakeup_cnt_.load(std::memory_order_relaxed);
+  stats.schedule_cnt = schedule_cnt_.load(std::memory_order_relaxed);
+  stats.spin_us = spin_us_.load(std::memory_order_relaxed);
+  stats.flying_instruction_cnt = flying_instruction_cnt_.load(std::memory_order_relaxed);
+  stats.max_flying_instruction_cnt = max_flying_instruction_cnt_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+int64_t VirtualMachine::SpinMicroseconds(int64_t idle_us) {
+  switch (scheduler_policy_) {
+    case vm::SchedulerPolicy::kLatency: return max_spin_us_;
+    case vm::SchedulerPolicy::kBalanced: {
+      avg_idle_us_ = (avg_idle_us_ * 7 + idle_us) / 8;
+      // Instructions that keep coming in shortly after the thread went to sleep are worth
+      // spinning for, sparse ones are not.
+      if (avg_idle_us_ >= max_spin_us_) { return 0; }
+      return std::min(avg_idle_us_ * 2, max_spin_us_);
+    }
+    case vm::SchedulerPolicy::kEfficiency: return 0;
+  }
+  return 0;
+}
+
 void VirtualMachine::Loop(const std::function<void()>& Initializer) {
   Initializer();
   auto* vm = mut_vm();
+  auto sleep_start = std::chrono::steady_clock::now();
   while (notifier_.WaitAndClearNotifiedCnt() == kNotifierStatusSuccess) {
     OF_PROFILER_RANGE_PUSH("VirtualMachine::Loop");
     auto start = std::chrono::steady_clock::now();
-    static constexpr int kWorkingMicroseconds = 1000;
-    // Every time this thread wakes up, vm is scheduled for about `kWorkingMicroseconds`.
-    // The cost of os thread switching is about 5-10 microseconds. Doing more scheduling in
-    // a single waiting up can reach higher performance.
-    do {
-      static constexpr int kNumSchedulingPerTimoutTest = 10000;
-      // Every time kWorkingMicroseconds timeout tested, vm is scheduled for about
-      // kNumSchedulingPerTimoutTest.
-      // The cost of `MicrosecondsFrom(start)` is about 400ns, while the empty scheduling costs
-      // about 10ns.
-      int i = 0;
+    const int64_t flying_instruction_cnt = vm->flying_instruction_cnt();
+    wakeup_cnt_.fetch_add(1, std::memory_order_relaxed);
+    flying_instruction_cnt_.fetch_add(flying_instruction_cnt, std::memory_order_relaxed);
+    if (flying_instruction_cnt > max_flying_instruction_cnt_.load(std::memory_order_relaxed)) {
+      max_flying_instruction_cnt_.store(flying_instruction_cnt, std::memory_order_relaxed);
+    }
+    // Every time this thread wakes up, vm is scheduled for about `spin_us`.
+    const int64_t spin_us = SpinMicroseconds(MicrosecondsFrom(sleep_start));
+    int64_t schedule_cnt = 0;
+    int64_t wait_us = 0;
+    if (scheduler_policy_ == vm::SchedulerPolicy::kEfficiency) {
+      // Sleep between scheduling passes until a worker finishes running instructions or new
+      // instructions arrive. The timeout covers completions nobody notifies, e.g. cuda events and
+      // callbacks of critical sections.
+      while (true) {
+        vm->Schedule();
+        ++schedule_cnt;
+        if (vm->ThreadUnsafeEmpty()) { break; }
+        const auto wait_start = std::chrono::steady_clock::now();
+        const auto status = notifier_.TimedWaitAndClearNotifiedCnt(kEfficiencyPollingMicroseconds);
+        wait_us += MicrosecondsFrom(wait_start);
+        if (status != kNotifierStatusSuccess) { break; }
+        wakeup_cnt_.fetch_add(1, std::memory_order_relaxed);
+      }
+    } else if (spin_us <= 0) {
+      do {
+        vm->Schedule();
+        ++schedule_cnt;
+      } while (!vm->ThreadUnsafeEmpty());
+    } else {
       do {
-        // Use ThreadUnsafeEmpty to avoid acquiring mutex lock.
-        // It's safe to use ThreadUnsafeEmpty here. notifier_.notified_cnt_ will be greater than
-        // zero
-        // when inconsistency between vm->pending_msg_list.list_head_.list_head_.container_ and
-        // vm->pending_msg_list.list_head_.list_head_.size_ occured. hence the pending
-        // instructions
-        // will get handled in the next iteration.
-        //  VirtualMachine::Receive may be less effiencient if the thread safe version `vm->Empty()`
-        // used
-        //  here, because VirtualMachine::Loop is more likely to get the mutex lock.
-        do { vm->Schedule(); } while (!vm->ThreadUnsafeEmpty());
-      } while (++i < kNumSchedulingPerTimoutTest);
-    } while (MicrosecondsFrom(start) < kWorkingMicroseconds);
+        static constexpr int kNumSchedulingPerTimoutTest = 10000;
+        // Every time spin_us timeout tested, vm is scheduled for about
+        // kNumSchedulingPerTimoutTest.
+        // The cost of `MicrosecondsFrom(start)` is about 400ns, while the empty scheduling costs
+        // about 10ns.
+        int i = 0;
+        do {
+          // Use ThreadUnsafeEmpty to avoid acquiring mutex lock.
+          // It's safe to use ThreadUnsafeEmpty here. notifier_.notified_cnt_ will be greater than
+          // zero
+          // when inconsistency between vm->pending_msg_list.list_head_.list_head_.container_ and
+          // vm->pending_msg_list.list_head_.list_head_.size_ occured. hence the pending
+          // instructions
+          // will get handled in the next iteration.
+          //  VirtualMachine::Receive may be less effiencient if the thread safe version
+          //  `vm->Empty()` used here, because VirtualMachine::Loop is more likely to get the mutex
+          //  lock.
+          do {
+            vm->Schedule();
+            ++schedule_cnt;
+          } while (!vm->ThreadUnsafeEmpty());
+        } while (++i < kNumSchedulingPerTimoutTest);
+      } while (MicrosecondsFrom(start) < spin_us);
+    }
+    schedule_cnt_.fetch_add(schedule_cnt, std::memory_order_relaxed);
+    sleep_start = std::chrono::steady_clock::now();
+    spin_us_.fetch_add(
+        std::chrono::duration_cast<std::chrono::microseconds>(sleep_start - start).count()
+            - wait_us,
+        std::memory_order_relaxed);
     OF_PROFILER_RANGE_POP();
   }
   while (!vm->Empty()) { vm->Schedule(); }
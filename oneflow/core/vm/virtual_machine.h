@@ -26,6 +26,30 @@ namespace oneflow {
 
 class InstructionsBuilder;
 
+namespace vm {
+
+// How the scheduler thread spends the time after the instructions it woke up for are scheduled.
+enum class SchedulerPolicy {
+  // keep scheduling for a fixed while, new instructions get picked up without a wakeup
+  kLatency = 0,
+  // keep scheduling for about twice the recent gap between wakeups, capped by the latency budget
+  kBalanced,
+  // sleep whenever nothing is ready to schedule, also while instructions are in flight
+  kEfficiency,
+};
+
+struct SchedulerStats {
+  int64_t wakeup_cnt;
+  int64_t schedule_cnt;
+  // time the scheduler thread was awake
+  int64_t spin_us;
+  // flying instructions found on wakeups
+  int64_t flying_instruction_cnt;
+  int64_t max_flying_instruction_cnt;
+};
+
+}  // namespace vm
+
 class VirtualMachine final {
  public:
   VirtualMachine(const VirtualMachine&) = delete;
@@ -36,11 +60,14 @@ class VirtualMachine final {
   Maybe<void> Receive(vm::InstructionMsgList* instr_list);
 
   const vm::VirtualMachineEngine& vm() const { return *vm_; }
+  vm::SchedulerPolicy scheduler_policy() const { return scheduler_policy_; }
+  vm::SchedulerStats scheduler_stats() const;
 
  private:
   friend class InstructionsBuilder;
 
   void Loop(const std::function<void()>& Initializer);
+  int64_t SpinMicroseconds(int64_t idle_us);
 
   vm::VirtualMachineEngine* mut_vm() { return vm_.Mutable(); }
   void ControlSync();
@@ -50,6 +77,17 @@ class VirtualMachine final {
   std::list<std::unique_ptr<std::thread>> worker_threads_;
   std::thread schedule_thread_;
   Notifier notifier_;
+
+  vm::SchedulerPolicy scheduler_policy_;
+  int64_t max_spin_us_;
+  // moving average of the time the scheduler thread slept before a wakeup
+  int64_t avg_idle_us_;
+  // only written by the scheduler thread
+  std::atomic<int64_t> wakeup_cnt_;
+  std::atomic<int64_t> schedule_cnt_;
+  std::atomic<int64_t> spin_us_;
+  std::atomic<int64_t> flying_instruction_cnt_;
+  std::atomic<int64_t> max_flying_instruction_cnt_;
 };
 
 }  // namespace oneflow
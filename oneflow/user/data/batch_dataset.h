@@ -32,13 +32,8 @@ class BatchDataset final : public Dataset<LoadTarget> {
   ~BatchDataset() = default;
 
   LoadTargetPtrList Next() override {
-    LoadTargetPtrList ret;
-    ret.reserve(batch_size_);
-    for (int32_t i = 0; i < batch_size_; ++i) {
-      LoadTargetPtrList tmp = loader_->Next();
-      CHECK_EQ(tmp.size(), 1);
-      ret.emplace_back(std::move(tmp.at(0)));
-    }
+    LoadTargetPtrList ret = loader_->NextBatch(batch_size_);
+    CHECK_EQ(ret.size(), batch_size_);
     return ret;
   }
 
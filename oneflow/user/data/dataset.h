@@ -33,6 +33,15 @@ class Dataset {
   virtual ~Dataset() = default;
 
   virtual LoadTargetPtrList Next() = 0;
+  // Returns the next n samples, datasets which read in bulk override it.
+  virtual LoadTargetPtrList NextBatch(size_t n) {
+    LoadTargetPtrList ret;
+    ret.reserve(n);
+    while (ret.size() < n) {
+      for (auto& sample_ptr : Next()) { ret.emplace_back(std::move(sample_ptr)); }
+    }
+    return ret;
+  }
 };
 
 template<typename LoadTarget>
@@ -14,11 +14,14 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/user/data/gpt_dataset.h"
+#include "oneflow/core/common/str_util.h"
 
 #ifdef __linux__
 #include <fcntl.h>
 #include <stdio.h>
 #include <errno.h>
+#include <unistd.h>
+#include <sys/file.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
 #endif
@@ -74,6 +77,51 @@ size_t GetNumCompleteEpochs(size_t num_samples, size_t seq_length, size_t tokens
   return separate_last_epoch ? (num_epochs - 1) : num_epochs;
 }
 
+constexpr char kIndexCacheMagicCode[] = "GPTIDXC1";
+constexpr size_t kIndexCacheMagicCodeLen = sizeof(kIndexCacheMagicCode) - 1;
+
+// Header of the index cache file, followed by the doc, sample and shuffle indices.
+struct IndexCacheHeader {
+  char magic_code[kIndexCacheMagicCodeLen];
+  uint64_t index_file_mtime;
+  uint64_t num_docs;
+  uint64_t tokens_per_epoch;
+  uint64_t num_epochs;
+  uint64_t num_complete_epochs;
+  uint64_t num_doc_indices;
+  uint64_t num_sample_indices;
+  uint64_t num_shuffle_indices;
+};
+
+static_assert(sizeof(std::pair<size_t, size_t>) == 2 * sizeof(size_t), "");
+
+// Holds an exclusive lock of path while alive, so that a single rank of a host builds the index
+// cache while the others wait to map it. Does nothing if the lock file can't be opened.
+class FileLockGuard final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(FileLockGuard);
+  explicit FileLockGuard(const std::string& path) : fd_(-1) {
+#ifdef __linux__
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ != -1 && flock(fd_, LOCK_EX) != 0) {
+      close(fd_);
+      fd_ = -1;
+    }
+#endif
+  }
+  ~FileLockGuard() {
+#ifdef __linux__
+    if (fd_ != -1) {
+      flock(fd_, LOCK_UN);
+      close(fd_);
+    }
+#endif
+  }
+
+ private:
+  int fd_;
+};
+
 }  // namespace
 
 constexpr char MegatronGPTIndex::kMagicCode[];
@@ -161,22 +209,155 @@ MegatronGPTMMapDataset::MegatronGPTMMapDataset(const std::string& data_file_pref
   tokens_per_epoch_ = GetEpochNumTokens(epoch_doc_indices);
   num_epochs_ = GetNumEpochs(num_samples_, seq_len_, tokens_per_epoch_);
   num_complete_epochs_ = GetNumCompleteEpochs(num_samples_, seq_len_, tokens_per_epoch_);
-  InitDocIndices(epoch_doc_indices, num_epochs_, num_complete_epochs_);
-  size_t total_num_samples = static_cast<size_t>(
-      std::floor(static_cast<double>(num_epochs_ * tokens_per_epoch_ - 1) / seq_len_));
-  InitSampleIndices(total_num_samples);
-  InitShuffleIndices(sample_indices_.size());
+  index_file_mtime_ = 0;
+#ifdef __linux__
+  struct stat index_file_stat;
+  if (stat((data_file_prefix + ".idx").c_str(), &index_file_stat) == 0) {
+    index_file_mtime_ = index_file_stat.st_mtime;
+  }
+#endif
+  const std::string cache_path = GetIndexCachePath(data_file_prefix, split_sizes, split_index);
+  std::unique_ptr<FileLockGuard> cache_lock;
+  if (!cache_path.empty()) { cache_lock.reset(new FileLockGuard(cache_path + ".lock")); }
+  if (cache_path.empty() || !TryMapIndexCache(cache_path)) {
+    InitDocIndices(epoch_doc_indices, num_epochs_, num_complete_epochs_);
+    size_t total_num_samples = static_cast<size_t>(
+        std::floor(static_cast<double>(num_epochs_ * tokens_per_epoch_ - 1) / seq_len_));
+    InitSampleIndices(total_num_samples);
+    InitShuffleIndices(sample_indices_.size());
+    if (!cache_path.empty() && SaveIndexCache(cache_path) && TryMapIndexCache(cache_path)) {
+      doc_indices_ = std::vector<size_t>();
+      sample_indices_ = std::vector<std::pair<size_t, size_t>>();
+      shuffle_indices_ = std::vector<size_t>();
+    } else {
+      UseIndicesInMemory();
+    }
+  }
+  cache_lock.reset();
   std::chrono::duration<double, std::milli> elapse = std::chrono::system_clock::now() - start;
   LOG(INFO) << "Create GPT Dataset successed, sequence length: " << seq_len_
             << ", number of samples: " << num_samples_
-            << ", total number of samples: " << shuffle_indices_.size()
-            << ", total number of documents: " << doc_indices_.size()
+            << ", total number of samples: " << num_shuffle_indices_
+            << ", total number of documents: " << num_doc_indices_
             << ", number of epochs: " << num_epochs_
             << ", number of complete epochs: " << num_complete_epochs_
             << ", shuffle: " << std::boolalpha << shuffle_ << ", random_seed: " << seed_
             << ", elapsed time: " << elapse.count() << " ms";
 }
 
+std::string MegatronGPTMMapDataset::GetIndexCachePath(const std::string& data_file_prefix,
+                                                      const std::vector<int64_t>& split_sizes,
+                                                      size_t split_index) const {
+#ifdef __linux__
+  if (!ParseBooleanFromEnv("ONEFLOW_GPT_DATASET_INDEX_CACHE", true)) { return ""; }
+  const char* cache_dir_env = std::getenv("ONEFLOW_GPT_DATASET_INDEX_CACHE_DIR");
+  const std::string cache_dir = cache_dir_env ? cache_dir_env : Dirname(data_file_prefix);
+  std::stringstream ss;
+  ss << Basename(data_file_prefix);
+  // the cache directory may be shared by data files of the same name in different directories
+  if (cache_dir_env) {
+    ss << "_" << std::hex << std::hash<std::string>()(data_file_prefix) << std::dec;
+  }
+  ss << "_split" << split_index << "of";
+  FOR_RANGE(size_t, i, 0, split_sizes.size()) { ss << (i == 0 ? "" : "-") << split_sizes[i]; }
+  ss << "_" << num_samples_ << "ns_" << seq_len_ << "sl_" << seed_ << "s"
+     << (shuffle_ ? "_shuffle" : "") << "_indexmap.bin";
+  return JoinPath(cache_dir, ss.str());
+#else
+  return "";
+#endif
+}
+
+bool MegatronGPTMMapDataset::TryMapIndexCache(const std::string& path) {
+#ifdef __linux__
+  struct stat cache_stat;
+  if (stat(path.c_str(), &cache_stat) != 0
+      || cache_stat.st_size < static_cast<off_t>(sizeof(IndexCacheHeader))) {
+    return false;
+  }
+  auto cache = std::make_unique<const MappedBuffer>(path);
+  const auto* header = static_cast<const IndexCacheHeader*>(cache->ptr());
+  const size_t expected_size =
+      sizeof(IndexCacheHeader)
+      + (header->num_doc_indices + 2 * header->num_sample_indices + header->num_shuffle_indices)
+            * sizeof(size_t);
+  if (std::memcmp(header->magic_code, kIndexCacheMagicCode, kIndexCacheMagicCodeLen) != 0
+      || header->index_file_mtime != index_file_mtime_ || header->num_docs != index_->num_docs()
+      || header->tokens_per_epoch != tokens_per_epoch_ || header->num_epochs != num_epochs_
+      || header->num_complete_epochs != num_complete_epochs_
+      || cache->size() != expected_size) {
+    // written for a different data file, or by an incompatible build
+    LOG(WARNING) << "Ignore stale GPT Dataset index cache " << path;
+    return false;
+  }
+  const auto* indices = reinterpret_cast<const size_t*>(header + 1);
+  doc_indices_ptr_ = indices;
+  num_doc_indices_ = header->num_doc_indices;
+  indices += num_doc_indices_;
+  sample_indices_ptr_ = reinterpret_cast<const std::pair<size_t, size_t>*>(indices);
+  num_sample_indices_ = header->num_sample_indices;
+  indices += 2 * num_sample_indices_;
+  shuffle_indices_ptr_ = indices;
+  num_shuffle_indices_ = header->num_shuffle_indices;
+  CHECK_GE(num_sample_indices_, num_samples_);
+  index_cache_ = std::move(cache);
+  LOG(INFO) << "Map GPT Dataset index cache " << path;
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool MegatronGPTMMapDataset::SaveIndexCache(const std::string& path) const {
+#ifdef __linux__
+  IndexCacheHeader header;
+  std::memcpy(header.magic_code, kIndexCacheMagicCode, kIndexCacheMagicCodeLen);
+  header.index_file_mtime = index_file_mtime_;
+  header.num_docs = index_->num_docs();
+  header.tokens_per_epoch = tokens_per_epoch_;
+  header.num_epochs = num_epochs_;
+  header.num_complete_epochs = num_complete_epochs_;
+  header.num_doc_indices = doc_indices_.size();
+  header.num_sample_indices = sample_indices_.size();
+  header.num_shuffle_indices = shuffle_indices_.size();
+  // write then rename so that concurrent readers never see a partial cache
+  const std::string tmp_path = path + ".tmp." + std::to_string(getpid());
+  {
+    std::ofstream out_stream(tmp_path, std::ofstream::out | std::ofstream::binary);
+    out_stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out_stream.write(reinterpret_cast<const char*>(doc_indices_.data()),
+                     doc_indices_.size() * sizeof(size_t));
+    out_stream.write(reinterpret_cast<const char*>(sample_indices_.data()),
+                     sample_indices_.size() * 2 * sizeof(size_t));
+    out_stream.write(reinterpret_cast<const char*>(shuffle_indices_.data()),
+                     shuffle_indices_.size() * sizeof(size_t));
+    if (!out_stream.good()) {
+      LOG(WARNING) << "Fail to write GPT Dataset index cache " << tmp_path;
+      out_stream.close();
+      unlink(tmp_path.c_str());
+      return false;
+    }
+  }
+  if (rename(tmp_path.c_str(), path.c_str()) != 0) {
+    LOG(WARNING) << "Fail to rename GPT Dataset index cache " << tmp_path << " to " << path;
+    unlink(tmp_path.c_str());
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+void MegatronGPTMMapDataset::UseIndicesInMemory() {
+  doc_indices_ptr_ = doc_indices_.data();
+  num_doc_indices_ = doc_indices_.size();
+  sample_indices_ptr_ = sample_indices_.data();
+  num_sample_indices_ = sample_indices_.size();
+  shuffle_indices_ptr_ = shuffle_indices_.data();
+  num_shuffle_indices_ = shuffle_indices_.size();
+}
+
 size_t MegatronGPTMMapDataset::GetEpochNumTokens(const std::vector<size_t>& doc_indices) const {
   size_t num_tokens = 0;
   for (auto doc_index : doc_indices) { num_tokens += index_->doc_length(doc_index); }
@@ -72,6 +72,11 @@ class MegatronGPTMMapDataset final {
  private:
   static const HashMap<char, size_t> kDTypeCode2Size;
 
+  std::string GetIndexCachePath(const std::string& data_file_prefix,
+                                const std::vector<int64_t>& split_sizes, size_t split_index) const;
+  bool TryMapIndexCache(const std::string& path);
+  bool SaveIndexCache(const std::string& path) const;
+  void UseIndicesInMemory();
   size_t GetEpochNumTokens(const std::vector<size_t>& doc_indices) const;
   void InitDocIndices(const std::vector<size_t>& epoch_doc_indices, size_t num_epochs,
                       size_t num_complete_epochs);
@@ -96,22 +101,33 @@ class MegatronGPTMMapDataset final {
   size_t tokens_per_epoch_;
   size_t num_epochs_;
   size_t num_complete_epochs_;
+  size_t index_file_mtime_;
   std::vector<size_t> doc_indices_;
   std::vector<std::pair<size_t, size_t>> sample_indices_;
   std::vector<size_t> shuffle_indices_;
+  // The indices GetSample reads, either in the vectors above or in the mapped index cache, which
+  // is built once for a (data file, seq_len, num_samples, split, seed, shuffle) and then shared
+  // through the page cache by the later runs and the other ranks on the host.
+  std::unique_ptr<const MappedBuffer> index_cache_;
+  const size_t* doc_indices_ptr_;
+  size_t num_doc_indices_;
+  const std::pair<size_t, size_t>* sample_indices_ptr_;
+  size_t num_sample_indices_;
+  const size_t* shuffle_indices_ptr_;
+  size_t num_shuffle_indices_;
 };
 
 template<typename T>
 void MegatronGPTMMapDataset::GetSample(size_t index, T* data) const {
-  CHECK_LT(index, shuffle_indices_.size());
-  const size_t sample_index = shuffle_indices_[index];
-  CHECK_LT(sample_index, sample_indices_.size());
-  size_t doc_indices_idx = sample_indices_[sample_index].first;
-  size_t doc_offset = sample_indices_[sample_index].second;
+  CHECK_LT(index, num_shuffle_indices_);
+  const size_t sample_index = shuffle_indices_ptr_[index];
+  CHECK_LT(sample_index, num_sample_indices_);
+  size_t doc_indices_idx = sample_indices_ptr_[sample_index].first;
+  size_t doc_offset = sample_indices_ptr_[sample_index].second;
   int remaining_tokens = sample_len_;
   while (remaining_tokens > 0) {
-    CHECK_LT(doc_indices_idx, doc_indices_.size());
-    const size_t doc_index = doc_indices_[doc_indices_idx];
+    CHECK_LT(doc_indices_idx, num_doc_indices_);
+    const size_t doc_index = doc_indices_ptr_[doc_indices_idx];
     size_t offset = index_->address(doc_index) + doc_offset * dtype_size_;
     size_t num_tokens = index_->doc_length(doc_index);
     CHECK_LT(doc_offset, num_tokens);
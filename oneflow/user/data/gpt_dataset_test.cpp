@@ -0,0 +1,180 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "oneflow/user/data/gpt_dataset.h"
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/persistence/file_system.h"
+
+#ifdef __linux__
+
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <utime.h>
+
+namespace oneflow {
+
+namespace data {
+
+namespace test {
+
+namespace {
+
+constexpr size_t kSeqLen = 64;
+constexpr size_t kNumSamples = 1000;
+
+std::string TestDataDir() {
+  std::string current_dir = GetCwd();
+  StringReplace(&current_dir, '\\', '/');
+  const std::string dir = JoinPath(current_dir, "tmp_gpt_dataset_test");
+  if (LocalFS()->IsDirectory(dir)) { LocalFS()->RecursivelyDeleteDir(dir); }
+  return dir;
+}
+
+// Writes a corpus of num_docs documents of uint16 tokens in the Megatron mmap format.
+void WriteCorpus(const std::string& data_file_prefix, size_t num_docs, uint32_t seed) {
+  std::mt19937 gen(seed);
+  std::vector<int32_t> sizes;
+  std::vector<int64_t> addresses;
+  std::vector<int64_t> doc_offsets{0};
+  std::ofstream bin_stream(data_file_prefix + ".bin", std::ios::binary);
+  int64_t address = 0;
+  FOR_RANGE(size_t, i, 0, num_docs) {
+    const int32_t size = 1 + gen() % 200;
+    sizes.emplace_back(size);
+    addresses.emplace_back(address);
+    doc_offsets.emplace_back(i + 1);
+    FOR_RANGE(int32_t, j, 0, size) {
+      const uint16_t token = gen();
+      bin_stream.write(reinterpret_cast<const char*>(&token), sizeof(token));
+    }
+    address += size * sizeof(uint16_t);
+  }
+  std::ofstream idx_stream(data_file_prefix + ".idx", std::ios::binary);
+  idx_stream.write(MegatronGPTIndex::kMagicCode, MegatronGPTIndex::kMagicCodeLen);
+  const uint64_t version = 1;
+  idx_stream.write(reinterpret_cast<const char*>(&version), sizeof(version));
+  const char dtype_code = 8;  // DataType::kUInt16
+  idx_stream.write(&dtype_code, sizeof(dtype_code));
+  const uint64_t sizes_size = sizes.size();
+  const uint64_t doc_offsets_size = doc_offsets.size();
+  idx_stream.write(reinterpret_cast<const char*>(&sizes_size), sizeof(sizes_size));
+  idx_stream.write(reinterpret_cast<const char*>(&doc_offsets_size), sizeof(doc_offsets_size));
+  idx_stream.write(reinterpret_cast<const char*>(sizes.data()), sizes.size() * sizeof(int32_t));
+  idx_stream.write(reinterpret_cast<const char*>(addresses.data()),
+                   addresses.size() * sizeof(int64_t));
+  idx_stream.write(reinterpret_cast<const char*>(doc_offsets.data()),
+                   doc_offsets.size() * sizeof(int64_t));
+}
+
+std::vector<int64_t> GetSamples(const std::string& data_file_prefix) {
+  MegatronGPTMMapDataset dataset(data_file_prefix, kSeqLen, 1, kNumSamples, {949, 50, 1}, 0, true,
+                                 1234);
+  std::vector<int64_t> samples((kSeqLen + 1) * kNumSamples);
+  FOR_RANGE(size_t, i, 0, kNumSamples) {
+    dataset.GetSample(i, samples.data() + i * (kSeqLen + 1));
+  }
+  return samples;
+}
+
+std::vector<int64_t> GetSamplesInMemory(const std::string& data_file_prefix) {
+  setenv("ONEFLOW_GPT_DATASET_INDEX_CACHE", "0", 1);
+  std::vector<int64_t> samples = GetSamples(data_file_prefix);
+  unsetenv("ONEFLOW_GPT_DATASET_INDEX_CACHE");
+  return samples;
+}
+
+std::vector<std::string> ListIndexCaches(const std::string& dir) {
+  const std::string suffix = "_indexmap.bin";
+  std::vector<std::string> caches;
+  for (const std::string& name : LocalFS()->ListDir(dir)) {
+    if (name.size() > suffix.size()
+        && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0) {
+      caches.emplace_back(JoinPath(dir, name));
+    }
+  }
+  return caches;
+}
+
+ino_t GetInode(const std::string& path) {
+  struct stat path_stat;
+  CHECK_EQ(stat(path.c_str(), &path_stat), 0);
+  return path_stat.st_ino;
+}
+
+}  // namespace
+
+TEST(MegatronGPTMMapDataset, index_cache) {
+  const std::string dir = TestDataDir();
+  LocalFS()->RecursivelyCreateDir(dir);
+  const std::string data_file_prefix = JoinPath(dir, "corpus");
+  WriteCorpus(data_file_prefix, 500, 0);
+  const std::vector<int64_t> samples = GetSamplesInMemory(data_file_prefix);
+  ASSERT_TRUE(ListIndexCaches(dir).empty());
+  // the first run writes the cache
+  ASSERT_EQ(GetSamples(data_file_prefix), samples);
+  const std::vector<std::string> caches = ListIndexCaches(dir);
+  ASSERT_EQ(caches.size(), 1);
+  const ino_t cache_inode = GetInode(caches.at(0));
+  // the second run maps it, a rebuilt cache would be renamed into place as a new file
+  ASSERT_EQ(GetSamples(data_file_prefix), samples);
+  ASSERT_EQ(GetInode(caches.at(0)), cache_inode);
+  // a cache of an older index file is stale and rebuilt
+  struct stat index_stat;
+  ASSERT_EQ(stat((data_file_prefix + ".idx").c_str(), &index_stat), 0);
+  struct utimbuf index_times;
+  index_times.actime = index_stat.st_atime;
+  index_times.modtime = index_stat.st_mtime + 10;
+  ASSERT_EQ(utime((data_file_prefix + ".idx").c_str(), &index_times), 0);
+  ASSERT_EQ(GetSamples(data_file_prefix), samples);
+  ASSERT_EQ(ListIndexCaches(dir), caches);
+  ASSERT_NE(GetInode(caches.at(0)), cache_inode);
+  LocalFS()->RecursivelyDeleteDir(dir);
+}
+
+TEST(MegatronGPTMMapDataset, index_cache_dir) {
+  const std::string dir = TestDataDir();
+  const std::string cache_dir = JoinPath(dir, "cache");
+  const std::string data_file_prefix_0 = JoinPath(dir, "0/corpus");
+  const std::string data_file_prefix_1 = JoinPath(dir, "1/corpus");
+  LocalFS()->RecursivelyCreateDir(cache_dir);
+  LocalFS()->RecursivelyCreateDir(Dirname(data_file_prefix_0));
+  LocalFS()->RecursivelyCreateDir(Dirname(data_file_prefix_1));
+  WriteCorpus(data_file_prefix_0, 500, 0);
+  WriteCorpus(data_file_prefix_1, 500, 1);
+  const std::vector<int64_t> samples_0 = GetSamplesInMemory(data_file_prefix_0);
+  const std::vector<int64_t> samples_1 = GetSamplesInMemory(data_file_prefix_1);
+  ASSERT_NE(samples_0, samples_1);
+  setenv("ONEFLOW_GPT_DATASET_INDEX_CACHE_DIR", cache_dir.c_str(), 1);
+  // data files of the same name get caches of their own in the cache directory
+  FOR_RANGE(int, i, 0, 2) {
+    ASSERT_EQ(GetSamples(data_file_prefix_0), samples_0);
+    ASSERT_EQ(GetSamples(data_file_prefix_1), samples_1);
+  }
+  unsetenv("ONEFLOW_GPT_DATASET_INDEX_CACHE_DIR");
+  ASSERT_EQ(ListIndexCaches(cache_dir).size(), 2);
+  ASSERT_TRUE(ListIndexCaches(Dirname(data_file_prefix_0)).empty());
+  ASSERT_TRUE(ListIndexCaches(Dirname(data_file_prefix_1)).empty());
+  LocalFS()->RecursivelyDeleteDir(dir);
+}
+
+}  // namespace test
+
+}  // namespace data
+
+}  // namespace oneflow
+
+#endif  // __linux__
@@ -20,15 +20,21 @@ limitations under the License.
 #include "oneflow/core/common/multi_client.h"
 #include "oneflow/core/common/str_util.h"
 #include "oneflow/core/framework/op_kernel.h"
-#include "oneflow/core/persistence/persistent_in_stream.h"
 #include "oneflow/core/job/job_set.pb.h"
 #include "oneflow/core/rpc/include/global_process_ctx.h"
 #include "oneflow/core/job/env_desc.h"
 #include "oneflow/user/data/dataset.h"
+#include "oneflow/user/data/ofrecord_readahead.h"
 
 namespace oneflow {
 namespace data {
 
+// Released records kept by OFRecordDataset for reuse.
+constexpr size_t kOFRecordDatasetMaxFreeRecordCnt = 4096;
+
+// Records are read by OFRecordReadahead with ONEFLOW_OFRECORD_READAHEAD_PARTS (1 by default) part
+// files open at a time. Opening more parts interleaves their records, which keeps more reads in
+// flight on network storage but changes the order of records.
 class OFRecordDataset final : public Dataset<TensorBuffer> {
  public:
   using LoadTargetPtr = std::shared_ptr<TensorBuffer>;
@@ -74,40 +80,41 @@ class OFRecordDataset final : public Dataset<TensorBuffer> {
     CHECK_LE(parallel_num_, data_part_num_);
     BalancedSplitter bs(data_part_num_, parallel_num_);
     range_ = bs.At(parallel_id_);
-    std::vector<std::string> local_file_paths = GetLocalFilePaths();
-    in_stream_.reset(
-        new PersistentInStream(DataFS(), local_file_paths, !shuffle_after_epoch_, false));
+    num_open_parts_ = ParseIntegerFromEnv("ONEFLOW_OFRECORD_READAHEAD_PARTS", 1);
+    CHECK_GT(num_open_parts_, 0);
+    record_pool_ = std::make_shared<TensorBufferPool>(kOFRecordDatasetMaxFreeRecordCnt);
+    ResetReadahead();
   }
   ~OFRecordDataset() = default;
 
-  LoadTargetPtrList Next() override {
-    LoadTargetPtrList ret;
-    LoadTargetPtr sample_ptr(new TensorBuffer());
-    ReadSample(*sample_ptr);
-    ret.emplace_back(std::move(sample_ptr));
+  LoadTargetPtrList Next() override { return NextBatch(1); }
+
+  LoadTargetPtrList NextBatch(size_t n) override {
+    LoadTargetPtrList ret(n);
+    for (auto& sample_ptr : ret) { ReadSample(&sample_ptr); }
     return ret;
   }
 
  private:
-  void ReadSample(TensorBuffer& tensor) {
-    int64_t OFRecord_size = -1;
-    char* size_ptr = reinterpret_cast<char*>(&OFRecord_size);
-    if (in_stream_->ReadFully(size_ptr, sizeof(int64_t)) != 0) {
-      ShuffleAfterEpoch();
-      CHECK_EQ(in_stream_->ReadFully(size_ptr, sizeof(int64_t)), 0);
+  void ReadSample(LoadTargetPtr* sample_ptr) {
+    if (!readahead_->Next(sample_ptr)) {
+      // starts the next epoch
+      if (shuffle_after_epoch_) { ShuffleAfterEpoch(); }
+      ResetReadahead();
+      CHECK(readahead_->Next(sample_ptr));
     }
-    CHECK_GT(OFRecord_size, 0);
-    tensor.Resize(Shape({OFRecord_size}), DataType::kChar);
-    CHECK_EQ(in_stream_->ReadFully(tensor.mut_data<char>(), OFRecord_size), 0);
   }
 
   void ShuffleAfterEpoch() {
-    CHECK(shuffle_after_epoch_);
     current_epoch_++;  // move to next epoch
     std::mt19937 g(kOneflowDatasetSeed + current_epoch_);
     std::shuffle(data_file_paths_.begin(), data_file_paths_.end(), g);
-    std::vector<std::string> local_file_paths = GetLocalFilePaths();
-    in_stream_.reset(new PersistentInStream(DataFS(), local_file_paths, false, false));
+  }
+
+  void ResetReadahead() {
+    readahead_.reset();
+    readahead_.reset(
+        new OFRecordReadahead(DataFS(), GetLocalFilePaths(), num_open_parts_, record_pool_));
   }
 
   std::vector<std::string> GetLocalFilePaths() {
@@ -126,7 +133,9 @@ class OFRecordDataset final : public Dataset<TensorBuffer> {
   int32_t parallel_num_;
   Range range_;
   std::vector<std::string> data_file_paths_;
-  std::unique_ptr<PersistentInStream> in_stream_;
+  int32_t num_open_parts_;
+  std::shared_ptr<TensorBufferPool> record_pool_;
+  std::unique_ptr<OFRecordReadahead> readahead_;
 };
 
 }  // namespace data
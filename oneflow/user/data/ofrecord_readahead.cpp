@@ -0,0 +1,125 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/data/ofrecord_readahead.h"
+#include "oneflow/core/persistence/persistent_in_stream.h"
+
+namespace oneflow {
+namespace data {
+
+namespace {
+
+// Records read by a part thread at a time, and chunks it may read ahead of the consumer.
+constexpr size_t kOFRecordReadaheadChunkSize = 64;
+constexpr size_t kOFRecordReadaheadMaxChunkCnt = 4;
+
+}  // namespace
+
+TensorBufferPool::TensorBufferPool(size_t max_free_cnt)
+    : max_free_cnt_(max_free_cnt), free_list_(std::make_shared<FreeList>()) {}
+
+std::shared_ptr<TensorBuffer> TensorBufferPool::Get() {
+  std::unique_ptr<TensorBuffer> buffer;
+  {
+    std::lock_guard<std::mutex> lock(free_list_->mutex);
+    if (!free_list_->buffers.empty()) {
+      buffer = std::move(free_list_->buffers.back());
+      free_list_->buffers.pop_back();
+    }
+  }
+  if (!buffer) { buffer.reset(new TensorBuffer()); }
+  std::shared_ptr<FreeList> free_list = free_list_;
+  const size_t max_free_cnt = max_free_cnt_;
+  const auto Release = [free_list, max_free_cnt](TensorBuffer* released) {
+    std::unique_ptr<TensorBuffer> released_buffer(released);
+    std::lock_guard<std::mutex> lock(free_list->mutex);
+    if (free_list->buffers.size() < max_free_cnt) {
+      free_list->buffers.emplace_back(std::move(released_buffer));
+    }
+  };
+  return std::shared_ptr<TensorBuffer>(buffer.release(), Release);
+}
+
+OFRecordReadahead::OFRecordReadahead(fs::FileSystem* fs, const std::vector<std::string>& file_paths,
+                                     int32_t num_open_parts, std::shared_ptr<TensorBufferPool> pool)
+    : pool_(std::move(pool)), cur_part_(0), num_done_parts_(0) {
+  CHECK_GT(num_open_parts, 0);
+  const size_t num_parts = std::min(static_cast<size_t>(num_open_parts), file_paths.size());
+  FOR_RANGE(size_t, i, 0, num_parts) {
+    std::vector<std::string> part_file_paths;
+    for (size_t j = i; j < file_paths.size(); j += num_parts) {
+      part_file_paths.emplace_back(file_paths.at(j));
+    }
+    parts_.emplace_back(new Part(kOFRecordReadaheadMaxChunkCnt));
+    Part* part = parts_.back().get();
+    part->read_thread = std::thread(&OFRecordReadahead::ReadPart, this, fs, part_file_paths, part);
+  }
+}
+
+OFRecordReadahead::~OFRecordReadahead() {
+  for (auto& part : parts_) {
+    part->chunks.Close();
+    part->read_thread.join();
+  }
+}
+
+void OFRecordReadahead::ReadPart(fs::FileSystem* fs, std::vector<std::string> file_paths,
+                                 Part* part) {
+  PersistentInStream in_stream(fs, file_paths, false, false);
+  bool is_eof = false;
+  while (!is_eof) {
+    auto chunk = std::make_shared<Chunk>();
+    chunk->reserve(kOFRecordReadaheadChunkSize);
+    while (chunk->size() < kOFRecordReadaheadChunkSize) {
+      int64_t record_size = -1;
+      if (in_stream.ReadFully(reinterpret_cast<char*>(&record_size), sizeof(int64_t)) != 0) {
+        is_eof = true;
+        break;
+      }
+      CHECK_GT(record_size, 0);
+      std::shared_ptr<TensorBuffer> record = pool_->Get();
+      record->Resize(Shape({record_size}), DataType::kChar);
+      CHECK_EQ(in_stream.ReadFully(record->mut_data<char>(), record_size), 0);
+      chunk->emplace_back(std::move(record));
+    }
+    if (chunk->empty()) { break; }
+    // closed by the destructor
+    if (part->chunks.Push(chunk) != kBufferStatusSuccess) { return; }
+  }
+  part->chunks.Close();
+}
+
+bool OFRecordReadahead::Next(std::shared_ptr<TensorBuffer>* record) {
+  while (num_done_parts_ < parts_.size()) {
+    Part* part = parts_.at(cur_part_).get();
+    if (!part->is_done && (!part->cur_chunk || part->cur_record == part->cur_chunk->size())) {
+      part->cur_chunk.reset();
+      part->cur_record = 0;
+      if (part->chunks.Pull(&part->cur_chunk) != kBufferStatusSuccess) {
+        part->is_done = true;
+        num_done_parts_ += 1;
+      }
+    }
+    cur_part_ = (cur_part_ + 1) % parts_.size();
+    if (part->is_done) { continue; }
+    *record = std::move(part->cur_chunk->at(part->cur_record));
+    part->cur_record += 1;
+    return true;
+  }
+  return false;
+}
+
+}  // namespace data
+}  // namespace oneflow
@@ -0,0 +1,81 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_DATA_OFRECORD_READAHEAD_H_
+#define ONEFLOW_USER_DATA_OFRECORD_READAHEAD_H_
+
+#include "oneflow/core/common/buffer.h"
+#include "oneflow/core/common/tensor_buffer.h"
+#include "oneflow/core/persistence/file_system.h"
+
+namespace oneflow {
+namespace data {
+
+// Recycles the TensorBuffers of records, so that a record reuses the memory of a released one
+// instead of allocating its own. The pool lives as long as any buffer taken from it.
+class TensorBufferPool final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(TensorBufferPool);
+  explicit TensorBufferPool(size_t max_free_cnt);
+  ~TensorBufferPool() = default;
+
+  std::shared_ptr<TensorBuffer> Get();
+
+ private:
+  struct FreeList {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<TensorBuffer>> buffers;
+  };
+  size_t max_free_cnt_;
+  std::shared_ptr<FreeList> free_list_;
+};
+
+// Reads the OFRecords of part files with num_open_parts of them open at a time. Open part i is
+// file_paths[i], file_paths[i + num_open_parts], ... read in sequence by a thread of its own,
+// which reads chunks of records ahead of the consumer. Next takes the records round-robin from
+// the open parts, so their order only depends on file_paths and num_open_parts.
+class OFRecordReadahead final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(OFRecordReadahead);
+  OFRecordReadahead(fs::FileSystem* fs, const std::vector<std::string>& file_paths,
+                    int32_t num_open_parts, std::shared_ptr<TensorBufferPool> pool);
+  ~OFRecordReadahead();
+
+  // Returns false when all the records of file_paths have been read.
+  bool Next(std::shared_ptr<TensorBuffer>* record);
+
+ private:
+  using Chunk = std::vector<std::shared_ptr<TensorBuffer>>;
+  struct Part {
+    explicit Part(size_t max_chunk_cnt) : chunks(max_chunk_cnt), cur_record(0), is_done(false) {}
+    Buffer<std::shared_ptr<Chunk>> chunks;
+    std::shared_ptr<Chunk> cur_chunk;
+    size_t cur_record;
+    bool is_done;
+    std::thread read_thread;
+  };
+
+  void ReadPart(fs::FileSystem* fs, std::vector<std::string> file_paths, Part* part);
+
+  std::shared_ptr<TensorBufferPool> pool_;
+  std::vector<std::unique_ptr<Part>> parts_;
+  size_t cur_part_;
+  size_t num_done_parts_;
+};
+
+}  // namespace data
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_DATA_OFRECORD_READAHEAD_H_
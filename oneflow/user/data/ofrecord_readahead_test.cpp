@@ -0,0 +1,201 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "oneflow/user/data/ofrecord_readahead.h"
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/persistence/persistent_in_stream.h"
+
+namespace oneflow {
+namespace data {
+namespace test {
+
+namespace {
+
+// Writes part files of num_records[i] records each, whose contents are their global ids.
+std::vector<std::string> WriteParts(const std::string& dir,
+                                    const std::vector<int64_t>& num_records) {
+  if (LocalFS()->IsDirectory(dir)) { LocalFS()->RecursivelyDeleteDir(dir); }
+  LocalFS()->RecursivelyCreateDir(dir);
+  std::vector<std::string> file_paths;
+  int64_t record_id = 0;
+  FOR_RANGE(size_t, i, 0, num_records.size()) {
+    file_paths.emplace_back(JoinPath(dir, "part-" + std::to_string(i)));
+    std::ofstream out_stream(file_paths.back(), std::ios::binary);
+    FOR_RANGE(int64_t, j, 0, num_records.at(i)) {
+      // records of different sizes
+      const std::string record = std::to_string(record_id) + std::string(record_id % 37, ' ');
+      const int64_t record_size = record.size();
+      out_stream.write(reinterpret_cast<const char*>(&record_size), sizeof(record_size));
+      out_stream.write(record.data(), record_size);
+      record_id += 1;
+    }
+  }
+  return file_paths;
+}
+
+int64_t RecordId(const TensorBuffer& record) {
+  return std::stoll(std::string(record.data<char>(), record.elem_cnt()));
+}
+
+// Reads the records of file_paths in sequence through one PersistentInStream, as OFRecordDataset
+// did before OFRecordReadahead.
+std::vector<int64_t> ReadRecordIdsInSequence(const std::vector<std::string>& file_paths) {
+  PersistentInStream in_stream(LocalFS(), file_paths, false, false);
+  std::vector<int64_t> record_ids;
+  int64_t record_size = -1;
+  while (in_stream.ReadFully(reinterpret_cast<char*>(&record_size), sizeof(int64_t)) == 0) {
+    std::string record(record_size, '\0');
+    CHECK_EQ(in_stream.ReadFully(&record.front(), record_size), 0);
+    record_ids.emplace_back(std::stoll(record));
+  }
+  return record_ids;
+}
+
+// Open part i reads files i, i + num_open_parts, ..., and the parts take turns by record.
+std::vector<int64_t> GetInterleavedRecordIds(const std::vector<std::string>& file_paths,
+                                             int32_t num_open_parts) {
+  const size_t num_parts = std::min(static_cast<size_t>(num_open_parts), file_paths.size());
+  std::vector<std::vector<int64_t>> part2record_ids(num_parts);
+  FOR_RANGE(size_t, i, 0, file_paths.size()) {
+    const std::vector<int64_t> record_ids = ReadRecordIdsInSequence({file_paths.at(i)});
+    std::vector<int64_t>& part_record_ids = part2record_ids.at(i % num_parts);
+    part_record_ids.insert(part_record_ids.end(), record_ids.cbegin(), record_ids.cend());
+  }
+  std::vector<int64_t> record_ids;
+  bool has_record = true;
+  for (size_t j = 0; has_record; ++j) {
+    has_record = false;
+    for (const auto& part_record_ids : part2record_ids) {
+      if (j < part_record_ids.size()) {
+        record_ids.emplace_back(part_record_ids.at(j));
+        has_record = true;
+      }
+    }
+  }
+  return record_ids;
+}
+
+std::vector<int64_t> ReadRecordIds(OFRecordReadahead* readahead, size_t max_cnt) {
+  std::vector<int64_t> record_ids;
+  std::shared_ptr<TensorBuffer> record;
+  while (record_ids.size() < max_cnt && readahead->Next(&record)) {
+    record_ids.emplace_back(RecordId(*record));
+  }
+  return record_ids;
+}
+
+std::string TestDataDir(const std::string& name) {
+  std::string current_dir = GetCwd();
+  StringReplace(&current_dir, '\\', '/');
+  return JoinPath(current_dir, "tmp_ofrecord_readahead_test_" + name);
+}
+
+}  // namespace
+
+TEST(OFRecordReadahead, order) {
+  const std::string dir = TestDataDir("order");
+  // parts shorter than a chunk of 64 records, and parts ending on or around chunk boundaries
+  const std::vector<std::string> file_paths = WriteParts(dir, {1, 63, 2, 64, 65, 128, 129, 200});
+  const auto pool = std::make_shared<TensorBufferPool>(1024);
+  const std::vector<int64_t> sequence = ReadRecordIdsInSequence(file_paths);
+  ASSERT_EQ(sequence.size(), 652);
+  for (int32_t num_open_parts : {1, 2, 3, 8, 11}) {
+    const std::vector<int64_t> expected =
+        num_open_parts == 1 ? sequence : GetInterleavedRecordIds(file_paths, num_open_parts);
+    ASSERT_EQ(expected.size(), sequence.size());
+    OFRecordReadahead readahead(LocalFS(), file_paths, num_open_parts, pool);
+    ASSERT_EQ(ReadRecordIds(&readahead, SIZE_MAX), expected) << num_open_parts;
+    std::shared_ptr<TensorBuffer> record;
+    ASSERT_FALSE(readahead.Next(&record));
+  }
+  LocalFS()->RecursivelyDeleteDir(dir);
+}
+
+TEST(OFRecordReadahead, reset) {
+  const std::string dir = TestDataDir("reset");
+  const std::vector<std::string> file_paths = WriteParts(dir, {500, 300, 700});
+  const auto pool = std::make_shared<TensorBufferPool>(1024);
+  for (int32_t num_open_parts : {1, 2, 4}) {
+    const std::vector<int64_t> expected = GetInterleavedRecordIds(file_paths, num_open_parts);
+    // each epoch replaces the readahead, as OFRecordDataset::ResetReadahead does, while its part
+    // threads are still reading ahead
+    std::unique_ptr<OFRecordReadahead> readahead;
+    for (size_t epoch_cnt : {0, 1, 100, 777}) {
+      readahead.reset();
+      readahead.reset(new OFRecordReadahead(LocalFS(), file_paths, num_open_parts, pool));
+      const std::vector<int64_t> record_ids = ReadRecordIds(readahead.get(), epoch_cnt);
+      ASSERT_TRUE(std::equal(record_ids.cbegin(), record_ids.cend(), expected.cbegin()));
+    }
+    readahead.reset();
+    readahead.reset(new OFRecordReadahead(LocalFS(), file_paths, num_open_parts, pool));
+    ASSERT_EQ(ReadRecordIds(readahead.get(), SIZE_MAX), expected);
+  }
+  LocalFS()->RecursivelyDeleteDir(dir);
+}
+
+TEST(TensorBufferPool, reuse) {
+  std::vector<TensorBuffer*> buffers;
+  {
+    auto pool = std::make_shared<TensorBufferPool>(2);
+    std::shared_ptr<TensorBuffer> buffer_0 = pool->Get();
+    std::shared_ptr<TensorBuffer> buffer_1 = pool->Get();
+    std::shared_ptr<TensorBuffer> buffer_2 = pool->Get();
+    buffer_0->Resize(Shape({1024}), DataType::kChar);
+    const char* data_0 = buffer_0->data<char>();
+    buffers = {buffer_0.get(), buffer_1.get(), buffer_2.get()};
+    buffer_0.reset();
+    buffer_1.reset();
+    // more than max_free_cnt released buffers are freed
+    buffer_2.reset();
+    std::shared_ptr<TensorBuffer> reused_1 = pool->Get();
+    std::shared_ptr<TensorBuffer> reused_0 = pool->Get();
+    ASSERT_EQ(reused_1.get(), buffers.at(1));
+    ASSERT_EQ(reused_0.get(), buffers.at(0));
+    // a reused buffer keeps its memory
+    ASSERT_EQ(reused_0->elem_cnt(), 1024);
+    reused_0->Resize(Shape({1000}), DataType::kChar);
+    ASSERT_EQ(reused_0->data<char>(), data_0);
+    // buffers may outlive the pool
+    pool.reset();
+    reused_0.reset();
+  }
+}
+
+TEST(OFRecordReadahead, reuse_records) {
+  const std::string dir = TestDataDir("reuse_records");
+  const std::vector<std::string> file_paths = WriteParts(dir, {2000, 2000});
+  const auto pool = std::make_shared<TensorBufferPool>(4096);
+  for (int32_t num_open_parts : {1, 2}) {
+    OFRecordReadahead readahead(LocalFS(), file_paths, num_open_parts, pool);
+    HashSet<const TensorBuffer*> records;
+    std::shared_ptr<TensorBuffer> record;
+    size_t record_cnt = 0;
+    while (readahead.Next(&record)) {
+      records.insert(record.get());
+      record_cnt += 1;
+    }
+    ASSERT_EQ(record_cnt, 4000);
+    // a part holds at most 6 chunks of 64 records, the ones it reads ahead, the one it reads and
+    // the one the consumer takes from, so the other records reuse released buffers
+    ASSERT_LE(records.size(), num_open_parts * 6 * 64 + 1);
+  }
+  LocalFS()->RecursivelyDeleteDir(dir);
+}
+
+}  // namespace test
+}  // namespace data
+}  // namespace oneflow
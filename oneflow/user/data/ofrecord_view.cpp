@@ -0,0 +1,241 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/data/ofrecord_view.h"
+
+namespace oneflow {
+namespace data {
+
+namespace {
+
+enum WireType {
+  kWireTypeVarint = 0,
+  kWireTypeFixed64 = 1,
+  kWireTypeLengthDelimited = 2,
+  kWireTypeFixed32 = 5,
+};
+
+struct WireField {
+  uint32_t number;
+  int32_t wire_type;
+  uint64_t varint;
+  // value of fixed and length delimited fields
+  OFRecordBytesView bytes;
+};
+
+bool ReadVarint(const char** ptr, const char* end, uint64_t* value) {
+  uint64_t result = 0;
+  for (int32_t shift = 0; shift < 64 && *ptr < end; shift += 7) {
+    const uint8_t byte = static_cast<uint8_t>(**ptr);
+    *ptr += 1;
+    result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      *value = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Reads the field at *ptr and moves *ptr past it. Returns false if the message is malformed.
+bool ReadField(const char** ptr, const char* end, WireField* field) {
+  uint64_t tag = 0;
+  if (!ReadVarint(ptr, end, &tag)) { return false; }
+  field->number = static_cast<uint32_t>(tag >> 3);
+  field->wire_type = static_cast<int32_t>(tag & 0x7);
+  size_t size = 0;
+  switch (field->wire_type) {
+    case kWireTypeVarint: return ReadVarint(ptr, end, &field->varint);
+    case kWireTypeFixed64: size = 8; break;
+    case kWireTypeFixed32: size = 4; break;
+    case kWireTypeLengthDelimited: {
+      uint64_t length = 0;
+      if (!ReadVarint(ptr, end, &length)) { return false; }
+      size = length;
+      break;
+    }
+    default: return false;
+  }
+  if (size > static_cast<size_t>(end - *ptr)) { return false; }
+  field->bytes.data = *ptr;
+  field->bytes.size = size;
+  *ptr += size;
+  return true;
+}
+
+// Calls Visit on the fields of each message in messages.
+template<typename F>
+void ForEachField(const std::vector<OFRecordBytesView>& messages, const F& Visit) {
+  for (const OFRecordBytesView& message : messages) {
+    const char* ptr = message.data;
+    const char* end = message.data + message.size;
+    WireField field{};
+    while (ptr < end) {
+      CHECK(ReadField(&ptr, end, &field)) << "malformed OFRecord";
+      Visit(field);
+    }
+  }
+}
+
+template<typename T>
+T LoadUnaligned(const char* ptr) {
+  T value;
+  std::memcpy(&value, ptr, sizeof(T));
+  return value;
+}
+
+// Calls Visit on the values of a numeric list, which may be packed or not.
+template<typename F>
+void ForEachNumericValue(Feature::KindCase kind, const std::vector<OFRecordBytesView>& lists,
+                         const F& Visit) {
+  ForEachField(lists, [&](const WireField& field) {
+    if (field.number != 1) { return; }
+    if (kind == Feature::kFloatList || kind == Feature::kDoubleList) {
+      const size_t value_bytes = kind == Feature::kFloatList ? sizeof(float) : sizeof(double);
+      const int32_t unpacked_wire_type =
+          kind == Feature::kFloatList ? kWireTypeFixed32 : kWireTypeFixed64;
+      CHECK(field.wire_type == kWireTypeLengthDelimited || field.wire_type == unpacked_wire_type)
+          << "malformed OFRecord";
+      CHECK_EQ(field.bytes.size % value_bytes, 0) << "malformed OFRecord";
+      for (size_t offset = 0; offset < field.bytes.size; offset += value_bytes) {
+        if (kind == Feature::kFloatList) {
+          Visit(LoadUnaligned<float>(field.bytes.data + offset));
+        } else {
+          Visit(LoadUnaligned<double>(field.bytes.data + offset));
+        }
+      }
+    } else if (field.wire_type == kWireTypeVarint) {
+      Visit(field.varint);
+    } else {
+      CHECK_EQ(field.wire_type, kWireTypeLengthDelimited) << "malformed OFRecord";
+      const char* ptr = field.bytes.data;
+      const char* end = field.bytes.data + field.bytes.size;
+      uint64_t value = 0;
+      while (ptr < end) {
+        CHECK(ReadVarint(&ptr, end, &value)) << "malformed OFRecord";
+        Visit(value);
+      }
+    }
+  });
+}
+
+template<typename T>
+struct ValueConverter {
+  const Feature::KindCase kind;
+  T operator()(float value) const { return static_cast<T>(value); }
+  T operator()(double value) const { return static_cast<T>(value); }
+  // int32 and int64 are varints of their two's complement
+  T operator()(uint64_t value) const {
+    return kind == Feature::kInt32List ? static_cast<T>(static_cast<int32_t>(value))
+                                       : static_cast<T>(static_cast<int64_t>(value));
+  }
+};
+
+}  // namespace
+
+int64_t OFRecordFeatureView::value_size() const {
+  int64_t size = 0;
+  if (kind_ == Feature::kBytesList) {
+    ForEachField(lists_, [&](const WireField& field) {
+      if (field.number == 1 && field.wire_type == kWireTypeLengthDelimited) { size += 1; }
+    });
+  } else if (kind_ != Feature::KIND_NOT_SET) {
+    ForEachNumericValue(kind_, lists_, [&](auto) { size += 1; });
+  }
+  return size;
+}
+
+OFRecordBytesView OFRecordFeatureView::bytes_value(int64_t i) const {
+  CHECK(has_bytes_list());
+  CHECK_GE(i, 0);
+  OFRecordBytesView value{nullptr, 0};
+  int64_t index = 0;
+  ForEachField(lists_, [&](const WireField& field) {
+    if (field.number != 1 || field.wire_type != kWireTypeLengthDelimited) { return; }
+    if (index == i) { value = field.bytes; }
+    index += 1;
+  });
+  CHECK_LT(i, index);
+  return value;
+}
+
+template<typename T>
+void OFRecordFeatureView::CopyValues(int64_t n, T* dst) const {
+  CHECK(kind_ != Feature::KIND_NOT_SET && kind_ != Feature::kBytesList);
+  const ValueConverter<T> Convert{kind_};
+  int64_t index = 0;
+  ForEachNumericValue(kind_, lists_, [&](auto value) {
+    if (index < n) { dst[index] = Convert(value); }
+    index += 1;
+  });
+  CHECK_LE(n, index);
+}
+
+bool OFRecordView::FindFeature(const std::string& name, OFRecordFeatureView* feature) const {
+  bool found = false;
+  // OFRecord.feature is a map, whose entries have the key as field 1 and the value as field 2.
+  // As in protobuf, the last entry of a key wins, and the fields of a message are merged.
+  ForEachField({OFRecordBytesView{data_, size_}}, [&](const WireField& record_field) {
+    if (record_field.number != 1 || record_field.wire_type != kWireTypeLengthDelimited) {
+      return;
+    }
+    bool is_key_matched = name.empty();
+    std::vector<OFRecordBytesView> values;
+    ForEachField({record_field.bytes}, [&](const WireField& entry_field) {
+      if (entry_field.wire_type != kWireTypeLengthDelimited) { return; }
+      if (entry_field.number == 1) {
+        is_key_matched = entry_field.bytes.size == name.size()
+                         && std::memcmp(entry_field.bytes.data, name.data(), name.size()) == 0;
+      } else if (entry_field.number == 2) {
+        values.emplace_back(entry_field.bytes);
+      }
+    });
+    if (!is_key_matched) { return; }
+    found = true;
+    feature->kind_ = Feature::KIND_NOT_SET;
+    feature->lists_.clear();
+    ForEachField(values, [&](const WireField& feature_field) {
+      if (feature_field.wire_type != kWireTypeLengthDelimited
+          || feature_field.number < Feature::kBytesList
+          || feature_field.number > Feature::kInt64List) {
+        return;
+      }
+      const auto kind = static_cast<Feature::KindCase>(feature_field.number);
+      // setting another member of the oneof clears the former one
+      if (kind != feature->kind_) {
+        feature->kind_ = kind;
+        feature->lists_.clear();
+      }
+      feature->lists_.emplace_back(feature_field.bytes);
+    });
+  });
+  return found;
+}
+
+#define INSTANTIATE_OFRECORD_FEATURE_VIEW_COPY_VALUES(T) \
+  template void OFRecordFeatureView::CopyValues<T>(int64_t n, T* dst) const;
+
+INSTANTIATE_OFRECORD_FEATURE_VIEW_COPY_VALUES(char)
+INSTANTIATE_OFRECORD_FEATURE_VIEW_COPY_VALUES(float)
+INSTANTIATE_OFRECORD_FEATURE_VIEW_COPY_VALUES(double)
+INSTANTIATE_OFRECORD_FEATURE_VIEW_COPY_VALUES(int8_t)
+INSTANTIATE_OFRECORD_FEATURE_VIEW_COPY_VALUES(uint8_t)
+INSTANTIATE_OFRECORD_FEATURE_VIEW_COPY_VALUES(int32_t)
+INSTANTIATE_OFRECORD_FEATURE_VIEW_COPY_VALUES(int64_t)
+
+#undef INSTANTIATE_OFRECORD_FEATURE_VIEW_COPY_VALUES
+
+}  // namespace data
+}  // namespace oneflow
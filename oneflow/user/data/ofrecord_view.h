@@ -0,0 +1,79 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_DATA_OFRECORD_VIEW_H_
+#define ONEFLOW_USER_DATA_OFRECORD_VIEW_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/record/record.pb.h"
+
+namespace oneflow {
+namespace data {
+
+struct OFRecordBytesView {
+  const char* data;
+  size_t size;
+};
+
+// A Feature of a serialized OFRecord, read from the protobuf wire format in place. Bytes values
+// point into the serialized record, so it must outlive the view.
+class OFRecordFeatureView final {
+ public:
+  OFRecordFeatureView() : kind_(Feature::KIND_NOT_SET) {}
+  ~OFRecordFeatureView() = default;
+
+  Feature::KindCase kind() const { return kind_; }
+  bool has_bytes_list() const { return kind_ == Feature::kBytesList; }
+  bool has_float_list() const { return kind_ == Feature::kFloatList; }
+  bool has_double_list() const { return kind_ == Feature::kDoubleList; }
+  bool has_int32_list() const { return kind_ == Feature::kInt32List; }
+  bool has_int64_list() const { return kind_ == Feature::kInt64List; }
+
+  // Number of values of the list.
+  int64_t value_size() const;
+  // The i-th value of a bytes list.
+  OFRecordBytesView bytes_value(int64_t i) const;
+  // Converts the first n values of a numeric list to T.
+  template<typename T>
+  void CopyValues(int64_t n, T* dst) const;
+
+ private:
+  friend class OFRecordView;
+
+  Feature::KindCase kind_;
+  // serialized list messages of kind_, which are merged in order
+  std::vector<OFRecordBytesView> lists_;
+};
+
+// Finds features of a serialized OFRecord by scanning its protobuf wire format, without parsing
+// the other features or copying values. Decoders which need a few features of large records use
+// it instead of OFRecord::ParseFromArray.
+class OFRecordView final {
+ public:
+  OFRecordView(const char* data, size_t size) : data_(data), size_(size) {}
+  ~OFRecordView() = default;
+
+  // Returns false if the record has no feature of name.
+  bool FindFeature(const std::string& name, OFRecordFeatureView* feature) const;
+
+ private:
+  const char* data_;
+  size_t size_;
+};
+
+}  // namespace data
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_DATA_OFRECORD_VIEW_H_
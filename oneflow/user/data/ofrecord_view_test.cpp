@@ -0,0 +1,256 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "oneflow/user/data/ofrecord_view.h"
+#include "oneflow/core/common/protobuf.h"
+
+namespace oneflow {
+namespace data {
+namespace test {
+
+namespace {
+
+std::string EncodeVarint(uint64_t value) {
+  std::string encoded;
+  while (value >= 0x80) {
+    encoded.push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  encoded.push_back(static_cast<char>(value));
+  return encoded;
+}
+
+std::string EncodeTag(uint32_t number, int32_t wire_type) {
+  return EncodeVarint((static_cast<uint64_t>(number) << 3) | wire_type);
+}
+
+std::string EncodeLengthDelimited(uint32_t number, const std::string& bytes) {
+  return EncodeTag(number, 2) + EncodeVarint(bytes.size()) + bytes;
+}
+
+template<typename T>
+std::string EncodeFixed(uint32_t number, T value) {
+  std::string encoded = EncodeTag(number, sizeof(T) == 4 ? 5 : 1);
+  encoded.append(reinterpret_cast<const char*>(&value), sizeof(T));
+  return encoded;
+}
+
+// An entry of OFRecord.feature whose value is given as serialized Feature messages, which are
+// merged when there are several.
+std::string EncodeFeatureEntry(const std::string& name, const std::vector<std::string>& values) {
+  std::string entry = EncodeLengthDelimited(1, name);
+  for (const std::string& value : values) { entry += EncodeLengthDelimited(2, value); }
+  return EncodeLengthDelimited(1, entry);
+}
+
+template<typename T>
+void CheckNumericValues(const OFRecordFeatureView& view, const std::vector<T>& expected) {
+  ASSERT_EQ(view.value_size(), expected.size());
+  std::vector<T> values(expected.size());
+  view.CopyValues(values.size(), values.data());
+  ASSERT_EQ(values, expected);
+  std::vector<double> double_values(expected.size());
+  view.CopyValues(double_values.size(), double_values.data());
+  FOR_RANGE(size_t, i, 0, expected.size()) {
+    ASSERT_EQ(double_values.at(i), static_cast<double>(expected.at(i)));
+  }
+}
+
+void CheckFeature(const OFRecordFeatureView& view, const Feature& expected) {
+  ASSERT_EQ(view.kind(), expected.kind_case());
+  switch (expected.kind_case()) {
+    case Feature::kBytesList: {
+      ASSERT_EQ(view.value_size(), expected.bytes_list().value_size());
+      FOR_RANGE(int64_t, i, 0, view.value_size()) {
+        const OFRecordBytesView bytes = view.bytes_value(i);
+        ASSERT_EQ(std::string(bytes.data, bytes.size), expected.bytes_list().value(i));
+      }
+      break;
+    }
+    case Feature::kFloatList: {
+      CheckNumericValues(view, PbRf2StdVec(expected.float_list().value()));
+      break;
+    }
+    case Feature::kDoubleList: {
+      CheckNumericValues(view, PbRf2StdVec(expected.double_list().value()));
+      break;
+    }
+    case Feature::kInt32List: {
+      const std::vector<int32_t> values = PbRf2StdVec(expected.int32_list().value());
+      CheckNumericValues(view, values);
+      CheckNumericValues(view, std::vector<int64_t>(values.cbegin(), values.cend()));
+      break;
+    }
+    case Feature::kInt64List: {
+      CheckNumericValues(view, PbRf2StdVec(expected.int64_list().value()));
+      break;
+    }
+    default: ASSERT_EQ(view.value_size(), 0);
+  }
+}
+
+// Checks the features of a serialized record against OFRecord::ParseFromString.
+void CheckRecord(const std::string& serialized, const std::vector<std::string>& names) {
+  OFRecord record;
+  ASSERT_TRUE(record.ParseFromString(serialized));
+  const OFRecordView record_view(serialized.data(), serialized.size());
+  for (const std::string& name : names) {
+    OFRecordFeatureView view;
+    const auto it = record.feature().find(name);
+    ASSERT_EQ(record_view.FindFeature(name, &view), it != record.feature().end()) << name;
+    if (it != record.feature().end()) { CheckFeature(view, it->second); }
+  }
+}
+
+Feature Int32Feature(const std::vector<int32_t>& values) {
+  Feature feature;
+  for (int32_t value : values) { feature.mutable_int32_list()->add_value(value); }
+  return feature;
+}
+
+Feature Int64Feature(const std::vector<int64_t>& values) {
+  Feature feature;
+  for (int64_t value : values) { feature.mutable_int64_list()->add_value(value); }
+  return feature;
+}
+
+Feature FloatFeature(const std::vector<float>& values) {
+  Feature feature;
+  for (float value : values) { feature.mutable_float_list()->add_value(value); }
+  return feature;
+}
+
+Feature BytesFeature(const std::vector<std::string>& values) {
+  Feature feature;
+  for (const std::string& value : values) { feature.mutable_bytes_list()->add_value(value); }
+  return feature;
+}
+
+}  // namespace
+
+TEST(OFRecordView, features) {
+  OFRecord record;
+  auto* features = record.mutable_feature();
+  (*features)["bytes"] = BytesFeature({"", "a", std::string(300, 'b'), std::string("\0\1", 2)});
+  (*features)["float"] = FloatFeature({0.5f, -1.25f, 3e10f});
+  Feature double_feature;
+  double_feature.mutable_double_list()->add_value(-0.125);
+  double_feature.mutable_double_list()->add_value(1e300);
+  (*features)["double"] = double_feature;
+  (*features)["int32"] =
+      Int32Feature({0, 1, -1, 127, 128, -300, std::numeric_limits<int32_t>::max(),
+                    std::numeric_limits<int32_t>::min()});
+  (*features)["int64"] = Int64Feature({0, -1, int64_t(1) << 40, std::numeric_limits<int64_t>::max(),
+                                       std::numeric_limits<int64_t>::min()});
+  (*features)["empty_list"] = Int64Feature({});
+  (*features)["empty_feature"] = Feature();
+  (*features)[""] = BytesFeature({"empty key"});
+  CheckRecord(record.SerializeAsString(), {"bytes", "float", "double", "int32", "int64",
+                                           "empty_list", "empty_feature", "", "missing", "int"});
+  // an empty record
+  CheckRecord("", {"", "missing"});
+}
+
+TEST(OFRecordView, duplicate_keys) {
+  OFRecord record_0;
+  (*record_0.mutable_feature())["a"] = Int32Feature({1, -2});
+  (*record_0.mutable_feature())["b"] = BytesFeature({"b0"});
+  OFRecord record_1;
+  (*record_1.mutable_feature())["a"] = FloatFeature({3.5f});
+  OFRecord record_2;
+  (*record_2.mutable_feature())["a"] = Int32Feature({4});
+  (*record_2.mutable_feature())["b"] = BytesFeature({"b2"});
+  // concatenated records are merged, and the last entry of a key replaces the former ones
+  CheckRecord(record_0.SerializeAsString() + record_1.SerializeAsString(), {"a", "b"});
+  CheckRecord(record_0.SerializeAsString() + record_1.SerializeAsString()
+                  + record_2.SerializeAsString(),
+              {"a", "b"});
+  CheckRecord(record_2.SerializeAsString() + record_0.SerializeAsString(), {"a", "b"});
+}
+
+TEST(OFRecordView, merged_features) {
+  const std::string int64_0 = Int64Feature({1, -2}).SerializeAsString();
+  const std::string int64_1 = Int64Feature({3}).SerializeAsString();
+  const std::string int32_0 = Int32Feature({-5, 6}).SerializeAsString();
+  const std::string int32_1 = Int32Feature({7}).SerializeAsString();
+  const std::string bytes_0 = BytesFeature({"x", "y"}).SerializeAsString();
+  const std::string bytes_1 = BytesFeature({"z"}).SerializeAsString();
+  const std::string float_0 = FloatFeature({8.5f}).SerializeAsString();
+  // Feature messages of an entry are merged, lists of the same kind are concatenated and setting
+  // another kind of the oneof clears the former one
+  const std::string serialized =
+      EncodeFeatureEntry("same_kind", {int64_0, int64_1})
+      + EncodeFeatureEntry("same_bytes_kind", {bytes_0, bytes_1})
+      + EncodeFeatureEntry("switched_kind", {int64_0, float_0})
+      + EncodeFeatureEntry("switched_back_kind", {int32_0, bytes_0, int32_1})
+      + EncodeFeatureEntry("switched_after_merge", {int32_0, int32_1, bytes_1})
+      // lists of a single Feature message are merged as well
+      + EncodeFeatureEntry("repeated_list", {int32_0 + int32_1})
+      + EncodeFeatureEntry("repeated_switched_list", {int32_0 + float_0})
+      + EncodeFeatureEntry("no_value", {});
+  CheckRecord(serialized, {"same_kind", "same_bytes_kind", "switched_kind", "switched_back_kind",
+                           "switched_after_merge", "repeated_list", "repeated_switched_list",
+                           "no_value"});
+}
+
+TEST(OFRecordView, unpacked_lists) {
+  std::string unpacked_int32;
+  for (int32_t value : {1, -1, 300, std::numeric_limits<int32_t>::min()}) {
+    // negative int32 values are sign extended to 10 bytes varints
+    unpacked_int32 += EncodeTag(1, 0) + EncodeVarint(static_cast<int64_t>(value));
+  }
+  std::string unpacked_int64;
+  for (int64_t value : {int64_t(-7), std::numeric_limits<int64_t>::max(),
+                        std::numeric_limits<int64_t>::min()}) {
+    unpacked_int64 += EncodeTag(1, 0) + EncodeVarint(value);
+  }
+  std::string unpacked_float;
+  for (float value : {1.5f, -2.0f}) { unpacked_float += EncodeFixed(1, value); }
+  std::string unpacked_double;
+  for (double value : {-3.5, 1e-300}) { unpacked_double += EncodeFixed(1, value); }
+  const std::string packed_int64 = Int64Feature({8, -9}).int64_list().SerializeAsString();
+  const std::string packed_float = FloatFeature({10.25f}).float_list().SerializeAsString();
+  const std::string serialized =
+      EncodeFeatureEntry("int32", {EncodeLengthDelimited(4, unpacked_int32)})
+      + EncodeFeatureEntry("int64", {EncodeLengthDelimited(5, unpacked_int64)})
+      + EncodeFeatureEntry("float", {EncodeLengthDelimited(2, unpacked_float)})
+      + EncodeFeatureEntry("double", {EncodeLengthDelimited(3, unpacked_double)})
+      // packed and unpacked values of a list
+      + EncodeFeatureEntry("mixed_int64",
+                           {EncodeLengthDelimited(5, packed_int64 + unpacked_int64 + packed_int64)})
+      + EncodeFeatureEntry("mixed_float", {EncodeLengthDelimited(2, unpacked_float + packed_float),
+                                           EncodeLengthDelimited(2, packed_float)});
+  CheckRecord(serialized, {"int32", "int64", "float", "double", "mixed_int64", "mixed_float"});
+}
+
+TEST(OFRecordView, unknown_fields) {
+  OFRecord record;
+  (*record.mutable_feature())["a"] = Int32Feature({-1, 2});
+  const std::string unknown_fields = EncodeLengthDelimited(15, std::string(5, '\0'))
+                                     + EncodeTag(14, 0) + EncodeVarint(300)
+                                     + EncodeFixed(13, 1.5f) + EncodeFixed(12, 2.5);
+  const std::string feature = Int64Feature({3, -4}).SerializeAsString() + unknown_fields;
+  const std::string entry =
+      EncodeLengthDelimited(1, EncodeLengthDelimited(1, "b") + unknown_fields
+                                   + EncodeLengthDelimited(2, feature));
+  // unknown fields of the record, of an entry and of a Feature are skipped, as by the padding of
+  // serialized records
+  CheckRecord(unknown_fields + record.SerializeAsString() + unknown_fields + entry, {"a", "b"});
+}
+
+}  // namespace test
+}  // namespace data
+}  // namespace oneflow
@@ -18,6 +18,9 @@ limitations under the License.
 #include "oneflow/core/kernel/new_kernel_util.h"
 #include "oneflow/core/kernel/kernel_util.h"
 #include "oneflow/core/ep/include/primitive/add.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/common/blas.h"
+#include "oneflow/core/thread/thread_pool.h"
 
 namespace oneflow {
 
@@ -35,27 +38,6 @@ using Col2ImFunc = void (*)(const T* col_buf, const ShapeView& in_shape,
                             const int32_t* strides, const int32_t* dilation_rate,
                             const int32_t* padding_before, T* in_diff_ptr);
 
-template<typename T>
-using GemmFunc = void (*)(ep::Stream* stream, enum CBLAS_TRANSPOSE trans_a,
-                          enum CBLAS_TRANSPOSE trans_b, const int m, const int n, const int k,
-                          const T alpha, const T* a, const T* b, const T beta, T* c);
-
-template<typename T>
-void Gemm4ChannelFirst(ep::Stream* stream, enum CBLAS_TRANSPOSE trans_a,
-                       enum CBLAS_TRANSPOSE trans_b, const int m, const int n, const int k,
-                       const T alpha, const T* a, const T* b, const T beta, T* c) {
-  NewKernelUtil<DeviceType::kCPU>::OFGemm(stream, trans_a, trans_b, m, n, k, alpha, a, b, beta, c);
-}
-
-template<typename T>
-void Gemm4ChannelLast(ep::Stream* stream, enum CBLAS_TRANSPOSE trans_a,
-                      enum CBLAS_TRANSPOSE trans_b, const int m, const int n, const int k,
-                      const T alpha, const T* a, const T* b, const T beta, T* c) {
-  trans_a = (trans_a == CblasNoTrans) ? CblasTrans : CblasNoTrans;
-  trans_b = (trans_b == CblasNoTrans) ? CblasTrans : CblasNoTrans;
-  NewKernelUtil<DeviceType::kCPU>::OFGemm(stream, trans_b, trans_a, n, m, k, alpha, b, a, beta, c);
-}
-
 template<typename T>
 T* GetImgMutDptr(user_op::Tensor* tensor, int64_t idx) {
   return tensor->mut_dptr<T>() + tensor->shape().Count(1) * idx;
@@ -293,11 +275,18 @@ struct ConvKernelUtil final {
   }
 };
 
+// Forward algorithms of ConvCpuKernel. The choice depends on the shapes and attributes only, so the
+// tmp buffer size inferred ahead of Compute always fits the algorithm Compute runs.
+enum class ConvCpuAlgo {
+  kIm2ColGemm,   // im2col into a per-thread column buffer, then gemm
+  kDirect1x1,    // 1x1 kernel, stride 1, no padding: the image itself is the column buffer
+  kWinograd2x2,  // F(2x2, 3x3) Winograd for channels_first 3x3 stride 1 conv2d
+};
+
 template<typename T>
 struct ConvOpKernelCache final : public user_op::OpKernelCache {
   Im2ColFunc<T> im2col_func_ = nullptr;
   Col2ImFunc<T> col2im_func_ = nullptr;
-  GemmFunc<T> forward_func_ = nullptr;
 
   Shape in_5d_shape_;
   Shape out_5d_shape_;
@@ -310,53 +299,80 @@ struct ConvOpKernelCache final : public user_op::OpKernelCache {
   enum CBLAS_TRANSPOSE is_out_diff_need_trans_ = CblasNoTrans;
   int32_t idx_offset_{};
   bool is_dynamic_{};
+  ConvCpuAlgo forward_algo_ = ConvCpuAlgo::kIm2ColGemm;
 };
 
+Shape Gen5DShape(const Shape& shape, int32_t idx_offset) {
+  DimVector ret_vec(shape.dim_vec());
+  int32_t ndims = ret_vec.size() - 2;
+  ret_vec.insert(ret_vec.begin() + idx_offset, 3 - ndims, 1);
+  return Shape(ret_vec);
+}
+
+std::vector<int32_t> Gen3DVec(const std::vector<int32_t>& origin_vec) {
+  std::vector<int32_t> ret_vec = origin_vec;
+  ret_vec.insert(ret_vec.begin(), 3 - ret_vec.size(), 1);
+  return ret_vec;
+}
+
+// Channels below which the 16 Winograd gemms get too thin to beat im2col.
+constexpr int64_t kMinWinogradChannels = 16;
+
 template<typename T>
-std::shared_ptr<ConvOpKernelCache<T>> CreateConvOpKernelCache(user_op::KernelCacheContext* ctx,
-                                                              const std::string& in_name,
-                                                              const std::string& out_name,
-                                                              const std::string& weight_name) {
-  const auto& data_format = ctx->Attr<std::string>("data_format");
+ConvCpuAlgo SelectConvCpuAlgo(const ConvOpKernelCache<T>& cache) {
+  const int32_t idx_offset = cache.idx_offset_;
+  bool is_unit_stride = true;
+  bool is_unit_dilation = true;
+  bool is_1x1 = true;
+  bool is_zero_padding = true;
+  bool is_same_spatial = true;
+  FOR_RANGE(int32_t, i, 0, 3) {
+    is_unit_stride = is_unit_stride && cache.strides_3d_.at(i) == 1;
+    is_unit_dilation = is_unit_dilation && cache.dilation_rate_3d_.at(i) == 1;
+    is_1x1 = is_1x1 && cache.weight_5d_shape_.At(idx_offset + i) == 1;
+    is_zero_padding = is_zero_padding && cache.padding_before_3d_.at(i) == 0;
+    is_same_spatial = is_same_spatial
+                      && cache.in_5d_shape_.At(idx_offset + i)
+                             == cache.out_5d_shape_.At(idx_offset + i);
+  }
+  if (is_1x1 && is_unit_stride && is_zero_padding && is_same_spatial) {
+    return ConvCpuAlgo::kDirect1x1;
+  }
+  if (idx_offset == 2 && is_unit_stride && is_unit_dilation && cache.in_5d_shape_.At(2) == 1
+      && cache.out_5d_shape_.At(2) == 1 && cache.weight_5d_shape_.At(2) == 1
+      && cache.weight_5d_shape_.At(3) == 3 && cache.weight_5d_shape_.At(4) == 3
+      && cache.weight_5d_shape_.At(0) >= kMinWinogradChannels
+      && cache.weight_5d_shape_.At(1) >= kMinWinogradChannels) {
+    return ConvCpuAlgo::kWinograd2x2;
+  }
+  return ConvCpuAlgo::kIm2ColGemm;
+}
 
-  std::shared_ptr<ConvOpKernelCache<T>> cache(new ConvOpKernelCache<T>());
+template<typename T>
+void InitConvOpKernelCache(const std::string& data_format, const Shape& in_shape,
+                           const Shape& out_shape, const Shape& weight_shape,
+                           const std::vector<int32_t>& strides,
+                           const std::vector<int32_t>& dilation_rate,
+                           const std::vector<int32_t>& padding_before,
+                           ConvOpKernelCache<T>* cache) {
   if (data_format == "channels_first") {
     cache->im2col_func_ = ConvKernelUtil<T>::NCDHWIm2Col;
     cache->col2im_func_ = ConvKernelUtil<T>::NCDHWCol2Im;
-    cache->forward_func_ = Gemm4ChannelFirst;
     cache->is_out_diff_need_trans_ = CblasNoTrans;
     cache->idx_offset_ = 2;
   } else {
     cache->im2col_func_ = ConvKernelUtil<T>::NDHWCIm2Col;
     cache->col2im_func_ = ConvKernelUtil<T>::NDHWCCol2Im;
-    cache->forward_func_ = Gemm4ChannelLast;
     cache->is_out_diff_need_trans_ = CblasTrans;
     cache->idx_offset_ = 1;
   }
 
-  auto Gen5DShape = [](const Shape& shape, int32_t idx_offset) -> Shape {
-    DimVector ret_vec(shape.dim_vec());
-    int32_t ndims = ret_vec.size() - 2;
-    ret_vec.insert(ret_vec.begin() + idx_offset, 3 - ndims, 1);
-    return Shape(ret_vec);
-  };
-  const auto* in_tensor = ctx->TensorDesc4ArgNameAndIndex(in_name, 0);
-  const auto& in_shape = in_tensor->shape();
   cache->in_5d_shape_ = Gen5DShape(in_shape, cache->idx_offset_);
-  cache->out_5d_shape_ =
-      Gen5DShape(ctx->TensorDesc4ArgNameAndIndex(out_name, 0)->shape(), cache->idx_offset_);
-  cache->weight_5d_shape_ =
-      Gen5DShape(ctx->TensorDesc4ArgNameAndIndex(weight_name, 0)->shape(), cache->idx_offset_);
-
-  auto Gen3DVec = [](const std::vector<int32_t>& origin_vec) -> std::vector<int32_t> {
-    std::vector<int32_t> ret_vec = origin_vec;
-    ret_vec.insert(ret_vec.begin(), 3 - ret_vec.size(), 1);
-    return ret_vec;
-  };
-  cache->strides_3d_ = Gen3DVec(ctx->Attr<std::vector<int32_t>>("strides"));
-  cache->dilation_rate_3d_ = Gen3DVec(ctx->Attr<std::vector<int32_t>>("dilation_rate"));
-  cache->is_dynamic_ = ctx->TensorDesc4ArgNameAndIndex(in_name, 0)->is_dynamic();
-  const auto& padding_before = ctx->Attr<std::vector<int32_t>>("padding_before");
+  cache->out_5d_shape_ = Gen5DShape(out_shape, cache->idx_offset_);
+  cache->weight_5d_shape_ = Gen5DShape(weight_shape, cache->idx_offset_);
+
+  cache->strides_3d_ = Gen3DVec(strides);
+  cache->dilation_rate_3d_ = Gen3DVec(dilation_rate);
   FOR_RANGE(uint8_t, dim, 0, 3) {
     int64_t index = static_cast<int64_t>(dim) - (3 - padding_before.size());
     if (index < 0) {
@@ -365,7 +381,23 @@ std::shared_ptr<ConvOpKernelCache<T>> CreateConvOpKernelCache(user_op::KernelCac
       cache->padding_before_3d_.emplace_back(padding_before.at(index));
     }
   }
+  cache->forward_algo_ = SelectConvCpuAlgo(*cache);
+}
 
+template<typename T>
+std::shared_ptr<ConvOpKernelCache<T>> CreateConvOpKernelCache(user_op::KernelCacheContext* ctx,
+                                                              const std::string& in_name,
+                                                              const std::string& out_name,
+                                                              const std::string& weight_name) {
+  std::shared_ptr<ConvOpKernelCache<T>> cache(new ConvOpKernelCache<T>());
+  InitConvOpKernelCache(ctx->Attr<std::string>("data_format"),
+                        ctx->TensorDesc4ArgNameAndIndex(in_name, 0)->shape(),
+                        ctx->TensorDesc4ArgNameAndIndex(out_name, 0)->shape(),
+                        ctx->TensorDesc4ArgNameAndIndex(weight_name, 0)->shape(),
+                        ctx->Attr<std::vector<int32_t>>("strides"),
+                        ctx->Attr<std::vector<int32_t>>("dilation_rate"),
+                        ctx->Attr<std::vector<int32_t>>("padding_before"), cache.get());
+  cache->is_dynamic_ = ctx->TensorDesc4ArgNameAndIndex(in_name, 0)->is_dynamic();
   return cache;
 }
 
@@ -374,6 +406,342 @@ void InitBiasMulBuf(T* dptr, int64_t num) {
   for (int64_t i = 0; i < num; ++i) { dptr[i] = 1; }
 }
 
+// Columns of the output one gemm call covers at least when a sample is split across threads.
+constexpr int64_t kMinColsPerBlock = 64;
+// Multiply-adds a ParallelFor chunk should cover at least.
+constexpr int64_t kMinMacsPerChunk = 1 << 18;
+// Winograd tiles transformed and multiplied together by one thread.
+constexpr int64_t kWinogradTilesPerBlock = 64;
+// Upper bound of the per-thread buffers of the forward kernel, at least one buffer is kept.
+constexpr size_t kMaxConvThreadBufferSize = 256 * 1024 * 1024;
+
+// Output tiles of F(2x2, 3x3), grouped into blocks of at most kWinogradTilesPerBlock.
+struct WinogradTiling {
+  explicit WinogradTiling(const Shape& out_5d_shape)
+      : tile_h((out_5d_shape.At(3) + 1) / 2),
+        tile_w((out_5d_shape.At(4) + 1) / 2),
+        tile_num(tile_h * tile_w),
+        tiles_per_block(std::min(tile_num, kWinogradTilesPerBlock)),
+        block_num(tiles_per_block == 0 ? 0 : (tile_num + tiles_per_block - 1) / tiles_per_block) {}
+  int64_t tile_h;
+  int64_t tile_w;
+  int64_t tile_num;
+  int64_t tiles_per_block;
+  int64_t block_num;
+};
+
+// Elements of the buffer shared by all threads: the transformed filter of Winograd.
+template<typename T>
+int64_t ConvForwardSharedElemCnt(const ConvOpKernelCache<T>& cache) {
+  if (cache.forward_algo_ != ConvCpuAlgo::kWinograd2x2) { return 0; }
+  return 16 * cache.weight_5d_shape_.Count(0, 2);
+}
+
+// Elements of the buffer each thread owns: a column buffer for im2col, the transformed input and
+// output of one tile block for Winograd.
+template<typename T>
+int64_t ConvForwardThreadElemCnt(const ConvOpKernelCache<T>& cache) {
+  if (cache.forward_algo_ == ConvCpuAlgo::kIm2ColGemm) {
+    return CalcElemNumOfColBuf(ShapeView(cache.out_5d_shape_), ShapeView(cache.weight_5d_shape_),
+                               cache.idx_offset_);
+  } else if (cache.forward_algo_ == ConvCpuAlgo::kWinograd2x2) {
+    return 16 * (cache.weight_5d_shape_.At(0) + cache.weight_5d_shape_.At(1))
+           * WinogradTiling(cache.out_5d_shape_).tiles_per_block;
+  } else {
+    return 0;
+  }
+}
+
+// Independent pieces of work that each need a thread buffer.
+template<typename T>
+int64_t ConvForwardThreadWorkNum(const ConvOpKernelCache<T>& cache, int64_t batch_size) {
+  if (cache.forward_algo_ == ConvCpuAlgo::kWinograd2x2) {
+    return batch_size * WinogradTiling(cache.out_5d_shape_).block_num;
+  }
+  return batch_size;
+}
+
+template<typename T>
+size_t InferConvTmpSize(user_op::InferContext* ctx) {
+  const Shape& in_shape = ctx->InputTensorDesc("in", 0).shape();
+  ConvOpKernelCache<T> cache;
+  InitConvOpKernelCache(ctx->Attr<std::string>("data_format"), in_shape,
+                        ctx->OutputTensorDesc("out", 0)->shape(),
+                        ctx->InputTensorDesc("weight", 0).shape(),
+                        ctx->Attr<std::vector<int32_t>>("strides"),
+                        ctx->Attr<std::vector<int32_t>>("dilation_rate"),
+                        ctx->Attr<std::vector<int32_t>>("padding_before"), &cache);
+  const int64_t thread_elem_cnt = ConvForwardThreadElemCnt(cache);
+  int64_t thread_buffer_num = 0;
+  if (thread_elem_cnt > 0) {
+    const ThreadPool* thread_pool = Global<ThreadPool>::Get();
+    const int64_t thread_num = thread_pool == nullptr ? 1 : thread_pool->thread_num();
+    thread_buffer_num = std::min(thread_num, ConvForwardThreadWorkNum(cache, in_shape.At(0)));
+    thread_buffer_num = std::min<int64_t>(
+        thread_buffer_num, kMaxConvThreadBufferSize / (thread_elem_cnt * sizeof(T)));
+    thread_buffer_num = std::max<int64_t>(thread_buffer_num, 1);
+  }
+  return (ConvForwardSharedElemCnt(cache) + thread_buffer_num * thread_elem_cnt) * sizeof(T);
+}
+
+// Computes columns [col_begin, col_end) of the output of one sample from its column buffer, which
+// is (ci * kd * kh * kw) x (od * oh * ow), or the transpose of that when is_col_trans.
+// channels first: out[:, cols] = weight * col[:, cols] + bias
+// channels last:  out[cols, :] = (weight * col[:, cols])(T) + bias(T)
+template<typename T>
+void ConvForwardGemm(const ConvOpKernelCache<T>& cache, bool is_col_trans, int64_t col_begin,
+                     int64_t col_end, const T* weight, const T* col, const T* bias, T* out) {
+  const int32_t idx_offset = cache.idx_offset_;
+  const int64_t filters = cache.weight_5d_shape_.At(0);
+  const int64_t k = cache.weight_5d_shape_.Count(1);
+  const int64_t spatial = cache.out_5d_shape_.Count(idx_offset, idx_offset + 3);
+  const int64_t cols = col_end - col_begin;
+  const T* col_block = is_col_trans ? col + col_begin * k : col + col_begin;
+  const int64_t ld_col = is_col_trans ? k : spatial;
+  if (idx_offset == 2) {
+    cblas_gemm<T>(CblasRowMajor, CblasNoTrans, is_col_trans ? CblasTrans : CblasNoTrans, filters,
+                  cols, k, static_cast<T>(1), weight, k, col_block, ld_col, static_cast<T>(0),
+                  out + col_begin, spatial);
+    if (bias != nullptr) {
+      FOR_RANGE(int64_t, f, 0, filters) {
+        T* out_row = out + f * spatial + col_begin;
+        FOR_RANGE(int64_t, j, 0, cols) { out_row[j] += bias[f]; }
+      }
+    }
+  } else {
+    cblas_gemm<T>(CblasRowMajor, is_col_trans ? CblasNoTrans : CblasTrans, CblasTrans, cols,
+                  filters, k, static_cast<T>(1), col_block, ld_col, weight, k, static_cast<T>(0),
+                  out + col_begin * filters, filters);
+    if (bias != nullptr) {
+      FOR_RANGE(int64_t, j, 0, cols) {
+        T* out_row = out + (col_begin + j) * filters;
+        FOR_RANGE(int64_t, f, 0, filters) { out_row[f] += bias[f]; }
+      }
+    }
+  }
+}
+
+// Splits the output columns of samples [0, sample_num) into blocks and calls
+// func(sample, col_begin, col_end) for each block in the thread pool.
+template<typename T, typename Func>
+void ForEachConvForwardBlock(ep::CpuStream* stream, const ConvOpKernelCache<T>& cache,
+                             int64_t sample_num, const Func& func) {
+  const int32_t idx_offset = cache.idx_offset_;
+  const int64_t spatial = cache.out_5d_shape_.Count(idx_offset, idx_offset + 3);
+  const int64_t macs_per_col =
+      std::max<int64_t>(cache.weight_5d_shape_.At(0) * cache.weight_5d_shape_.Count(1), 1);
+  const int64_t cols_per_block =
+      std::min(spatial, std::max(kMinColsPerBlock, kMinMacsPerChunk / macs_per_col));
+  if (cols_per_block == 0) { return; }
+  const int64_t block_num = (spatial + cols_per_block - 1) / cols_per_block;
+  stream->ParallelFor(
+      0, sample_num * block_num,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+          const int64_t col_begin = (i % block_num) * cols_per_block;
+          func(i / block_num, col_begin, std::min(col_begin + cols_per_block, spatial));
+        }
+      },
+      std::max<int64_t>(kMinMacsPerChunk / (cols_per_block * macs_per_col), 1));
+}
+
+template<typename T>
+void ConvForwardIm2ColGemm(ep::CpuStream* stream, const ConvOpKernelCache<T>& cache,
+                           const user_op::Tensor* in, const T* weight, const T* bias,
+                           user_op::Tensor* tmp_buffer, user_op::Tensor* out) {
+  const int64_t col_elem_cnt = ConvForwardThreadElemCnt(cache);
+  const int64_t col_buf_num = tmp_buffer->shape().elem_cnt() / (col_elem_cnt * sizeof(T));
+  CHECK_GT(col_buf_num, 0);
+  T* col_buf_dptr = tmp_buffer->mut_dptr<T>();
+  const int64_t batch_size = in->shape().At(0);
+  // Each round fills one column buffer per sample in parallel, then runs the gemms of all of its
+  // samples split by output columns, so a small batch still keeps every thread busy.
+  for (int64_t round_begin = 0; round_begin < batch_size; round_begin += col_buf_num) {
+    const int64_t round_size = std::min(col_buf_num, batch_size - round_begin);
+    stream->ParallelFor(
+        0, round_size,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t i = begin; i < end; ++i) {
+            cache.im2col_func_(GetImgDptr<T>(in, round_begin + i), ShapeView(cache.in_5d_shape_),
+                               ShapeView(cache.weight_5d_shape_), ShapeView(cache.out_5d_shape_),
+                               cache.strides_3d_.data(), cache.dilation_rate_3d_.data(),
+                               cache.padding_before_3d_.data(), col_buf_dptr + i * col_elem_cnt);
+          }
+        },
+        1);
+    ForEachConvForwardBlock(stream, cache, round_size,
+                            [&](int64_t i, int64_t col_begin, int64_t col_end) {
+                              ConvForwardGemm(cache, false, col_begin, col_end, weight,
+                                              col_buf_dptr + i * col_elem_cnt, bias,
+                                              GetImgMutDptr<T>(out, round_begin + i));
+                            });
+  }
+}
+
+// A channels_first image is already the (ci x spatial) column buffer of a 1x1 conv and a
+// channels_last one its transpose, so the gemm reads the input directly.
+template<typename T>
+void ConvForwardDirect1x1(ep::CpuStream* stream, const ConvOpKernelCache<T>& cache,
+                          const user_op::Tensor* in, const T* weight, const T* bias,
+                          user_op::Tensor* out) {
+  ForEachConvForwardBlock(stream, cache, in->shape().At(0),
+                          [&](int64_t i, int64_t col_begin, int64_t col_end) {
+                            ConvForwardGemm(cache, cache.idx_offset_ != 2, col_begin, col_end,
+                                            weight, GetImgDptr<T>(in, i), bias,
+                                            GetImgMutDptr<T>(out, i));
+                          });
+}
+
+// U = G g G(T) of one 3x3 filter, element xi of U stored at u[xi * stride].
+template<typename T>
+void WinogradTransformFilter(const T* g, T* u, int64_t stride) {
+  T gg[4][3];
+  FOR_RANGE(int32_t, j, 0, 3) {
+    gg[0][j] = g[j];
+    gg[1][j] = (g[j] + g[3 + j] + g[6 + j]) * static_cast<T>(0.5);
+    gg[2][j] = (g[j] - g[3 + j] + g[6 + j]) * static_cast<T>(0.5);
+    gg[3][j] = g[6 + j];
+  }
+  FOR_RANGE(int32_t, i, 0, 4) {
+    u[(i * 4 + 0) * stride] = gg[i][0];
+    u[(i * 4 + 1) * stride] = (gg[i][0] + gg[i][1] + gg[i][2]) * static_cast<T>(0.5);
+    u[(i * 4 + 2) * stride] = (gg[i][0] - gg[i][1] + gg[i][2]) * static_cast<T>(0.5);
+    u[(i * 4 + 3) * stride] = gg[i][2];
+  }
+}
+
+// V = B(T) d B of the 4x4 input tiles [tile_begin, tile_begin + tile_cnt) of every channel of one
+// image, stored as 16 matrices of (ci x tile_cnt).
+template<typename T>
+void WinogradTransformInput(const ConvOpKernelCache<T>& cache, const WinogradTiling& tiling,
+                            const T* img, int64_t tile_begin, int64_t tile_cnt, T* v) {
+  const int64_t channels = cache.in_5d_shape_.At(1);
+  const int64_t height = cache.in_5d_shape_.At(3);
+  const int64_t width = cache.in_5d_shape_.At(4);
+  const int64_t pad_h = cache.padding_before_3d_.at(1);
+  const int64_t pad_w = cache.padding_before_3d_.at(2);
+  const int64_t stride = channels * tile_cnt;
+  FOR_RANGE(int64_t, c, 0, channels) {
+    const T* src = img + c * height * width;
+    FOR_RANGE(int64_t, t, 0, tile_cnt) {
+      const int64_t tile = tile_begin + t;
+      const int64_t y0 = (tile / tiling.tile_w) * 2 - pad_h;
+      const int64_t x0 = (tile % tiling.tile_w) * 2 - pad_w;
+      T d[4][4];
+      FOR_RANGE(int64_t, i, 0, 4) {
+        const int64_t y = y0 + i;
+        FOR_RANGE(int64_t, j, 0, 4) {
+          const int64_t x = x0 + j;
+          d[i][j] = (y >= 0 && y < height && x >= 0 && x < width) ? src[y * width + x] : 0;
+        }
+      }
+      T bd[4][4];
+      FOR_RANGE(int32_t, j, 0, 4) {
+        bd[0][j] = d[0][j] - d[2][j];
+        bd[1][j] = d[1][j] + d[2][j];
+        bd[2][j] = d[2][j] - d[1][j];
+        bd[3][j] = d[1][j] - d[3][j];
+      }
+      T* dst = v + c * tile_cnt + t;
+      FOR_RANGE(int32_t, i, 0, 4) {
+        dst[(i * 4 + 0) * stride] = bd[i][0] - bd[i][2];
+        dst[(i * 4 + 1) * stride] = bd[i][1] + bd[i][2];
+        dst[(i * 4 + 2) * stride] = bd[i][2] - bd[i][1];
+        dst[(i * 4 + 3) * stride] = bd[i][1] - bd[i][3];
+      }
+    }
+  }
+}
+
+// Y = A(T) M A of the tiles transformed by WinogradTransformInput, plus bias, written into the
+// 2x2 output tiles that fall inside the image.
+template<typename T>
+void WinogradTransformOutput(const ConvOpKernelCache<T>& cache, const WinogradTiling& tiling,
+                             const T* m, const T* bias, int64_t tile_begin, int64_t tile_cnt,
+                             T* img) {
+  const int64_t filters = cache.out_5d_shape_.At(1);
+  const int64_t height = cache.out_5d_shape_.At(3);
+  const int64_t width = cache.out_5d_shape_.At(4);
+  const int64_t stride = filters * tile_cnt;
+  FOR_RANGE(int64_t, f, 0, filters) {
+    T* dst = img + f * height * width;
+    const T b = bias == nullptr ? static_cast<T>(0) : bias[f];
+    FOR_RANGE(int64_t, t, 0, tile_cnt) {
+      const T* src = m + f * tile_cnt + t;
+      T am[2][4];
+      FOR_RANGE(int32_t, j, 0, 4) {
+        am[0][j] = src[j * stride] + src[(4 + j) * stride] + src[(8 + j) * stride];
+        am[1][j] = src[(4 + j) * stride] - src[(8 + j) * stride] - src[(12 + j) * stride];
+      }
+      const int64_t tile = tile_begin + t;
+      const int64_t y0 = (tile / tiling.tile_w) * 2;
+      const int64_t x0 = (tile % tiling.tile_w) * 2;
+      FOR_RANGE(int32_t, i, 0, 2) {
+        if (y0 + i >= height) { break; }
+        T* dst_row = dst + (y0 + i) * width + x0;
+        dst_row[0] = am[i][0] + am[i][1] + am[i][2] + b;
+        if (x0 + 1 < width) { dst_row[1] = am[i][1] - am[i][2] - am[i][3] + b; }
+      }
+    }
+  }
+}
+
+// F(2x2, 3x3) Winograd: the filter is transformed once, then each thread takes blocks of output
+// tiles of any sample, transforms their inputs, runs the 16 (filters x ci) x (ci x tiles) gemms
+// and transforms the products back, which takes 4 multiplications per output instead of 9.
+template<typename T>
+void ConvForwardWinograd2x2(ep::CpuStream* stream, const ConvOpKernelCache<T>& cache,
+                            const user_op::Tensor* in, const T* weight, const T* bias,
+                            user_op::Tensor* tmp_buffer, user_op::Tensor* out) {
+  const WinogradTiling tiling(cache.out_5d_shape_);
+  const int64_t filters = cache.weight_5d_shape_.At(0);
+  const int64_t channels = cache.weight_5d_shape_.At(1);
+  const int64_t filter_elem_cnt = filters * channels;
+  T* u = tmp_buffer->mut_dptr<T>();
+  stream->ParallelFor(
+      0, filter_elem_cnt,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+          WinogradTransformFilter(weight + i * 9, u + i, filter_elem_cnt);
+        }
+      },
+      std::max<int64_t>(ep::kParallelForDefaultGrain / 16, 1));
+
+  const int64_t shared_elem_cnt = ConvForwardSharedElemCnt(cache);
+  const int64_t thread_elem_cnt = ConvForwardThreadElemCnt(cache);
+  const int64_t work_num = ConvForwardThreadWorkNum(cache, in->shape().At(0));
+  if (work_num == 0) { return; }
+  const int64_t tmp_elem_cnt = tmp_buffer->shape().elem_cnt() / sizeof(T);
+  const int64_t thread_buffer_num =
+      std::min(work_num, (tmp_elem_cnt - shared_elem_cnt) / thread_elem_cnt);
+  CHECK_GT(thread_buffer_num, 0);
+  stream->ParallelFor(
+      0, thread_buffer_num,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t buffer_id = begin; buffer_id < end; ++buffer_id) {
+          T* v = u + shared_elem_cnt + buffer_id * thread_elem_cnt;
+          T* m = v + 16 * channels * tiling.tiles_per_block;
+          const int64_t work_begin = buffer_id * work_num / thread_buffer_num;
+          const int64_t work_end = (buffer_id + 1) * work_num / thread_buffer_num;
+          for (int64_t work = work_begin; work < work_end; ++work) {
+            const int64_t i = work / tiling.block_num;
+            const int64_t tile_begin = (work % tiling.block_num) * tiling.tiles_per_block;
+            const int64_t tile_cnt = std::min(tiling.tiles_per_block, tiling.tile_num - tile_begin);
+            WinogradTransformInput(cache, tiling, GetImgDptr<T>(in, i), tile_begin, tile_cnt, v);
+            FOR_RANGE(int64_t, xi, 0, 16) {
+              cblas_gemm<T>(CblasRowMajor, CblasNoTrans, CblasNoTrans, filters, tile_cnt, channels,
+                            static_cast<T>(1), u + xi * filter_elem_cnt, channels,
+                            v + xi * channels * tile_cnt, tile_cnt, static_cast<T>(0),
+                            m + xi * filters * tile_cnt, tile_cnt);
+            }
+            WinogradTransformOutput(cache, tiling, m, bias, tile_begin, tile_cnt,
+                                    GetImgMutDptr<T>(out, i));
+          }
+        }
+      },
+      1);
+}
+
 template<typename T, size_t NDims>
 class ConvCpuKernel final : public user_op::OpKernel {
  public:
@@ -395,78 +763,30 @@ class ConvCpuKernel final : public user_op::OpKernel {
 
     const user_op::Tensor* in = ctx->Tensor4ArgNameAndIndex("in", 0);
     const user_op::Tensor* weight = ctx->Tensor4ArgNameAndIndex("weight", 0);
-    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    const user_op::Tensor* bias = ctx->Tensor4ArgNameAndIndex("bias", 0);
     user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
-
-    T* col_buf_dptr = tmp_buffer->mut_dptr<T>();
-
-    bool is_bias_mul_inited = false;
-    for (int64_t i = 0; i < in->shape().At(0); ++i) {
-      conv_cache->im2col_func_(GetImgDptr<T>(in, i), ShapeView(conv_cache->in_5d_shape_),
-                               ShapeView(conv_cache->weight_5d_shape_),
-                               ShapeView(conv_cache->out_5d_shape_), conv_cache->strides_3d_.data(),
-                               conv_cache->dilation_rate_3d_.data(),
-                               conv_cache->padding_before_3d_.data(), col_buf_dptr);
-
-      // channels first: out = weight * col_buf
-      // channels last:  out = (weight * col_buf)(T)
-      int32_t idx_offset = conv_cache->idx_offset_;
-      conv_cache->forward_func_(
-          ctx->stream(), CblasNoTrans, CblasNoTrans,
-          conv_cache->weight_5d_shape_.At(0),                           // filter
-          conv_cache->out_5d_shape_.Count(idx_offset, idx_offset + 3),  // od * oh * ow
-          conv_cache->weight_5d_shape_.Count(1),                        // ci * kd * kh * kw
-          static_cast<T>(1), weight->dptr<T>(), col_buf_dptr, static_cast<T>(0),
-          GetImgMutDptr<T>(out, i));
-
-      const user_op::Tensor* bias = ctx->Tensor4ArgNameAndIndex("bias", 0);
-      if (bias != nullptr) {
-        int64_t num_of_col_buf = CalcElemNumOfColBuf(out->shape(), weight->shape(), idx_offset);
-        int64_t num_of_bias_mul =
-            (tmp_buffer->shape().elem_cnt() - num_of_col_buf * sizeof(T)) / sizeof(T);
-        CHECK_GT(num_of_bias_mul, 0);
-        T* bias_mul_dptr = col_buf_dptr + num_of_col_buf;
-        if (!is_bias_mul_inited) {
-          InitBiasMulBuf(bias_mul_dptr, num_of_bias_mul);
-          is_bias_mul_inited = true;
-        }
-
-        // channels first:  out += bias * bias_mul
-        // channels last:   out += (bias * bias_mul)(T)
-        conv_cache->forward_func_(
-            ctx->stream(), CblasNoTrans, CblasNoTrans,
-            conv_cache->weight_5d_shape_.At(0),                           // filter
-            conv_cache->out_5d_shape_.Count(idx_offset, idx_offset + 3),  // od * oh * ow
-            1,                                                            // 1
-            static_cast<T>(1), bias->dptr<T>(), bias_mul_dptr, static_cast<T>(1),
-            GetImgMutDptr<T>(out, i));
-      }
+    const T* bias_dptr = bias == nullptr ? nullptr : bias->dptr<T>();
+    auto* stream = ctx->stream()->As<ep::CpuStream>();
+
+    if (conv_cache->forward_algo_ == ConvCpuAlgo::kDirect1x1) {
+      ConvForwardDirect1x1(stream, *conv_cache, in, weight->dptr<T>(), bias_dptr, out);
+    } else if (conv_cache->forward_algo_ == ConvCpuAlgo::kWinograd2x2) {
+      ConvForwardWinograd2x2(stream, *conv_cache, in, weight->dptr<T>(), bias_dptr,
+                             ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0), out);
+    } else {
+      ConvForwardIm2ColGemm(stream, *conv_cache, in, weight->dptr<T>(), bias_dptr,
+                            ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0), out);
     }
   }
 };
 
-#define REGISTER_CONV_KERNEL(op_name, dtype, ndims)                                         \
-  REGISTER_USER_KERNEL(#op_name)                                                            \
-      .SetCreateFn<ConvCpuKernel<dtype, ndims>>()                                           \
-      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                       \
-                       && (user_op::HobAttr<int32_t>("groups") == 1)                        \
-                       && (user_op::HobDataType("in", 0) == GetDataType<dtype>::value))     \
-      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                         \
-        size_t tmp_buffer_size = 0;                                                         \
-        const auto& out_shape = ctx->OutputTensorDesc("out", 0)->shape();                   \
-        const auto& weight_shape = ctx->InputTensorDesc("weight", 0).shape();               \
-                                                                                            \
-        int64_t idx_offset = IdxOffset(ctx->Attr<std::string>("data_format"));              \
-        tmp_buffer_size +=                                                                  \
-            CalcElemNumOfColBuf(out_shape, weight_shape, idx_offset) * sizeof(dtype);       \
-        bool has_bias = ctx->has_input("bias", 0);                                          \
-        if (has_bias) {                                                                     \
-          int64_t bias_mul_cnt = 1;                                                         \
-          for (int i = 0; i < ndims; ++i) { bias_mul_cnt *= out_shape.At(idx_offset + i); } \
-          tmp_buffer_size += bias_mul_cnt * sizeof(dtype);                                  \
-        }                                                                                   \
-        return tmp_buffer_size;                                                             \
-      })
+#define REGISTER_CONV_KERNEL(op_name, dtype, ndims)                                     \
+  REGISTER_USER_KERNEL(#op_name)                                                        \
+      .SetCreateFn<ConvCpuKernel<dtype, ndims>>()                                       \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                   \
+                       && (user_op::HobAttr<int32_t>("groups") == 1)                    \
+                       && (user_op::HobDataType("in", 0) == GetDataType<dtype>::value)) \
+      .SetInferTmpSizeFn(InferConvTmpSize<dtype>)
 
 REGISTER_CONV_KERNEL(conv1d, float, 1);
 REGISTER_CONV_KERNEL(conv2d, float, 2);
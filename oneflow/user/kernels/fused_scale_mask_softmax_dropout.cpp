@@ -0,0 +1,103 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/fused_softmax_cpu_kernel_util.h"
+
+namespace oneflow {
+
+namespace {
+
+template<typename T>
+class FusedScaleMaskSoftmaxDropoutCpuKernel final : public user_op::OpKernel {
+ public:
+  FusedScaleMaskSoftmaxDropoutCpuKernel() = default;
+  ~FusedScaleMaskSoftmaxDropoutCpuKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const user_op::Tensor* mask = ctx->Tensor4ArgNameAndIndex("mask", 0);
+    const user_op::Tensor* dropout_mask = ctx->Tensor4ArgNameAndIndex("dropout_mask", 0);
+    user_op::Tensor* y = ctx->Tensor4ArgNameAndIndex("y", 0);
+    user_op::Tensor* softmax_y = ctx->Tensor4ArgNameAndIndex("softmax_y", 0);
+    const ShapeView& x_shape = x->shape();
+    CHECK_GE(x_shape.NumAxes(), 2);
+    const int64_t cols = x_shape.At(x_shape.NumAxes() - 1);
+    const int64_t rows = x_shape.Count(0, x_shape.NumAxes() - 1);
+    fused_softmax::ScaleMaskLoad<T, T> load(x->dptr<T>(), mask->dptr<int8_t>(), cols,
+                                            ctx->Attr<float>("mask_fill_value"),
+                                            ctx->Attr<float>("scale_value"));
+    fused_softmax::MaskAndScaleStore<T, T> store(y->mut_dptr<T>(), softmax_y->mut_dptr<T>(),
+                                                 dropout_mask->dptr<int8_t>(), cols,
+                                                 ctx->Attr<float>("dropout_scale_value"));
+    fused_softmax::DispatchSoftmax<T>(ctx->stream(), rows, cols, load, store);
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T>
+class FusedScaleMaskSoftmaxDropoutGradCpuKernel final : public user_op::OpKernel {
+ public:
+  FusedScaleMaskSoftmaxDropoutGradCpuKernel() = default;
+  ~FusedScaleMaskSoftmaxDropoutGradCpuKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* softmax_y = ctx->Tensor4ArgNameAndIndex("softmax_y", 0);
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const user_op::Tensor* mask = ctx->Tensor4ArgNameAndIndex("mask", 0);
+    const user_op::Tensor* dropout_mask = ctx->Tensor4ArgNameAndIndex("dropout_mask", 0);
+    user_op::Tensor* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
+    const ShapeView& dy_shape = dy->shape();
+    CHECK_GE(dy_shape.NumAxes(), 2);
+    const int64_t cols = dy_shape.At(dy_shape.NumAxes() - 1);
+    const int64_t rows = dy_shape.Count(0, dy_shape.NumAxes() - 1);
+    fused_softmax::DirectLoad<T, T> load_softmax_y(softmax_y->dptr<T>(), cols);
+    fused_softmax::MaskAndScaleLoad<T, T> load_dy(dy->dptr<T>(), dropout_mask->dptr<int8_t>(),
+                                                  cols, ctx->Attr<float>("dropout_scale_value"));
+    fused_softmax::ScaleMaskStore<T, T> store(dx->mut_dptr<T>(), mask->dptr<int8_t>(), cols,
+                                              static_cast<T>(0.0), ctx->Attr<float>("scale_value"));
+    fused_softmax::DispatchSoftmaxGrad<T>(ctx->stream(), rows, cols, load_softmax_y, load_dy,
+                                          store);
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+}  // namespace
+
+#define REGISTER_FUSED_SCALE_MASK_SOFTMAX_DROPOUT_CPU_KERNEL(dtype)   \
+  REGISTER_USER_KERNEL("fused_scale_mask_softmax_dropout")            \
+      .SetCreateFn<FusedScaleMaskSoftmaxDropoutCpuKernel<dtype>>()    \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
+                       && (user_op::HobDataType("y", 0) == GetDataType<dtype>::value));
+
+REGISTER_FUSED_SCALE_MASK_SOFTMAX_DROPOUT_CPU_KERNEL(float)
+REGISTER_FUSED_SCALE_MASK_SOFTMAX_DROPOUT_CPU_KERNEL(double)
+#undef REGISTER_FUSED_SCALE_MASK_SOFTMAX_DROPOUT_CPU_KERNEL
+
+#define REGISTER_FUSED_SCALE_MASK_SOFTMAX_DROPOUT_GRAD_CPU_KERNEL(dtype) \
+  REGISTER_USER_KERNEL("fused_scale_mask_softmax_dropout_grad")          \
+      .SetCreateFn<FusedScaleMaskSoftmaxDropoutGradCpuKernel<dtype>>()   \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)    \
+                       && (user_op::HobDataType("dx", 0) == GetDataType<dtype>::value));
+
+REGISTER_FUSED_SCALE_MASK_SOFTMAX_DROPOUT_GRAD_CPU_KERNEL(float)
+REGISTER_FUSED_SCALE_MASK_SOFTMAX_DROPOUT_GRAD_CPU_KERNEL(double)
+#undef REGISTER_FUSED_SCALE_MASK_SOFTMAX_DROPOUT_GRAD_CPU_KERNEL
+
+}  // namespace oneflow
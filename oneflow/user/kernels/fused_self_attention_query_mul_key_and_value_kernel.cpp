@@ -0,0 +1,161 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/common/blas.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+namespace {
+
+// Multiply-adds a ParallelFor chunk should cover at least.
+constexpr int64_t kMinMacsPerChunk = 1 << 18;
+
+// hidden_states is (s, b, n, 3, h), so q, k and v of head i = b * num_heads + n are s x h matrices
+// at offsets 3h * i, 3h * i + h and 3h * i + 2h with leading dimension b * n * 3h. The gemms read
+// these strided views directly, the transposed copies the CUDA kernel makes are never formed.
+struct PackedQkvLayout {
+  PackedQkvLayout(int64_t seq_len, int64_t batch_size, int64_t num_heads, int64_t head_size)
+      : seq_len(seq_len),
+        num_batches(batch_size * num_heads),
+        head_size(head_size),
+        stride(3 * head_size),
+        ld(batch_size * num_heads * 3 * head_size) {}
+  int64_t seq_len;
+  int64_t num_batches;
+  int64_t head_size;
+  int64_t stride;
+  int64_t ld;
+};
+
+template<typename Func>
+void ForEachHead(ep::Stream* stream, const PackedQkvLayout& layout, Func func) {
+  const int64_t macs_per_head = layout.seq_len * layout.seq_len * layout.head_size;
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, layout.num_batches,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) { func(i); }
+      },
+      std::max<int64_t>(kMinMacsPerChunk / std::max<int64_t>(macs_per_head, 1), 1));
+}
+
+template<typename T>
+class FusedSelfAttentionQueryMulKeyAndValueCpuKernel final : public user_op::OpKernel {
+ public:
+  FusedSelfAttentionQueryMulKeyAndValueCpuKernel() = default;
+  ~FusedSelfAttentionQueryMulKeyAndValueCpuKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* h_tensor = ctx->Tensor4ArgNameAndIndex("hidden_states", 0);
+    user_op::Tensor* qmk_tensor = ctx->Tensor4ArgNameAndIndex("query_mul_key", 0);
+    user_op::Tensor* v_tensor = ctx->Tensor4ArgNameAndIndex("value", 0);
+    const int64_t seq_len = h_tensor->shape().At(0);
+    const int64_t batch_size = h_tensor->shape().At(1);
+    const int64_t hidden_size = h_tensor->shape().At(2);
+    const int64_t head_size = ctx->Attr<int64_t>("head_size");
+    const int64_t num_heads = hidden_size / (3 * head_size);
+    const PackedQkvLayout layout(seq_len, batch_size, num_heads, head_size);
+    const T alpha = static_cast<T>(ctx->Attr<float>("alpha"));
+    const T* h_dptr = h_tensor->dptr<T>();
+    T* qmk_dptr = qmk_tensor->mut_dptr<T>();
+    T* v_dptr = v_tensor->mut_dptr<T>();
+    ForEachHead(ctx->stream(), layout, [&](int64_t i) {
+      const T* q = h_dptr + i * layout.stride;
+      const T* k = q + head_size;
+      const T* v = q + 2 * head_size;
+      // (sq, h) x (sk, h)^T -> (sq, sk)
+      cblas_gemm<T>(CblasRowMajor, CblasNoTrans, CblasTrans, seq_len, seq_len, head_size, alpha,
+                    q, layout.ld, k, layout.ld, static_cast<T>(0), qmk_dptr + i * seq_len * seq_len,
+                    seq_len);
+      T* v_out = v_dptr + i * seq_len * head_size;
+      for (int64_t s = 0; s < seq_len; ++s) {
+        std::copy(v + s * layout.ld, v + s * layout.ld + head_size, v_out + s * head_size);
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T>
+class FusedSelfAttentionQueryMulKeyAndValueGradCpuKernel final : public user_op::OpKernel {
+ public:
+  FusedSelfAttentionQueryMulKeyAndValueGradCpuKernel() = default;
+  ~FusedSelfAttentionQueryMulKeyAndValueGradCpuKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* v_grad_tensor = ctx->Tensor4ArgNameAndIndex("value_grad", 0);
+    const user_op::Tensor* qmk_grad_tensor = ctx->Tensor4ArgNameAndIndex("query_mul_key_grad", 0);
+    const user_op::Tensor* h_tensor = ctx->Tensor4ArgNameAndIndex("hidden_states", 0);
+    user_op::Tensor* h_grad_tensor = ctx->Tensor4ArgNameAndIndex("hidden_states_grad", 0);
+    const int64_t seq_len = h_grad_tensor->shape().At(0);
+    const int64_t batch_size = h_grad_tensor->shape().At(1);
+    const int64_t hidden_size = h_grad_tensor->shape().At(2);
+    const int64_t num_heads = v_grad_tensor->shape().At(1);
+    const int64_t head_size = v_grad_tensor->shape().At(3);
+    CHECK_EQ(hidden_size, num_heads * 3 * head_size);
+    const PackedQkvLayout layout(seq_len, batch_size, num_heads, head_size);
+    const T alpha = static_cast<T>(ctx->Attr<float>("alpha"));
+    const T* h_dptr = h_tensor->dptr<T>();
+    const T* qmk_grad_dptr = qmk_grad_tensor->dptr<T>();
+    const T* v_grad_dptr = v_grad_tensor->dptr<T>();
+    T* h_grad_dptr = h_grad_tensor->mut_dptr<T>();
+    ForEachHead(ctx->stream(), layout, [&](int64_t i) {
+      const T* q = h_dptr + i * layout.stride;
+      const T* k = q + head_size;
+      const T* qmk_grad = qmk_grad_dptr + i * seq_len * seq_len;
+      T* q_grad = h_grad_dptr + i * layout.stride;
+      T* k_grad = q_grad + head_size;
+      T* v_grad = q_grad + 2 * head_size;
+      // grad_q = grad_qmk * k: (sq, sk) x (sk, h) -> (sq, h)
+      cblas_gemm<T>(CblasRowMajor, CblasNoTrans, CblasNoTrans, seq_len, head_size, seq_len, alpha,
+                    qmk_grad, seq_len, k, layout.ld, static_cast<T>(0), q_grad, layout.ld);
+      // grad_k = grad_qmk^T * q: (sk, sq) x (sq, h) -> (sk, h)
+      cblas_gemm<T>(CblasRowMajor, CblasTrans, CblasNoTrans, seq_len, head_size, seq_len, alpha,
+                    qmk_grad, seq_len, q, layout.ld, static_cast<T>(0), k_grad, layout.ld);
+      const T* v_grad_in = v_grad_dptr + i * seq_len * head_size;
+      for (int64_t s = 0; s < seq_len; ++s) {
+        std::copy(v_grad_in + s * head_size, v_grad_in + (s + 1) * head_size,
+                  v_grad + s * layout.ld);
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+}  // namespace
+
+#define REGISTER_FUSED_SELF_ATTENTION_QUERY_MUL_KEY_AND_VALUE_CPU_KERNEL(dtype) \
+  REGISTER_USER_KERNEL("fused_self_attention_query_mul_key_and_value")          \
+      .SetCreateFn<FusedSelfAttentionQueryMulKeyAndValueCpuKernel<dtype>>()     \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)           \
+                       && (user_op::HobDataType("hidden_states", 0) == GetDataType<dtype>::value));
+
+#define REGISTER_FUSED_SELF_ATTENTION_QUERY_MUL_KEY_AND_VALUE_GRAD_CPU_KERNEL(dtype) \
+  REGISTER_USER_KERNEL("fused_self_attention_query_mul_key_and_value_grad")          \
+      .SetCreateFn<FusedSelfAttentionQueryMulKeyAndValueGradCpuKernel<dtype>>()      \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                \
+                       && (user_op::HobDataType("hidden_states", 0) == GetDataType<dtype>::value));
+
+REGISTER_FUSED_SELF_ATTENTION_QUERY_MUL_KEY_AND_VALUE_CPU_KERNEL(float)
+REGISTER_FUSED_SELF_ATTENTION_QUERY_MUL_KEY_AND_VALUE_CPU_KERNEL(double)
+REGISTER_FUSED_SELF_ATTENTION_QUERY_MUL_KEY_AND_VALUE_GRAD_CPU_KERNEL(float)
+REGISTER_FUSED_SELF_ATTENTION_QUERY_MUL_KEY_AND_VALUE_GRAD_CPU_KERNEL(double)
+
+}  // namespace oneflow
@@ -0,0 +1,200 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_FUSED_SOFTMAX_CPU_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_FUSED_SOFTMAX_CPU_KERNEL_UTIL_H_
+
+#include <vector>
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/ep/cpu/primitive/softmax_util.h"
+
+namespace oneflow {
+
+namespace fused_softmax {
+
+// float rows use the ISA dispatched row functions of the softmax primitive, double rows the
+// scalar ones.
+template<typename ComputeType>
+struct SoftmaxRowFuncs;
+
+template<>
+struct SoftmaxRowFuncs<float> {
+  using Forward = void (*)(const float* x, float* y, size_t cols);
+  using Backward = void (*)(const float* y, const float* dy, float* dx, size_t cols);
+  static Forward GetForward() {
+    return ep::primitive::GetSoftmaxRowFunc(ep::primitive::SoftmaxAlgorithm::kSoftmax,
+                                            ep::GetCpuIsa());
+  }
+  static Backward GetBackward() {
+    return ep::primitive::GetSoftmaxBackwardRowFunc(ep::primitive::SoftmaxAlgorithm::kSoftmax,
+                                                    ep::GetCpuIsa());
+  }
+};
+
+template<>
+struct SoftmaxRowFuncs<double> {
+  using Forward = void (*)(const double* x, double* y, size_t cols);
+  using Backward = void (*)(const double* y, const double* dy, double* dx, size_t cols);
+  static Forward GetForward() {
+    return &ep::primitive::SoftmaxRowScalar<ep::primitive::SoftmaxAlgorithm::kSoftmax, double>;
+  }
+  static Backward GetBackward() {
+    return &ep::primitive::SoftmaxBackwardRowScalar<ep::primitive::SoftmaxAlgorithm::kSoftmax,
+                                                    double>;
+  }
+};
+
+// CPU counterpart of cuda::softmax::DispatchSoftmax for the fused softmax kernels. Rows are
+// split over the ThreadPool, load(row, buf) fills a ComputeType row, softmax is computed in place
+// and store(row, buf) writes the row out, so the fused elementwise work costs no extra pass.
+template<typename ComputeType, typename LOAD, typename STORE>
+void DispatchSoftmax(ep::Stream* stream, int64_t rows, int64_t cols, LOAD load, STORE store) {
+  const auto row_func = SoftmaxRowFuncs<ComputeType>::GetForward();
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, rows,
+      [&](int64_t begin, int64_t end) {
+        std::vector<ComputeType> row_buf(cols);
+        for (int64_t row = begin; row < end; ++row) {
+          load(row, row_buf.data());
+          row_func(row_buf.data(), row_buf.data(), cols);
+          store(row, row_buf.data());
+        }
+      },
+      ep::primitive::GetSoftmaxRowGrain(cols));
+}
+
+// Same as DispatchSoftmax for the gradient, load_y and load_dy fill the forward output and the
+// incoming gradient of a row, store receives dx.
+template<typename ComputeType, typename LOAD_Y, typename LOAD_DY, typename STORE>
+void DispatchSoftmaxGrad(ep::Stream* stream, int64_t rows, int64_t cols, LOAD_Y load_y,
+                         LOAD_DY load_dy, STORE store) {
+  const auto row_func = SoftmaxRowFuncs<ComputeType>::GetBackward();
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, rows,
+      [&](int64_t begin, int64_t end) {
+        std::vector<ComputeType> y_buf(cols);
+        std::vector<ComputeType> dy_buf(cols);
+        for (int64_t row = begin; row < end; ++row) {
+          load_y(row, y_buf.data());
+          load_dy(row, dy_buf.data());
+          row_func(y_buf.data(), dy_buf.data(), dy_buf.data(), cols);
+          store(row, dy_buf.data());
+        }
+      },
+      ep::primitive::GetSoftmaxRowGrain(cols));
+}
+
+template<typename SRC, typename DST>
+struct DirectLoad {
+  DirectLoad(const SRC* src, int64_t row_size) : src(src), row_size(row_size) {}
+  void operator()(int64_t row, DST* dst) const {
+    const SRC* row_src = src + row * row_size;
+    for (int64_t i = 0; i < row_size; ++i) { dst[i] = static_cast<DST>(row_src[i]); }
+  }
+  const SRC* src;
+  int64_t row_size;
+};
+
+template<typename SRC, typename DST>
+struct DirectStore {
+  DirectStore(DST* dst, int64_t row_size) : dst(dst), row_size(row_size) {}
+  void operator()(int64_t row, const SRC* src) const {
+    DST* row_dst = dst + row * row_size;
+    for (int64_t i = 0; i < row_size; ++i) { row_dst[i] = static_cast<DST>(src[i]); }
+  }
+  DST* dst;
+  int64_t row_size;
+};
+
+template<typename SRC, typename DST>
+struct ScaleMaskLoad {
+  ScaleMaskLoad(const SRC* src, const int8_t* mask, int64_t row_size, DST fill, DST scale)
+      : src(src), mask(mask), row_size(row_size), fill(fill), scale(scale) {}
+  void operator()(int64_t row, DST* dst) const {
+    const SRC* row_src = src + row * row_size;
+    const int8_t* row_mask = mask + row * row_size;
+    for (int64_t i = 0; i < row_size; ++i) {
+      dst[i] = row_mask[i] == 0 ? fill : static_cast<DST>(row_src[i]) * scale;
+    }
+  }
+  const SRC* src;
+  const int8_t* mask;
+  int64_t row_size;
+  DST fill;
+  DST scale;
+};
+
+template<typename SRC, typename DST>
+struct ScaleMaskStore {
+  ScaleMaskStore(DST* dst, const int8_t* mask, int64_t row_size, SRC fill, SRC scale)
+      : dst(dst), mask(mask), row_size(row_size), fill(fill), scale(scale) {}
+  void operator()(int64_t row, const SRC* src) const {
+    DST* row_dst = dst + row * row_size;
+    const int8_t* row_mask = mask + row * row_size;
+    for (int64_t i = 0; i < row_size; ++i) {
+      row_dst[i] = static_cast<DST>(row_mask[i] == 0 ? fill : src[i] * scale);
+    }
+  }
+  DST* dst;
+  const int8_t* mask;
+  int64_t row_size;
+  SRC fill;
+  SRC scale;
+};
+
+// Multiplies a row by mask * scale, used for dropout and for the mask of the tril softmax.
+template<typename SRC, typename DST>
+struct MaskAndScaleLoad {
+  MaskAndScaleLoad(const SRC* src, const int8_t* mask, int64_t row_size, DST scale)
+      : src(src), mask(mask), row_size(row_size), scale(scale) {}
+  void operator()(int64_t row, DST* dst) const {
+    const SRC* row_src = src + row * row_size;
+    const int8_t* row_mask = mask + row * row_size;
+    for (int64_t i = 0; i < row_size; ++i) {
+      dst[i] = static_cast<DST>(row_src[i]) * static_cast<DST>(row_mask[i]) * scale;
+    }
+  }
+  const SRC* src;
+  const int8_t* mask;
+  int64_t row_size;
+  DST scale;
+};
+
+// Stores the softmax output to softmax_y and the output multiplied by mask * scale to dst.
+template<typename SRC, typename DST>
+struct MaskAndScaleStore {
+  MaskAndScaleStore(DST* dst, DST* softmax_y, const int8_t* mask, int64_t row_size, SRC scale)
+      : dst(dst), softmax_y(softmax_y), mask(mask), row_size(row_size), scale(scale) {}
+  void operator()(int64_t row, const SRC* src) const {
+    DST* row_dst = dst + row * row_size;
+    DST* row_softmax_y = softmax_y + row * row_size;
+    const int8_t* row_mask = mask + row * row_size;
+    for (int64_t i = 0; i < row_size; ++i) {
+      row_softmax_y[i] = static_cast<DST>(src[i]);
+      row_dst[i] = static_cast<DST>(src[i] * static_cast<SRC>(row_mask[i]) * scale);
+    }
+  }
+  DST* dst;
+  DST* softmax_y;
+  const int8_t* mask;
+  int64_t row_size;
+  SRC scale;
+};
+
+}  // namespace fused_softmax
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_FUSED_SOFTMAX_CPU_KERNEL_UTIL_H_
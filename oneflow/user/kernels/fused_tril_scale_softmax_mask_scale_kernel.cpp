@@ -0,0 +1,154 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/fused_softmax_cpu_kernel_util.h"
+
+namespace oneflow {
+
+namespace {
+
+template<typename SRC, typename DST>
+struct TrilScaleLoad {
+  TrilScaleLoad(const SRC* src, int64_t tril_num_rows, int64_t row_size, int64_t diagonal, DST fill,
+                DST scale)
+      : src(src),
+        tril_num_rows(tril_num_rows),
+        row_size(row_size),
+        diagonal(diagonal),
+        fill(fill),
+        scale(scale) {}
+  void operator()(int64_t row, DST* dst) const {
+    const SRC* row_src = src + row * row_size;
+    const int64_t num_kept =
+        std::min(std::max<int64_t>(row % tril_num_rows + diagonal + 1, 0), row_size);
+    for (int64_t i = 0; i < num_kept; ++i) { dst[i] = static_cast<DST>(row_src[i]) * scale; }
+    for (int64_t i = num_kept; i < row_size; ++i) { dst[i] = fill; }
+  }
+  const SRC* src;
+  int64_t tril_num_rows;
+  int64_t row_size;
+  int64_t diagonal;
+  DST fill;
+  DST scale;
+};
+
+template<typename SRC, typename DST>
+struct TrilScaleStore {
+  TrilScaleStore(DST* dst, int64_t tril_num_rows, int64_t row_size, int64_t diagonal, SRC fill,
+                 SRC scale)
+      : dst(dst),
+        tril_num_rows(tril_num_rows),
+        row_size(row_size),
+        diagonal(diagonal),
+        fill(fill),
+        scale(scale) {}
+  void operator()(int64_t row, const SRC* src) const {
+    DST* row_dst = dst + row * row_size;
+    const int64_t num_kept =
+        std::min(std::max<int64_t>(row % tril_num_rows + diagonal + 1, 0), row_size);
+    for (int64_t i = 0; i < num_kept; ++i) { row_dst[i] = static_cast<DST>(src[i] * scale); }
+    for (int64_t i = num_kept; i < row_size; ++i) { row_dst[i] = static_cast<DST>(fill); }
+  }
+  DST* dst;
+  int64_t tril_num_rows;
+  int64_t row_size;
+  int64_t diagonal;
+  SRC fill;
+  SRC scale;
+};
+
+template<typename T>
+class FusedTrilScaleSoftmaxMaskScaleCpuKernel final : public user_op::OpKernel {
+ public:
+  FusedTrilScaleSoftmaxMaskScaleCpuKernel() = default;
+  ~FusedTrilScaleSoftmaxMaskScaleCpuKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const user_op::Tensor* mask = ctx->Tensor4ArgNameAndIndex("mask", 0);
+    user_op::Tensor* y = ctx->Tensor4ArgNameAndIndex("y", 0);
+    user_op::Tensor* softmax_y = ctx->Tensor4ArgNameAndIndex("softmax_y", 0);
+    const ShapeView& x_shape = x->shape();
+    CHECK_GE(x_shape.NumAxes(), 2);
+    const int64_t cols = x_shape.At(x_shape.NumAxes() - 1);
+    const int64_t rows = x_shape.Count(0, x_shape.NumAxes() - 1);
+    const int64_t tril_num_rows = x_shape.At(x_shape.NumAxes() - 2);
+    TrilScaleLoad<T, T> load(x->dptr<T>(), tril_num_rows, cols, ctx->Attr<int64_t>("diagonal"),
+                             ctx->Attr<float>("tril_fill_value"),
+                             ctx->Attr<float>("tril_scale_value"));
+    fused_softmax::MaskAndScaleStore<T, T> store(y->mut_dptr<T>(), softmax_y->mut_dptr<T>(),
+                                                 mask->dptr<int8_t>(), cols,
+                                                 ctx->Attr<float>("mask_scale_value"));
+    fused_softmax::DispatchSoftmax<T>(ctx->stream(), rows, cols, load, store);
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T>
+class FusedTrilScaleSoftmaxMaskScaleGradCpuKernel final : public user_op::OpKernel {
+ public:
+  FusedTrilScaleSoftmaxMaskScaleGradCpuKernel() = default;
+  ~FusedTrilScaleSoftmaxMaskScaleGradCpuKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* softmax_y = ctx->Tensor4ArgNameAndIndex("softmax_y", 0);
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const user_op::Tensor* mask = ctx->Tensor4ArgNameAndIndex("mask", 0);
+    user_op::Tensor* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
+    const ShapeView& dy_shape = dy->shape();
+    CHECK_GE(dy_shape.NumAxes(), 2);
+    const int64_t cols = dy_shape.At(dy_shape.NumAxes() - 1);
+    const int64_t rows = dy_shape.Count(0, dy_shape.NumAxes() - 1);
+    const int64_t tril_num_rows = dy_shape.At(dy_shape.NumAxes() - 2);
+    fused_softmax::DirectLoad<T, T> load_softmax_y(softmax_y->dptr<T>(), cols);
+    fused_softmax::MaskAndScaleLoad<T, T> load_dy(dy->dptr<T>(), mask->dptr<int8_t>(), cols,
+                                                  ctx->Attr<float>("mask_scale_value"));
+    TrilScaleStore<T, T> store(dx->mut_dptr<T>(), tril_num_rows, cols,
+                               ctx->Attr<int64_t>("diagonal"), static_cast<T>(0.0),
+                               ctx->Attr<float>("tril_scale_value"));
+    fused_softmax::DispatchSoftmaxGrad<T>(ctx->stream(), rows, cols, load_softmax_y, load_dy,
+                                          store);
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+}  // namespace
+
+#define REGISTER_FUSED_TRIL_SCALE_SOFTMAX_MASK_SCALE_CPU_KERNEL(dtype) \
+  REGISTER_USER_KERNEL("fused_tril_scale_softmax_mask_scale")          \
+      .SetCreateFn<FusedTrilScaleSoftmaxMaskScaleCpuKernel<dtype>>()   \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)  \
+                       && (user_op::HobDataType("y", 0) == GetDataType<dtype>::value));
+
+REGISTER_FUSED_TRIL_SCALE_SOFTMAX_MASK_SCALE_CPU_KERNEL(float)
+REGISTER_FUSED_TRIL_SCALE_SOFTMAX_MASK_SCALE_CPU_KERNEL(double)
+#undef REGISTER_FUSED_TRIL_SCALE_SOFTMAX_MASK_SCALE_CPU_KERNEL
+
+#define REGISTER_FUSED_TRIL_SCALE_SOFTMAX_MASK_SCALE_GRAD_CPU_KERNEL(dtype) \
+  REGISTER_USER_KERNEL("fused_tril_scale_softmax_mask_scale_grad")          \
+      .SetCreateFn<FusedTrilScaleSoftmaxMaskScaleGradCpuKernel<dtype>>()    \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)       \
+                       && (user_op::HobDataType("dx", 0) == GetDataType<dtype>::value));
+
+REGISTER_FUSED_TRIL_SCALE_SOFTMAX_MASK_SCALE_GRAD_CPU_KERNEL(float)
+REGISTER_FUSED_TRIL_SCALE_SOFTMAX_MASK_SCALE_GRAD_CPU_KERNEL(double)
+#undef REGISTER_FUSED_TRIL_SCALE_SOFTMAX_MASK_SCALE_GRAD_CPU_KERNEL
+
+}  // namespace oneflow
@@ -14,9 +14,185 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
 
 namespace oneflow {
 
+namespace {
+
+// Number of independent accumulators per row. The lanes are updated in lockstep so that the
+// inner loops over them are vectorized by the compiler.
+constexpr int64_t kNumLanes = 8;
+
+template<typename T>
+void WelfordCombine(T b_mean, T b_m2, T b_count, T* mean, T* m2, T* count) {
+  if (b_count == 0) { return; }
+  const T new_count = *count + b_count;
+  const T nb_over_n = b_count / new_count;
+  const T delta = b_mean - *mean;
+  *mean += delta * nb_over_n;
+  *m2 += b_m2 + delta * delta * (*count) * nb_over_n;
+  *count = new_count;
+}
+
+// One-pass Welford mean/variance of a row, the variance is biased as in the cuda kernel.
+template<typename T>
+void WelfordRowMeanVariance(const T* x, int64_t cols, T* row_mean, T* row_variance) {
+  T lane_mean[kNumLanes] = {0};
+  T lane_m2[kNumLanes] = {0};
+  const int64_t num_steps = cols / kNumLanes;
+  for (int64_t step = 0; step < num_steps; ++step) {
+    const T* x_step = x + step * kNumLanes;
+    const T inv_count = static_cast<T>(1) / static_cast<T>(step + 1);
+    for (int64_t lane = 0; lane < kNumLanes; ++lane) {
+      const T delta = x_step[lane] - lane_mean[lane];
+      lane_mean[lane] += delta * inv_count;
+      lane_m2[lane] += delta * (x_step[lane] - lane_mean[lane]);
+    }
+  }
+  T mean = 0;
+  T m2 = 0;
+  T count = 0;
+  for (int64_t lane = 0; lane < kNumLanes; ++lane) {
+    WelfordCombine<T>(lane_mean[lane], lane_m2[lane], static_cast<T>(num_steps), &mean, &m2,
+                      &count);
+  }
+  for (int64_t col = num_steps * kNumLanes; col < cols; ++col) {
+    count += 1;
+    const T delta = x[col] - mean;
+    mean += delta / count;
+    m2 += delta * (x[col] - mean);
+  }
+  *row_mean = mean;
+  *row_variance = m2 / static_cast<T>(cols);
+}
+
+template<typename T, bool do_scale, bool do_center>
+void LayerNormForwardRows(int64_t row_begin, int64_t row_end, int64_t cols, double epsilon,
+                          const T* x, const T* gamma, const T* beta, T* normalized, T* y, T* mean,
+                          T* inv_variance) {
+  for (int64_t row = row_begin; row < row_end; ++row) {
+    const T* row_x = x + row * cols;
+    T* row_y = y + row * cols;
+    T* row_normalized = normalized + row * cols;
+    T row_mean = 0;
+    T row_variance = 0;
+    WelfordRowMeanVariance<T>(row_x, cols, &row_mean, &row_variance);
+    const T row_inv_var =
+        static_cast<T>(1) / std::sqrt(row_variance + static_cast<T>(epsilon));
+    mean[row] = row_mean;
+    inv_variance[row] = row_inv_var;
+    // fused normalize and scale/shift
+    for (int64_t col = 0; col < cols; ++col) {
+      const T normalized_val = (row_x[col] - row_mean) * row_inv_var;
+      if (do_scale) { row_normalized[col] = normalized_val; }
+      T y_val = normalized_val;
+      if (do_scale) { y_val *= gamma[col]; }
+      if (do_center) { y_val += beta[col]; }
+      row_y[col] = y_val;
+    }
+  }
+}
+
+template<typename T>
+void DispatchLayerNormForwardRows(int64_t row_begin, int64_t row_end, int64_t cols,
+                                  double epsilon, const T* x, const T* gamma, const T* beta,
+                                  T* normalized, T* y, T* mean, T* inv_variance) {
+  if (gamma != nullptr && beta != nullptr) {
+    LayerNormForwardRows<T, true, true>(row_begin, row_end, cols, epsilon, x, gamma, beta,
+                                        normalized, y, mean, inv_variance);
+  } else if (gamma != nullptr && beta == nullptr) {
+    LayerNormForwardRows<T, true, false>(row_begin, row_end, cols, epsilon, x, gamma, beta,
+                                         normalized, y, mean, inv_variance);
+  } else if (gamma == nullptr && beta != nullptr) {
+    LayerNormForwardRows<T, false, true>(row_begin, row_end, cols, epsilon, x, gamma, beta,
+                                         normalized, y, mean, inv_variance);
+  } else {
+    LayerNormForwardRows<T, false, false>(row_begin, row_end, cols, epsilon, x, gamma, beta,
+                                          normalized, y, mean, inv_variance);
+  }
+}
+
+template<typename T, bool do_scale, bool do_add>
+void LayerNormBackwardRows(int64_t row_begin, int64_t row_end, int64_t cols, const T* dy,
+                           const T* x, const T* mean, const T* inv_variance, const T* gamma,
+                           const T* add_to_output, T* dx) {
+  for (int64_t row = row_begin; row < row_end; ++row) {
+    const int64_t offset = row * cols;
+    const T row_mean = mean[row];
+    const T row_inv_var = inv_variance[row];
+    T sum_stats1 = 0;
+    T sum_stats2 = 0;
+    for (int64_t col = 0; col < cols; ++col) {
+      const T scaled_dy = do_scale ? dy[offset + col] * gamma[col] : dy[offset + col];
+      const T normalized_val = (x[offset + col] - row_mean) * row_inv_var;
+      sum_stats1 += scaled_dy;
+      sum_stats2 += scaled_dy * normalized_val;
+    }
+    const T inv_variance_over_cols = row_inv_var / static_cast<T>(cols);
+    for (int64_t col = 0; col < cols; ++col) {
+      const T scaled_dy = do_scale ? dy[offset + col] * gamma[col] : dy[offset + col];
+      const T normalized_val = (x[offset + col] - row_mean) * row_inv_var;
+      T dx_val = (static_cast<T>(cols) * scaled_dy - sum_stats1 - normalized_val * sum_stats2)
+                 * inv_variance_over_cols;
+      if (do_add) { dx_val += add_to_output[offset + col]; }
+      dx[offset + col] = dx_val;
+    }
+  }
+}
+
+template<typename T>
+void DispatchLayerNormBackwardRows(int64_t row_begin, int64_t row_end, int64_t cols, const T* dy,
+                                   const T* x, const T* mean, const T* inv_variance,
+                                   const T* gamma, const T* add_to_output, T* dx) {
+  if (gamma != nullptr && add_to_output != nullptr) {
+    LayerNormBackwardRows<T, true, true>(row_begin, row_end, cols, dy, x, mean, inv_variance,
+                                         gamma, add_to_output, dx);
+  } else if (gamma != nullptr && add_to_output == nullptr) {
+    LayerNormBackwardRows<T, true, false>(row_begin, row_end, cols, dy, x, mean, inv_variance,
+                                          gamma, add_to_output, dx);
+  } else if (gamma == nullptr && add_to_output != nullptr) {
+    LayerNormBackwardRows<T, false, true>(row_begin, row_end, cols, dy, x, mean, inv_variance,
+                                          gamma, add_to_output, dx);
+  } else {
+    LayerNormBackwardRows<T, false, false>(row_begin, row_end, cols, dy, x, mean, inv_variance,
+                                           gamma, add_to_output, dx);
+  }
+}
+
+// Columns are independent in the param grad, so every thread owns a range of columns and walks
+// all the rows, which needs no partial sum buffers and keeps the result deterministic.
+template<typename T>
+void LayerNormParamGradCols(int64_t col_begin, int64_t col_end, int64_t rows, int64_t cols,
+                            const T* dy, const T* normalized, const T* gamma, T* gamma_diff,
+                            T* beta_diff, T* normalized_diff) {
+  if (gamma_diff != nullptr) { std::fill(gamma_diff + col_begin, gamma_diff + col_end, 0); }
+  if (beta_diff != nullptr) { std::fill(beta_diff + col_begin, beta_diff + col_end, 0); }
+  for (int64_t row = 0; row < rows; ++row) {
+    const int64_t offset = row * cols;
+    if (gamma_diff != nullptr) {
+      for (int64_t col = col_begin; col < col_end; ++col) {
+        gamma_diff[col] += dy[offset + col] * normalized[offset + col];
+      }
+    }
+    if (beta_diff != nullptr) {
+      for (int64_t col = col_begin; col < col_end; ++col) { beta_diff[col] += dy[offset + col]; }
+    }
+    if (normalized_diff != nullptr) {
+      if (gamma != nullptr) {
+        for (int64_t col = col_begin; col < col_end; ++col) {
+          normalized_diff[offset + col] = dy[offset + col] * gamma[col];
+        }
+      } else {
+        std::copy(dy + offset + col_begin, dy + offset + col_end,
+                  normalized_diff + offset + col_begin);
+      }
+    }
+  }
+}
+
+}  // namespace
+
 template<typename T>
 class LayerNormCpuKernel final : public user_op::OpKernel {
  public:
@@ -25,7 +201,39 @@ class LayerNormCpuKernel final : public user_op::OpKernel {
 
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
-  void Compute(user_op::KernelComputeContext* ctx) const override { TODO(); };
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    user_op::Tensor* y = ctx->Tensor4ArgNameAndIndex("y", 0);
+    user_op::Tensor* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+    user_op::Tensor* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+    user_op::Tensor* normalized =
+        ctx->has_input("gamma", 0) ? ctx->Tensor4ArgNameAndIndex("normalized", 0) : y;
+    const double epsilon = ctx->Attr<double>("epsilon");
+    const int64_t num_instances = mean->shape().elem_cnt();
+    if (num_instances == 0) { return; }
+    const int64_t norm_size = x->shape().elem_cnt() / num_instances;
+    const T* gamma_ptr = nullptr;
+    const T* beta_ptr = nullptr;
+    if (ctx->has_input("gamma", 0)) {
+      const user_op::Tensor* gamma = ctx->Tensor4ArgNameAndIndex("gamma", 0);
+      gamma_ptr = gamma->dptr<T>();
+      CHECK_EQ(gamma->shape().elem_cnt(), norm_size);
+    }
+    if (ctx->has_input("beta", 0)) { beta_ptr = ctx->Tensor4ArgNameAndIndex("beta", 0)->dptr<T>(); }
+    const T* x_ptr = x->dptr<T>();
+    T* normalized_ptr = normalized->mut_dptr<T>();
+    T* y_ptr = y->mut_dptr<T>();
+    T* mean_ptr = mean->mut_dptr<T>();
+    T* inv_variance_ptr = inv_variance->mut_dptr<T>();
+    ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+        0, num_instances,
+        [&](int64_t begin, int64_t end) {
+          DispatchLayerNormForwardRows<T>(begin, end, norm_size, epsilon, x_ptr, gamma_ptr,
+                                          beta_ptr, normalized_ptr, y_ptr, mean_ptr,
+                                          inv_variance_ptr);
+        },
+        std::max<int64_t>(ep::kParallelForDefaultGrain / norm_size, 1));
+  };
 };
 
 #define REGISTER_LAYER_NORM_CPU_KERNEL(dtype)                         \
@@ -45,14 +253,55 @@ class LayerNormGradCpuKernel final : public user_op::OpKernel {
 
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
-  void Compute(user_op::KernelComputeContext* ctx) const override { TODO(); };
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const user_op::Tensor* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+    const user_op::Tensor* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+    user_op::Tensor* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
+    const int64_t num_instances = mean->shape().elem_cnt();
+    if (num_instances == 0) { return; }
+    const int64_t norm_size = x->shape().elem_cnt() / num_instances;
+    const T* gamma_ptr = nullptr;
+    if (ctx->has_input("gamma", 0)) {
+      gamma_ptr = ctx->Tensor4ArgNameAndIndex("gamma", 0)->dptr<T>();
+    }
+    const T* add_to_output_ptr = nullptr;
+    if (ctx->has_input("_add_to_output", 0)) {
+      const user_op::Tensor* add_to_output = ctx->Tensor4ArgNameAndIndex("_add_to_output", 0);
+      CHECK_EQ(add_to_output->data_type(), dx->data_type());
+      CHECK_EQ(add_to_output->shape(), dx->shape());
+      add_to_output_ptr = add_to_output->dptr<T>();
+    }
+    const T* dy_ptr = dy->dptr<T>();
+    const T* x_ptr = x->dptr<T>();
+    const T* mean_ptr = mean->dptr<T>();
+    const T* inv_variance_ptr = inv_variance->dptr<T>();
+    T* dx_ptr = dx->mut_dptr<T>();
+    ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+        0, num_instances,
+        [&](int64_t begin, int64_t end) {
+          DispatchLayerNormBackwardRows<T>(begin, end, norm_size, dy_ptr, x_ptr, mean_ptr,
+                                           inv_variance_ptr, gamma_ptr, add_to_output_ptr,
+                                           dx_ptr);
+        },
+        std::max<int64_t>(ep::kParallelForDefaultGrain / norm_size, 1));
+  };
 };
 
-#define REGISTER_LAYER_NORM_GRAD_CPU_KERNEL(dtype)                    \
-  REGISTER_USER_KERNEL("layer_norm_grad")                             \
-      .SetCreateFn<LayerNormGradCpuKernel<dtype>>()                   \
-      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
-                       && (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value));
+#define REGISTER_LAYER_NORM_GRAD_CPU_KERNEL(dtype)                                              \
+  REGISTER_USER_KERNEL("layer_norm_grad")                                                       \
+      .SetCreateFn<LayerNormGradCpuKernel<dtype>>()                                             \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                           \
+                       && (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value))         \
+      .SetInplaceProposalFn(                                                                    \
+          [](const user_op::InferContext& ctx,                                                  \
+             const user_op::AddInplaceArgPair& AddInplaceArgPairFn) -> Maybe<void> {            \
+            if (ctx.has_input("_add_to_output", 0)) {                                           \
+              OF_RETURN_IF_ERROR(AddInplaceArgPairFn("dx", 0, "_add_to_output", 0, true));      \
+            }                                                                                   \
+            return Maybe<void>::Ok();                                                           \
+          });
 
 REGISTER_LAYER_NORM_GRAD_CPU_KERNEL(float)
 REGISTER_LAYER_NORM_GRAD_CPU_KERNEL(double)
@@ -65,7 +314,44 @@ class LayerNormParamGradCpuKernel final : public user_op::OpKernel {
 
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
-  void Compute(user_op::KernelComputeContext* ctx) const override { TODO(); };
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    user_op::Tensor* beta_diff = ctx->Tensor4ArgNameAndIndex("beta_diff", 0);
+    user_op::Tensor* gamma_diff = ctx->Tensor4ArgNameAndIndex("gamma_diff", 0);
+    user_op::Tensor* normalized_diff = ctx->Tensor4ArgNameAndIndex("normalized_diff", 0);
+    const user_op::Tensor* gamma = ctx->Tensor4ArgNameAndIndex("gamma", 0);
+    const int64_t begin_params_axis = ctx->Attr<int64_t>("begin_params_axis");
+    const int64_t m = dy->shape().Count(begin_params_axis);
+    if (m == 0) { return; }
+    CHECK_EQ(dy->shape().elem_cnt() % m, 0);
+    const int64_t n = dy->shape().elem_cnt() / m;
+    const T* normalized_ptr = nullptr;
+    T* gamma_diff_ptr = nullptr;
+    if (gamma_diff != nullptr) {
+      CHECK_EQ(m, gamma_diff->shape().elem_cnt());
+      normalized_ptr = ctx->Tensor4ArgNameAndIndex("normalized", 0)->dptr<T>();
+      gamma_diff_ptr = gamma_diff->mut_dptr<T>();
+    }
+    T* beta_diff_ptr = nullptr;
+    if (beta_diff != nullptr) {
+      CHECK_EQ(m, beta_diff->shape().elem_cnt());
+      beta_diff_ptr = beta_diff->mut_dptr<T>();
+    }
+    const T* gamma_ptr = nullptr;
+    if (gamma != nullptr) {
+      CHECK_EQ(m, gamma->shape().elem_cnt());
+      gamma_ptr = gamma->dptr<T>();
+    }
+    T* normalized_diff_ptr = normalized_diff != nullptr ? normalized_diff->mut_dptr<T>() : nullptr;
+    const T* dy_ptr = dy->dptr<T>();
+    ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+        0, m,
+        [&](int64_t begin, int64_t end) {
+          LayerNormParamGradCols<T>(begin, end, n, m, dy_ptr, normalized_ptr, gamma_ptr,
+                                    gamma_diff_ptr, beta_diff_ptr, normalized_diff_ptr);
+        },
+        std::max<int64_t>(ep::kParallelForDefaultGrain / std::max<int64_t>(n, 1), 1));
+  };
 };
 
 #define REGISTER_LAYER_NORM_PARAM_GRAD_CPU_KERNEL(dtype)              \
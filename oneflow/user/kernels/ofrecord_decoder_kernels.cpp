@@ -20,6 +20,7 @@ limitations under the License.
 #include "oneflow/core/kernel/new_kernel_util.h"
 #include "oneflow/core/kernel/kernel_util.h"
 #include "oneflow/core/thread/thread_manager.h"
+#include "oneflow/user/data/ofrecord_view.h"
 #include "oneflow/user/image/random_crop_generator.h"
 #include "oneflow/user/image/image_util.h"
 #include "oneflow/user/kernels/random_crop_kernel_state.h"
@@ -32,36 +33,51 @@ namespace oneflow {
 
 namespace {
 
+template<typename T>
+void DecodeOneRawBytes(const int8_t* in_dptr, int64_t size, T* dptr, int64_t sample_elem_cnt) {
+  sample_elem_cnt = std::min<int64_t>(sample_elem_cnt, size);
+  std::transform(in_dptr, in_dptr + sample_elem_cnt, dptr,
+                 [](int8_t v) { return static_cast<T>(v); });
+}
+
+// CopyValues(n, dptr) converts the first n of the value_size values of the list.
+template<typename T, typename CopyValuesFn>
+void DecodeOneRawList(int64_t value_size, const CopyValuesFn& CopyValues, T* dptr,
+                      int64_t sample_elem_cnt, bool truncate, bool dim1_varying_length) {
+  const int64_t padding_elem_num = truncate ? sample_elem_cnt - value_size : 0;
+  if (truncate) {
+    sample_elem_cnt = std::min<int64_t>(sample_elem_cnt, value_size);
+  } else {
+    if (dim1_varying_length) {
+      sample_elem_cnt = value_size;
+    } else {
+      CHECK_EQ(sample_elem_cnt, value_size);
+    }
+  }
+  CopyValues(sample_elem_cnt, dptr);
+  if (padding_elem_num > 0) {
+    std::memset(dptr + sample_elem_cnt, 0, padding_elem_num * sizeof(T));
+  }
+}
+
 template<typename T>
 void DecodeOneRawOFRecord(const Feature& feature, T* dptr, int64_t sample_elem_cnt, bool truncate,
                           bool dim1_varying_length) {
   if (feature.has_bytes_list()) {
     CHECK_EQ(feature.bytes_list().value_size(), 1);
     const auto& value0 = feature.bytes_list().value(0);
-    auto in_dptr = reinterpret_cast<const int8_t*>(value0.c_str());
-    sample_elem_cnt = std::min<int64_t>(sample_elem_cnt, value0.size());
-    std::transform(in_dptr, in_dptr + sample_elem_cnt, dptr,
-                   [](int8_t v) { return static_cast<T>(v); });
+    DecodeOneRawBytes(reinterpret_cast<const int8_t*>(value0.c_str()), value0.size(), dptr,
+                      sample_elem_cnt);
   }
-#define DEFINE_ONE_ELIF(PbT, CppT)                                                       \
-  else if (feature.has_##PbT##_list()) {                                                 \
-    const auto& list = feature.PbT##_list();                                             \
-    const CppT* in_dptr = list.value().data();                                           \
-    const int64_t padding_elem_num = truncate ? sample_elem_cnt - list.value_size() : 0; \
-    if (truncate) {                                                                      \
-      sample_elem_cnt = std::min<int64_t>(sample_elem_cnt, list.value_size());           \
-    } else {                                                                             \
-      if (dim1_varying_length) {                                                         \
-        sample_elem_cnt = list.value_size();                                             \
-      } else {                                                                           \
-        CHECK_EQ(sample_elem_cnt, list.value_size());                                    \
-      }                                                                                  \
-    }                                                                                    \
-    std::transform(in_dptr, in_dptr + sample_elem_cnt, dptr,                             \
-                   [](CppT v) { return static_cast<T>(v); });                            \
-    if (padding_elem_num > 0) {                                                          \
-      std::memset(dptr + sample_elem_cnt, 0, padding_elem_num * sizeof(T));              \
-    }                                                                                    \
+#define DEFINE_ONE_ELIF(PbT, CppT)                                                              \
+  else if (feature.has_##PbT##_list()) {                                                        \
+    const auto& list = feature.PbT##_list();                                                    \
+    const CppT* in_dptr = list.value().data();                                                  \
+    const auto CopyValues = [&](int64_t n, T* out_dptr) {                                       \
+      std::transform(in_dptr, in_dptr + n, out_dptr, [](CppT v) { return static_cast<T>(v); }); \
+    };                                                                                          \
+    DecodeOneRawList(list.value_size(), CopyValues, dptr, sample_elem_cnt, truncate,            \
+                     dim1_varying_length);                                                      \
   }
   DEFINE_ONE_ELIF(float, float)
   DEFINE_ONE_ELIF(double, double)
@@ -73,6 +89,23 @@ void DecodeOneRawOFRecord(const Feature& feature, T* dptr, int64_t sample_elem_c
   }
 }
 
+template<typename T>
+void DecodeOneRawOFRecord(const data::OFRecordFeatureView& feature, T* dptr,
+                          int64_t sample_elem_cnt, bool truncate, bool dim1_varying_length) {
+  if (feature.has_bytes_list()) {
+    CHECK_EQ(feature.value_size(), 1);
+    const data::OFRecordBytesView value0 = feature.bytes_value(0);
+    DecodeOneRawBytes(reinterpret_cast<const int8_t*>(value0.data), value0.size, dptr,
+                      sample_elem_cnt);
+  } else if (feature.kind() != Feature::KIND_NOT_SET) {
+    const auto CopyValues = [&](int64_t n, T* out_dptr) { feature.CopyValues(n, out_dptr); };
+    DecodeOneRawList(feature.value_size(), CopyValues, dptr, sample_elem_cnt, truncate,
+                     dim1_varying_length);
+  } else {
+    UNIMPLEMENTED();
+  }
+}
+
 }  // namespace
 
 template<typename T>
@@ -89,13 +122,26 @@ class OFRecordRawDecoderKernel final : public user_op::OpKernel {
     int64_t record_num = in_blob->shape().At(0);
     int64_t sample_elem_cnt = out_blob->shape().Count(1);
     CHECK(record_num > 0);
-    const OFRecord* records = in_blob->dptr<OFRecord>();
     T* out_dptr = out_blob->mut_dptr<T>();
     const std::string& name = ctx->Attr<std::string>("name");
 
     bool truncate = ctx->Attr<bool>("truncate");
     bool dim1_varying_length = ctx->Attr<bool>("dim1_varying_length");
 
+    if (in_blob->data_type() == DataType::kTensorBuffer) {
+      // serialized records, whose feature is found without parsing the others
+      const TensorBuffer* buffers = in_blob->dptr<TensorBuffer>();
+      MultiThreadLoop(record_num, [&](size_t i) {
+        const TensorBuffer& buffer = buffers[i];
+        const data::OFRecordView record(buffer.data<char>(), buffer.nbytes());
+        T* dptr = out_dptr + i * sample_elem_cnt;
+        data::OFRecordFeatureView feature;
+        CHECK(record.FindFeature(name, &feature)) << "Field " << name << " not found";
+        DecodeOneRawOFRecord(feature, dptr, sample_elem_cnt, truncate, dim1_varying_length);
+      });
+      return;
+    }
+    const OFRecord* records = in_blob->dptr<OFRecord>();
     MultiThreadLoop(record_num, [&](size_t i) {
       const OFRecord& record = *(records + i);
       T* dptr = out_dptr + i * sample_elem_cnt;
@@ -108,11 +154,12 @@ class OFRecordRawDecoderKernel final : public user_op::OpKernel {
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
 
-#define REGISTER_RAW_DECODER_KERNEL(dtype)                                       \
-  REGISTER_USER_KERNEL("ofrecord_raw_decoder")                                   \
-      .SetCreateFn<OFRecordRawDecoderKernel<dtype>>()                            \
-      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)            \
-                       && (user_op::HobDataType("in", 0) == DataType::kOFRecord) \
+#define REGISTER_RAW_DECODER_KERNEL(dtype)                                                \
+  REGISTER_USER_KERNEL("ofrecord_raw_decoder")                                            \
+      .SetCreateFn<OFRecordRawDecoderKernel<dtype>>()                                     \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                     \
+                       && ((user_op::HobDataType("in", 0) == DataType::kOFRecord)         \
+                           || (user_op::HobDataType("in", 0) == DataType::kTensorBuffer)) \
                        && (user_op::HobDataType("out", 0) == GetDataType<dtype>::value));
 
 REGISTER_RAW_DECODER_KERNEL(char)
@@ -16,6 +16,7 @@ limitations under the License.
 #include <cstdint>
 #include "oneflow/core/framework/framework.h"
 #include "oneflow/core/kernel/kernel_util.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
 
 namespace oneflow {
 
@@ -61,4 +62,58 @@ REGISTER_CPU_TRIL_KERNEL(int8_t)
 REGISTER_CPU_TRIL_KERNEL(int32_t)
 REGISTER_CPU_TRIL_KERNEL(int64_t)
 
+template<typename T>
+class CpuFusedScaleTrilKernel final : public user_op::OpKernel {
+ public:
+  CpuFusedScaleTrilKernel() = default;
+  ~CpuFusedScaleTrilKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("in", 0);
+    const auto shape = x->shape();
+    const auto diagonal = ctx->Attr<int64_t>("diagonal");
+    const int64_t num_rows = shape.At(shape.NumAxes() - 2);
+    const int64_t num_cols = shape.At(shape.NumAxes() - 1);
+    user_op::Tensor* y = ctx->Tensor4ArgNameAndIndex("out", 0);
+    T* y_dptr = y->mut_dptr<T>();
+    const T* x_dptr = x->dptr<T>();
+    const T fill = ctx->Attr<bool>("is_floating_fill_value")
+                       ? static_cast<T>(ctx->Attr<double>("floating_fill_value"))
+                       : static_cast<T>(ctx->Attr<int64_t>("integer_fill_value"));
+    const T scale = ctx->Attr<bool>("is_floating_scale_value")
+                        ? static_cast<T>(ctx->Attr<double>("floating_scale_value"))
+                        : static_cast<T>(ctx->Attr<int64_t>("integer_scale_value"));
+    if (num_cols == 0) { return; }
+    const int64_t total_rows = shape.elem_cnt() / num_cols;
+    ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+        0, total_rows,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t row = begin; row < end; ++row) {
+            const T* x_row = x_dptr + row * num_cols;
+            T* y_row = y_dptr + row * num_cols;
+            const int64_t num_kept =
+                std::min(std::max<int64_t>(row % num_rows + diagonal + 1, 0), num_cols);
+            for (int64_t j = 0; j < num_kept; ++j) { y_row[j] = x_row[j] * scale; }
+            for (int64_t j = num_kept; j < num_cols; ++j) { y_row[j] = fill; }
+          }
+        },
+        std::max<int64_t>(ep::kParallelForDefaultGrain / num_cols, 1));
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_FUSED_SCALE_TRIL_KERNEL(dtype)                   \
+  REGISTER_USER_KERNEL("fused_scale_tril")                            \
+      .SetCreateFn<CpuFusedScaleTrilKernel<dtype>>()                  \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
+                       && (user_op::HobDataType("out", 0) == GetDataType<dtype>::value));
+
+REGISTER_CPU_FUSED_SCALE_TRIL_KERNEL(float)
+REGISTER_CPU_FUSED_SCALE_TRIL_KERNEL(double)
+REGISTER_CPU_FUSED_SCALE_TRIL_KERNEL(uint8_t)
+REGISTER_CPU_FUSED_SCALE_TRIL_KERNEL(int8_t)
+REGISTER_CPU_FUSED_SCALE_TRIL_KERNEL(int32_t)
+REGISTER_CPU_FUSED_SCALE_TRIL_KERNEL(int64_t)
+
 }  // namespace oneflow
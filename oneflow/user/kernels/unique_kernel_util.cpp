@@ -14,9 +14,232 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/user/kernels/unique_kernel_util.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
 
 namespace oneflow {
 
+namespace {
+
+// Inputs with fewer elements keep the serial HashMap version, which wins when the extra passes
+// of the partitioned version cannot be spread over threads.
+constexpr int64_t kParallelUniqueMinElements = 1 << 16;
+constexpr int64_t kLog2NumUniquePartitions = 6;
+
+// Final mixer of MurmurHash3, spreads consecutive ids over all bits. The top bits pick the
+// partition and the low bits the slot in the partition's table.
+inline uint64_t HashUniqueKey(uint64_t key) {
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  key ^= key >> 33;
+  key *= 0xc4ceb9fe1a85ec53ULL;
+  key ^= key >> 33;
+  return key;
+}
+
+// Linear probing table from key to its partition-local unique id, grown to stay at most half
+// full so that partitions with few distinct keys stay small.
+template<typename KEY>
+class UniqueHashTable final {
+ public:
+  UniqueHashTable() : size_(0) { Resize(64); }
+
+  // Returns the id of key, inserting it as the next id if it is not in the table yet.
+  int64_t FindOrInsert(KEY key, uint64_t hash) {
+    for (uint64_t slot = hash & mask_;; slot = (slot + 1) & mask_) {
+      const int64_t id = ids_[slot];
+      if (id < 0) {
+        const int64_t new_id = size_++;
+        keys_[slot] = key;
+        ids_[slot] = new_id;
+        if (2 * size_ > static_cast<int64_t>(ids_.size())) { Resize(2 * ids_.size()); }
+        return new_id;
+      }
+      if (keys_[slot] == key) { return id; }
+    }
+  }
+
+ private:
+  void Resize(int64_t capacity) {
+    std::vector<KEY> old_keys(capacity);
+    std::vector<int64_t> old_ids(capacity, -1);
+    old_keys.swap(keys_);
+    old_ids.swap(ids_);
+    mask_ = capacity - 1;
+    for (size_t i = 0; i < old_ids.size(); ++i) {
+      if (old_ids[i] < 0) { continue; }
+      uint64_t slot = HashUniqueKey(static_cast<uint64_t>(old_keys[i])) & mask_;
+      while (ids_[slot] >= 0) { slot = (slot + 1) & mask_; }
+      keys_[slot] = old_keys[i];
+      ids_[slot] = old_ids[i];
+    }
+  }
+
+  int64_t size_;
+  uint64_t mask_;
+  std::vector<KEY> keys_;
+  std::vector<int64_t> ids_;
+};
+
+template<typename KEY, typename IDX>
+void HashMapUniqueWithCounts(int64_t n, const KEY* in, IDX* num_unique, KEY* unique_out,
+                             IDX* idx_out, IDX* count) {
+  HashMap<KEY, IDX> map;
+  FOR_RANGE(int64_t, i, 0, n) {
+    KEY in_i = in[i];
+    auto it = map.find(in_i);
+    if (it == map.end()) {
+      IDX idx = map.size();
+      if (count != nullptr) { count[idx] = 1; }
+      idx_out[i] = idx;
+      unique_out[idx] = in_i;
+      map[in_i] = idx;
+    } else {
+      IDX idx = it->second;
+      if (count != nullptr) { count[idx] += 1; }
+      idx_out[i] = idx;
+    }
+  }
+  *num_unique = map.size();
+}
+
+// Unique of integral keys numbered in order of first occurrence, like the HashMap version.
+// Elements are bucketed by key hash into partitions, keeping their original order inside a
+// partition, and every partition is deduplicated by its own thread. A prefix sum over the
+// first-occurrence flags then turns the partition-local ids into the global numbering.
+template<typename KEY, typename IDX>
+void ParallelUniqueWithCounts(ep::Stream* stream, int64_t n, const KEY* in, IDX* num_unique,
+                              KEY* unique_out, IDX* idx_out, IDX* count) {
+  ep::CpuStream* cpu_stream = stream->As<ep::CpuStream>();
+  const int64_t num_partitions = int64_t(1) << kLog2NumUniquePartitions;
+  const int64_t num_chunks = num_partitions;
+  const int64_t chunk_size = (n + num_chunks - 1) / num_chunks;
+  auto PartitionOf = [](uint64_t hash) -> int64_t {
+    return hash >> (64 - kLog2NumUniquePartitions);
+  };
+  auto ForEachChunk = [&](const std::function<void(int64_t, int64_t, int64_t)>& func) {
+    cpu_stream->ParallelFor(
+        0, num_chunks,
+        [&](int64_t chunk_begin, int64_t chunk_end) {
+          for (int64_t c = chunk_begin; c < chunk_end; ++c) {
+            func(c, std::min(c * chunk_size, n), std::min((c + 1) * chunk_size, n));
+          }
+        },
+        1);
+  };
+
+  // Per chunk histogram over partitions, then stable scatter of element indices so that each
+  // partition's elements are contiguous and ascending.
+  std::vector<uint64_t> hashes(n);
+  std::vector<int64_t> histogram(num_chunks * num_partitions, 0);
+  ForEachChunk([&](int64_t c, int64_t begin, int64_t end) {
+    int64_t* chunk_histogram = histogram.data() + c * num_partitions;
+    for (int64_t i = begin; i < end; ++i) {
+      hashes[i] = HashUniqueKey(static_cast<uint64_t>(in[i]));
+      chunk_histogram[PartitionOf(hashes[i])] += 1;
+    }
+  });
+  std::vector<int64_t> partition_begin(num_partitions + 1);
+  std::vector<int64_t> chunk_offsets(num_chunks * num_partitions);
+  int64_t offset = 0;
+  for (int64_t p = 0; p < num_partitions; ++p) {
+    partition_begin[p] = offset;
+    for (int64_t c = 0; c < num_chunks; ++c) {
+      chunk_offsets[c * num_partitions + p] = offset;
+      offset += histogram[c * num_partitions + p];
+    }
+  }
+  partition_begin[num_partitions] = offset;
+  std::vector<int64_t> positions(n);
+  ForEachChunk([&](int64_t c, int64_t begin, int64_t end) {
+    int64_t* chunk_offset = chunk_offsets.data() + c * num_partitions;
+    for (int64_t i = begin; i < end; ++i) { positions[chunk_offset[PartitionOf(hashes[i])]++] = i; }
+  });
+
+  // Deduplicate every partition, recording where each unique key first occurs.
+  std::vector<uint8_t> is_first(n, 0);
+  std::vector<IDX> local_ids(n);
+  std::vector<std::vector<int64_t>> first_positions(num_partitions);
+  std::vector<std::vector<IDX>> local_counts(num_partitions);
+  cpu_stream->ParallelFor(
+      0, num_partitions,
+      [&](int64_t partition_begin_idx, int64_t partition_end_idx) {
+        for (int64_t p = partition_begin_idx; p < partition_end_idx; ++p) {
+          UniqueHashTable<KEY> table;
+          std::vector<int64_t>* first_position = &first_positions[p];
+          std::vector<IDX>* local_count = &local_counts[p];
+          for (int64_t j = partition_begin[p]; j < partition_begin[p + 1]; ++j) {
+            const int64_t i = positions[j];
+            const int64_t id = table.FindOrInsert(in[i], hashes[i]);
+            if (id == static_cast<int64_t>(first_position->size())) {
+              first_position->push_back(i);
+              local_count->push_back(0);
+              is_first[i] = 1;
+            }
+            (*local_count)[id] += 1;
+            local_ids[j] = id;
+          }
+        }
+      },
+      1);
+
+  // The global id of a unique key is the number of first occurrences before its own.
+  std::vector<int64_t> chunk_num_firsts(num_chunks + 1, 0);
+  ForEachChunk([&](int64_t c, int64_t begin, int64_t end) {
+    int64_t num_firsts = 0;
+    for (int64_t i = begin; i < end; ++i) { num_firsts += is_first[i]; }
+    chunk_num_firsts[c + 1] = num_firsts;
+  });
+  for (int64_t c = 0; c < num_chunks; ++c) { chunk_num_firsts[c + 1] += chunk_num_firsts[c]; }
+  ForEachChunk([&](int64_t c, int64_t begin, int64_t end) {
+    IDX global_id = chunk_num_firsts[c];
+    for (int64_t i = begin; i < end; ++i) {
+      if (is_first[i]) { idx_out[i] = global_id++; }
+    }
+  });
+
+  cpu_stream->ParallelFor(
+      0, num_partitions,
+      [&](int64_t partition_begin_idx, int64_t partition_end_idx) {
+        for (int64_t p = partition_begin_idx; p < partition_end_idx; ++p) {
+          const std::vector<int64_t>& first_position = first_positions[p];
+          std::vector<IDX> global_ids(first_position.size());
+          for (size_t u = 0; u < first_position.size(); ++u) {
+            const IDX global_id = idx_out[first_position[u]];
+            global_ids[u] = global_id;
+            unique_out[global_id] = in[first_position[u]];
+            if (count != nullptr) { count[global_id] = local_counts[p][u]; }
+          }
+          for (int64_t j = partition_begin[p]; j < partition_begin[p + 1]; ++j) {
+            idx_out[positions[j]] = global_ids[local_ids[j]];
+          }
+        }
+      },
+      1);
+  *num_unique = chunk_num_firsts[num_chunks];
+}
+
+// Large inputs of integral keys take the parallel path. Floating point keys keep the HashMap,
+// whose == based lookup defines how -0.0 and NaN are deduplicated.
+template<typename KEY, typename IDX>
+void UniqueWithCountsCpu(std::true_type /*is_integral*/, ep::Stream* stream, int64_t n,
+                         const KEY* in, IDX* num_unique, KEY* unique_out, IDX* idx_out,
+                         IDX* count) {
+  if (n < kParallelUniqueMinElements) {
+    HashMapUniqueWithCounts(n, in, num_unique, unique_out, idx_out, count);
+  } else {
+    ParallelUniqueWithCounts(stream, n, in, num_unique, unique_out, idx_out, count);
+  }
+}
+
+template<typename KEY, typename IDX>
+void UniqueWithCountsCpu(std::false_type /*is_integral*/, ep::Stream* stream, int64_t n,
+                         const KEY* in, IDX* num_unique, KEY* unique_out, IDX* idx_out,
+                         IDX* count) {
+  HashMapUniqueWithCounts(n, in, num_unique, unique_out, idx_out, count);
+}
+
+}  // namespace
+
 template<typename KEY, typename IDX>
 struct UniqueKernelUtil<DeviceType::kCPU, KEY, IDX> {
   static void Unique(ep::Stream* stream, int64_t n, const KEY* in, IDX* num_unique, KEY* unique_out,
@@ -28,23 +251,8 @@ struct UniqueKernelUtil<DeviceType::kCPU, KEY, IDX> {
   static void UniqueWithCounts(ep::Stream* stream, int64_t n, const KEY* in, IDX* num_unique,
                                KEY* unique_out, IDX* idx_out, IDX* count, void* workspace,
                                int64_t workspace_size_in_bytes) {
-    HashMap<KEY, IDX> map;
-    FOR_RANGE(int64_t, i, 0, n) {
-      KEY in_i = in[i];
-      auto it = map.find(in_i);
-      if (it == map.end()) {
-        IDX idx = map.size();
-        if (count != nullptr) { count[idx] = 1; }
-        idx_out[i] = idx;
-        unique_out[idx] = in_i;
-        map[in_i] = idx;
-      } else {
-        IDX idx = it->second;
-        if (count != nullptr) { count[idx] += 1; }
-        idx_out[i] = idx;
-      }
-    }
-    *num_unique = map.size();
+    UniqueWithCountsCpu(std::is_integral<KEY>(), stream, n, in, num_unique, unique_out, idx_out,
+                        count);
   }
   static void GetUniqueWorkspaceSizeInBytes(ep::Stream* stream, int64_t n,
                                             int64_t* workspace_size_in_bytes) {
@@ -0,0 +1,110 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/unique_kernel_util.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/thread/thread_pool.h"
+#include <gtest/gtest.h>
+#include <random>
+
+namespace oneflow {
+
+namespace {
+
+// Inputs of at least this many integral keys take the parallel path.
+constexpr int64_t kParallelUniqueElements = 1 << 16;
+
+// Keys numbered in order of first occurrence, the way the HashMap path of the CPU kernel does.
+template<typename KEY, typename IDX>
+void ReferenceUniqueWithCounts(const std::vector<KEY>& in, std::vector<KEY>* unique_out,
+                               std::vector<IDX>* idx_out, std::vector<IDX>* count) {
+  HashMap<KEY, IDX> key2idx;
+  for (KEY key : in) {
+    auto it = key2idx.find(key);
+    if (it == key2idx.end()) {
+      it = key2idx.emplace(key, static_cast<IDX>(unique_out->size())).first;
+      unique_out->push_back(key);
+      count->push_back(0);
+    }
+    idx_out->push_back(it->second);
+    (*count)[it->second] += 1;
+  }
+}
+
+template<typename KEY, typename IDX>
+void TestUniqueWithCounts(int64_t n, int64_t key_range, uint64_t seed) {
+  std::mt19937_64 rng(seed);
+  std::vector<KEY> in(n);
+  // about a third of the keys are negative
+  for (auto& key : in) {
+    key = static_cast<KEY>(static_cast<int64_t>(rng() % key_range) - key_range / 3);
+  }
+  std::vector<KEY> expected_unique;
+  std::vector<IDX> expected_idx;
+  std::vector<IDX> expected_count;
+  ReferenceUniqueWithCounts(in, &expected_unique, &expected_idx, &expected_count);
+
+  std::vector<KEY> unique_out(n);
+  std::vector<IDX> idx_out(n);
+  std::vector<IDX> count(n);
+  IDX num_unique = 0;
+  ep::CpuStream stream(nullptr);
+  UniqueKernelUtil<DeviceType::kCPU, KEY, IDX>::UniqueWithCounts(
+      &stream, n, in.data(), &num_unique, unique_out.data(), idx_out.data(), count.data(), nullptr,
+      0);
+  ASSERT_EQ(num_unique, expected_unique.size());
+  for (int64_t i = 0; i < num_unique; ++i) {
+    ASSERT_EQ(unique_out[i], expected_unique[i]) << "unique " << i;
+    ASSERT_EQ(count[i], expected_count[i]) << "count " << i;
+  }
+  for (int64_t i = 0; i < n; ++i) { ASSERT_EQ(idx_out[i], expected_idx[i]) << "idx " << i; }
+
+  std::vector<IDX> unique_idx_out(n);
+  UniqueKernelUtil<DeviceType::kCPU, KEY, IDX>::Unique(&stream, n, in.data(), &num_unique,
+                                                       unique_out.data(), unique_idx_out.data(),
+                                                       nullptr, 0);
+  ASSERT_EQ(num_unique, expected_unique.size());
+  ASSERT_TRUE(std::equal(unique_out.begin(), unique_out.begin() + num_unique,
+                         expected_unique.begin()));
+  ASSERT_EQ(unique_idx_out, expected_idx);
+}
+
+template<typename KEY, typename IDX>
+void TestUniqueWithCountsShapes() {
+  // runs the chunks on pool threads when no pool has been set up by the environment
+  const bool own_thread_pool = Global<ThreadPool>::Get() == nullptr;
+  if (own_thread_pool) { Global<ThreadPool>::New(4); }
+  // below the threshold, HashMap path
+  TestUniqueWithCounts<KEY, IDX>(kParallelUniqueElements - 1, 1000, 1);
+  // few distinct keys, every partition sees many duplicates
+  TestUniqueWithCounts<KEY, IDX>(kParallelUniqueElements, 100, 2);
+  // many distinct keys, uneven chunks
+  TestUniqueWithCounts<KEY, IDX>(3 * kParallelUniqueElements + 17, 1000000, 3);
+  // almost all keys distinct
+  TestUniqueWithCounts<KEY, IDX>(2 * kParallelUniqueElements, 1LL << 30, 4);
+  if (own_thread_pool) { Global<ThreadPool>::Delete(); }
+}
+
+TEST(CpuUniqueKernelUtil, Int32KeyInt32Idx) { TestUniqueWithCountsShapes<int32_t, int32_t>(); }
+
+TEST(CpuUniqueKernelUtil, Int32KeyInt64Idx) { TestUniqueWithCountsShapes<int32_t, int64_t>(); }
+
+TEST(CpuUniqueKernelUtil, Int64KeyInt32Idx) { TestUniqueWithCountsShapes<int64_t, int32_t>(); }
+
+TEST(CpuUniqueKernelUtil, Int64KeyInt64Idx) { TestUniqueWithCountsShapes<int64_t, int64_t>(); }
+
+}  // namespace
+
+}  // namespace oneflow
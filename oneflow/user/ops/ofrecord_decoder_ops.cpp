@@ -51,7 +51,9 @@ namespace oneflow {
 /* static */ Maybe<void> OfrecordRawDecoderOp::InferDataType(user_op::InferContext* ctx) {
   const user_op::TensorDesc& in_tensor = ctx->InputTensorDesc("in", 0);
   user_op::TensorDesc* out_tensor = ctx->OutputTensorDesc("out", 0);
-  CHECK_OR_RETURN(in_tensor.data_type() == DataType::kOFRecord);
+  // records are either parsed, or serialized in tensor buffers
+  CHECK_OR_RETURN(in_tensor.data_type() == DataType::kOFRecord
+                  || in_tensor.data_type() == DataType::kTensorBuffer);
   *out_tensor->mut_data_type() = ctx->Attr<DataType>("data_type");
   return Maybe<void>::Ok();
 }
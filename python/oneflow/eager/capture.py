@@ -0,0 +1,80 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import oneflow
+import oneflow._oneflow_internal
+
+
+class EagerCapture(object):
+    r"""Runs an eager inference step by replaying the instructions captured from an
+    earlier call.
+
+    The first call, and every call whose inputs differ in shape, dtype or device from
+    the captured ones, runs ``fn`` normally while capturing. The other calls copy the
+    inputs into the captured input tensors and replay the capture, which skips op
+    dispatch, inference and instruction building. Intermediate tensors keep their
+    memory between replays.
+
+    The returned tensors are the captured output tensors, which the next call
+    overwrites. ``fn`` runs under ``oneflow.no_grad()`` and may only use local tensors,
+    without reading tensor values back to the host.
+
+    For example:
+
+    .. code-block:: python
+
+        >>> import oneflow as flow
+        >>> from oneflow.eager.capture import EagerCapture
+        >>> linear = flow.nn.Linear(3, 4)
+        >>> step = EagerCapture(lambda x: flow.relu(linear(x)))
+        >>> y = step(flow.ones(2, 3))
+        >>> y = step(flow.zeros(2, 3))  # replayed
+        >>> y.shape
+        oneflow.Size([2, 4])
+
+    """
+
+    def __init__(self, fn):
+        self._fn = fn
+        self._capture = oneflow._oneflow_internal.InstructionCapture()
+        self._signature = None
+        self._static_inputs = None
+        self._static_outputs = None
+
+    def __call__(self, *args):
+        signature = tuple((x.shape, x.dtype, x.device) for x in args)
+        if signature != self._signature or not self._capture.valid:
+            return self._capture_call(signature, args)
+        for static_input, x in zip(self._static_inputs, args):
+            static_input.copy_(x)
+        self._capture.replay()
+        return self._static_outputs
+
+    @property
+    def captured(self):
+        return self._capture.valid
+
+    def _capture_call(self, signature, args):
+        self._signature = None
+        self._static_inputs = [x.clone() for x in args]
+        with oneflow.no_grad():
+            self._capture.begin_capture()
+            try:
+                outputs = self._fn(*self._static_inputs)
+            finally:
+                self._capture.end_capture()
+        self._signature = signature
+        self._static_outputs = outputs
+        return outputs
@@ -417,6 +417,21 @@ def _test_conv1d_compilcate(test_case, device):
     test_case.assertTrue(np.allclose(input.grad.numpy(), np_grad, 1e-06, 1e-06))
 
 
+def _test_conv1d_channels_last_1x1(test_case, device):
+    x = np.random.randn(3, 11, 20)
+    weight = np.random.randn(24, 1, 20)
+    of_out = flow._C.conv1d(
+        flow.tensor(x, dtype=flow.float32, device=flow.device(device)),
+        flow.tensor(weight, dtype=flow.float32, device=flow.device(device)),
+        stride=[1],
+        padding=[0],
+        dilation=[1],
+        channel_pos="channels_last",
+    )
+    np_out = np.einsum("nlc,oc->nlo", x, weight.reshape(24, 20))
+    test_case.assertTrue(np.allclose(of_out.numpy(), np_out, 1e-4, 1e-4))
+
+
 @flow.unittest.skip_unless_1n1d()
 class TestConv1d(flow.unittest.TestCase):
     def test_conv1d(test_case):
@@ -455,6 +470,28 @@ class TestConv1d(flow.unittest.TestCase):
         y = m(x)
         return y
 
+    def test_conv1d_channels_last_1x1(test_case):
+        _test_conv1d_channels_last_1x1(test_case, "cpu")
+
+    @autotest(n=3)
+    def test_conv1d_large_batch_with_random_data(test_case):
+        # more samples than the cpu kernel has column buffers, one per thread
+        channels = random(16, 33)
+        m = torch.nn.Conv1d(
+            in_channels=channels,
+            out_channels=random(16, 33),
+            kernel_size=oneof(1, 3),
+            padding=random(0, 2).to(int),
+            bias=random(),
+        )
+        m.train(random())
+        m.to("cpu")
+        x = random_pytorch_tensor(
+            ndim=3, dim0=2 * os.cpu_count() + 1, dim1=channels, dim2=oneof(7, 13)
+        ).to("cpu")
+        y = m(x)
+        return y
+
     @unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
     @autotest(n=30, check_allclose=False)
     def test_conv1d_group_with_random_data(test_case):
@@ -1562,6 +1562,21 @@ def _test_conv2d_large_out_channel(test_case, device):
     test_case.assertTrue(np.allclose(input.grad.numpy(), np_grad, 1e-3, 1e-3))
 
 
+def _test_conv2d_channels_last_1x1(test_case, device):
+    x = np.random.randn(3, 7, 9, 20)
+    weight = np.random.randn(24, 1, 1, 20)
+    of_out = flow._C.conv2d(
+        flow.tensor(x, dtype=flow.float32, device=flow.device(device)),
+        flow.tensor(weight, dtype=flow.float32, device=flow.device(device)),
+        stride=[1, 1],
+        padding=[0, 0],
+        dilation=[1, 1],
+        channel_pos="channels_last",
+    )
+    np_out = np.einsum("nhwc,oc->nhwo", x, weight.reshape(24, 20))
+    test_case.assertTrue(np.allclose(of_out.numpy(), np_out, 1e-4, 1e-4))
+
+
 @flow.unittest.skip_unless_1n1d()
 class TestConv2d(flow.unittest.TestCase):
     def test_conv2d_default_init(test_case):
@@ -1842,6 +1857,45 @@ class TestConv2d(flow.unittest.TestCase):
         y = m(x)
         return y
 
+    def test_conv2d_channels_last_1x1(test_case):
+        _test_conv2d_channels_last_1x1(test_case, "cpu")
+
+    @autotest(n=5, rtol=1e-3, atol=1e-4)
+    def test_conv2d_winograd_with_random_data(test_case):
+        channels = random(16, 33)
+        m = torch.nn.Conv2d(
+            in_channels=channels,
+            out_channels=random(16, 33),
+            kernel_size=3,
+            padding=random(0, 2).to(int),
+            bias=random(),
+        )
+        m.train(random())
+        m.to("cpu")
+        x = random_pytorch_tensor(
+            ndim=4, dim1=channels, dim2=oneof(7, 13), dim3=oneof(9, 15)
+        ).to("cpu")
+        y = m(x)
+        return y
+
+    @autotest(n=3)
+    def test_conv2d_large_batch_with_random_data(test_case):
+        # more samples than the cpu kernel has column buffers, one per thread
+        channels = random(1, 6)
+        m = torch.nn.Conv2d(
+            in_channels=channels,
+            out_channels=random(1, 20),
+            kernel_size=oneof(1, 3),
+            padding=random(0, 2).to(int),
+        )
+        m.train(random())
+        m.to("cpu")
+        x = random_pytorch_tensor(
+            ndim=4, dim0=2 * os.cpu_count() + 1, dim1=channels, dim2=7, dim3=9
+        ).to("cpu")
+        y = m(x)
+        return y
+
     @unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
     @autotest(n=30, check_allclose=False)
     def test_conv2d_group_with_random_data(test_case):
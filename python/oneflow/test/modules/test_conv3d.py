@@ -14,12 +14,30 @@ See the License for the specific language governing permissions and
 limitations under the License.
 """
 import unittest
+
+import numpy as np
+
 import oneflow as flow
 import oneflow.unittest
 
 from oneflow.test_utils.automated_test_util import *
 
 
+def _test_conv3d_channels_last_1x1(test_case, device):
+    x = np.random.randn(3, 5, 7, 9, 20)
+    weight = np.random.randn(24, 1, 1, 1, 20)
+    of_out = flow._C.conv3d(
+        flow.tensor(x, dtype=flow.float32, device=flow.device(device)),
+        flow.tensor(weight, dtype=flow.float32, device=flow.device(device)),
+        stride=[1, 1, 1],
+        padding=[0, 0, 0],
+        dilation=[1, 1, 1],
+        channel_pos="channels_last",
+    )
+    np_out = np.einsum("ndhwc,oc->ndhwo", x, weight.reshape(24, 20))
+    test_case.assertTrue(np.allclose(of_out.numpy(), np_out, 1e-4, 1e-4))
+
+
 @flow.unittest.skip_unless_1n1d()
 class TestConv3DModule(flow.unittest.TestCase):
     @autotest(n=10)
@@ -42,6 +60,47 @@ class TestConv3DModule(flow.unittest.TestCase):
         y = m(x)
         return y
 
+    def test_conv3d_channels_last_1x1(test_case):
+        _test_conv3d_channels_last_1x1(test_case, "cpu")
+
+    @autotest(n=5, rtol=1e-3, atol=1e-4)
+    def test_conv3d_depth_one_with_random_data(test_case):
+        # single-depth input and kernel, the shape the cpu winograd path accepts
+        # as long as the depth is not padded
+        channels = random(16, 33)
+        m = torch.nn.Conv3d(
+            in_channels=channels,
+            out_channels=random(16, 33),
+            kernel_size=(1, 3, 3),
+            padding=oneof((0, 1, 1), (1, 1, 1), (1, 0, 0)),
+            bias=random(),
+        )
+        m.train(random())
+        m.to("cpu")
+        x = random_pytorch_tensor(
+            ndim=5, dim1=channels, dim2=1, dim3=oneof(7, 13), dim4=oneof(9, 15)
+        ).to("cpu")
+        y = m(x)
+        return y
+
+    @autotest(n=3)
+    def test_conv3d_large_batch_with_random_data(test_case):
+        # more samples than the cpu kernel has column buffers, one per thread
+        channels = random(1, 6)
+        m = torch.nn.Conv3d(
+            in_channels=channels,
+            out_channels=random(1, 6),
+            kernel_size=oneof(1, 3),
+            padding=random(0, 2).to(int),
+        )
+        m.train(random())
+        m.to("cpu")
+        x = random_pytorch_tensor(
+            ndim=5, dim0=2 * os.cpu_count() + 1, dim1=channels, dim2=3, dim3=5, dim4=5
+        ).to("cpu")
+        y = m(x)
+        return y
+
     @unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
     @autotest(n=30, check_allclose=False)
     def test_conv3d_group_with_random_data(test_case):
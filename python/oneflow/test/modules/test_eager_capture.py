@@ -0,0 +1,86 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import unittest
+from collections import OrderedDict
+
+import numpy as np
+from test_util import GenArgList
+
+import oneflow as flow
+import oneflow.unittest
+from oneflow.eager.capture import EagerCapture
+
+
+def _test_eager_capture_replay(test_case, device, shape):
+    weight = flow.tensor(
+        np.random.rand(shape[-1], 4), dtype=flow.float32, device=flow.device(device)
+    )
+
+    def step(x):
+        # the intermediate tensors are dropped inside the step
+        return flow.relu(flow.matmul(x * 2, weight) - 1)
+
+    captured_step = EagerCapture(step)
+    for _ in range(3):
+        x = flow.tensor(
+            np.random.rand(*shape), dtype=flow.float32, device=flow.device(device)
+        )
+        y = captured_step(x)
+        test_case.assertTrue(captured_step.captured)
+        test_case.assertTrue(np.allclose(y.numpy(), step(x).numpy(), 1e-4, 1e-4))
+
+
+def _test_eager_capture_recapture_on_new_shape(test_case, device, shape):
+    captured_step = EagerCapture(lambda x: x * x + 1)
+    x = flow.tensor(
+        np.random.rand(*shape), dtype=flow.float32, device=flow.device(device)
+    )
+    y = captured_step(x)
+    test_case.assertTrue(np.allclose(y.numpy(), x.numpy() ** 2 + 1, 1e-4, 1e-4))
+    new_shape = [dim * 2 for dim in shape]
+    x = flow.tensor(
+        np.random.rand(*new_shape), dtype=flow.float32, device=flow.device(device)
+    )
+    y = captured_step(x)
+    test_case.assertEqual(tuple(y.shape), tuple(new_shape))
+    test_case.assertTrue(np.allclose(y.numpy(), x.numpy() ** 2 + 1, 1e-4, 1e-4))
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestEagerCapture(flow.unittest.TestCase):
+    def test_eager_capture(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["test_fun"] = [
+            _test_eager_capture_replay,
+            _test_eager_capture_recapture_on_new_shape,
+        ]
+        arg_dict["device"] = ["cpu", "cuda"]
+        arg_dict["shape"] = [[2, 3], [1, 10]]
+        for arg in GenArgList(arg_dict):
+            arg[0](test_case, *arg[1:])
+
+    def test_capture_rejects_host_reads(test_case):
+        capture = flow._oneflow_internal.InstructionCapture()
+        x = flow.ones(2, 3)
+        capture.begin_capture()
+        x.numpy()
+        with test_case.assertRaises(Exception):
+            capture.end_capture()
+        test_case.assertFalse(capture.valid)
+
+
+if __name__ == "__main__":
+    unittest.main()
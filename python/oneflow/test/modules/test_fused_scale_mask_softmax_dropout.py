@@ -27,15 +27,15 @@ import oneflow.unittest
 
 
 def _test_fused_scale_mask_softmax_dropout(
-    test_case, batch_size, num_heads, seq_length, fill_value, scale_value, p
+    test_case, batch_size, num_heads, seq_length, fill_value, scale_value, p, device
 ):
     x = np.random.randn(batch_size, num_heads, seq_length, seq_length)
     mask = np.random.randint(
         0, 2, size=(batch_size, num_heads, seq_length, seq_length), dtype=np.uint8
     )
 
-    fused_x_tensor = flow.tensor(x).to("cuda")
-    fused_mask_tensor = flow.tensor(mask, dtype=flow.int8).to("cuda")
+    fused_x_tensor = flow.tensor(x).to(device)
+    fused_mask_tensor = flow.tensor(mask, dtype=flow.int8).to(device)
     fused_x_tensor.requires_grad = True
 
     # if mask is zero, fill it
@@ -47,8 +47,8 @@ def _test_fused_scale_mask_softmax_dropout(
         p=p,
     )[0]
 
-    origin_x_tensor = flow.tensor(x).to("cuda")
-    origin_mask_tensor = flow.tensor(mask, dtype=flow.float32).to("cuda")
+    origin_x_tensor = flow.tensor(x).to(device)
+    origin_mask_tensor = flow.tensor(mask, dtype=flow.float32).to(device)
     origin_x_tensor.requires_grad = True
     origin_out = flow.mul(
         origin_x_tensor, origin_mask_tensor
@@ -84,6 +84,24 @@ class TestFusedScaleMaskSoftmaxDropout(flow.unittest.TestCase):
         args_dict["fill_value"] = [-10000.0]
         args_dict["scale_value"] = [1.0, 2.0, 4.0]
         args_dict["p"] = [0.0, 1.0]
+        args_dict["device"] = ["cuda"]
+
+        for arg in GenArgList(args_dict):
+            arg[0](test_case, *arg[1:])
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestFusedScaleMaskSoftmaxDropoutCpu(flow.unittest.TestCase):
+    def test_fused_op(test_case):
+        args_dict = OrderedDict()
+        args_dict["test_fun"] = [_test_fused_scale_mask_softmax_dropout]
+        args_dict["batch_size"] = [2, 4]
+        args_dict["num_heads"] = [1, 4]
+        args_dict["seq_length"] = [7, 16, 33]
+        args_dict["fill_value"] = [-10000.0]
+        args_dict["scale_value"] = [1.0, 2.0]
+        args_dict["p"] = [0.0, 1.0]
+        args_dict["device"] = ["cpu"]
 
         for arg in GenArgList(args_dict):
             arg[0](test_case, *arg[1:])
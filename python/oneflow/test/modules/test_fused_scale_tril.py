@@ -86,5 +86,19 @@ class FusedScaleTrilTestCase(flow.unittest.TestCase):
             _test_fused_scale_tril(test_case, **kwargs)
 
 
+@flow.unittest.skip_unless_1n1d()
+class FusedScaleTrilCpuTestCase(flow.unittest.TestCase):
+    def test_fused_scale_tril(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["shape"] = [(5, 5), (4, 6), (2, 3, 7)]
+        arg_dict["diagonal"] = [-1, 0, 1]
+        arg_dict["fill_value"] = [-1, 0, 1]
+        arg_dict["scale"] = [-2.3, 0.7, 2]
+        arg_dict["dtype"] = [flow.float32, flow.float64]
+        arg_dict["device_type"] = ["cpu"]
+        for kwargs in GenArgDict(arg_dict):
+            _test_fused_scale_tril(test_case, **kwargs)
+
+
 if __name__ == "__main__":
     unittest.main()
@@ -26,11 +26,10 @@ import oneflow.unittest
 
 
 def _test_fused_tril_softmax_mask_scale(
-    test_case, seq_length, channel, p, diagonal, tril_scale_value
+    test_case, seq_length, channel, p, diagonal, tril_scale_value, device
 ):
     x = np.random.randn(4, seq_length, channel)
-    # fused version only support in GPU
-    fused_x_tensor = flow.Tensor(x).to("cuda")
+    fused_x_tensor = flow.Tensor(x).to(device)
     fused_x_tensor.requires_grad = True
     fused_out = flow._C.fused_scale_tril_softmax_mask_scale(
         fused_x_tensor, p=p, diagonal=diagonal, tril_scale_value=tril_scale_value
@@ -38,7 +37,7 @@ def _test_fused_tril_softmax_mask_scale(
         0
     ]  # The second output is softmax_y
 
-    origin_x_tensor = flow.Tensor(x).to("cuda")
+    origin_x_tensor = flow.Tensor(x).to(device)
     origin_x_tensor.requires_grad = True
     origin_out = flow.tril(origin_x_tensor, diagonal)
     origin_out = origin_out * tril_scale_value
@@ -72,6 +71,23 @@ class TestFusedTrilSoftmaxMaskScale(flow.unittest.TestCase):
         arg_dict["p"] = [0.0, 1.0]
         arg_dict["diagonal"] = [0, 1, 2]
         arg_dict["tril_scale_value"] = [2, 4, 10]
+        arg_dict["device"] = ["cuda"]
+
+        for arg in GenArgList(arg_dict):
+            arg[0](test_case, *arg[1:])
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestFusedTrilSoftmaxMaskScaleCpu(flow.unittest.TestCase):
+    def test_fused_tril_softmax_dropout(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["test_fun"] = [_test_fused_tril_softmax_mask_scale]
+        arg_dict["seq_length"] = [10, 20]
+        arg_dict["channel"] = [20, 30]
+        arg_dict["p"] = [0.0, 1.0]
+        arg_dict["diagonal"] = [-1, 0, 2]
+        arg_dict["tril_scale_value"] = [2, 10]
+        arg_dict["device"] = ["cpu"]
 
         for arg in GenArgList(arg_dict):
             arg[0](test_case, *arg[1:])
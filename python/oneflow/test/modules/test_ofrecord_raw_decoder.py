@@ -0,0 +1,117 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+import unittest
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+from oneflow.core.record import record_pb2
+
+
+def _gen_record(rng):
+    record = record_pb2.OFRecord()
+    record.feature["label"].int32_list.value.append(int(rng.randint(-1000, 1000)))
+    record.feature["ids"].int64_list.value.extend(
+        rng.randint(-(2 ** 40), 2 ** 40, size=4).tolist()
+    )
+    record.feature["x"].float_list.value.extend(rng.rand(3).astype(np.float32).tolist())
+    record.feature["bytes"].bytes_list.value.append(
+        rng.randint(-128, 128, size=6).astype(np.int8).tobytes()
+    )
+    record.feature["varying"].int32_list.value.extend(
+        rng.randint(-5, 5, size=rng.randint(1, 6)).tolist()
+    )
+    serialized = record.SerializeToString()
+    if rng.rand() < 0.5:
+        # a later entry of a key replaces the former one
+        override = record_pb2.OFRecord()
+        override.feature["label"].int32_list.value.append(int(rng.randint(-1000, 1000)))
+        serialized += override.SerializeToString()
+    return serialized
+
+
+def _pad_records(records):
+    # Serialized records are padded to the same length by an unknown field, which
+    # parsers skip, so that they fit in a tensor of one row per record.
+    max_len = max(len(record) for record in records) + 2
+    padded = []
+    for record in records:
+        pad_len = max_len - len(record) - 2
+        assert 0 <= pad_len < 128
+        padded.append(record + bytes([15 << 3 | 2, pad_len]) + b"\0" * pad_len)
+    return np.stack([np.frombuffer(record, dtype=np.int8) for record in padded])
+
+
+def _test_ofrecord_raw_decoder_tensor_buffer(test_case, batch_size):
+    rng = np.random.RandomState(batch_size)
+    records = [_gen_record(rng) for _ in range(batch_size)]
+    padded = _pad_records(records)
+    parsed = [record_pb2.OFRecord.FromString(record.tobytes()) for record in padded]
+    serialized = flow.tensor_to_tensor_buffer(
+        flow.tensor(padded, dtype=flow.int8), instance_dims=1
+    )
+    test_case.assertEqual(serialized.shape, flow.Size([batch_size]))
+
+    def decode(name, shape, dtype, truncate=False):
+        decoder = flow.nn.OFRecordRawDecoder(
+            name, shape=shape, dtype=dtype, truncate=truncate
+        )
+        return decoder(serialized).numpy()
+
+    label = decode("label", (), flow.int32)
+    expected_label = [record.feature["label"].int32_list.value[0] for record in parsed]
+    test_case.assertTrue(
+        np.array_equal(label, np.array(expected_label, dtype=np.int32))
+    )
+    # int32 values converted to float
+    label = decode("label", (), flow.float32)
+    test_case.assertTrue(
+        np.array_equal(label, np.array(expected_label, dtype=np.float32))
+    )
+    ids = decode("ids", (4,), flow.int64)
+    expected_ids = [list(record.feature["ids"].int64_list.value) for record in parsed]
+    test_case.assertTrue(np.array_equal(ids, np.array(expected_ids, dtype=np.int64)))
+    x = decode("x", (3,), flow.float32)
+    expected_x = [list(record.feature["x"].float_list.value) for record in parsed]
+    test_case.assertTrue(np.array_equal(x, np.array(expected_x, dtype=np.float32)))
+    x = decode("x", (3,), flow.float64)
+    test_case.assertTrue(np.array_equal(x, np.array(expected_x, dtype=np.float64)))
+    raw_bytes = decode("bytes", (6,), flow.int8)
+    expected_bytes = [
+        np.frombuffer(record.feature["bytes"].bytes_list.value[0], dtype=np.int8)
+        for record in parsed
+    ]
+    test_case.assertTrue(np.array_equal(raw_bytes, np.stack(expected_bytes)))
+    # lists shorter than the shape are padded with zeros
+    varying = decode("varying", (5,), flow.int32, truncate=True)
+    expected_varying = np.zeros((batch_size, 5), dtype=np.int32)
+    for i, record in enumerate(parsed):
+        values = record.feature["varying"].int32_list.value
+        expected_varying[i, : len(values)] = values
+    test_case.assertTrue(np.array_equal(varying, expected_varying))
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestOFRecordRawDecoder(flow.unittest.TestCase):
+    def test_ofrecord_raw_decoder_tensor_buffer(test_case):
+        for batch_size in [1, 7, 64]:
+            _test_ofrecord_raw_decoder_tensor_buffer(test_case, batch_size)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,97 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+import json
+import os
+import subprocess
+import sys
+import unittest
+
+import oneflow as flow
+import oneflow.unittest
+
+# The policy is read once when the virtual machine is created, so every case runs in a fresh
+# interpreter.
+_SCRIPT = """
+import json
+import oneflow as flow
+
+vm = flow._oneflow_internal.vm
+x = flow.ones(16, 16)
+(x + x).numpy()
+before = vm.GetSchedulerStats()
+for _ in range(100):
+    x = flow.relu(x + 1)
+x.numpy()
+after = vm.GetSchedulerStats()
+print(
+    json.dumps(
+        {
+            "policy": vm.GetSchedulerPolicy(),
+            "wakeup_cnt": [before.wakeup_cnt, after.wakeup_cnt],
+            "schedule_cnt": [before.schedule_cnt, after.schedule_cnt],
+            "spin_us": [before.spin_us, after.spin_us],
+            "max_flying_instruction_cnt": after.max_flying_instruction_cnt,
+        }
+    )
+)
+"""
+
+
+def _run_with_policy(policy):
+    env = dict(os.environ)
+    if policy is None:
+        env.pop("ONEFLOW_VM_SCHEDULER_POLICY", None)
+    else:
+        env["ONEFLOW_VM_SCHEDULER_POLICY"] = policy
+    return subprocess.run(
+        [sys.executable, "-c", _SCRIPT],
+        env=env,
+        stdout=subprocess.PIPE,
+        stderr=subprocess.PIPE,
+        universal_newlines=True,
+        timeout=300,
+    )
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestVmSchedulerPolicy(flow.unittest.TestCase):
+    def test_policies(test_case):
+        for policy, expected in [
+            (None, "latency"),
+            ("latency", "latency"),
+            ("balanced", "balanced"),
+            ("efficiency", "efficiency"),
+        ]:
+            result = _run_with_policy(policy)
+            test_case.assertEqual(result.returncode, 0, msg=result.stderr)
+            stats = json.loads(result.stdout.strip().splitlines()[-1])
+            test_case.assertEqual(stats["policy"], expected)
+            for key in ["wakeup_cnt", "schedule_cnt"]:
+                before, after = stats[key]
+                test_case.assertGreater(after, before, msg=(policy, key))
+            before, after = stats["spin_us"]
+            test_case.assertGreaterEqual(after, before, msg=policy)
+            test_case.assertGreater(stats["max_flying_instruction_cnt"], 0, msg=policy)
+
+    def test_invalid_policy(test_case):
+        result = _run_with_policy("fastest")
+        test_case.assertNotEqual(result.returncode, 0)
+        test_case.assertIn("ONEFLOW_VM_SCHEDULER_POLICY", result.stderr)
+
+
+if __name__ == "__main__":
+    unittest.main()